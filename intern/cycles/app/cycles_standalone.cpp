@@ -23,13 +23,16 @@
 #include "render/session.h"
 #include "render/integrator.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_args.h"
+#include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_function.h"
 #include "util/util_logging.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_string.h"
+#include "util/util_system.h"
 #include "util/util_time.h"
 #include "util/util_transform.h"
 #include "util/util_version.h"
@@ -51,6 +54,9 @@ struct Options {
 	SessionParams session_params;
 	bool quiet;
 	bool show_help, interactive, pause;
+	int benchmark_trials;
+	string benchmark_output;
+	string simd;
 } options;
 
 static void session_print(const string& str)
@@ -315,6 +321,192 @@ static void keyboard(unsigned char key)
 }
 #endif
 
+/* Benchmark
+ *
+ * Renders the scene a number of times in the background, loading and
+ * syncing it from scratch for each trial, and writes the time spent in the
+ * stages of each trial as JSON. */
+
+struct BenchmarkTrial {
+	double load;
+	SceneUpdateTimes update;
+	double render;
+	double total;
+	vector<double> path_trace_tiles;
+	vector<double> denoise_tiles;
+	/* Wall clock time spent denoising, overlapping with path tracing. */
+	double denoise_wall;
+};
+
+static string benchmark_simd_level()
+{
+	DebugFlags::CPU& cpu = DebugFlags().cpu;
+
+	if(cpu.avx2 && system_cpu_support_avx2())
+		return "avx2";
+	else if(cpu.avx && system_cpu_support_avx())
+		return "avx";
+	else if(cpu.sse41 && system_cpu_support_sse41())
+		return "sse41";
+	else if(cpu.sse3 && system_cpu_support_sse3())
+		return "sse3";
+	else if(cpu.sse2 && system_cpu_support_sse2())
+		return "sse2";
+
+	return "none";
+}
+
+static string benchmark_json_string(const string& str)
+{
+	string result = "\"";
+
+	foreach(char c, str) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+
+	return result + "\"";
+}
+
+static double benchmark_sum(const vector<double>& times)
+{
+	double sum = 0.0;
+	foreach(double time, times)
+		sum += time;
+	return sum;
+}
+
+static double benchmark_median(vector<double> times)
+{
+	if(times.empty())
+		return 0.0;
+
+	sort(times.begin(), times.end());
+	size_t middle = times.size()/2;
+
+	return (times.size() % 2)? times[middle]: 0.5*(times[middle - 1] + times[middle]);
+}
+
+static double benchmark_ms_per_megapixel(double time)
+{
+	double megapixels = (double)options.width*options.height*1e-6;
+	return (megapixels > 0.0)? time*1000.0/megapixels: 0.0;
+}
+
+static void benchmark_write_tiles(FILE *f, const char *name, const vector<double>& times)
+{
+	double min_time = (times.empty())? 0.0: times[0];
+	double max_time = min_time;
+
+	foreach(double time, times) {
+		min_time = min(min_time, time);
+		max_time = max(max_time, time);
+	}
+
+	fprintf(f, "      \"%s\": {\"count\": %d, \"total\": %f, \"median\": %f, \"min\": %f, \"max\": %f, \"times\": [",
+	        name, (int)times.size(), benchmark_sum(times), benchmark_median(times), min_time, max_time);
+
+	for(size_t i = 0; i < times.size(); i++)
+		fprintf(f, "%s%f", (i == 0)? "": ", ", times[i]);
+
+	fprintf(f, "]}");
+}
+
+static void benchmark_write(FILE *f, const vector<BenchmarkTrial>& trials)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"scene\": %s,\n", benchmark_json_string(options.filepath).c_str());
+	fprintf(f, "  \"version\": \"%s\",\n", CYCLES_VERSION_STRING);
+	fprintf(f, "  \"device\": %s,\n", benchmark_json_string(options.session_params.device.description).c_str());
+	fprintf(f, "  \"threads\": %d,\n", (options.session_params.threads)? options.session_params.threads: system_cpu_thread_count());
+	fprintf(f, "  \"simd\": \"%s\",\n", benchmark_simd_level().c_str());
+	fprintf(f, "  \"samples\": %d,\n", options.session_params.samples);
+	fprintf(f, "  \"width\": %d,\n", options.width);
+	fprintf(f, "  \"height\": %d,\n", options.height);
+	fprintf(f, "  \"tile_width\": %d,\n", options.session_params.tile_size.x);
+	fprintf(f, "  \"tile_height\": %d,\n", options.session_params.tile_size.y);
+	fprintf(f, "  \"trials\": [\n");
+
+	for(size_t i = 0; i < trials.size(); i++) {
+		const BenchmarkTrial& trial = trials[i];
+
+		fprintf(f, "    {\n");
+		fprintf(f, "      \"load\": %f,\n", trial.load);
+		fprintf(f, "      \"sync\": %f,\n", trial.update.total);
+		fprintf(f, "      \"shaders\": %f,\n", trial.update.shaders);
+		fprintf(f, "      \"meshes\": %f,\n", trial.update.meshes);
+		fprintf(f, "      \"bvh\": %f,\n", trial.update.bvh);
+		fprintf(f, "      \"objects\": %f,\n", trial.update.objects);
+		fprintf(f, "      \"images\": %f,\n", trial.update.images);
+		fprintf(f, "      \"lights\": %f,\n", trial.update.lights);
+		fprintf(f, "      \"render\": %f,\n", trial.render);
+		fprintf(f, "      \"total\": %f,\n", trial.total);
+		benchmark_write_tiles(f, "path_trace_tiles", trial.path_trace_tiles);
+		fprintf(f, ",\n");
+		benchmark_write_tiles(f, "denoise_tiles", trial.denoise_tiles);
+		fprintf(f, ",\n");
+		/* Denoising cost summed over all threads and as wall clock time. */
+		fprintf(f, "      \"denoise_ms_per_megapixel\": %f,\n", benchmark_ms_per_megapixel(benchmark_sum(trial.denoise_tiles)));
+		fprintf(f, "      \"denoise_wall_ms_per_megapixel\": %f", benchmark_ms_per_megapixel(trial.denoise_wall));
+		fprintf(f, "\n    }%s\n", (i + 1 < trials.size())? ",": "");
+	}
+
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+}
+
+static bool benchmark_run()
+{
+	vector<BenchmarkTrial> trials;
+
+	for(int i = 0; i < options.benchmark_trials; i++) {
+		BenchmarkTrial trial;
+		double start_time = time_dt();
+
+		scene_init();
+		trial.load = time_dt() - start_time;
+
+		session_init();
+		options.session->wait();
+
+		if(options.session->progress.get_error()) {
+			fprintf(stderr, "Benchmark failed: %s\n",
+			        options.session->progress.get_error_message().c_str());
+			session_exit();
+			return false;
+		}
+
+		trial.total = time_dt() - start_time;
+		trial.update = options.session->scene->update_times;
+		trial.render = trial.total - trial.load - trial.update.total;
+		trial.path_trace_tiles = options.session->path_trace_tile_times;
+		trial.denoise_tiles = options.session->denoise_tile_times;
+		trial.denoise_wall = options.session->denoise_end_time - options.session->denoise_start_time;
+		trials.push_back(trial);
+
+		session_exit();
+	}
+
+	FILE *f = stdout;
+
+	if(!options.benchmark_output.empty()) {
+		f = path_fopen(options.benchmark_output, "w");
+
+		if(!f) {
+			fprintf(stderr, "Failed to open benchmark output file %s\n", options.benchmark_output.c_str());
+			return false;
+		}
+	}
+
+	benchmark_write(f, trials);
+
+	if(f != stdout)
+		fclose(f);
+
+	return true;
+}
+
 static int files_parse(int argc, const char *argv[])
 {
 	if(argc > 0)
@@ -330,10 +522,14 @@ static void options_parse(int argc, const char **argv)
 	options.filepath = "";
 	options.session = NULL;
 	options.quiet = false;
+	options.benchmark_trials = 0;
+	options.benchmark_output = "";
+	options.simd = "";
 
 	/* device names */
 	string device_names = "";
 	string devicename = "CPU";
+	string servers = "";
 	bool list = false;
 
 	vector<DeviceType>& types = Device::available_types();
@@ -361,6 +557,9 @@ static void options_parse(int argc, const char **argv)
 	ap.options ("Usage: cycles [options] file.xml",
 		"%*", files_parse, "",
 		"--device %s", &devicename, ("Devices to use: " + device_names).c_str(),
+#ifdef WITH_NETWORK
+		"--servers %s", &servers, "Comma separated render servers (host, host:port or [ipv6]:port) for the NETWORK device",
+#endif
 #ifdef WITH_OSL
 		"--shadingsys %s", &ssname, "Shading system to use: svm, osl",
 #endif
@@ -373,6 +572,14 @@ static void options_parse(int argc, const char **argv)
 		"--height %d", &options.height, "Window height in pixel",
 		"--tile-width %d", &options.session_params.tile_size.x, "Tile width in pixels",
 		"--tile-height %d", &options.session_params.tile_size.y, "Tile height in pixels",
+		"--texture-cache %d", &options.scene_params.texture_cache_size, "Texture cache size in megabytes (CPU only, 0 loads all images)",
+		"--bvh-cache", &options.scene_params.use_bvh_cache, "Cache built BVHs on disk and reuse them for identical geometry",
+		"--bvh-cache-size %d", &options.scene_params.bvh_cache_size, "BVH disk cache size in megabytes, least recently used are removed first (0 for no limit)",
+		"--image-cache", &options.scene_params.use_image_cache, "Cache decoded images on disk and map them in later renders",
+		"--image-cache-size %d", &options.scene_params.image_cache_size, "Image disk cache size in megabytes, least recently used are removed first (0 for no limit)",
+		"--simd %s", &options.simd, "Highest instruction set for CPU kernels: sse2, sse3, sse41, avx, avx2",
+		"--benchmark %d", &options.benchmark_trials, "Render the scene this number of times in background and print timings as JSON",
+		"--benchmark-output %s", &options.benchmark_output, "File path to write benchmark timings to instead of standard output",
 		"--list-devices", &list, "List information about all available devices",
 #ifdef WITH_CYCLES_LOGGING
 		"--debug", &debug, "Enable debug logging",
@@ -424,8 +631,36 @@ static void options_parse(int argc, const char **argv)
 	options.session_params.background = true;
 #endif
 
-	/* Use progressive rendering */
-	options.session_params.progressive = true;
+	if(options.simd != "") {
+		const char *levels[] = {"sse2", "sse3", "sse41", "avx", "avx2"};
+		bool *flags[] = {&DebugFlags().cpu.sse2, &DebugFlags().cpu.sse3, &DebugFlags().cpu.sse41,
+		                 &DebugFlags().cpu.avx, &DebugFlags().cpu.avx2};
+		int num_levels = sizeof(levels)/sizeof(*levels);
+		int level = 0;
+
+		while(level < num_levels && options.simd != levels[level])
+			level++;
+
+		if(level == num_levels) {
+			fprintf(stderr, "Unknown instruction set: %s\n", options.simd.c_str());
+			exit(EXIT_FAILURE);
+		}
+
+		for(int i = 0; i < num_levels; i++)
+			*flags[i] = (i <= level);
+	}
+
+	if(options.benchmark_trials) {
+		/* Render every tile once with all samples, without progress
+		 * messages mixing with the timings. */
+		options.session_params.background = true;
+		options.session_params.progressive = false;
+		options.quiet = true;
+	}
+	else {
+		/* Use progressive rendering */
+		options.session_params.progressive = true;
+	}
 
 	/* find matching device */
 	DeviceType device_type = Device::type_from_string(devicename.c_str());
@@ -441,6 +676,24 @@ static void options_parse(int argc, const char **argv)
 		}
 	}
 
+#ifdef WITH_NETWORK
+	/* render on the given servers, tiles are distributed between them */
+	if(device_type == DEVICE_NETWORK && servers != "") {
+		vector<string> addresses;
+		vector<DeviceInfo> subdevices;
+
+		string_split(addresses, servers, ",");
+
+		foreach(string& address, addresses)
+			subdevices.push_back(Device::get_network_device(address));
+
+		if(subdevices.size() == 1)
+			options.session_params.device = subdevices[0];
+		else if(subdevices.size() > 1)
+			options.session_params.device = Device::get_multi_device(subdevices);
+	}
+#endif
+
 	/* handle invalid configurations */
 	if(options.session_params.device.type == DEVICE_NONE || !device_available) {
 		fprintf(stderr, "Unknown device: %s\n", devicename.c_str());
@@ -460,6 +713,14 @@ static void options_parse(int argc, const char **argv)
 		fprintf(stderr, "Invalid number of samples: %d\n", options.session_params.samples);
 		exit(EXIT_FAILURE);
 	}
+	else if(options.benchmark_trials < 0) {
+		fprintf(stderr, "Invalid number of benchmark trials: %d\n", options.benchmark_trials);
+		exit(EXIT_FAILURE);
+	}
+	else if(options.benchmark_trials && options.session_params.samples == INT_MAX) {
+		fprintf(stderr, "Benchmark needs a fixed number of samples\n");
+		exit(EXIT_FAILURE);
+	}
 	else if(options.filepath == "") {
 		fprintf(stderr, "No file path specified\n");
 		exit(EXIT_FAILURE);
@@ -468,8 +729,9 @@ static void options_parse(int argc, const char **argv)
 	/* For smoother Viewport */
 	options.session_params.start_resolution = 64;
 
-	/* load scene */
-	scene_init();
+	/* load scene, benchmarks load it for every trial */
+	if(!options.benchmark_trials)
+		scene_init();
 }
 
 CCL_NAMESPACE_END
@@ -482,6 +744,9 @@ int main(int argc, const char **argv)
 	path_init();
 	options_parse(argc, argv);
 
+	if(options.benchmark_trials)
+		return (benchmark_run())? 0: 1;
+
 #ifdef WITH_CYCLES_STANDALONE_GUI
 	if(options.session_params.background) {
 #endif
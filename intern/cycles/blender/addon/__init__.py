@@ -83,7 +83,13 @@ class CyclesRender(bpy.types.RenderEngine):
         engine.render(self)
 
     def bake(self, scene, obj, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result):
-        engine.bake(self, obj, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result)
+        engine.bake(self, obj, (pass_type,), pass_filter, object_id, pixel_array, num_pixels, depth, result)
+
+    def bake_passes(self, scene, obj, pass_types, pass_filter, object_id, pixel_array, num_pixels, depth, result):
+        # results are expected in order of the pass values
+        items = bpy.types.RenderEngine.bl_rna.functions["bake_passes"].parameters["pass_types"].enum_items
+        pass_types = sorted(pass_types, key=lambda pass_type: items[pass_type].value)
+        engine.bake(self, obj, pass_types, pass_filter, object_id, pixel_array, num_pixels, depth, result)
 
     # viewport render
     def view_update(self, context):
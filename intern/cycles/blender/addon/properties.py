@@ -140,6 +140,15 @@ enum_texture_limit = (
     ('8192', "8192", "Limit texture size to 8192 pixels", 7),
     )
 
+enum_pass_storage = (
+    ('FLOAT', "Float", "Store passes in full precision", 0),
+    ('HALF', "Half", "Store the average of samples as half float, using half the memory or less", 1),
+    )
+
+enum_index_pass_storage = enum_pass_storage + (
+    ('BYTE', "8-bit", "Store index passes in a single byte, for indices up to 255", 2),
+    )
+
 class CyclesRenderSettings(bpy.types.PropertyGroup):
     @classmethod
     def register(cls):
@@ -290,6 +299,33 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0.0, max=1.0,
                 default=0.01,
                 )
+        cls.use_light_tree = BoolProperty(
+                name="Light Tree",
+                description="Pick lights using a tree that takes their distance and orientation into account, "
+                            "reduces noise in scenes with many lamps and mesh lights",
+                default=False,
+                )
+
+        cls.use_adaptive_sampling = BoolProperty(
+                name="Adaptive Sampling",
+                description="Stop sampling pixels once their noise is below the threshold, "
+                            "only used for final renders without progressive refine",
+                default=False,
+                )
+        cls.adaptive_threshold = FloatProperty(
+                name="Adaptive Threshold",
+                description="Noise level at which a pixel is considered converged, "
+                            "lower values give less noise but longer render times",
+                min=0.0, max=1.0,
+                default=0.01,
+                precision=4,
+                )
+        cls.adaptive_min_samples = IntProperty(
+                name="Adaptive Min Samples",
+                description="Minimum number of samples a pixel receives before convergence is tested",
+                min=0, max=4096,
+                default=16,
+                )
 
         cls.caustics_reflective = BoolProperty(
                 name="Reflective Caustics",
@@ -388,6 +424,13 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=2, max=65536
                 )
 
+        cls.volume_skip_empty = BoolProperty(
+                name="Skip Empty Space",
+                description="Don't evaluate volume shaders where all smoke grids of the object are empty, "
+                            "assuming the shader has no density there (CPU only, requires Sparse Volumes)",
+                default=False,
+                )
+
         cls.dicing_rate = FloatProperty(
                 name="Dicing Rate",
                 description="Size of a micropolygon in pixels",
@@ -409,6 +452,20 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 min=0, max=16,
                 default=12,
                 )
+        cls.offscreen_dicing_scale = FloatProperty(
+                name="Offscreen Scale",
+                description="Multiplier for dicing rate of geometry outside of the camera view, increasing with the "
+                            "distance from the view",
+                min=1.0, soft_max=25.0,
+                default=4.0,
+                )
+        cls.micropolygon_budget = IntProperty(
+                name="Micropolygon Budget",
+                description="Maximum number of micropolygons in millions adaptive subdivision creates for the whole "
+                            "scene, dicing rates are increased to fit (0 for unlimited)",
+                min=0, max=100000,
+                default=0,
+                )
 
         cls.film_exposure = FloatProperty(
                 name="Exposure",
@@ -534,6 +591,44 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
                 default=0,
                 min=0, max=16,
                 )
+        cls.use_bvh_cache = BoolProperty(
+                name="Cache BVH",
+                description="Cache built BVHs on disk and reuse them for final renders of identical geometry",
+                default=False,
+                )
+        cls.bvh_cache_size = IntProperty(
+                name="BVH Cache Size",
+                description="Maximum disk space in megabytes for cached BVHs, least recently used ones "
+                            "are removed first (0 for no limit)",
+                min=0, max=1048576,
+                default=4096,
+                )
+        cls.use_image_cache = BoolProperty(
+                name="Cache Images",
+                description="Cache decoded image textures on disk and map them in final renders, "
+                            "instead of decoding the image files again",
+                default=False,
+                )
+        cls.image_cache_size = IntProperty(
+                name="Image Cache Size",
+                description="Maximum disk space in megabytes for cached images, least recently used ones "
+                            "are removed first (0 for no limit)",
+                min=0, max=1048576,
+                default=8192,
+                )
+        cls.checkpoint_directory = StringProperty(
+                name="Checkpoint Directory",
+                description="Directory to periodically save render progress in, so that an interrupted background "
+                            "render continues where it stopped (checkpoints of a changed scene are ignored)",
+                subtype='DIR_PATH',
+                default="",
+                )
+        cls.checkpoint_interval = FloatProperty(
+                name="Checkpoint Interval",
+                description="Time in seconds between saving render checkpoints",
+                min=1.0, max=86400.0,
+                default=300.0,
+                )
         cls.tile_order = EnumProperty(
                 name="Tile Order",
                 description="Tile order for rendering",
@@ -638,6 +733,26 @@ class CyclesRenderSettings(bpy.types.PropertyGroup):
             items=enum_texture_limit
             )
 
+        cls.texture_cache_size = IntProperty(
+            name="Texture Cache Size",
+            description="Maximum memory in megabytes for image textures read on demand from files, "
+                        "instead of loading all images into memory (CPU only, 0 disables the cache)",
+            min=0, max=1048576,
+            default=0,
+            )
+        cls.use_sparse_volumes = BoolProperty(
+            name="Sparse Volumes",
+            description="Store smoke and fire grids in tiles, leaving out empty regions, "
+                        "to reduce memory usage (CPU only)",
+            default=False,
+            )
+        cls.use_packet_traversal = BoolProperty(
+            name="Packet Traversal",
+            description="Trace camera rays of neighboring pixels and shadow rays to all lights "
+                        "together as ray packets (CPU only)",
+            default=False,
+            )
+
         cls.ao_bounces = IntProperty(
             name="AO Bounces",
             default=0,
@@ -1161,6 +1276,12 @@ class CyclesCurveRenderSettings(bpy.types.PropertyGroup):
                 min=0, max=24,
                 default=4,
                 )
+        cls.use_compact_keys = BoolProperty(
+                name="Compact Keys",
+                description="Store strand keys with 16 bit precision relative to their strand, "
+                            "using half the memory",
+                default=True,
+                )
 
     @classmethod
     def unregister(cls):
@@ -1195,6 +1316,25 @@ class CyclesRenderLayerSettings(bpy.types.PropertyGroup):
                 default=False,
                 )
 
+        cls.pass_storage_data = EnumProperty(
+                name="Data Pass Storage",
+                description="Storage of the Z, mist, normal and UV passes in the render buffers",
+                items=enum_pass_storage,
+                default='FLOAT',
+                )
+        cls.pass_storage_index = EnumProperty(
+                name="Index Pass Storage",
+                description="Storage of the object and material index passes in the render buffers",
+                items=enum_index_pass_storage,
+                default='FLOAT',
+                )
+        cls.pass_storage_light = EnumProperty(
+                name="Light Pass Storage",
+                description="Storage of the light, color, shadow and AO passes in the render buffers",
+                items=enum_pass_storage,
+                default='FLOAT',
+                )
+
         cls.use_denoising = BoolProperty(
                 name="Use Denoising",
                 description="Denoise the rendered image",
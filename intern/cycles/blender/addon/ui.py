@@ -172,6 +172,7 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
         sub.prop(cscene, "sample_clamp_direct")
         sub.prop(cscene, "sample_clamp_indirect")
         sub.prop(cscene, "light_sampling_threshold")
+        sub.prop(cscene, "use_light_tree")
 
         if cscene.progressive == 'PATH' or use_branched_path(context) is False:
             col = split.column()
@@ -205,6 +206,13 @@ class CyclesRender_PT_sampling(CyclesButtonsPanel, Panel):
 
         layout.row().prop(cscene, "sampling_pattern", text="Pattern")
 
+        row = layout.row(align=True)
+        row.prop(cscene, "use_adaptive_sampling", text="Adaptive")
+        sub = row.row(align=True)
+        sub.active = cscene.use_adaptive_sampling
+        sub.prop(cscene, "adaptive_threshold", text="Threshold")
+        sub.prop(cscene, "adaptive_min_samples", text="Min Samples")
+
         for rl in scene.render.layers:
             if rl.samples > 0:
                 layout.separator()
@@ -234,6 +242,7 @@ class CyclesRender_PT_geometry(CyclesButtonsPanel, Panel):
             sub.label("Volume Sampling:")
             sub.prop(cscene, "volume_step_size")
             sub.prop(cscene, "volume_max_steps")
+            sub.prop(cscene, "volume_skip_empty")
 
             col = split.column()
 
@@ -243,12 +252,16 @@ class CyclesRender_PT_geometry(CyclesButtonsPanel, Panel):
             sub.prop(cscene, "preview_dicing_rate", text="Preview")
             sub.separator()
             sub.prop(cscene, "max_subdivisions")
+            sub.prop(cscene, "offscreen_dicing_scale")
+            sub.prop(cscene, "micropolygon_budget")
         else:
             row = layout.row()
             row.label("Volume Sampling:")
             row = layout.row()
             row.prop(cscene, "volume_step_size")
             row.prop(cscene, "volume_max_steps")
+            row = layout.row()
+            row.prop(cscene, "volume_skip_empty")
 
         layout.prop(ccscene, "use_curves", text="Use Hair")
         col = layout.column()
@@ -265,6 +278,9 @@ class CyclesRender_PT_geometry(CyclesButtonsPanel, Panel):
         elif ccscene.primitive == 'CURVE_SEGMENTS':
             col.prop(ccscene, "subdivisions", text="Curve subdivisions")
 
+        if ccscene.primitive != 'TRIANGLES':
+            col.prop(ccscene, "use_compact_keys")
+
         row = col.row()
         row.prop(ccscene, "minimum_width", text="Min Pixels")
         row.prop(ccscene, "maximum_width", text="Max Extension")
@@ -421,7 +437,27 @@ class CyclesRender_PT_performance(CyclesButtonsPanel, Panel):
         col.separator()
 
         col.label(text="Final Render:")
-        col.prop(rd, "use_persistent_data", text="Persistent Images")
+        col.prop(rd, "use_persistent_data", text="Persistent Data")
+        col.prop(cscene, "use_bvh_cache")
+        sub = col.column()
+        sub.active = cscene.use_bvh_cache
+        sub.prop(cscene, "bvh_cache_size", text="BVH Cache (MB)")
+        col.prop(cscene, "use_image_cache")
+        sub = col.column()
+        sub.active = cscene.use_image_cache
+        sub.prop(cscene, "image_cache_size", text="Image Cache (MB)")
+        col.prop(cscene, "checkpoint_directory", text="")
+        sub = col.column()
+        sub.active = bool(cscene.checkpoint_directory)
+        sub.prop(cscene, "checkpoint_interval", text="Checkpoint Interval")
+
+        col.separator()
+
+        sub = col.column()
+        sub.active = use_cpu(context)
+        sub.prop(cscene, "texture_cache_size", text="Texture Cache (MB)")
+        sub.prop(cscene, "use_sparse_volumes")
+        sub.prop(cscene, "use_packet_traversal")
 
         col.separator()
 
@@ -530,6 +566,12 @@ class CyclesRender_PT_layer_passes(CyclesButtonsPanel, Panel):
         col.prop(rl, "use_pass_emit", text="Emission")
         col.prop(rl, "use_pass_environment")
 
+        col.separator()
+        col.label(text="Storage:")
+        col.prop(crl, "pass_storage_data", text="Data")
+        col.prop(crl, "pass_storage_index", text="Index")
+        col.prop(crl, "pass_storage_light", text="Light")
+
         if context.scene.cycles.feature_set == 'EXPERIMENTAL':
            col.separator()
            sub = col.column()
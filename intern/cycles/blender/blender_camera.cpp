@@ -80,6 +80,8 @@ struct BlenderCamera {
 	BoundBox2D pano_viewplane;
 	BoundBox2D viewport_camera_border;
 
+	float offscreen_dicing_scale;
+
 	Transform matrix;
 };
 
@@ -104,6 +106,7 @@ static void blender_camera_init(BlenderCamera *bcam,
 	bcam->pano_viewplane.top = 1.0f;
 	bcam->viewport_camera_border.right = 1.0f;
 	bcam->viewport_camera_border.top = 1.0f;
+	bcam->offscreen_dicing_scale = 1.0f;
 
 	/* render resolution */
 	bcam->full_width = render_resolution_x(b_render);
@@ -466,6 +469,9 @@ static void blender_camera_sync(Camera *cam, BlenderCamera *bcam, int width, int
 	cam->border = bcam->border;
 	cam->viewport_camera_border = bcam->viewport_camera_border;
 
+	/* dicing */
+	cam->offscreen_dicing_scale = bcam->offscreen_dicing_scale;
+
 	/* set update flag */
 	if(cam->modified(prevcam))
 		cam->tag_update();
@@ -501,6 +507,7 @@ void BlenderSync::sync_camera(BL::RenderSettings& b_render,
 		                                     Camera::ROLLING_SHUTTER_NUM_TYPES,
 		                                     Camera::ROLLING_SHUTTER_NONE);
 	bcam.rolling_shutter_duration = RNA_float_get(&cscene, "rolling_shutter_duration");
+	bcam.offscreen_dicing_scale = RNA_float_get(&cscene, "offscreen_dicing_scale");
 
 	/* border */
 	if(b_render.use_border()) {
@@ -811,6 +818,8 @@ void BlenderSync::sync_view(BL::SpaceView3D& b_v3d,
 	                      b_v3d,
 	                      b_rv3d,
 	                      width, height);
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
+	bcam.offscreen_dicing_scale = RNA_float_get(&cscene, "offscreen_dicing_scale");
 	blender_camera_sync(scene->camera, &bcam, width, height, "");
 }
 
@@ -31,6 +31,7 @@
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_md5.h"
 
 #include "mikktspace.h"
 
@@ -901,13 +902,65 @@ static void create_subd_mesh(Scene *scene,
 	sdparams.dicing_rate = max(0.1f, RNA_float_get(&cobj, "dicing_rate") * dicing_rate);
 	sdparams.max_level = max_subdivisions;
 
-	scene->camera->update();
 	sdparams.camera = scene->camera;
 	sdparams.objecttoworld = get_transform(b_ob.matrix_world());
 }
 
 /* Sync */
 
+struct BlenderSync::MeshSyncData {
+	MeshSyncData(BL::Object& b_ob, Mesh *mesh)
+	: b_ob(b_ob), b_mesh(PointerRNA_NULL), mesh(mesh),
+	  hide_tris(false), can_free_caches(false),
+	  requested_geometry_flags(Mesh::GEOMETRY_NONE),
+	  use_motion_blur(mesh->use_motion_blur),
+	  motion_steps(mesh->motion_steps)
+	{}
+
+	BL::Object b_ob;
+	BL::Mesh b_mesh;
+	Mesh *mesh;
+	bool hide_tris;
+	bool can_free_caches;
+	int requested_geometry_flags;
+
+	/* Motion blur settings from objects using the mesh, the conversion task
+	 * sizes attributes from them so they are applied once it is done. */
+	bool use_motion_blur;
+	uint motion_steps;
+
+	array<int> oldtriangle;
+	array<float3> oldcurve_keys;
+	array<float> oldcurve_radius;
+
+	/* Hash of the mesh before the sync, to detect meshes which were tagged
+	 * but did not change. Empty when not checked. */
+	string oldhash;
+};
+
+/* Hash of all mesh data written by the sync, used with persistent data where
+ * meshes are resynchronized every frame when they may be deformed. */
+static string mesh_content_hash(const Mesh *mesh)
+{
+	MD5Hash md5;
+	mesh->hash_values(md5);
+
+	foreach(Shader *shader, mesh->used_shaders)
+		md5.append((const uint8_t*)&shader, sizeof(shader));
+
+	const AttributeSet *sets[2] = {&mesh->attributes, &mesh->curve_attributes};
+	for(int i = 0; i < 2; i++) {
+		foreach(const Attribute& attr, sets[i]->attributes) {
+			md5.append((const uint8_t*)attr.name.c_str(), attr.name.size());
+			md5.append((const uint8_t*)&attr.std, sizeof(attr.std));
+			if(attr.buffer.size())
+				md5.append((const uint8_t*)&attr.buffer[0], attr.buffer.size());
+		}
+	}
+
+	return md5.get_hex();
+}
+
 static void sync_mesh_fluid_motion(BL::Object& b_ob, Scene *scene, Mesh *mesh)
 {
 	if(scene->need_motion() == Scene::MOTION_NONE)
@@ -1021,12 +1074,27 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	mesh_synced.insert(mesh);
 
 	/* create derived mesh */
-	array<int> oldtriangle = mesh->triangles;
+	MeshSyncData *data = new MeshSyncData(b_ob, mesh);
+	data->hide_tris = hide_tris;
+	data->can_free_caches = can_free_caches;
+	data->requested_geometry_flags = requested_geometry_flags;
+	data->oldtriangle = mesh->triangles;
 	
 	/* compares curve_keys rather than strands in order to handle quick hair
 	 * adjustments in dynamic BVH - other methods could probably do this better*/
-	array<float3> oldcurve_keys = mesh->curve_keys;
-	array<float> oldcurve_radius = mesh->curve_radius;
+	data->oldcurve_keys = mesh->curve_keys;
+	data->oldcurve_radius = mesh->curve_radius;
+
+	/* Only meshes which are up to date on the device can be skipped. With
+	 * the object transform applied the mesh data is no longer in object
+	 * space, so it can't be compared with a new sync. */
+	if(scene->params.persistent_data && !preview &&
+	   !mesh->need_update && !mesh->transform_applied &&
+	   mesh->subdivision_type == Mesh::SUBDIVISION_NONE &&
+	   mesh->geometry_flags == requested_geometry_flags)
+	{
+		data->oldhash = mesh_content_hash(mesh);
+	}
 
 	mesh->clear();
 	mesh->used_shaders = used_shaders;
@@ -1053,43 +1121,98 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 			mesh->subdivision_type = Mesh::SUBDIVISION_NONE;
 		}
 
-		BL::Mesh b_mesh = object_to_mesh(b_data,
-		                                 b_ob,
-		                                 b_scene,
-		                                 true,
-		                                 !preview,
-		                                 need_undeformed,
-		                                 mesh->subdivision_type);
-
-		if(b_mesh) {
-			if(render_layer.use_surfaces && !hide_tris) {
-				if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
-					create_subd_mesh(scene, mesh, b_ob, b_mesh, used_shaders,
-					                 dicing_rate, max_subdivisions);
-				else
-					create_mesh(scene, mesh, b_mesh, used_shaders, false);
+		/* Evaluating the derived mesh adds it to the blend data, so this
+		 * has to happen here rather than in the conversion task. */
+		data->b_mesh = object_to_mesh(b_data,
+		                              b_ob,
+		                              b_scene,
+		                              true,
+		                              !preview,
+		                              need_undeformed,
+		                              mesh->subdivision_type);
+
+		if(data->b_mesh && render_layer.use_surfaces && !hide_tris) {
+			/* Subdivision parameters reference the camera, make sure it is
+			 * updated before any of the tasks read it. */
+			if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
+				scene->camera->update();
+
+			mesh_sync_pool.push(function_bind(&BlenderSync::sync_mesh_convert, this, data));
+		}
+	}
 
-				create_mesh_volume_attributes(scene, b_ob, mesh, b_scene.frame_current());
-			}
+	/* Objects test this to see if they need an update, tagging the mesh
+	 * itself happens once its data is finished. This includes meshes which
+	 * may turn out unchanged, so their objects still sync motion blur. */
+	mesh->need_update = true;
 
-			if(render_layer.use_hair && mesh->subdivision_type == Mesh::SUBDIVISION_NONE)
-				sync_curves(mesh, b_mesh, b_ob, false);
+	mesh_sync_pending.push_back(data);
 
-			if(can_free_caches) {
-				b_ob.cache_release();
-			}
+	/* Every pending mesh keeps its derived Blender mesh alive, finish
+	 * them in batches to keep peak memory usage bounded. */
+	if(mesh_sync_pending.size() >= (size_t)max(TaskScheduler::num_threads(), 1) * 4)
+		sync_meshes_wait();
+
+	return mesh;
+}
+
+void BlenderSync::sync_mesh_convert(MeshSyncData *data)
+{
+	Mesh *mesh = data->mesh;
+
+	/* Only reads from the derived Blender mesh and writes to the Cycles mesh
+	 * owned by this task, anything touching shared scene data is done in
+	 * sync_mesh_finish(). */
+	if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE)
+		create_subd_mesh(scene, mesh, data->b_ob, data->b_mesh, mesh->used_shaders,
+		                 dicing_rate, max_subdivisions);
+	else
+		create_mesh(scene, mesh, data->b_mesh, mesh->used_shaders, false);
+}
 
-			/* free derived mesh */
-			b_data.meshes.remove(b_mesh, false);
+void BlenderSync::sync_mesh_finish(MeshSyncData *data)
+{
+	BL::Object& b_ob = data->b_ob;
+	BL::Mesh& b_mesh = data->b_mesh;
+	Mesh *mesh = data->mesh;
+
+	if(b_mesh) {
+		if(render_layer.use_surfaces && !data->hide_tris)
+			create_mesh_volume_attributes(scene, b_ob, mesh, b_scene.frame_current());
+
+		if(render_layer.use_hair && mesh->subdivision_type == Mesh::SUBDIVISION_NONE)
+			sync_curves(mesh, b_mesh, b_ob, false);
+
+		if(data->can_free_caches) {
+			b_ob.cache_release();
 		}
+
+		/* free derived mesh */
+		b_data.meshes.remove(b_mesh, false);
 	}
-	mesh->geometry_flags = requested_geometry_flags;
+	mesh->geometry_flags = data->requested_geometry_flags;
+	mesh->use_motion_blur = data->use_motion_blur;
+	mesh->motion_steps = data->motion_steps;
 
 	/* fluid motion */
 	sync_mesh_fluid_motion(b_ob, scene, mesh);
 
+	/* meshes without any change, for example deformed meshes on frames
+	 * without animation, keep their device data */
+	if(!data->oldhash.empty() &&
+	   mesh->subdivision_type == Mesh::SUBDIVISION_NONE &&
+	   data->oldhash == mesh_content_hash(mesh))
+	{
+		mesh->need_update = false;
+		num_meshes_unchanged++;
+		return;
+	}
+
 	/* tag update */
 	bool rebuild = false;
+	array<int>& oldtriangle = data->oldtriangle;
+	array<float3>& oldcurve_keys = data->oldcurve_keys;
+	array<float>& oldcurve_radius = data->oldcurve_radius;
 
 	if(oldtriangle.size() != mesh->triangles.size())
 		rebuild = true;
@@ -1113,8 +1236,42 @@ Mesh *BlenderSync::sync_mesh(BL::Object& b_ob,
 	}
 	
 	mesh->tag_update(scene, rebuild);
+}
 
-	return mesh;
+void BlenderSync::sync_mesh_motion_blur(Mesh *mesh,
+                                        bool use_motion_blur,
+                                        uint motion_steps)
+{
+	/* Conversion of the mesh may still be running, defer to sync_mesh_finish().
+	 * Only a few batches of meshes are pending at a time, so a linear lookup
+	 * is fine. */
+	foreach(MeshSyncData *data, mesh_sync_pending) {
+		if(data->mesh == mesh) {
+			data->use_motion_blur = use_motion_blur;
+			data->motion_steps = motion_steps;
+			return;
+		}
+	}
+
+	mesh->use_motion_blur = use_motion_blur;
+	mesh->motion_steps = motion_steps;
+}
+
+void BlenderSync::sync_meshes_wait()
+{
+	if(mesh_sync_pending.empty())
+		return;
+
+	mesh_sync_pool.wait_work();
+
+	/* finish in the order meshes were synced, so the result does not depend
+	 * on the order in which the tasks happened to run */
+	foreach(MeshSyncData *data, mesh_sync_pending) {
+		sync_mesh_finish(data);
+		delete data;
+	}
+
+	mesh_sync_pending.clear();
 }
 
 void BlenderSync::sync_mesh_motion(BL::Object& b_ob,
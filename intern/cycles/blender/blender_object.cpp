@@ -247,10 +247,11 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
                                  bool *use_portal)
 {
 	BL::Object b_ob = (b_dupli_ob ? b_dupli_ob.object() : b_parent);
+	InstanceSource& source = instance_source(b_ob);
 	bool motion = motion_time != 0.0f;
 	
 	/* light is handled separately */
-	if(object_is_light(b_ob)) {
+	if(source.is_light) {
 		/* don't use lamps for excluded layers used as mask layer */
 		if(!motion && !((layer_flag & render_layer.holdout_layer) && (layer_flag & render_layer.exclude_layer)))
 			sync_light(b_parent, persistent_id, b_ob, tfm, use_portal);
@@ -259,7 +260,7 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 	}
 
 	/* only interested in object that we can create meshes from */
-	if(!object_is_mesh(b_ob)) {
+	if(!source.is_mesh) {
 		return NULL;
 	}
 
@@ -310,8 +311,12 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 	
 	bool use_holdout = (layer_flag & render_layer.holdout_layer) != 0;
 	
-	/* mesh sync */
-	object->mesh = sync_mesh(b_ob, object_updated, hide_tris);
+	/* mesh sync, once for all instances unless the mesh has a transform
+	 * applied that needs to be undone */
+	if(!source.mesh || (object_updated && source.mesh->transform_applied)) {
+		source.mesh = sync_mesh(b_ob, object_updated, hide_tris);
+	}
+	object->mesh = source.mesh;
 
 	/* special case not tracked by object update flags */
 
@@ -323,9 +328,9 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 	}
 
 	/* visibility flags for both parent and child */
-	uint visibility = object_ray_visibility(b_ob) & PATH_RAY_ALL_VISIBILITY;
+	uint visibility = source.visibility & PATH_RAY_ALL_VISIBILITY;
 	if(b_parent.ptr.data != b_ob.ptr.data) {
-		visibility &= object_ray_visibility(b_parent);
+		visibility &= instance_source(b_parent).visibility;
 	}
 
 	/* make holdout objects on excluded layer invisible for non-camera rays */
@@ -343,19 +348,22 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 		object_updated = true;
 	}
 
-	PointerRNA cobject = RNA_pointer_get(&b_ob.ptr, "cycles");
-	bool is_shadow_catcher = get_boolean(cobject, "is_shadow_catcher");
-	if(is_shadow_catcher != object->is_shadow_catcher) {
-		object->is_shadow_catcher = is_shadow_catcher;
+	if(source.is_shadow_catcher != object->is_shadow_catcher) {
+		object->is_shadow_catcher = source.is_shadow_catcher;
 		object_updated = true;
 	}
 
+	/* resynchronized meshes may already have cleared their update tag when
+	 * they turned out unchanged, objects still need to sync motion blur */
+	bool mesh_updated = object->mesh && (object->mesh->need_update ||
+	                                     mesh_synced.find(object->mesh) != mesh_synced.end());
+
 	/* object sync
 	 * transform comparison should not be needed, but duplis don't work perfect
 	 * in the depsgraph and may not signal changes, so this is a workaround */
-	if(object_updated || (object->mesh && object->mesh->need_update) || tfm != object->tfm) {
-		object->name = b_ob.name().c_str();
-		object->pass_id = b_ob.pass_index();
+	if(object_updated || mesh_updated || tfm != object->tfm) {
+		object->name = source.name;
+		object->pass_id = source.pass_id;
 		object->tfm = tfm;
 		object->motion.pre = transform_empty();
 		object->motion.post = transform_empty();
@@ -364,19 +372,21 @@ Object *BlenderSync::sync_object(BL::Object& b_parent,
 		/* motion blur */
 		if(scene->need_motion() == Scene::MOTION_BLUR && object->mesh) {
 			Mesh *mesh = object->mesh;
-
-			mesh->use_motion_blur = false;
+			bool use_motion_blur = false;
+			uint motion_steps = mesh->motion_steps;
 
 			if(object_use_motion(b_parent, b_ob)) {
 				if(object_use_deform_motion(b_parent, b_ob)) {
-					mesh->motion_steps = object_motion_steps(b_ob);
-					mesh->use_motion_blur = true;
+					motion_steps = object_motion_steps(b_ob);
+					use_motion_blur = true;
 				}
 
 				vector<float> times = object->motion_times();
 				foreach(float time, times)
 					motion_times.insert(time);
 			}
+
+			sync_mesh_motion_blur(mesh, use_motion_blur, motion_steps);
 		}
 
 		/* dupli texture coordinates and random_id */
@@ -476,6 +486,125 @@ static bool object_render_hide_duplis(BL::Object& b_ob)
 	return (parent && object_render_hide_original(b_ob.type(), parent.dupli_type()));
 }
 
+/* Instance Sources */
+
+BlenderSync::InstanceSource& BlenderSync::instance_source(BL::Object& b_ob)
+{
+	map<void*, InstanceSource>::iterator it = instance_sources.find(b_ob.ptr.data);
+
+	if(it != instance_sources.end()) {
+		return it->second;
+	}
+
+	InstanceSource& source = instance_sources[b_ob.ptr.data];
+	PointerRNA cobject = RNA_pointer_get(&b_ob.ptr, "cycles");
+
+	source.is_light = object_is_light(b_ob);
+	source.is_mesh = object_is_mesh(b_ob);
+	source.visibility = object_ray_visibility(b_ob);
+	source.is_shadow_catcher = get_boolean(cobject, "is_shadow_catcher");
+	source.pass_id = b_ob.pass_index();
+	source.name = ustring(b_ob.name().c_str());
+	source.mesh = NULL;
+
+	for(int i = 0; i < 2; i++) {
+		source.dupli_hide_valid[i] = false;
+		source.dupli_hide[i] = false;
+		source.dupli_hide_tris[i] = false;
+	}
+
+	return source;
+}
+
+bool BlenderSync::instance_render_hide(BL::Object& b_dup_ob,
+                                       bool in_dupli_group,
+                                       bool& hide_tris)
+{
+	InstanceSource& source = instance_source(b_dup_ob);
+	const int i = in_dupli_group;
+
+	if(!source.dupli_hide_valid[i]) {
+		bool dup_hide = (render_layer.use_viewport_visibility)? b_dup_ob.hide(): b_dup_ob.hide_render();
+
+		source.dupli_hide[i] = dup_hide ||
+		                       object_render_hide(b_dup_ob,
+		                                          false,
+		                                          in_dupli_group,
+		                                          source.dupli_hide_tris[i]);
+		source.dupli_hide_valid[i] = true;
+	}
+
+	hide_tris = source.dupli_hide_tris[i];
+	return source.dupli_hide[i];
+}
+
+/* Compact Instances */
+
+bool BlenderSync::dupli_use_instances(BL::Object& b_parent,
+                                      BL::Object& b_ob,
+                                      Object *object)
+{
+	/* instances have no motion or particle data of their own */
+	Scene::MotionType need_motion = scene->need_motion();
+
+	if(need_motion == Scene::MOTION_PASS)
+		return false;
+	if(need_motion == Scene::MOTION_BLUR && object_use_motion(b_parent, b_ob))
+		return false;
+	if(object->mesh->need_attribute(scene, ATTR_STD_PARTICLE))
+		return false;
+
+	return true;
+}
+
+void BlenderSync::sync_dupli_instance(DupliPrototype& prototype,
+                                      BL::Object& b_ob,
+                                      BL::DupliObject& b_dup,
+                                      Transform& tfm,
+                                      BlenderObjectCulling& culling)
+{
+	if(culling.test(scene, b_ob, tfm)) {
+		return;
+	}
+
+	ObjectInstance instance;
+	instance.tfm = tfm;
+	instance.dupli_generated = 0.5f*get_float3(b_dup.orco()) - make_float3(0.5f, 0.5f, 0.5f);
+	instance.dupli_uv = get_float2(b_dup.uv());
+	instance.random_id = b_dup.random_id();
+
+	/* overwrite the instances of the previous sync in place, to detect
+	 * changes without keeping a copy around */
+	vector<ObjectInstance>& instances = prototype.object->instances;
+
+	if(prototype.num_instances < instances.size()) {
+		if(!(instances[prototype.num_instances] == instance)) {
+			instances[prototype.num_instances] = instance;
+			prototype.instances_updated = true;
+		}
+	}
+	else {
+		instances.push_back(instance);
+		prototype.instances_updated = true;
+	}
+
+	prototype.num_instances++;
+}
+
+void BlenderSync::sync_dupli_instances_finish(DupliPrototype& prototype)
+{
+	vector<ObjectInstance>& instances = prototype.object->instances;
+
+	if(prototype.num_instances != instances.size()) {
+		instances.resize(prototype.num_instances);
+		prototype.instances_updated = true;
+	}
+
+	if(prototype.instances_updated) {
+		prototype.object->tag_update(scene);
+	}
+}
+
 /* Object Loop */
 
 void BlenderSync::sync_objects(float motion_time)
@@ -496,6 +625,8 @@ void BlenderSync::sync_objects(float motion_time)
 		mesh_motion_synced.clear();
 	}
 
+	instance_sources.clear();
+
 	/* initialize culling */
 	BlenderObjectCulling culling(scene, b_scene);
 
@@ -537,15 +668,27 @@ void BlenderSync::sync_objects(float motion_time)
 					b_ob.dupli_list_create(b_scene, dupli_settings);
 
 					BL::Object::dupli_list_iterator b_dup;
+					map<void*, DupliPrototype> dupli_prototypes;
 
 					for(b_ob.dupli_list.begin(b_dup); b_dup != b_ob.dupli_list.end(); ++b_dup) {
 						Transform tfm = get_transform(b_dup->matrix());
 						BL::Object b_dup_ob = b_dup->object();
-						bool dup_hide = (render_layer.use_viewport_visibility)? b_dup_ob.hide(): b_dup_ob.hide_render();
 						bool in_dupli_group = (b_dup->type() == BL::DupliObject::type_GROUP);
 						bool hide_tris;
 
-						if(!(b_dup->hide() || dup_hide || object_render_hide(b_dup_ob, false, in_dupli_group, hide_tris))) {
+						if(!(b_dup->hide() || instance_render_hide(b_dup_ob, in_dupli_group, hide_tris))) {
+							/* later duplis of the same source object are compact
+							 * instances of the first one where possible */
+							map<void*, DupliPrototype>::iterator it = dupli_prototypes.find(b_dup_ob.ptr.data);
+							DupliPrototype *prototype = (it != dupli_prototypes.end())? &it->second: NULL;
+
+							if(prototype && prototype->use_instances) {
+								if(!motion) {
+									sync_dupli_instance(*prototype, b_dup_ob, *b_dup, tfm, culling);
+								}
+								continue;
+							}
+
 							/* the persistent_id allows us to match dupli objects
 							 * between frames and updates */
 							BL::Array<int, OBJECT_PERSISTENT_ID_SIZE> persistent_id = b_dup->persistent_id();
@@ -567,6 +710,37 @@ void BlenderSync::sync_objects(float motion_time)
 								sync_dupli_particle(b_ob, *b_dup, object);
 							}
 
+							if(!object) {
+								continue;
+							}
+
+							if(!prototype) {
+								DupliPrototype& new_prototype = dupli_prototypes[b_dup_ob.ptr.data];
+								new_prototype.object = object;
+								new_prototype.use_instances = dupli_use_instances(b_ob, b_dup_ob, object);
+								new_prototype.num_instances = 0;
+								new_prototype.instances_updated = false;
+
+								/* instances need the mesh in object space, like a
+								 * new object sharing the mesh */
+								if(new_prototype.use_instances && !motion && object->mesh->transform_applied) {
+									InstanceSource& source = instance_source(b_dup_ob);
+									source.mesh = sync_mesh(b_dup_ob, true, hide_tris);
+									object->mesh = source.mesh;
+								}
+							}
+							else if(!motion && !object->instances.empty()) {
+								/* was a prototype in the previous sync */
+								object->instances.clear();
+								object->tag_update(scene);
+							}
+						}
+					}
+
+					if(!motion) {
+						map<void*, DupliPrototype>::iterator it;
+						for(it = dupli_prototypes.begin(); it != dupli_prototypes.end(); it++) {
+							sync_dupli_instances_finish(it->second);
 						}
 					}
 
@@ -596,6 +770,11 @@ void BlenderSync::sync_objects(float motion_time)
 		}
 	}
 
+	/* finish meshes converted in parallel, also when cancelled since they
+	 * hold on to derived meshes in the blend data */
+	if(!motion)
+		sync_meshes_wait();
+
 	progress.set_sync_status("");
 
 	if(!cancel && !motion) {
@@ -292,14 +292,21 @@ static PyObject *render_func(PyObject * /*self*/, PyObject *value)
 /* pixel_array and result passed as pointers */
 static PyObject *bake_func(PyObject * /*self*/, PyObject *args)
 {
-	PyObject *pysession, *pyobject;
+	PyObject *pysession, *pyobject, *pypass_types;
 	PyObject *pypixel_array, *pyresult;
-	const char *pass_type;
 	int num_pixels, depth, object_id, pass_filter;
 
-	if(!PyArg_ParseTuple(args, "OOsiiOiiO", &pysession, &pyobject, &pass_type, &pass_filter, &object_id, &pypixel_array, &num_pixels, &depth, &pyresult))
+	if(!PyArg_ParseTuple(args, "OOO!iiOiiO", &pysession, &pyobject, &PyTuple_Type, &pypass_types, &pass_filter, &object_id, &pypixel_array, &num_pixels, &depth, &pyresult))
 		return NULL;
 
+	vector<string> pass_types;
+	for(Py_ssize_t i = 0; i < PyTuple_GET_SIZE(pypass_types); i++) {
+		const char *pass_type = _PyUnicode_AsString(PyTuple_GET_ITEM(pypass_types, i));
+		if(pass_type == NULL)
+			return NULL;
+		pass_types.push_back(pass_type);
+	}
+
 	BlenderSession *session = (BlenderSession*)PyLong_AsVoidPtr(pysession);
 
 	PointerRNA objectptr;
@@ -314,7 +321,7 @@ static PyObject *bake_func(PyObject * /*self*/, PyObject *args)
 
 	python_thread_state_save(&session->python_thread_state);
 
-	session->bake(b_object, pass_type, pass_filter, object_id, b_bake_pixel, (size_t)num_pixels, depth, (float *)b_result);
+	session->bake(b_object, pass_types, pass_filter, object_id, b_bake_pixel, (size_t)num_pixels, depth, (float *)b_result);
 
 	python_thread_state_restore(&session->python_thread_state);
 
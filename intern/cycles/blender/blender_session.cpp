@@ -193,6 +193,9 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 		 * them rather than trying to distinguish which settings need to be updated
 		 */
 
+		delete sync;
+		sync = NULL;
+
 		delete session;
 
 		create_session();
@@ -210,8 +213,12 @@ void BlenderSession::reset_session(BL::BlendData& b_data_, BL::Scene& b_scene_)
 	 */
 	session->stats.mem_peak = session->stats.mem_used;
 
-	/* sync object should be re-created */
-	sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress, is_cpu);
+	/* with persistent data the sync object and scene data are kept from the
+	 * previous render, so only changes have to be synchronized */
+	if(sync)
+		sync->reset(b_data, b_scene);
+	else
+		sync = new BlenderSync(b_engine, b_data, b_scene, scene, !background, session->progress, is_cpu);
 
 	/* for final render we will do full data sync per render layer, only
 	 * do some basic syncing here, no objects or materials for speed */
@@ -376,6 +383,7 @@ void BlenderSession::render()
 	/* get buffer parameters */
 	SessionParams session_params = BlenderSync::get_session_params(b_engine, b_userpref, b_scene, background);
 	BufferParams buffer_params = BlenderSync::get_buffer_params(b_render, b_v3d, b_rv3d, scene->camera, width, height);
+	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
 
 	/* render each layer */
 	BL::RenderSettings r = b_scene.render();
@@ -431,6 +439,13 @@ void BlenderSession::render()
 		session->params.denoising_feature_strength = get_float(crl, "denoising_feature_strength");
 		session->params.denoising_relative_pca = get_boolean(crl, "denoising_relative_pca");
 
+		/* adaptive sampling rescales converged pixels once a tile is done,
+		 * so it can't be combined with progressive refine */
+		bool use_adaptive_sampling = !session_params.progressive_refine &&
+		                             get_boolean(cscene, "use_adaptive_sampling");
+		buffer_params.adaptive_sampling_pass = use_adaptive_sampling;
+		scene->film->adaptive_sampling_pass = use_adaptive_sampling;
+
 		scene->film->pass_alpha_threshold = b_layer_iter->pass_alpha_threshold();
 		scene->film->tag_passes_update(scene, passes);
 		scene->film->tag_update(scene);
@@ -472,6 +487,21 @@ void BlenderSession::render()
 			/* Update tile manager if we're doing resumable render. */
 			update_resumable_tile_manager(effective_layer_samples);
 
+			/* Checkpoint file for this frame, layer and view. Only for
+			 * background renders, interactive ones are cancelled on purpose
+			 * rather than interrupted. */
+			string checkpoint_directory = get_string(cscene, "checkpoint_directory");
+			if(background && !checkpoint_directory.empty()) {
+				string filename = string_printf("%s_%04d_%s_%s.ckpt",
+				                                b_scene.name().c_str(),
+				                                b_scene.frame_current(),
+				                                b_rlay_name.c_str(),
+				                                b_rview_name.c_str());
+				session->params.checkpoint_path = path_join(blender_absolute_path(b_data, b_scene, checkpoint_directory),
+				                                            filename);
+				session->params.checkpoint_interval = (double)get_float(cscene, "checkpoint_interval");
+			}
+
 			/* Update session itself. */
 			session->reset(buffer_params, effective_layer_samples);
 
@@ -500,13 +530,16 @@ void BlenderSession::render()
 	session->update_render_tile_cb = function_null;
 
 	/* free all memory used (host and device), so we wouldn't leave render
-	 * engine with extra memory allocated
+	 * engine with extra memory allocated. with persistent data host side
+	 * scene data is kept for the next render.
 	 */
 
 	session->device_free();
 
-	delete sync;
-	sync = NULL;
+	if(!scene->params.persistent_data) {
+		delete sync;
+		sync = NULL;
+	}
 }
 
 static void populate_bake_data(BakeData *data, const
@@ -555,16 +588,43 @@ static int bake_pass_filter_get(const int pass_filter)
 	return flag;
 }
 
+static void bake_write_result(float *result,
+                              const size_t num_pixels,
+                              const int depth,
+                              BakeData *bake_data,
+                              int pass,
+                              const float *pass_result)
+{
+	float *out = result + pass * num_pixels * depth;
+	const int num_channels = min(depth, 4);
+
+	for(size_t i = 0; i < bake_data->size(); i++) {
+		if(bake_data->is_valid(i)) {
+			for(int j = 0; j < num_channels; j++) {
+				out[i*depth + j] = pass_result[i*4 + j];
+			}
+		}
+	}
+}
+
 void BlenderSession::bake(BL::Object& b_object,
-                          const string& pass_type,
+                          const vector<string>& pass_types,
                           const int pass_filter,
                           const int object_id,
                           BL::BakePixel& pixel_array,
                           const size_t num_pixels,
-                          const int /*depth*/,
+                          const int depth,
                           float result[])
 {
-	ShaderEvalType shader_type = get_shader_type(pass_type);
+	vector<BakePass> passes;
+
+	foreach(const string& pass_type, pass_types) {
+		ShaderEvalType shader_type = get_shader_type(pass_type);
+		int bake_pass_filter = bake_pass_filter_get(pass_filter);
+		bake_pass_filter = BakeManager::shader_type_to_pass_filter(shader_type, bake_pass_filter);
+
+		passes.push_back(BakePass(shader_type, bake_pass_filter));
+	}
 
 	/* Set baking flag in advance, so kernel loading can check if we need
 	 * any baking capabilities.
@@ -574,17 +634,16 @@ void BlenderSession::bake(BL::Object& b_object,
 	/* ensure kernels are loaded before we do any scene updates */
 	session->load_kernels();
 
-	if(shader_type == SHADER_EVAL_UV) {
-		/* force UV to be available */
-		Pass::add(PASS_UV, scene->film->passes);
-	}
-
-	int bake_pass_filter = bake_pass_filter_get(pass_filter);
-	bake_pass_filter = BakeManager::shader_type_to_pass_filter(shader_type, bake_pass_filter);
+	foreach(const BakePass& pass, passes) {
+		if(pass.type == SHADER_EVAL_UV) {
+			/* force UV to be available */
+			Pass::add(PASS_UV, scene->film->passes);
+		}
 
-	/* force use_light_pass to be true if we bake more than just colors */
-	if(bake_pass_filter & ~BAKE_FILTER_COLOR) {
-		Pass::add(PASS_LIGHT, scene->film->passes);
+		/* force use_light_pass to be true if we bake more than just colors */
+		if(pass.pass_filter & ~BAKE_FILTER_COLOR) {
+			Pass::add(PASS_LIGHT, scene->film->passes);
+		}
 	}
 
 	/* create device and update scene */
@@ -644,7 +703,12 @@ void BlenderSession::bake(BL::Object& b_object,
 
 	/* Perform bake. Check cancel to avoid crash with incomplete scene data. */
 	if(!session->progress.get_cancel()) {
-		scene->bake_manager->bake(scene->device, &scene->dscene, scene, session->progress, shader_type, bake_pass_filter, bake_data, result);
+		/* all passes are evaluated in the same sweep over the pixels */
+		vector<BakeData*> objects(1, bake_data);
+
+		scene->bake_manager->bake_batch(scene->device, &scene->dscene, scene, session->progress,
+		                                passes, objects,
+		                                function_bind(&bake_write_result, result, num_pixels, depth, _1, _2, _3));
 	}
 
 	/* free all memory used (host and device), so we wouldn't leave render
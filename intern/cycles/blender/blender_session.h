@@ -60,8 +60,9 @@ public:
 	/* offline render */
 	void render();
 
+	/* Bake all passes in one go, the result holds one pass after the other. */
 	void bake(BL::Object& b_object,
-	          const string& pass_type,
+	          const vector<string>& pass_types,
 	          const int custom_flag,
 	          const int object_id,
 	          BL::BakePixel& pixel_array,
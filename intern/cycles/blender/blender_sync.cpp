@@ -37,6 +37,7 @@
 #include "util/util_foreach.h"
 #include "util/util_opengl.h"
 #include "util/util_hash.h"
+#include "util/util_logging.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -57,6 +58,7 @@ BlenderSync::BlenderSync(BL::RenderEngine& b_engine,
   mesh_map(&scene->meshes),
   light_map(&scene->lights),
   particle_system_map(&scene->particle_systems),
+  num_meshes_unchanged(0),
   world_map(NULL),
   world_recalc(false),
   scene(scene),
@@ -65,17 +67,140 @@ BlenderSync::BlenderSync(BL::RenderEngine& b_engine,
   is_cpu(is_cpu),
   dicing_rate(1.0f),
   max_subdivisions(12),
+  offscreen_dicing_scale(1.0f),
   progress(progress)
 {
 	PointerRNA cscene = RNA_pointer_get(&b_scene.ptr, "cycles");
 	dicing_rate = preview ? RNA_float_get(&cscene, "preview_dicing_rate") : RNA_float_get(&cscene, "dicing_rate");
 	max_subdivisions = RNA_int_get(&cscene, "max_subdivisions");
+	offscreen_dicing_scale = RNA_float_get(&cscene, "offscreen_dicing_scale");
 }
 
 BlenderSync::~BlenderSync()
 {
 }
 
+/* Node trees which can change between frames without being tagged, through
+ * animation or image sequences and movies. */
+static bool node_tree_is_time_dependent(BL::NodeTree& b_ntree)
+{
+	if(!b_ntree)
+		return false;
+	if(b_ntree.animation_data())
+		return true;
+
+	BL::NodeTree::nodes_iterator b_node;
+	for(b_ntree.nodes.begin(b_node); b_node != b_ntree.nodes.end(); ++b_node) {
+		BL::Image b_image(PointerRNA_NULL);
+
+		if(b_node->is_a(&RNA_ShaderNodeTexImage))
+			b_image = BL::ShaderNodeTexImage(*b_node).image();
+		else if(b_node->is_a(&RNA_ShaderNodeTexEnvironment))
+			b_image = BL::ShaderNodeTexEnvironment(*b_node).image();
+		else if(b_node->is_a(&RNA_ShaderNodeGroup)) {
+			BL::NodeTree b_group_ntree(((BL::NodeGroup)(*b_node)).node_tree());
+			if(node_tree_is_time_dependent(b_group_ntree))
+				return true;
+		}
+
+		if(b_image && (b_image.source() == BL::Image::source_SEQUENCE ||
+		               b_image.source() == BL::Image::source_MOVIE))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BlenderSync::reset(BL::BlendData& b_data, BL::Scene& b_scene)
+{
+	/* Used with persistent data, where the synchronized scene is kept between
+	 * frames of a final render. The frame change clears the depsgraph tags
+	 * before the render starts, so only data which can change over time is
+	 * tagged here. Meshes whose contents turn out unchanged are not updated
+	 * on the device. */
+	this->b_data = b_data;
+	this->b_scene = b_scene;
+
+	int num_shaders = 0, num_objects = 0, num_meshes = 0, num_lights = 0, num_particles = 0;
+
+	BL::BlendData::materials_iterator b_mat;
+	for(b_data.materials.begin(b_mat); b_mat != b_data.materials.end(); ++b_mat) {
+		BL::NodeTree b_ntree(b_mat->node_tree());
+		Shader *shader = shader_map.find(*b_mat);
+
+		if(b_mat->animation_data() || node_tree_is_time_dependent(b_ntree) ||
+		   (shader != NULL && shader->has_object_dependency))
+		{
+			shader_map.set_recalc(*b_mat);
+			num_shaders++;
+		}
+	}
+
+	BL::BlendData::lamps_iterator b_lamp;
+	for(b_data.lamps.begin(b_lamp); b_lamp != b_data.lamps.end(); ++b_lamp) {
+		BL::NodeTree b_ntree(b_lamp->node_tree());
+		if(b_lamp->animation_data() || node_tree_is_time_dependent(b_ntree)) {
+			shader_map.set_recalc(*b_lamp);
+			num_shaders++;
+		}
+	}
+
+	BL::BlendData::objects_iterator b_ob;
+	for(b_data.objects.begin(b_ob); b_ob != b_data.objects.end(); ++b_ob) {
+		if(object_is_mesh(*b_ob)) {
+			/* Objects with animation, parents or constraints can change their
+			 * transform and animated properties like the pass index. */
+			if(b_ob->animation_data() || b_ob->parent() || b_ob->constraints.length()) {
+				object_map.set_recalc(*b_ob);
+				num_objects++;
+			}
+
+			/* Any modifier can depend on time or on other objects, not only
+			 * deforming ones, so all modified meshes are resynchronized. The
+			 * content hash in sync_mesh() skips the unchanged ones. Meshes
+			 * with the object transform applied hold world space positions
+			 * and always need a resync. */
+			BL::ID key = BKE_object_is_modified(*b_ob)? *b_ob: b_ob->data();
+			Mesh *mesh = mesh_map.find(key);
+
+			if(b_ob->type() == BL::Object::type_META ||
+			   ccl::BKE_object_is_modified(*b_ob, b_scene, preview) ||
+			   (mesh != NULL && mesh->transform_applied))
+			{
+				mesh_map.set_recalc(key);
+				num_meshes++;
+			}
+		}
+		else if(object_is_light(*b_ob)) {
+			/* Unlike objects, lights only take their transform on recalc. */
+			light_map.set_recalc(*b_ob);
+			num_lights++;
+		}
+
+		if(b_ob->particle_systems.length()) {
+			particle_system_map.set_recalc(*b_ob);
+			num_particles++;
+		}
+	}
+
+	BL::World b_world = b_scene.world();
+	if(b_world) {
+		BL::NodeTree b_ntree(b_world.node_tree());
+		if(b_world.animation_data() || node_tree_is_time_dependent(b_ntree) ||
+		   scene->default_background->has_object_dependency)
+		{
+			world_recalc = true;
+		}
+	}
+
+	VLOG(1) << "Tagged for recalc: " << num_shaders << " shaders, "
+	        << num_objects << " objects, " << num_meshes << " meshes, " << num_lights << " lights, "
+	        << num_particles << " particle objects"
+	        << (world_recalc? ", world.": ".");
+}
+
 /* Sync */
 
 bool BlenderSync::sync_recalc()
@@ -122,6 +247,13 @@ bool BlenderSync::sync_recalc()
 			max_subdivisions = updated_max_subdivisions;
 			dicing_prop_changed = true;
 		}
+
+		float updated_offscreen_dicing_scale = RNA_float_get(&cscene, "offscreen_dicing_scale");
+
+		if(offscreen_dicing_scale != updated_offscreen_dicing_scale) {
+			offscreen_dicing_scale = updated_offscreen_dicing_scale;
+			dicing_prop_changed = true;
+		}
 	}
 
 	BL::BlendData::objects_iterator b_ob;
@@ -217,6 +349,12 @@ void BlenderSync::sync_data(BL::RenderSettings& b_render,
 	            width, height,
 	            python_thread_state);
 
+	if(scene->params.persistent_data) {
+		VLOG(1) << "Synchronized " << mesh_synced.size() << " meshes, "
+		        << num_meshes_unchanged << " of them unchanged.";
+	}
+	num_meshes_unchanged = 0;
+
 	mesh_synced.clear();
 }
 
@@ -248,6 +386,7 @@ void BlenderSync::sync_integrator()
 
 	integrator->volume_max_steps = get_int(cscene, "volume_max_steps");
 	integrator->volume_step_size = get_float(cscene, "volume_step_size");
+	integrator->volume_skip_empty = get_boolean(cscene, "volume_skip_empty");
 
 	integrator->caustics_reflective = get_boolean(cscene, "caustics_reflective");
 	integrator->caustics_refractive = get_boolean(cscene, "caustics_refractive");
@@ -293,6 +432,17 @@ void BlenderSync::sync_integrator()
 	integrator->sample_all_lights_direct = get_boolean(cscene, "sample_all_lights_direct");
 	integrator->sample_all_lights_indirect = get_boolean(cscene, "sample_all_lights_indirect");
 	integrator->light_sampling_threshold = get_float(cscene, "light_sampling_threshold");
+	integrator->use_light_tree = get_boolean(cscene, "use_light_tree");
+	integrator->use_packet_traversal = get_boolean(cscene, "use_packet_traversal");
+
+	if(get_boolean(cscene, "use_adaptive_sampling")) {
+		integrator->adaptive_threshold = get_float(cscene, "adaptive_threshold");
+		integrator->adaptive_min_samples = get_int(cscene, "adaptive_min_samples");
+	}
+	else {
+		integrator->adaptive_threshold = 0.0f;
+		integrator->adaptive_min_samples = 0;
+	}
 
 	int diffuse_samples = get_int(cscene, "diffuse_samples");
 	int glossy_samples = get_int(cscene, "glossy_samples");
@@ -549,12 +699,27 @@ int BlenderSync::get_denoising_pass(BL::RenderPass& b_pass)
 	return -1;
 }
 
+PassStorage BlenderSync::get_pass_storage(PointerRNA& crp, PassType type)
+{
+	const char *name = "pass_storage_light";
+
+	if(type & (PASS_DEPTH|PASS_MIST|PASS_NORMAL|PASS_UV))
+		name = "pass_storage_data";
+	else if(type & (PASS_OBJECT_ID|PASS_MATERIAL_ID))
+		name = "pass_storage_index";
+
+	/* Unsupported storage falls back to float in Pass::add. */
+	return (PassStorage)get_enum(crp, name, 3, PASS_STORAGE_FLOAT);
+}
+
 array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
                                             BL::SceneRenderLayer& b_srlay)
 {
 	array<Pass> passes;
 	Pass::add(PASS_COMBINED, passes);
 
+	PointerRNA crp = RNA_pointer_get(&b_srlay.ptr, "cycles");
+
 	/* loop over passes */
 	BL::RenderLayer::passes_iterator b_pass_iter;
 
@@ -565,10 +730,9 @@ array<Pass> BlenderSync::sync_render_passes(BL::RenderLayer& b_rlay,
 		if(pass_type == PASS_MOTION && scene->integrator->motion_blur)
 			continue;
 		if(pass_type != PASS_NONE)
-			Pass::add(pass_type, passes);
+			Pass::add(pass_type, passes, get_pass_storage(crp, pass_type));
 	}
 
-	PointerRNA crp = RNA_pointer_get(&b_srlay.ptr, "cycles");
 	if(get_boolean(crp, "denoising_store_passes")) {
 		b_engine.add_pass("Denoising Normal",          3, "XYZ", b_srlay.name().c_str());
 		b_engine.add_pass("Denoising Normal Variance", 3, "XYZ", b_srlay.name().c_str());
@@ -633,6 +797,10 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 	params.use_bvh_spatial_split = RNA_boolean_get(&cscene, "debug_use_spatial_splits");
 	params.use_bvh_unaligned_nodes = RNA_boolean_get(&cscene, "debug_use_hair_bvh");
 	params.num_bvh_time_steps = RNA_int_get(&cscene, "debug_bvh_time_steps");
+	params.use_bvh_cache = background && RNA_boolean_get(&cscene, "use_bvh_cache");
+	params.bvh_cache_size = RNA_int_get(&cscene, "bvh_cache_size");
+	params.use_image_cache = background && RNA_boolean_get(&cscene, "use_image_cache");
+	params.image_cache_size = RNA_int_get(&cscene, "image_cache_size");
 
 	if(background && params.shadingsystem != SHADINGSYSTEM_OSL)
 		params.persistent_data = r.use_persistent_data();
@@ -653,6 +821,19 @@ SceneParams BlenderSync::get_scene_params(BL::Scene& b_scene,
 		params.texture_limit = 0;
 	}
 
+	/* Texture cache is only supported by the CPU device. */
+	if(is_cpu) {
+		params.texture_cache_size = RNA_int_get(&cscene, "texture_cache_size");
+	}
+	else {
+		params.texture_cache_size = 0;
+	}
+
+	/* Sparse volume grids are only supported by the CPU device. */
+	params.use_sparse_volumes = is_cpu && get_boolean(cscene, "use_sparse_volumes");
+
+	params.micropolygon_budget = RNA_int_get(&cscene, "micropolygon_budget");
+
 #if !(defined(__GNUC__) && (defined(i386) || defined(_M_IX86)))
 	if(is_cpu) {
 		params.use_qbvh = DebugFlags().cpu.qbvh && system_cpu_support_sse2();
@@ -29,6 +29,7 @@
 
 #include "util/util_map.h"
 #include "util/util_set.h"
+#include "util/util_task.h"
 #include "util/util_transform.h"
 #include "util/util_vector.h"
 
@@ -58,6 +59,8 @@ public:
 	            bool is_cpu);
 	~BlenderSync();
 
+	void reset(BL::BlendData& b_data, BL::Scene& b_scene);
+
 	/* sync */
 	bool sync_recalc();
 	void sync_data(BL::RenderSettings& b_render,
@@ -97,6 +100,7 @@ public:
 
 	static PassType get_pass_type(BL::RenderPass& b_pass);
 	static int get_denoising_pass(BL::RenderPass& b_pass);
+	static PassStorage get_pass_storage(PointerRNA& crp, PassType type);
 
 private:
 	/* sync */
@@ -115,6 +119,11 @@ private:
 
 	void sync_nodes(Shader *shader, BL::ShaderNodeTree& b_ntree);
 	Mesh *sync_mesh(BL::Object& b_ob, bool object_updated, bool hide_tris);
+	struct MeshSyncData;
+	void sync_mesh_convert(MeshSyncData *data);
+	void sync_mesh_finish(MeshSyncData *data);
+	void sync_mesh_motion_blur(Mesh *mesh, bool use_motion_blur, uint motion_steps);
+	void sync_meshes_wait();
 	void sync_curves(Mesh *mesh,
 	                 BL::Mesh& b_mesh,
 	                 BL::Object& b_ob,
@@ -143,6 +152,45 @@ private:
 	                        int width, int height,
 	                        float motion_time);
 
+	/* Data of a source object shared by all of its instances. */
+	struct InstanceSource {
+		bool is_light;
+		bool is_mesh;
+		uint visibility;
+		bool is_shadow_catcher;
+		int pass_id;
+		ustring name;
+		/* Synced mesh, NULL until the first instance is synced. */
+		Mesh *mesh;
+		/* Render visibility as dupli, indexed by being in a dupli group. */
+		bool dupli_hide_valid[2];
+		bool dupli_hide[2];
+		bool dupli_hide_tris[2];
+	};
+	InstanceSource& instance_source(BL::Object& b_ob);
+	bool instance_render_hide(BL::Object& b_dup_ob,
+	                          bool in_dupli_group,
+	                          bool& hide_tris);
+
+	/* Object synced for the first dupli of a source object in a dupli list,
+	 * later duplis of the same source may become its compact instances. */
+	struct DupliPrototype {
+		Object *object;
+		bool use_instances;
+		/* Instances synced so far, and whether any of them changed. */
+		size_t num_instances;
+		bool instances_updated;
+	};
+	bool dupli_use_instances(BL::Object& b_parent,
+	                         BL::Object& b_ob,
+	                         Object *object);
+	void sync_dupli_instance(DupliPrototype& prototype,
+	                         BL::Object& b_ob,
+	                         BL::DupliObject& b_dup,
+	                         Transform& tfm,
+	                         BlenderObjectCulling& culling);
+	void sync_dupli_instances_finish(DupliPrototype& prototype);
+
 	/* particles */
 	bool sync_dupli_particle(BL::Object& b_ob,
 	                         BL::DupliObject& b_dup,
@@ -169,6 +217,16 @@ private:
 	id_map<ParticleSystemKey, ParticleSystem> particle_system_map;
 	set<Mesh*> mesh_synced;
 	set<Mesh*> mesh_motion_synced;
+	/* Looked up once per object sync, so instancing millions of duplis of
+	 * the same object only does per-instance RNA access for the dupli
+	 * itself. */
+	map<void*, InstanceSource> instance_sources;
+	/* Meshes being converted in parallel by sync_mesh(), finished in sync
+	 * order by sync_meshes_wait(). */
+	TaskPool mesh_sync_pool;
+	vector<MeshSyncData*> mesh_sync_pending;
+	/* Meshes resynchronized with persistent data which turned out unchanged. */
+	int num_meshes_unchanged;
 	set<float> motion_times;
 	void *world_map;
 	bool world_recalc;
@@ -180,6 +238,7 @@ private:
 
 	float dicing_rate;
 	int max_subdivisions;
+	float offscreen_dicing_scale;
 
 	struct RenderLayerInfo {
 		RenderLayerInfo()
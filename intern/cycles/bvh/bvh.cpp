@@ -26,6 +26,10 @@
 #include "bvh/bvh_node.h"
 
 #include "util/util_foreach.h"
+#include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
+#include "util/util_path.h"
 #include "util/util_progress.h"
 
 CCL_NAMESPACE_BEGIN
@@ -45,8 +49,13 @@ int BVHStackEntry::encodeIdx() const
 /* BVH */
 
 BVH::BVH(const BVHParams& params_, const vector<Object*>& objects_)
-: params(params_), objects(objects_)
+: params(params_), objects(objects_), num_objects(objects_.size())
 {
+	if(params.top_level) {
+		foreach(Object *ob, objects_) {
+			objects.insert(objects.end(), ob->instances.size(), ob);
+		}
+	}
 }
 
 BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
@@ -61,10 +70,21 @@ BVH *BVH::create(const BVHParams& params, const vector<Object*>& objects)
 
 void BVH::build(Progress& progress)
 {
+	string key;
+
+	if(params.use_cache) {
+		progress.set_substatus("Looking in BVH cache");
+		key = cache_key();
+
+		if(cache_read(key))
+			return;
+	}
+
 	progress.set_substatus("Building BVH");
 
 	/* build nodes */
 	BVHBuild bvh_build(objects,
+	                   num_objects,
 	                   pack.prim_type,
 	                   pack.prim_index,
 	                   pack.prim_object,
@@ -93,6 +113,235 @@ void BVH::build(Progress& progress)
 
 	/* free build nodes */
 	root->deleteSubtree();
+
+	if(params.use_cache) {
+		progress.set_substatus("Writing BVH cache");
+		cache_write(key);
+	}
+}
+
+/* Cache
+ *
+ * Packed BVH arrays are stored in a file named after an MD5 hash of all data
+ * which goes into the build: build parameters, object transforms and
+ * visibility, and mesh geometry. Rendering the same static geometry again,
+ * for example in a later shot, then only costs reading the file. Files are
+ * touched when read, and the least recently used are removed once the cache
+ * grows beyond its size limit. */
+
+#define BVH_CACHE_VERSION 1
+
+template<typename T>
+static void cache_hash_array(MD5Hash& md5, const array<T>& data)
+{
+	size_t size = data.size();
+	md5.append((const uint8_t*)&size, sizeof(size));
+	if(size)
+		md5.append((const uint8_t*)data.data(), sizeof(T)*size);
+}
+
+template<typename T>
+static void cache_hash_value(MD5Hash& md5, const T& value)
+{
+	md5.append((const uint8_t*)&value, sizeof(T));
+}
+
+static void cache_hash_attribute(MD5Hash& md5, AttributeSet& attributes)
+{
+	Attribute *attr = attributes.find(ATTR_STD_MOTION_VERTEX_POSITION);
+	size_t size = (attr)? attr->buffer.size(): 0;
+
+	cache_hash_value(md5, size);
+	if(size)
+		md5.append((const uint8_t*)attr->data(), size);
+}
+
+string BVH::cache_key()
+{
+	MD5Hash md5;
+
+	cache_hash_value(md5, (int)BVH_CACHE_VERSION);
+
+	/* build parameters, hashed field by field to avoid padding bytes */
+	cache_hash_value(md5, params.use_spatial_split);
+	cache_hash_value(md5, params.spatial_split_alpha);
+	cache_hash_value(md5, params.unaligned_split_threshold);
+	cache_hash_value(md5, params.sah_node_cost);
+	cache_hash_value(md5, params.sah_primitive_cost);
+	cache_hash_value(md5, params.min_leaf_size);
+	cache_hash_value(md5, params.max_triangle_leaf_size);
+	cache_hash_value(md5, params.max_motion_triangle_leaf_size);
+	cache_hash_value(md5, params.max_curve_leaf_size);
+	cache_hash_value(md5, params.max_motion_curve_leaf_size);
+	cache_hash_value(md5, params.top_level);
+	cache_hash_value(md5, params.use_qbvh);
+	cache_hash_value(md5, params.primitive_mask);
+	cache_hash_value(md5, params.use_unaligned_nodes);
+	cache_hash_value(md5, params.num_motion_curve_steps);
+	cache_hash_value(md5, params.num_motion_triangle_steps);
+
+	/* objects and meshes, shared meshes are only hashed once but the sharing
+	 * itself is part of the key since it affects instance packing */
+	map<Mesh*, int> mesh_index;
+
+	for(size_t i = 0; i < num_objects; i++) {
+		Object *ob = objects[i];
+		Mesh *mesh = ob->mesh;
+
+		cache_hash_value(md5, ob->tfm);
+		cache_hash_value(md5, ob->visibility);
+		cache_hash_value(md5, ob->use_motion);
+		if(ob->use_motion)
+			cache_hash_value(md5, ob->motion);
+
+		if(params.top_level) {
+			cache_hash_value(md5, ob->instances.size());
+			foreach(const ObjectInstance& instance, ob->instances)
+				cache_hash_value(md5, instance.tfm);
+		}
+
+		map<Mesh*, int>::iterator it = mesh_index.find(mesh);
+		if(it != mesh_index.end()) {
+			cache_hash_value(md5, it->second);
+			continue;
+		}
+
+		int index = mesh_index.size();
+		mesh_index[mesh] = index;
+		cache_hash_value(md5, index);
+
+		cache_hash_value(md5, mesh->transform_applied);
+		cache_hash_value(md5, mesh->has_surface_bssrdf);
+		cache_hash_value(md5, mesh->tri_offset);
+		cache_hash_value(md5, mesh->curve_offset);
+		cache_hash_value(md5, mesh->motion_steps);
+		cache_hash_value(md5, mesh->use_motion_blur);
+		cache_hash_array(md5, mesh->verts);
+		cache_hash_array(md5, mesh->triangles);
+		cache_hash_array(md5, mesh->curve_keys);
+		cache_hash_array(md5, mesh->curve_radius);
+		cache_hash_array(md5, mesh->curve_first_key);
+		cache_hash_attribute(md5, mesh->attributes);
+		cache_hash_attribute(md5, mesh->curve_attributes);
+	}
+
+	return md5.get_hex();
+}
+
+static string cache_filepath(const string& key)
+{
+	return path_cache_get(path_join("bvh", key + ".bvh"));
+}
+
+template<typename T>
+static bool cache_read_array(FILE *f, array<T>& data)
+{
+	size_t size;
+
+	if(fread(&size, sizeof(size), 1, f) != 1)
+		return false;
+
+	data.clear();
+
+	if(size == 0)
+		return true;
+
+	/* read straight into the array storage, no intermediate copy */
+	data.resize(size);
+	return fread(data.data(), sizeof(T), size, f) == size;
+}
+
+template<typename T>
+static bool cache_write_array(FILE *f, const array<T>& data)
+{
+	size_t size = data.size();
+
+	if(fwrite(&size, sizeof(size), 1, f) != 1)
+		return false;
+
+	return (size == 0) || fwrite(data.data(), sizeof(T), size, f) == size;
+}
+
+bool BVH::cache_read(const string& key)
+{
+	string filepath = cache_filepath(key);
+	FILE *f = path_fopen(filepath, "rb");
+
+	if(!f)
+		return false;
+
+	int version = 0;
+	bool ok = fread(&version, sizeof(version), 1, f) == 1 &&
+	          version == BVH_CACHE_VERSION &&
+	          fread(&pack.root_index, sizeof(pack.root_index), 1, f) == 1 &&
+	          cache_read_array(f, pack.nodes) &&
+	          cache_read_array(f, pack.leaf_nodes) &&
+	          cache_read_array(f, pack.object_node) &&
+	          cache_read_array(f, pack.prim_tri_index) &&
+	          cache_read_array(f, pack.prim_tri_verts) &&
+	          cache_read_array(f, pack.prim_type) &&
+	          cache_read_array(f, pack.prim_visibility) &&
+	          cache_read_array(f, pack.prim_index) &&
+	          cache_read_array(f, pack.prim_object) &&
+	          cache_read_array(f, pack.prim_time);
+
+	fclose(f);
+
+	if(!ok) {
+		VLOG(1) << "Invalid BVH cache file " << filepath << ", rebuilding.";
+		pack = PackedBVH();
+		return false;
+	}
+
+	/* keep recently used files from being evicted */
+	path_touch(filepath);
+
+	VLOG(1) << "Loaded BVH from cache " << filepath << ".";
+	return true;
+}
+
+void BVH::cache_write(const string& key)
+{
+	string filepath = cache_filepath(key);
+	/* write to a temporary file first, so other processes sharing the cache
+	 * never see a partially written file */
+	string filepath_tmp = path_temp_filepath(filepath);
+
+	path_create_directories(filepath);
+	FILE *f = path_fopen(filepath_tmp, "wb");
+
+	if(!f) {
+		VLOG(1) << "Failed to open BVH cache file " << filepath_tmp << " for writing.";
+		return;
+	}
+
+	int version = BVH_CACHE_VERSION;
+	bool ok = fwrite(&version, sizeof(version), 1, f) == 1 &&
+	          fwrite(&pack.root_index, sizeof(pack.root_index), 1, f) == 1 &&
+	          cache_write_array(f, pack.nodes) &&
+	          cache_write_array(f, pack.leaf_nodes) &&
+	          cache_write_array(f, pack.object_node) &&
+	          cache_write_array(f, pack.prim_tri_index) &&
+	          cache_write_array(f, pack.prim_tri_verts) &&
+	          cache_write_array(f, pack.prim_type) &&
+	          cache_write_array(f, pack.prim_visibility) &&
+	          cache_write_array(f, pack.prim_index) &&
+	          cache_write_array(f, pack.prim_object) &&
+	          cache_write_array(f, pack.prim_time);
+
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || rename(filepath_tmp.c_str(), filepath.c_str()) != 0) {
+		VLOG(1) << "Failed to write BVH cache file " << filepath << ".";
+		path_remove(filepath_tmp);
+	}
+
+	/* Instance BVHs are built before the top level one, trim the cache once
+	 * all of them are written rather than scanning it for every mesh. */
+	if(params.top_level && params.cache_size > 0) {
+		path_cache_trim(path_dirname(filepath),
+		                (uint64_t)params.cache_size * 1024 * 1024);
+	}
 }
 
 /* Refitting */
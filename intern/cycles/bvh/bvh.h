@@ -20,6 +20,7 @@
 
 #include "bvh/bvh_params.h"
 
+#include "util/util_string.h"
 #include "util/util_types.h"
 #include "util/util_vector.h"
 
@@ -80,7 +81,10 @@ class BVH
 public:
 	PackedBVH pack;
 	BVHParams params;
+	/* Objects by object index. For the top level, the compact instances of
+	 * the first num_objects objects follow them, mapped to their object. */
 	vector<Object*> objects;
+	size_t num_objects;
 
 	static BVH *create(const BVHParams& params, const vector<Object*>& objects);
 	virtual ~BVH() {}
@@ -98,6 +102,11 @@ protected:
 	/* merge instance BVH's */
 	void pack_instances(size_t nodes_size, size_t leaf_nodes_size);
 
+	/* disk cache of packed BVH's, keyed by geometry and build parameters */
+	string cache_key();
+	bool cache_read(const string& key);
+	void cache_write(const string& key);
+
 	/* for subclasses to implement */
 	virtual void pack_nodes(const BVHNode *root) = 0;
 	virtual void refit_nodes() = 0;
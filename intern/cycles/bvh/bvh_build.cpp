@@ -91,6 +91,7 @@ private:
 /* Constructor / Destructor */
 
 BVHBuild::BVHBuild(const vector<Object*>& objects_,
+                   size_t num_objects_,
                    array<int>& prim_type_,
                    array<int>& prim_index_,
                    array<int>& prim_object_,
@@ -98,6 +99,7 @@ BVHBuild::BVHBuild(const vector<Object*>& objects_,
                    const BVHParams& params_,
                    Progress& progress_)
  : objects(objects_),
+   num_objects(num_objects_),
    prim_type(prim_type_),
    prim_index(prim_index_),
    prim_object(prim_object_),
@@ -354,6 +356,19 @@ void BVHBuild::add_reference_object(BoundBox& root, BoundBox& center, Object *ob
 	center.grow(ob->bounds.center2());
 }
 
+void BVHBuild::add_reference_instance(BoundBox& root,
+                                      BoundBox& center,
+                                      Object *ob,
+                                      const ObjectInstance& instance,
+                                      int i)
+{
+	BoundBox bounds = ob->instance_bounds(instance);
+
+	references.push_back(BVHReference(bounds, -1, i, 0));
+	root.grow(bounds);
+	center.grow(bounds.center2());
+}
+
 static size_t count_curve_segments(Mesh *mesh)
 {
 	size_t num = 0, num_curves = mesh->num_curves();
@@ -369,11 +384,14 @@ void BVHBuild::add_references(BVHRange& root)
 	/* reserve space for references */
 	size_t num_alloc_references = 0;
 
-	foreach(Object *ob, objects) {
+	for(size_t i = 0; i < num_objects; i++) {
+		Object *ob = objects[i];
+
 		if(params.top_level) {
 			if(!ob->is_traceable()) {
 				continue;
 			}
+			num_alloc_references += ob->instances.size();
 			if(!ob->mesh->is_instanced()) {
 				if(params.primitive_mask & PRIMITIVE_ALL_TRIANGLE) {
 					num_alloc_references += ob->mesh->num_triangles();
@@ -401,7 +419,9 @@ void BVHBuild::add_references(BVHRange& root)
 	BoundBox bounds = BoundBox::empty, center = BoundBox::empty;
 	int i = 0;
 
-	foreach(Object *ob, objects) {
+	for(size_t j = 0; j < num_objects; j++) {
+		Object *ob = objects[j];
+
 		if(params.top_level) {
 			if(!ob->is_traceable()) {
 				++i;
@@ -420,6 +440,25 @@ void BVHBuild::add_references(BVHRange& root)
 		if(progress.get_cancel()) return;
 	}
 
+	/* compact instances, with object indices following all objects */
+	if(params.top_level) {
+		for(size_t j = 0; j < num_objects; j++) {
+			Object *ob = objects[j];
+
+			if(!ob->is_traceable()) {
+				i += ob->instances.size();
+				continue;
+			}
+
+			foreach(const ObjectInstance& instance, ob->instances) {
+				add_reference_instance(bounds, center, ob, instance, i);
+				i++;
+			}
+
+			if(progress.get_cancel()) return;
+		}
+	}
+
 	/* happens mostly on empty meshes */
 	if(!bounds.valid())
 		bounds.grow(make_float3(0.0f, 0.0f, 0.0f));
@@ -36,6 +36,7 @@ class BVHParams;
 class InnerNode;
 class Mesh;
 class Object;
+struct ObjectInstance;
 class Progress;
 
 /* BVH Builder */
@@ -45,6 +46,7 @@ class BVHBuild
 public:
 	/* Constructor/Destructor */
 	BVHBuild(const vector<Object*>& objects,
+	         size_t num_objects,
 	         array<int>& prim_type,
 	         array<int>& prim_index,
 	         array<int>& prim_object,
@@ -68,6 +70,11 @@ protected:
 	void add_reference_curves(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
 	void add_reference_mesh(BoundBox& root, BoundBox& center, Mesh *mesh, int i);
 	void add_reference_object(BoundBox& root, BoundBox& center, Object *ob, int i);
+	void add_reference_instance(BoundBox& root,
+	                            BoundBox& center,
+	                            Object *ob,
+	                            const ObjectInstance& instance,
+	                            int i);
 	void add_references(BVHRange& root);
 
 	/* Building. */
@@ -104,8 +111,10 @@ protected:
 	void rotate(BVHNode *node, int max_depth);
 	void rotate(BVHNode *node, int max_depth, int iterations);
 
-	/* Objects and primitive references. */
+	/* Objects and primitive references, compact instances follow the first
+	 * num_objects objects. */
 	vector<Object*> objects;
+	size_t num_objects;
 	vector<BVHReference> references;
 	int num_original_references;
 
@@ -53,6 +53,11 @@ public:
 	/* QBVH */
 	bool use_qbvh;
 
+	/* Read and write packed BVH to the disk cache. */
+	bool use_cache;
+	/* Disk cache size in megabytes, zero for no limit. */
+	int cache_size;
+
 	/* Mask of primitives to be included into the BVH. */
 	int primitive_mask;
 
@@ -99,6 +104,8 @@ public:
 
 		top_level = false;
 		use_qbvh = false;
+		use_cache = false;
+		cache_size = 0;
 		use_unaligned_nodes = false;
 
 		primitive_mask = PRIMITIVE_ALL;
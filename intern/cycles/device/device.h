@@ -299,6 +299,12 @@ public:
 	/* open shading language, only for CPU device */
 	virtual void *osl_memory() { return NULL; }
 
+	/* out-of-core image texture cache, only for CPU device */
+	virtual void *texture_cache_memory() { return NULL; }
+
+	/* sparse volume grids, only for CPU device */
+	virtual void *sparse_grid_memory() { return NULL; }
+
 	/* load/compile kernels, must be called before adding tasks */ 
 	virtual bool load_kernels(
 	        const DeviceRequestedFeatures& /*requested_features*/)
@@ -316,8 +322,8 @@ public:
 		const DeviceDrawParams &draw_params);
 
 #ifdef WITH_NETWORK
-	/* networking */
-	void server_run();
+	/* networking, port zero uses the default server port */
+	void server_run(int port = 0);
 #endif
 
 	/* multi device */
@@ -335,6 +341,10 @@ public:
 	static vector<DeviceInfo>& available_devices();
 	static string device_capabilities();
 	static DeviceInfo get_multi_device(vector<DeviceInfo> subdevices);
+#ifdef WITH_NETWORK
+	/* Network device rendering on the server at "host" or "host:port". */
+	static DeviceInfo get_network_device(const string& address);
+#endif
 
 	/* Tag devices lists for update. */
 	static void tag_update();
@@ -34,6 +34,8 @@
 #include "kernel/kernel_types.h"
 #include "kernel/split/kernel_split_data.h"
 #include "kernel/kernel_globals.h"
+#include "kernel/kernel_sparse_grid.h"
+#include "kernel/kernel_texture_cache.h"
 
 #include "kernel/filter/filter.h"
 
@@ -165,11 +167,18 @@ public:
 	OSLGlobals osl_globals;
 #endif
 
+	TextureCacheGlobals texture_cache_globals;
+	SparseGridGlobals sparse_grid_globals;
+
 	bool use_split_kernel;
 
 	DeviceRequestedFeatures requested_features;
 
 	KernelFunctions<void(*)(KernelGlobals *, float *, unsigned int *, int, int, int, int, int)>   path_trace_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, unsigned int *, int, int, int, int, int, int)> path_trace_packet_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>                   adaptive_stopping_kernel;
+	KernelFunctions<bool(*)(KernelGlobals *, float *, int, int, int, int, int, int, int, int)>    adaptive_filter_kernel;
+	KernelFunctions<void(*)(KernelGlobals *, float *, int, int, int, int, int)>                   adaptive_adjust_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>       convert_to_half_float_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uchar4 *, float *, float, int, int, int, int)>       convert_to_byte_kernel;
 	KernelFunctions<void(*)(KernelGlobals *, uint4 *, float4 *, float*, int, int, int, int, int)> shader_kernel;
@@ -206,6 +215,10 @@ public:
 	: Device(info, stats, background),
 #define REGISTER_KERNEL(name) name ## _kernel(KERNEL_FUNCTIONS(name))
 	  REGISTER_KERNEL(path_trace),
+	  REGISTER_KERNEL(path_trace_packet),
+	  REGISTER_KERNEL(adaptive_stopping),
+	  REGISTER_KERNEL(adaptive_filter),
+	  REGISTER_KERNEL(adaptive_adjust),
 	  REGISTER_KERNEL(convert_to_half_float),
 	  REGISTER_KERNEL(convert_to_byte),
 	  REGISTER_KERNEL(shader),
@@ -228,6 +241,9 @@ public:
 #ifdef WITH_OSL
 		kernel_globals.osl = &osl_globals;
 #endif
+		kernel_globals.texture_cache = &texture_cache_globals;
+		kernel_globals.texture_cache_tdata = NULL;
+		kernel_globals.sparse_grids = &sparse_grid_globals;
 		use_split_kernel = DebugFlags().cpu.split_kernel;
 		if(use_split_kernel) {
 			VLOG(1) << "Will be using split kernel.";
@@ -361,6 +377,16 @@ public:
 #endif
 	}
 
+	void *texture_cache_memory()
+	{
+		return &texture_cache_globals;
+	}
+
+	void *sparse_grid_memory()
+	{
+		return &sparse_grid_globals;
+	}
+
 	void thread_run(DeviceTask *task)
 	{
 		if(task->type == DeviceTask::RENDER) {
@@ -623,6 +649,10 @@ public:
 		int start_sample = tile.start_sample;
 		int end_sample = tile.start_sample + tile.num_samples;
 
+		/* adaptive sampling needs the whole tile rendered in one go, as
+		 * converged pixels are rescaled once all samples are done */
+		bool use_adaptive_sampling = task.adaptive_sampling && start_sample == 0;
+
 		for(int sample = start_sample; sample < end_sample; sample++) {
 			if(task.get_cancel() || task_pool.canceled()) {
 				if(task.need_finish_queue == false)
@@ -630,16 +660,78 @@ public:
 			}
 
 			for(int y = tile.y; y < tile.y + tile.h; y++) {
-				for(int x = tile.x; x < tile.x + tile.w; x++) {
-					path_trace_kernel()(kg, render_buffer, rng_state,
-					                    sample, x, y, tile.offset, tile.stride);
+				if(task.packet_traversal) {
+					/* trace runs of pixels in a row as ray packets */
+					for(int x = tile.x; x < tile.x + tile.w; x += BVH_PACKET_SIZE) {
+						int num_pixels = min(BVH_PACKET_SIZE, tile.x + tile.w - x);
+						path_trace_packet_kernel()(kg, render_buffer, rng_state,
+						                           sample, x, y, num_pixels,
+						                           tile.offset, tile.stride);
+					}
+				}
+				else {
+					for(int x = tile.x; x < tile.x + tile.w; x++) {
+						path_trace_kernel()(kg, render_buffer, rng_state,
+						                    sample, x, y, tile.offset, tile.stride);
+					}
 				}
 			}
 
 			tile.sample = sample + 1;
 
+			if(use_adaptive_sampling && task.need_adaptive_filter(sample)) {
+				if(adaptive_sampling_filter(kg, tile, sample)) {
+					/* all pixels converged, count the skipped samples as done */
+					task.update_progress(&tile, tile.w*tile.h*(end_sample - sample));
+					tile.sample = end_sample;
+					break;
+				}
+			}
+
 			task.update_progress(&tile, tile.w*tile.h);
 		}
+
+		if(use_adaptive_sampling) {
+			adaptive_sampling_adjust(kg, tile);
+		}
+	}
+
+	bool adaptive_sampling_filter(KernelGlobals *kg, RenderTile &tile, int sample)
+	{
+		float *render_buffer = (float*)tile.buffer;
+		bool all_converged = true;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_stopping_kernel()(kg, render_buffer, sample,
+				                           x, y, tile.offset, tile.stride);
+			}
+		}
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				if(!adaptive_filter_kernel()(kg, render_buffer, x, y,
+				                             tile.x, tile.y, tile.w, tile.h,
+				                             tile.offset, tile.stride))
+				{
+					all_converged = false;
+				}
+			}
+		}
+
+		return all_converged;
+	}
+
+	void adaptive_sampling_adjust(KernelGlobals *kg, RenderTile &tile)
+	{
+		float *render_buffer = (float*)tile.buffer;
+
+		for(int y = tile.y; y < tile.y + tile.h; y++) {
+			for(int x = tile.x; x < tile.x + tile.w; x++) {
+				adaptive_adjust_kernel()(kg, render_buffer, tile.sample,
+				                         x, y, tile.offset, tile.stride);
+			}
+		}
 	}
 
 	void denoise(DeviceTask &task, RenderTile &tile)
@@ -756,6 +848,8 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		texture_cache_thread_init(&kg);
+
 		for(int sample = 0; sample < task.num_samples; sample++) {
 			for(int x = task.shader_x; x < task.shader_x + task.shader_w; x++)
 				shader_kernel()(&kg,
@@ -778,6 +872,7 @@ public:
 #ifdef WITH_OSL
 		OSLShader::thread_free(&kg);
 #endif
+		texture_cache_thread_free(&kg);
 	}
 
 	int get_split_task_count(DeviceTask& task)
@@ -826,6 +921,7 @@ protected:
 #ifdef WITH_OSL
 		OSLShader::thread_init(&kg, &kernel_globals, &osl_globals);
 #endif
+		texture_cache_thread_init(&kg);
 		return kg;
 	}
 
@@ -848,6 +944,27 @@ protected:
 #ifdef WITH_OSL
 		OSLShader::thread_free(kg);
 #endif
+		texture_cache_thread_free(kg);
+	}
+
+	inline void texture_cache_thread_init(KernelGlobals *kg)
+	{
+		if(texture_cache_globals.ts != NULL) {
+			kg->texture_cache_tdata = new TextureCacheThreadData();
+			kg->texture_cache_tdata->info = texture_cache_globals.ts->create_thread_info();
+		}
+		else {
+			kg->texture_cache_tdata = NULL;
+		}
+	}
+
+	inline void texture_cache_thread_free(KernelGlobals *kg)
+	{
+		if(kg->texture_cache_tdata != NULL) {
+			texture_cache_globals.ts->destroy_thread_info(kg->texture_cache_tdata->info);
+			delete kg->texture_cache_tdata;
+			kg->texture_cache_tdata = NULL;
+		}
 	}
 
 	virtual bool load_kernels(DeviceRequestedFeatures& requested_features_) {
@@ -56,16 +56,21 @@ public:
 		}
 
 #ifdef WITH_NETWORK
-		/* try to add network devices */
-		ServerDiscovery discovery(true);
-		time_sleep(1.0);
+		/* try to add network devices, unless servers were given explicitly */
+		bool use_discovery = info.multi_devices.empty() ||
+		                     info.multi_devices[0].type != DEVICE_NETWORK;
 
-		vector<string> servers = discovery.get_server_list();
+		if(use_discovery) {
+			ServerDiscovery discovery(true);
+			time_sleep(1.0);
 
-		foreach(string& server, servers) {
-			device = device_network_create(info, stats, server.c_str());
-			if(device)
-				devices.push_back(SubDevice(device));
+			vector<string> servers = discovery.get_server_list();
+
+			foreach(string& server, servers) {
+				device = device_network_create(info, stats, server.c_str());
+				if(device)
+					devices.push_back(SubDevice(device));
+			}
 		}
 #endif
 	}
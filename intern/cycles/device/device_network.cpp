@@ -20,6 +20,8 @@
 
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_set.h"
+#include "util/util_thread.h"
 
 #if defined(WITH_NETWORK)
 
@@ -51,20 +53,35 @@ public:
 
 	thread_mutex rpc_lock;
 
+	/* Thread serving tile requests of the server while a task runs. */
+	thread *task_thread;
+
+	/* Buffers allocated read-only, which are deduplicated by content. */
+	set<device_ptr> read_only_mem;
+
 	virtual bool show_samples() const
 	{
 		return false;
 	}
 
 	NetworkDevice(DeviceInfo& info, Stats &stats, const char *address)
-	: Device(info, stats, true), socket(io_service)
+	: Device(info, stats, true), socket(io_service), task_thread(NULL), connected(false)
 	{
 		error_func = NetworkError();
+		mem_counter = 0;
+
+		string host;
+		int port;
+		if(!network_parse_address(address, &host, &port)) {
+			error_func.network_error(string_printf("Invalid server address \"%s\"", address));
+			return;
+		}
+
 		stringstream portstr;
-		portstr << SERVER_PORT;
+		portstr << port;
 
 		tcp::resolver resolver(io_service);
-		tcp::resolver::query query(address, portstr.str());
+		tcp::resolver::query query(host, portstr.str());
 		tcp::resolver::iterator endpoint_iterator = resolver.resolve(query);
 		tcp::resolver::iterator end;
 
@@ -77,16 +94,35 @@ public:
 
 		if(error)
 			error_func.network_error(error.message());
-
-		mem_counter = 0;
+		else
+			connected = true;
 	}
 
 	~NetworkDevice()
 	{
+		task_wait();
+
+		if(!have_connection())
+			return;
+
 		RPCSend snd(socket, &error_func, "stop");
 		snd.write();
 	}
 
+	/* Network errors are reported as device errors. */
+	const string& error_message()
+	{
+		if(error_func.have_error() && error_msg.empty())
+			error_msg = error_func.message();
+		return error_msg;
+	}
+
+	/* No remote calls are made without a connection, or after an error. */
+	bool have_connection()
+	{
+		return connected && !have_error();
+	}
+
 	void mem_alloc(const char *name, device_memory& mem, MemoryType type)
 	{
 		if(name) {
@@ -99,6 +135,12 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
+		if(type == MEM_READ_ONLY)
+			read_only_mem.insert(mem.device_pointer);
+
+		if(!have_connection())
+			return;
+
 		RPCSend snd(socket, &error_func, "mem_alloc");
 
 		snd.add(mem);
@@ -106,19 +148,58 @@ public:
 		snd.write();
 	}
 
+	/* Hash of buffer contents for deduplication, empty if the buffer is
+	 * always sent. */
+	string mem_hash(device_memory& mem, bool read_only)
+	{
+		if(!read_only || mem.memory_size() < NETWORK_DEDUP_MIN_SIZE)
+			return "";
+
+		return network_content_hash((void*)mem.data_pointer, mem.memory_size());
+	}
+
+	/* Send buffer contents after the RPC, unless the server replies that it
+	 * already has data with the same hash. */
+	void mem_send_data(RPCSend& snd, device_memory& mem, const string& hash)
+	{
+		if(hash != "") {
+			bool found = false;
+			RPCReceive rcv(socket, &error_func);
+			rcv.read(found);
+
+			if(found) {
+				VLOG(2) << "Network device skipped upload of "
+				        << string_human_readable_size(mem.memory_size())
+				        << " already on the server.";
+				return;
+			}
+		}
+
+		snd.write_buffer_compressed((void*)mem.data_pointer, mem.memory_size());
+	}
+
 	void mem_copy_to(device_memory& mem)
 	{
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 
+		string hash = mem_hash(mem, read_only_mem.count(mem.device_pointer) != 0);
+
 		RPCSend snd(socket, &error_func, "mem_copy_to");
 
 		snd.add(mem);
+		snd.add(hash);
 		snd.write();
-		snd.write_buffer((void*)mem.data_pointer, mem.memory_size());
+		mem_send_data(snd, mem, hash);
 	}
 
 	void mem_copy_from(device_memory& mem, int y, int w, int h, int elem)
 	{
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 
 		size_t data_size = mem.memory_size();
@@ -133,11 +214,14 @@ public:
 		snd.write();
 
 		RPCReceive rcv(socket, &error_func);
-		rcv.read_buffer((void*)mem.data_pointer, data_size);
+		rcv.read_buffer_compressed((void*)mem.data_pointer, data_size);
 	}
 
 	void mem_zero(device_memory& mem)
 	{
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 
 		RPCSend snd(socket, &error_func, "mem_zero");
@@ -151,17 +235,23 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
-			RPCSend snd(socket, &error_func, "mem_free");
+			if(have_connection()) {
+				RPCSend snd(socket, &error_func, "mem_free");
 
-			snd.add(mem);
-			snd.write();
+				snd.add(mem);
+				snd.write();
+			}
 
+			read_only_mem.erase(mem.device_pointer);
 			mem.device_pointer = 0;
 		}
 	}
 
 	void const_copy_to(const char *name, void *host, size_t size)
 	{
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 
 		RPCSend snd(socket, &error_func, "const_copy_to");
@@ -187,16 +277,21 @@ public:
 
 		mem.device_pointer = ++mem_counter;
 
+		if(!have_connection())
+			return;
+
 		RPCSend snd(socket, &error_func, "tex_alloc");
 
 		string name_string(name);
+		string hash = mem_hash(mem, true);
 
 		snd.add(name_string);
 		snd.add(mem);
 		snd.add(interpolation);
 		snd.add(extension);
+		snd.add(hash);
 		snd.write();
-		snd.write_buffer((void*)mem.data_pointer, mem.memory_size());
+		mem_send_data(snd, mem, hash);
 	}
 
 	void tex_free(device_memory& mem)
@@ -204,10 +299,12 @@ public:
 		if(mem.device_pointer) {
 			thread_scoped_lock lock(rpc_lock);
 
-			RPCSend snd(socket, &error_func, "tex_free");
+			if(have_connection()) {
+				RPCSend snd(socket, &error_func, "tex_free");
 
-			snd.add(mem);
-			snd.write();
+				snd.add(mem);
+				snd.write();
+			}
 
 			mem.device_pointer = 0;
 		}
@@ -215,7 +312,7 @@ public:
 
 	bool load_kernels(const DeviceRequestedFeatures& requested_features)
 	{
-		if(error_func.have_error())
+		if(!have_connection())
 			return false;
 
 		thread_scoped_lock lock(rpc_lock);
@@ -236,6 +333,12 @@ public:
 
 	void task_add(DeviceTask& task)
 	{
+		/* The server runs one task at a time. */
+		task_wait();
+
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 
 		the_task = task;
@@ -243,20 +346,33 @@ public:
 		RPCSend snd(socket, &error_func, "task_add");
 		snd.add(task);
 		snd.write();
+
+		RPCSend snd_wait(socket, &error_func, "task_wait");
+		snd_wait.write();
+
+		lock.unlock();
+
+		/* Serve tile requests from a thread, so that servers of a multi
+		 * device all render at the same time. */
+		task_thread = new thread(function_bind(&NetworkDevice::task_run, this));
 	}
 
 	void task_wait()
 	{
-		thread_scoped_lock lock(rpc_lock);
-
-		RPCSend snd(socket, &error_func, "task_wait");
-		snd.write();
+		if(task_thread) {
+			task_thread->join();
+			delete task_thread;
+			task_thread = NULL;
+		}
+	}
 
+	void task_run()
+	{
+		thread_scoped_lock lock(rpc_lock);
 		lock.unlock();
 
 		TileList the_tiles;
 
-		/* todo: run this threaded for connecting to multiple clients */
 		for(;;) {
 			if(error_func.have_error())
 				break;
@@ -316,6 +432,9 @@ public:
 
 	void task_cancel()
 	{
+		if(!have_connection())
+			return;
+
 		thread_scoped_lock lock(rpc_lock);
 		RPCSend snd(socket, &error_func, "task_cancel");
 		snd.write();
@@ -328,11 +447,31 @@ public:
 
 private:
 	NetworkError error_func;
+	/* set once connected to the server */
+	bool connected;
 };
 
 Device *device_network_create(DeviceInfo& info, Stats &stats, const char *address)
 {
-	return new NetworkDevice(info, stats, address);
+	/* Devices for a specific server have its address in the id. */
+	string server_address = address;
+	if(string_startswith(info.id, "NETWORK_"))
+		server_address = info.id.substr(strlen("NETWORK_"));
+
+	return new NetworkDevice(info, stats, server_address.c_str());
+}
+
+DeviceInfo Device::get_network_device(const string& address)
+{
+	/* Same capabilities as the generic network device, for one server. */
+	vector<DeviceInfo> devices;
+	device_network_info(devices);
+
+	DeviceInfo info = devices[0];
+	info.description = "Network Device (" + address + ")";
+	info.id = "NETWORK_" + address;
+
+	return info;
 }
 
 void device_network_info(vector<DeviceInfo>& devices)
@@ -360,7 +499,7 @@ public:
 	bool have_error() { return error_func.have_error(); }
 
 	DeviceServer(Device *device_, tcp::socket& socket_)
-	: device(device_), socket(socket_), stop(false), blocked_waiting(false)
+	: device(device_), socket(socket_), freed_size(0), stop(false), blocked_waiting(false)
 	{
 		error_func = NetworkError();
 	}
@@ -414,6 +553,100 @@ protected:
 		return i->second;
 	}
 
+	/* Content hashes of read-only buffers, and of freed buffers which are
+	 * kept in case the client uploads the same data again. */
+	void data_hash_insert(device_ptr client_pointer, const string& hash)
+	{
+		data_hash_remove(client_pointer);
+
+		if(hash != "") {
+			ptr_hash[client_pointer] = hash;
+			hash_ptr[hash] = client_pointer;
+		}
+	}
+
+	void data_hash_remove(device_ptr client_pointer)
+	{
+		map<device_ptr, string>::iterator i = ptr_hash.find(client_pointer);
+
+		if(i != ptr_hash.end()) {
+			map<string, device_ptr>::iterator j = hash_ptr.find(i->second);
+			if(j != hash_ptr.end() && j->second == client_pointer)
+				hash_ptr.erase(j);
+			ptr_hash.erase(i);
+		}
+	}
+
+	/* Fill data with earlier received contents matching the hash. */
+	bool data_hash_find(const string& hash, DataVector& data)
+	{
+		map<string, device_ptr>::iterator i = hash_ptr.find(hash);
+		if(i != hash_ptr.end()) {
+			DataVector& src = data_vector_find(i->second);
+			if(src.size() == data.size()) {
+				data = src;
+				return true;
+			}
+		}
+
+		map<string, DataVector>::iterator j = freed_data.find(hash);
+		if(j != freed_data.end() && j->second.size() == data.size()) {
+			data = j->second;
+			return true;
+		}
+
+		return false;
+	}
+
+	/* Keep the data of a freed read-only buffer, dropping the oldest freed
+	 * buffers when over the memory limit. */
+	void data_hash_free(device_ptr client_pointer, DataVector& data)
+	{
+		map<device_ptr, string>::iterator i = ptr_hash.find(client_pointer);
+
+		if(i == ptr_hash.end())
+			return;
+
+		string hash = i->second;
+		data_hash_remove(client_pointer);
+
+		if(data.size() > NETWORK_SERVER_CACHE_SIZE || freed_data.count(hash))
+			return;
+
+		freed_data[hash].swap(data);
+		freed_order.push_back(hash);
+		freed_size += freed_data[hash].size();
+
+		while(freed_size > NETWORK_SERVER_CACHE_SIZE) {
+			map<string, DataVector>::iterator j = freed_data.find(freed_order.front());
+			freed_size -= j->second.size();
+			freed_data.erase(j);
+			freed_order.pop_front();
+		}
+	}
+
+	/* Receive buffer contents, or reuse data with the same hash. */
+	void data_receive(RPCReceive& rcv, DataVector& data, const string& hash)
+	{
+		if(hash != "") {
+			bool found = data_hash_find(hash, data);
+
+			stats.num_hashed_uploads++;
+			if(found)
+				stats.num_skipped_uploads++;
+
+			RPCSend snd(socket, &error_func, "data_found");
+			snd.add(found);
+			snd.write();
+
+			if(found)
+				return;
+		}
+
+		if(data.size())
+			rcv.read_buffer_compressed(&data[0], data.size());
+	}
+
 	/* setup mapping and reverse mapping of client_pointer<->real_pointer */
 	void pointer_mapping_insert(device_ptr client_pointer, device_ptr real_pointer)
 	{
@@ -453,6 +686,7 @@ protected:
 		/* erase the data vector */
 		DataMap::iterator idata = mem_data.find(client_pointer);
 		assert(idata != mem_data.end());
+		data_hash_free(client_pointer, idata->second);
 		mem_data.erase(idata);
 
 		return result;
@@ -494,21 +728,22 @@ protected:
 		}
 		else if(rcv.name == "mem_copy_to") {
 			network_device_memory mem;
+			string hash;
 
 			rcv.read(mem);
-			lock.unlock();
+			rcv.read(hash);
 
 			device_ptr client_pointer = mem.device_pointer;
 
 			DataVector &data_v = data_vector_find(client_pointer);
 
-			size_t data_size = mem.memory_size();
-
 			/* get pointer to memory buffer	for device buffer */
 			mem.data_pointer = (device_ptr)&data_v[0];
 
 			/* copy data from network into memory buffer */
-			rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
+			data_receive(rcv, data_v, hash);
+			data_hash_insert(client_pointer, hash);
+			lock.unlock();
 
 			/* translate the client pointer to a real device pointer */
 			mem.device_pointer = device_ptr_from_client_pointer(client_pointer);
@@ -534,12 +769,13 @@ protected:
 			mem.data_pointer = (device_ptr)&(data_v[0]);
 
 			device->mem_copy_from(mem, y, w, h, elem);
+			data_hash_remove(client_pointer);
 
 			size_t data_size = mem.memory_size();
 
 			RPCSend snd(socket, &error_func, "mem_copy_from");
 			snd.write();
-			snd.write_buffer((uint8_t*)mem.data_pointer, data_size);
+			snd.write_buffer_compressed((uint8_t*)mem.data_pointer, data_size);
 			lock.unlock();
 		}
 		else if(rcv.name == "mem_zero") {
@@ -555,6 +791,7 @@ protected:
 
 			mem.data_pointer = (device_ptr)&(data_v[0]);
 
+			data_hash_remove(client_pointer);
 			device->mem_zero(mem);
 		}
 		else if(rcv.name == "mem_free") {
@@ -589,12 +826,13 @@ protected:
 			InterpolationType interpolation;
 			ExtensionType extension_type;
 			device_ptr client_pointer;
+			string hash;
 
 			rcv.read(name);
 			rcv.read(mem);
 			rcv.read(interpolation);
 			rcv.read(extension_type);
-			lock.unlock();
+			rcv.read(hash);
 
 			client_pointer = mem.device_pointer;
 
@@ -607,7 +845,9 @@ protected:
 			else
 				mem.data_pointer = 0;
 
-			rcv.read_buffer((uint8_t*)mem.data_pointer, data_size);
+			data_receive(rcv, data_v, hash);
+			data_hash_insert(client_pointer, hash);
+			lock.unlock();
 
 			device->tex_alloc(name.c_str(), mem, interpolation, extension_type);
 
@@ -740,6 +980,7 @@ protected:
 					if(tile.buffer) tile.buffer = ptr_map[tile.buffer];
 					if(tile.rng_state) tile.rng_state = ptr_map[tile.rng_state];
 
+					stats.num_tiles++;
 					result = true;
 					break;
 				}
@@ -816,6 +1057,13 @@ protected:
 	PtrMap ptr_imap;
 	DataMap mem_data;
 
+	/* content hashes of buffers, see data_hash_insert */
+	map<device_ptr, string> ptr_hash;
+	map<string, device_ptr> hash_ptr;
+	map<string, DataVector> freed_data;
+	list<string> freed_order;
+	size_t freed_size;
+
 	struct AcquireEntry {
 		string name;
 		RenderTile tile;
@@ -826,6 +1074,10 @@ protected:
 
 	bool stop;
 	bool blocked_waiting;
+
+public:
+	NetworkServerStats stats;
+
 private:
 	NetworkError error_func;
 
@@ -833,27 +1085,41 @@ private:
 
 };
 
-void Device::server_run()
+void device_network_server_accept(Device *device,
+                                  tcp::acceptor *acceptor,
+                                  NetworkServerStats *stats)
 {
+	tcp::socket socket(acceptor->get_io_service());
+	acceptor->accept(socket);
+
+	string remote_address = socket.remote_endpoint().address().to_string();
+	printf("Connected to remote client at: %s\n", remote_address.c_str());
+
+	DeviceServer server(device, socket);
+	server.listen();
+
+	if(stats)
+		*stats = server.stats;
+
+	printf("Disconnected.\n");
+}
+
+void Device::server_run(int port)
+{
+	if(port == 0)
+		port = SERVER_PORT;
+
 	try {
 		/* starts thread that responds to discovery requests */
 		ServerDiscovery discovery;
 
 		for(;;) {
-			/* accept connection */
+			/* accept connection, from IPv6 and IPv4 clients */
 			boost::asio::io_service io_service;
-			tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), SERVER_PORT));
-
-			tcp::socket socket(io_service);
-			acceptor.accept(socket);
-
-			string remote_address = socket.remote_endpoint().address().to_string();
-			printf("Connected to remote client at: %s\n", remote_address.c_str());
-
-			DeviceServer server(this, socket);
-			server.listen();
+			tcp::acceptor acceptor(io_service);
+			network_listen(acceptor, port);
 
-			printf("Disconnected.\n");
+			device_network_server_accept(this, &acceptor);
 		}
 	}
 	catch(exception& e) {
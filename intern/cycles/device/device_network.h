@@ -33,11 +33,15 @@
 #include <sstream>
 #include <deque>
 
+#include <zlib.h>
+
 #include "render/buffers.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_list.h"
 #include "util/util_map.h"
+#include "util/util_md5.h"
 #include "util/util_string.h"
 
 CCL_NAMESPACE_BEGIN
@@ -55,6 +59,111 @@ static const int DISCOVER_PORT = 5121;
 static const string DISCOVER_REQUEST_MSG = "REQUEST_RENDER_SERVER_IP";
 static const string DISCOVER_REPLY_MSG = "REPLY_RENDER_SERVER_IP";
 
+/* Buffers are compressed in blocks of this size, smaller buffers and
+ * blocks which do not compress are sent as they are. */
+static const size_t NETWORK_COMPRESS_BLOCK_SIZE = 16*1024*1024;
+static const size_t NETWORK_COMPRESS_MIN_SIZE = 1024;
+
+/* Read-only buffers of at least this size are identified by a hash of their
+ * contents, so the server can reuse data it already received. */
+static const size_t NETWORK_DEDUP_MIN_SIZE = 64*1024;
+
+/* Memory the server keeps for freed buffers which may be uploaded again. */
+static const size_t NETWORK_SERVER_CACHE_SIZE = 1024*1024*1024;
+
+/* Split "host:port" into its parts, the port is optional. IPv6 literals are
+ * given as "[address]:port", or as a bare address without port. Returns false
+ * for addresses that can not be parsed. */
+static inline bool network_parse_address(const string& address, string *host, int *port)
+{
+	string port_str;
+
+	if(string_startswith(address, "[")) {
+		size_t bracket = address.find(']');
+		if(bracket == string::npos)
+			return false;
+
+		*host = address.substr(1, bracket - 1);
+
+		if(bracket + 1 < address.size()) {
+			if(address[bracket + 1] != ':')
+				return false;
+			port_str = address.substr(bracket + 2);
+			if(port_str.empty())
+				return false;
+		}
+	}
+	else {
+		size_t colon = address.find(':');
+
+		if(colon == string::npos || address.find(':', colon + 1) != string::npos) {
+			/* no port, or an IPv6 literal which can not have one */
+			*host = address;
+		}
+		else {
+			*host = address.substr(0, colon);
+			port_str = address.substr(colon + 1);
+			if(port_str.empty())
+				return false;
+		}
+	}
+
+	if(host->empty())
+		return false;
+
+	if(port_str.empty()) {
+		*port = SERVER_PORT;
+		return true;
+	}
+
+	if(port_str.size() > 5 || port_str.find_first_not_of("0123456789") != string::npos)
+		return false;
+
+	*port = atoi(port_str.c_str());
+	return (*port > 0 && *port <= 65535);
+}
+
+/* Listen for clients on both IPv6 and IPv4, or on IPv4 only where the system
+ * has no IPv6. Port 0 picks a free port. */
+static inline void network_listen(tcp::acceptor& acceptor, int port)
+{
+	boost::system::error_code error;
+	tcp protocol = tcp::v6();
+
+	acceptor.open(protocol, error);
+	if(!error)
+		acceptor.set_option(boost::asio::ip::v6_only(false), error);
+
+	if(error) {
+		if(acceptor.is_open())
+			acceptor.close();
+		protocol = tcp::v4();
+		acceptor.open(protocol);
+	}
+
+	acceptor.set_option(tcp::acceptor::reuse_address(true));
+	acceptor.bind(tcp::endpoint(protocol, port));
+	acceptor.listen();
+}
+
+static inline string network_content_hash(const void *data, size_t size)
+{
+	MD5Hash md5;
+	const uint8_t *bytes = (const uint8_t*)data;
+
+	md5.append((const uint8_t*)&size, sizeof(size));
+
+	/* MD5Hash takes int sizes. */
+	while(size > 0) {
+		size_t block = min(size, NETWORK_COMPRESS_BLOCK_SIZE);
+		md5.append(bytes, (int)block);
+		bytes += block;
+		size -= block;
+	}
+
+	return md5.get_hex();
+}
+
 #if 0
 typedef boost::archive::text_oarchive o_archive;
 typedef boost::archive::text_iarchive i_archive;
@@ -93,6 +202,10 @@ public:
 		return true ? error_count > 0 : false;
 	}
 
+	const string& message() {
+		return error;
+	}
+
 private:
 	string error;
 	int error_count;
@@ -187,6 +300,37 @@ public:
 			error_func->network_error(error.message());
 	}
 
+	/* Write buffer compressed in blocks, each preceded by its compressed
+	 * size, or zero when the block is sent uncompressed. */
+	void write_buffer_compressed(void *buffer, size_t size)
+	{
+		uint8_t *data = (uint8_t*)buffer;
+		vector<uint8_t> packed;
+
+		for(size_t offset = 0; offset < size; offset += NETWORK_COMPRESS_BLOCK_SIZE) {
+			size_t block_size = min(size - offset, NETWORK_COMPRESS_BLOCK_SIZE);
+			uint64_t packed_size = 0;
+
+			if(block_size >= NETWORK_COMPRESS_MIN_SIZE) {
+				uLongf dest_size = compressBound(block_size);
+				packed.resize(dest_size);
+
+				if(compress2(&packed[0], &dest_size, data + offset, block_size, Z_BEST_SPEED) == Z_OK &&
+				   dest_size < block_size)
+				{
+					packed_size = dest_size;
+				}
+			}
+
+			write_buffer(&packed_size, sizeof(packed_size));
+
+			if(packed_size)
+				write_buffer(&packed[0], packed_size);
+			else
+				write_buffer(data + offset, block_size);
+		}
+	}
+
 protected:
 	string name;
 	tcp::socket& socket;
@@ -284,6 +428,41 @@ public:
 			cout << "Network receive error: buffer size doesn't match expected size\n";
 	}
 
+	/* Read buffer written with RPCSend::write_buffer_compressed. */
+	void read_buffer_compressed(void *buffer, size_t size)
+	{
+		uint8_t *data = (uint8_t*)buffer;
+		vector<uint8_t> packed;
+
+		for(size_t offset = 0; offset < size; offset += NETWORK_COMPRESS_BLOCK_SIZE) {
+			size_t block_size = min(size - offset, NETWORK_COMPRESS_BLOCK_SIZE);
+			uint64_t packed_size = 0;
+
+			read_buffer(&packed_size, sizeof(packed_size));
+
+			if(packed_size == 0) {
+				read_buffer(data + offset, block_size);
+				continue;
+			}
+
+			if(packed_size > compressBound(block_size)) {
+				error_func->network_error("Network receive error: invalid compressed block size");
+				return;
+			}
+
+			packed.resize(packed_size);
+			read_buffer(&packed[0], packed_size);
+
+			uLongf dest_size = block_size;
+			if(uncompress(data + offset, &dest_size, &packed[0], packed_size) != Z_OK ||
+			   dest_size != block_size)
+			{
+				error_func->network_error("Network receive error: failed to decompress buffer");
+				return;
+			}
+		}
+	}
+
 	void read(DeviceTask& task)
 	{
 		int type;
@@ -464,6 +643,29 @@ private:
 	vector<string> servers;
 };
 
+/* Server */
+
+/* What a server did for one client connection. */
+struct NetworkServerStats {
+	NetworkServerStats()
+	: num_hashed_uploads(0), num_skipped_uploads(0), num_tiles(0)
+	{
+	}
+
+	/* uploads of read-only buffers identified by their contents, and those
+	 * of them for which the server already had the data */
+	int num_hashed_uploads;
+	int num_skipped_uploads;
+	/* tiles rendered by the server */
+	int num_tiles;
+};
+
+/* Accept one client on the acceptor and serve it with the device until the
+ * client disconnects. */
+void device_network_server_accept(Device *device,
+                                  tcp::acceptor *acceptor,
+                                  NetworkServerStats *stats = NULL);
+
 CCL_NAMESPACE_END
 
 #endif
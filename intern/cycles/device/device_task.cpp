@@ -32,7 +32,9 @@ DeviceTask::DeviceTask(Type type_)
 : type(type_), x(0), y(0), w(0), h(0), rgba_byte(0), rgba_half(0), buffer(0),
   sample(0), num_samples(1),
   shader_input(0), shader_output(0), shader_output_luma(0),
-  shader_eval_type(0), shader_filter(0), shader_x(0), shader_w(0)
+  shader_eval_type(0), shader_filter(0), shader_x(0), shader_w(0),
+  adaptive_sampling(false), adaptive_min_samples(0),
+  packet_traversal(false)
 {
 	last_update_time = time_dt();
 }
@@ -101,6 +103,19 @@ void DeviceTask::split(list<DeviceTask>& tasks, int num, int max_size)
 	}
 }
 
+bool DeviceTask::need_adaptive_filter(int sample) const
+{
+	/* Check every 4 samples, an even number of samples is needed for the
+	 * half buffer to hold exactly half of them. */
+	const int adaptive_step = 4;
+
+	if(!adaptive_sampling)
+		return false;
+
+	return (sample + 1) >= max(adaptive_min_samples, adaptive_step) &&
+	       (sample + 1) % adaptive_step == 0;
+}
+
 void DeviceTask::update_progress(RenderTile *rtile, int pixel_samples)
 {
 	if((type != RENDER) &&
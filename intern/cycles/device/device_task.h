@@ -76,6 +76,15 @@ public:
 	int pass_denoising_data;
 	int pass_denoising_clean;
 
+	bool adaptive_sampling;
+	int adaptive_min_samples;
+
+	/* Test whether the adaptive sampling convergence check should run after
+	 * the given sample was rendered. */
+	bool need_adaptive_filter(int sample) const;
+
+	bool packet_traversal;
+
 	bool need_finish_queue;
 	bool integrator_branched;
 	int2 requested_tile_size;
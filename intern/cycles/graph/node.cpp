@@ -18,6 +18,7 @@
 #include "graph/node_type.h"
 
 #include "util/util_foreach.h"
+#include "util/util_md5.h"
 #include "util/util_param.h"
 #include "util/util_transform.h"
 
@@ -403,5 +404,87 @@ bool Node::equals(const Node& other) const
 	return true;
 }
 
+/* hash */
+
+template<typename T>
+static void value_hash(const T& value, MD5Hash& md5)
+{
+	md5.append((const uint8_t*)&value, sizeof(T));
+}
+
+/* Only the used components, padding of float3 is not initialized. */
+static void value_hash(const float3& value, MD5Hash& md5)
+{
+	md5.append((const uint8_t*)&value.x, sizeof(float));
+	md5.append((const uint8_t*)&value.y, sizeof(float));
+	md5.append((const uint8_t*)&value.z, sizeof(float));
+}
+
+static void value_hash(const ustring& value, MD5Hash& md5)
+{
+	value_hash((int)value.size(), md5);
+	md5.append((const uint8_t*)value.c_str(), value.size());
+}
+
+template<typename T>
+static void array_hash(const Node *node, const SocketType& socket, MD5Hash& md5)
+{
+	const array<T>& a = get_socket_value<array<T> >(node, socket);
+	value_hash((int)a.size(), md5);
+	for(size_t i = 0; i < a.size(); i++) {
+		value_hash(a[i], md5);
+	}
+}
+
+static void node_hash(const Node *node, MD5Hash& md5, bool use_node_references)
+{
+	const NodeType *type = node->type;
+	md5.append((const uint8_t*)type->name.c_str(), type->name.size());
+
+	foreach(const SocketType& socket, type->inputs) {
+		if(!use_node_references &&
+		   (socket.type == SocketType::NODE || socket.type == SocketType::NODE_ARRAY))
+		{
+			continue;
+		}
+
+		switch(socket.type) {
+			case SocketType::COLOR:
+			case SocketType::VECTOR:
+			case SocketType::POINT:
+			case SocketType::NORMAL:
+				value_hash(get_socket_value<float3>(node, socket), md5);
+				break;
+			case SocketType::STRING:
+				value_hash(get_socket_value<ustring>(node, socket), md5);
+				break;
+			case SocketType::BOOLEAN_ARRAY: array_hash<bool>(node, socket, md5); break;
+			case SocketType::FLOAT_ARRAY: array_hash<float>(node, socket, md5); break;
+			case SocketType::INT_ARRAY: array_hash<int>(node, socket, md5); break;
+			case SocketType::COLOR_ARRAY: array_hash<float3>(node, socket, md5); break;
+			case SocketType::VECTOR_ARRAY: array_hash<float3>(node, socket, md5); break;
+			case SocketType::POINT_ARRAY: array_hash<float3>(node, socket, md5); break;
+			case SocketType::NORMAL_ARRAY: array_hash<float3>(node, socket, md5); break;
+			case SocketType::POINT2_ARRAY: array_hash<float2>(node, socket, md5); break;
+			case SocketType::STRING_ARRAY: array_hash<ustring>(node, socket, md5); break;
+			case SocketType::TRANSFORM_ARRAY: array_hash<Transform>(node, socket, md5); break;
+			case SocketType::NODE_ARRAY: array_hash<Node*>(node, socket, md5); break;
+			default:
+				md5.append(((const uint8_t*)node) + socket.struct_offset, socket.size());
+				break;
+		}
+	}
+}
+
+void Node::hash(MD5Hash& md5) const
+{
+	node_hash(this, md5, true);
+}
+
+void Node::hash_values(MD5Hash& md5) const
+{
+	node_hash(this, md5, false);
+}
+
 CCL_NAMESPACE_END
 
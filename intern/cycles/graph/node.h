@@ -24,6 +24,7 @@
 
 CCL_NAMESPACE_BEGIN
 
+class MD5Hash;
 struct Node;
 struct NodeType;
 struct Transform;
@@ -88,6 +89,12 @@ struct Node
 	/* equals */
 	bool equals(const Node& other) const;
 
+	/* hash of the type and all input values, nodes with equal values hash the same */
+	void hash(MD5Hash& md5) const;
+	/* same but leaving out inputs referencing other nodes, their pointers
+	 * differ between runs while the hash must not */
+	void hash_values(MD5Hash& md5) const;
+
 	ustring name;
 	const NodeType *type;
 };
@@ -157,6 +157,12 @@ CCL_NAMESPACE_BEGIN
 #undef BVH_NAME_EVAL
 #undef BVH_FUNCTION_FULL_NAME
 
+/* Packet traversal */
+
+#if defined(__QBVH__) && defined(__KERNEL_CPU__)
+#  include "kernel/bvh/qbvh_packet.h"
+#endif
+
 /* Note: ray is passed by value to work around a possible CUDA compiler bug. */
 ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
                                           const Ray ray,
@@ -201,6 +207,36 @@ ccl_device_intersect bool scene_intersect(KernelGlobals *kg,
 #endif /* __KERNEL_CPU__ */
 }
 
+#ifdef __KERNEL_CPU__
+/* Intersect up to BVH_PACKET_SIZE rays, returns a mask of the rays which hit
+ * something. Scenes which the packet traversal does not support are traced
+ * one ray at a time. */
+ccl_device_intersect uint scene_intersect_packet(KernelGlobals *kg,
+                                                 const Ray *rays,
+                                                 Intersection *isects,
+                                                 const uint visibility,
+                                                 const int num_rays)
+{
+#ifdef __QBVH__
+	if(kernel_data.bvh.use_qbvh &&
+	   !kernel_data.bvh.have_motion &&
+	   !kernel_data.bvh.have_curves &&
+	   !kernel_data.bvh.have_instancing)
+	{
+		return qbvh_intersect_packet(kg, rays, isects, visibility, num_rays);
+	}
+#endif /* __QBVH__ */
+
+	uint hits = 0;
+	for(int i = 0; i < num_rays; i++) {
+		if(scene_intersect(kg, rays[i], visibility, &isects[i], NULL, 0.0f, 0.0f)) {
+			hits |= (1u << i);
+		}
+	}
+	return hits;
+}
+#endif /* __KERNEL_CPU__ */
+
 #ifdef __SUBSURFACE__
 /* Note: ray is passed by value to work around a possible CUDA compiler bug. */
 ccl_device_intersect void scene_intersect_subsurface(KernelGlobals *kg,
@@ -21,6 +21,11 @@ struct QBVHStackItem {
 	float dist;
 };
 
+struct QBVHPacketStackItem {
+	int addr;
+	uint mask;
+};
+
 ccl_device_inline void qbvh_near_far_idx_calc(const float3& idir,
                                               int *ccl_restrict near_x,
                                               int *ccl_restrict near_y,
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* QBVH packet traversal for the CPU.
+ *
+ * Up to BVH_PACKET_SIZE rays traverse the tree together with a shared stack.
+ * Each stack item holds a mask of the rays which still need to visit the node,
+ * so the node data is fetched once for the whole packet, and the four child
+ * boxes of a node are tested with SSE for each ray. This works well for
+ * coherent rays such as camera rays of neighboring pixels, or shadow rays
+ * from one shading point to many lights.
+ *
+ * Only triangles without instancing or motion blur are supported, the caller
+ * falls back to single ray traversal otherwise.
+ */
+
+ccl_device uint qbvh_intersect_packet(KernelGlobals *kg,
+                                      const Ray *rays,
+                                      Intersection *isects,
+                                      const uint visibility,
+                                      const int num_rays)
+{
+	kernel_assert(num_rays <= BVH_PACKET_SIZE);
+
+	/* Traversal stack. */
+	QBVHPacketStackItem traversal_stack[BVH_QSTACK_SIZE];
+	traversal_stack[0].addr = ENTRYPOINT_SENTINEL;
+	traversal_stack[0].mask = 0;
+
+	/* Ray parameters. */
+	float3 P[BVH_PACKET_SIZE];
+	float3 dir[BVH_PACKET_SIZE];
+	sse3f idir4[BVH_PACKET_SIZE];
+#ifdef __KERNEL_AVX2__
+	sse3f P_idir4[BVH_PACKET_SIZE];
+#else
+	sse3f org4[BVH_PACKET_SIZE];
+#endif
+	int near_x[BVH_PACKET_SIZE], near_y[BVH_PACKET_SIZE], near_z[BVH_PACKET_SIZE];
+	int far_x[BVH_PACKET_SIZE], far_y[BVH_PACKET_SIZE], far_z[BVH_PACKET_SIZE];
+
+	/* Rays which did not terminate yet. */
+	uint active = 0;
+
+	for(int i = 0; i < num_rays; i++) {
+		const Ray *ray = &rays[i];
+		Intersection *isect = &isects[i];
+
+		isect->t = ray->t;
+		isect->u = 0.0f;
+		isect->v = 0.0f;
+		isect->prim = PRIM_NONE;
+		isect->object = OBJECT_NONE;
+#ifdef __KERNEL_DEBUG__
+		isect->num_traversed_nodes = 0;
+		isect->num_traversed_instances = 0;
+		isect->num_intersections = 0;
+#endif
+
+		P[i] = ray->P;
+		dir[i] = bvh_clamp_direction(ray->D);
+		float3 idir = bvh_inverse_direction(dir[i]);
+
+		idir4[i] = sse3f(ssef(idir.x), ssef(idir.y), ssef(idir.z));
+#ifdef __KERNEL_AVX2__
+		float3 P_idir = P[i]*idir;
+		P_idir4[i] = sse3f(P_idir.x, P_idir.y, P_idir.z);
+#else
+		org4[i] = sse3f(ssef(P[i].x), ssef(P[i].y), ssef(P[i].z));
+#endif
+
+		qbvh_near_far_idx_calc(idir,
+		                       &near_x[i], &near_y[i], &near_z[i],
+		                       &far_x[i], &far_y[i], &far_z[i]);
+
+		if(isfinite(P[i].x)) {
+			active |= (1u << i);
+		}
+	}
+
+	/* Traversal variables. */
+	int stack_ptr = 0;
+	int node_addr = kernel_data.bvh.root;
+	uint node_mask = active;
+	uint hits = 0;
+
+	const ssef tnear(0.0f);
+
+	while(node_addr != ENTRYPOINT_SENTINEL) {
+		/* Skip rays which terminated since the node was pushed. */
+		node_mask &= active;
+
+		if(node_mask == 0) {
+			/* Pop. */
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			--stack_ptr;
+			continue;
+		}
+
+		if(node_addr >= 0) {
+			/* Traverse internal node. */
+			float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+			(void)inodes;
+
+#ifdef __VISIBILITY_FLAG__
+			if((__float_as_uint(inodes.x) & visibility) == 0) {
+				/* Pop. */
+				node_addr = traversal_stack[stack_ptr].addr;
+				node_mask = traversal_stack[stack_ptr].mask;
+				--stack_ptr;
+				continue;
+			}
+#endif
+
+			/* Fetch child bounds once for the whole packet. */
+			ssef bounds[6];
+			for(int j = 0; j < 6; j++) {
+				bounds[j] = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+1+j);
+			}
+
+			uint child_rays[4] = {0, 0, 0, 0};
+			float child_dist[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+
+			uint ray_mask = node_mask;
+			while(ray_mask) {
+				const int i = __bscf(ray_mask);
+				const ssef tfar(isects[i].t);
+
+#ifdef __KERNEL_AVX2__
+				const ssef tnear_x = msub(bounds[near_x[i]], idir4[i].x, P_idir4[i].x);
+				const ssef tnear_y = msub(bounds[near_y[i]], idir4[i].y, P_idir4[i].y);
+				const ssef tnear_z = msub(bounds[near_z[i]], idir4[i].z, P_idir4[i].z);
+				const ssef tfar_x = msub(bounds[far_x[i]], idir4[i].x, P_idir4[i].x);
+				const ssef tfar_y = msub(bounds[far_y[i]], idir4[i].y, P_idir4[i].y);
+				const ssef tfar_z = msub(bounds[far_z[i]], idir4[i].z, P_idir4[i].z);
+#else
+				const ssef tnear_x = (bounds[near_x[i]] - org4[i].x) * idir4[i].x;
+				const ssef tnear_y = (bounds[near_y[i]] - org4[i].y) * idir4[i].y;
+				const ssef tnear_z = (bounds[near_z[i]] - org4[i].z) * idir4[i].z;
+				const ssef tfar_x = (bounds[far_x[i]] - org4[i].x) * idir4[i].x;
+				const ssef tfar_y = (bounds[far_y[i]] - org4[i].y) * idir4[i].y;
+				const ssef tfar_z = (bounds[far_z[i]] - org4[i].z) * idir4[i].z;
+#endif
+
+#ifdef __KERNEL_SSE41__
+				const ssef dist_near = maxi(maxi(tnear_x, tnear_y), maxi(tnear_z, tnear));
+				const ssef dist_far = mini(mini(tfar_x, tfar_y), mini(tfar_z, tfar));
+				const sseb vmask = cast(dist_near) > cast(dist_far);
+				int child_mask = (int)movemask(vmask)^0xf;
+#else
+				const ssef dist_near = max4(tnear_x, tnear_y, tnear_z, tnear);
+				const ssef dist_far = min4(tfar_x, tfar_y, tfar_z, tfar);
+				const sseb vmask = dist_near <= dist_far;
+				int child_mask = (int)movemask(vmask);
+#endif
+
+				while(child_mask) {
+					const int c = __bscf(child_mask);
+					child_rays[c] |= (1u << i);
+					child_dist[c] = min(child_dist[c], dist_near[c]);
+				}
+			}
+
+			float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+7);
+
+			/* Push hit children sorted far to near, so the nearest child
+			 * ends up on top of the stack. */
+			int num_children = 0;
+			int children[4];
+			for(int c = 0; c < 4; c++) {
+				if(child_rays[c] == 0) {
+					continue;
+				}
+				int k = num_children++;
+				while(k > 0 && child_dist[children[k-1]] < child_dist[c]) {
+					children[k] = children[k-1];
+					--k;
+				}
+				children[k] = c;
+			}
+
+			for(int k = 0; k < num_children; k++) {
+				++stack_ptr;
+				kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+				traversal_stack[stack_ptr].addr = __float_as_int(cnodes[children[k]]);
+				traversal_stack[stack_ptr].mask = child_rays[children[k]];
+			}
+		}
+		else {
+			/* Intersect leaf primitives. */
+			float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr-1));
+
+#ifdef __VISIBILITY_FLAG__
+			if((__float_as_uint(leaf.z) & visibility) != 0)
+#endif
+			{
+				int prim_addr = __float_as_int(leaf.x);
+				int prim_addr2 = __float_as_int(leaf.y);
+				kernel_assert(prim_addr >= 0);
+				kernel_assert((__float_as_uint(leaf.w) & PRIMITIVE_ALL) == PRIMITIVE_TRIANGLE);
+
+				for(; prim_addr < prim_addr2; prim_addr++) {
+					uint ray_mask = node_mask & active;
+					while(ray_mask) {
+						const int i = __bscf(ray_mask);
+						if(triangle_intersect(kg,
+						                      &isects[i],
+						                      P[i],
+						                      dir[i],
+						                      visibility,
+						                      OBJECT_NONE,
+						                      prim_addr))
+						{
+							hits |= (1u << i);
+							/* Shadow ray early termination. */
+							if(visibility == PATH_RAY_SHADOW_OPAQUE) {
+								active &= ~(1u << i);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		/* Pop. */
+		node_addr = traversal_stack[stack_ptr].addr;
+		node_mask = traversal_stack[stack_ptr].mask;
+		--stack_ptr;
+	}
+
+	return hits;
+}
@@ -26,10 +26,37 @@ ccl_device_inline void kernel_filter_nlm_calc_difference(int dx, int dy,
                                                          float a,
                                                          float k_2)
 {
+	int numChannels = channel_offset? 3 : 1;
+#ifdef __KERNEL_AVX__
+	const __m256 a_8 = _mm256_set1_ps(a);
+	const __m256 k_2_8 = _mm256_set1_ps(k_2);
+	const __m256 epsilon_8 = _mm256_set1_ps(1e-8f);
+	const __m256 channel_fac_8 = _mm256_set1_ps(1.0f/numChannels);
+#endif
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
+		int x = rect.x;
+#ifdef __KERNEL_AVX__
+		/* Eight pixels at a time, the remaining ones are handled by the scalar loop. */
+		for(; x + 8 <= rect.z; x += 8) {
+			__m256 diff = _mm256_setzero_ps();
+			for(int c = 0; c < numChannels; c++) {
+				int p_ofs = c*channel_offset + y*w+x;
+				int q_ofs = c*channel_offset + (y+dy)*w+(x+dx);
+				__m256 cdiff = _mm256_sub_ps(_mm256_loadu_ps(weight_image + p_ofs), _mm256_loadu_ps(weight_image + q_ofs));
+				__m256 pvar = _mm256_loadu_ps(variance_image + p_ofs);
+				__m256 qvar = _mm256_loadu_ps(variance_image + q_ofs);
+				__m256 num = _mm256_sub_ps(_mm256_mul_ps(cdiff, cdiff), _mm256_mul_ps(a_8, _mm256_add_ps(pvar, _mm256_min_ps(pvar, qvar))));
+				__m256 den = _mm256_add_ps(epsilon_8, _mm256_mul_ps(k_2_8, _mm256_add_ps(pvar, qvar)));
+				diff = _mm256_add_ps(diff, _mm256_div_ps(num, den));
+			}
+			if(numChannels > 1) {
+				diff = _mm256_mul_ps(diff, channel_fac_8);
+			}
+			_mm256_storeu_ps(difference_image + y*w+x, diff);
+		}
+#endif
+		for(; x < rect.z; x++) {
 			float diff = 0.0f;
-			int numChannels = channel_offset? 3 : 1;
 			for(int c = 0; c < numChannels; c++) {
 				float cdiff = weight_image[c*channel_offset + y*w+x] - weight_image[c*channel_offset + (y+dy)*w+(x+dx)];
 				float pvar = variance_image[c*channel_offset + y*w+x];
@@ -50,10 +77,34 @@ ccl_device_inline void kernel_filter_nlm_blur(const float *ccl_restrict differen
                                               int w,
                                               int f)
 {
-#ifdef __KERNEL_SSE3__
+#ifdef __KERNEL_AVX__
+	/* Sum up eight columns at a time in registers instead of accumulating
+	 * in the output image. */
+	for(int y = rect.y; y < rect.w; y++) {
+		const int low = max(rect.y, y-f);
+		const int high = min(rect.w, y+f+1);
+		const float fac = 1.0f/(high - low);
+		int x = rect.x;
+		for(; x + 8 <= rect.z; x += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for(int y1 = low; y1 < high; y1++) {
+				sum = _mm256_add_ps(sum, _mm256_loadu_ps(difference_image + y1*w+x));
+			}
+			_mm256_storeu_ps(out_image + y*w+x, _mm256_mul_ps(sum, _mm256_set1_ps(fac)));
+		}
+		for(; x < rect.z; x++) {
+			float sum = 0.0f;
+			for(int y1 = low; y1 < high; y1++) {
+				sum += difference_image[y1*w+x];
+			}
+			out_image[y*w+x] = sum*fac;
+		}
+	}
+#else
+#  ifdef __KERNEL_SSE3__
 	int aligned_lowx = (rect.x & ~(3));
 	int aligned_highx = ((rect.z + 3) & ~(3));
-#endif
+#  endif
 	for(int y = rect.y; y < rect.w; y++) {
 		const int low = max(rect.y, y-f);
 		const int high = min(rect.w, y+f+1);
@@ -61,20 +112,21 @@ ccl_device_inline void kernel_filter_nlm_blur(const float *ccl_restrict differen
 			out_image[y*w+x] = 0.0f;
 		}
 		for(int y1 = low; y1 < high; y1++) {
-#ifdef __KERNEL_SSE3__
+#  ifdef __KERNEL_SSE3__
 			for(int x = aligned_lowx; x < aligned_highx; x+=4) {
 				_mm_store_ps(out_image + y*w+x, _mm_add_ps(_mm_load_ps(out_image + y*w+x), _mm_load_ps(difference_image + y1*w+x)));
 			}
-#else
+#  else
 			for(int x = rect.x; x < rect.z; x++) {
 				out_image[y*w+x] += difference_image[y1*w+x];
 			}
-#endif
+#  endif
 		}
 		for(int x = rect.x; x < rect.z; x++) {
 			out_image[y*w+x] *= 1.0f/(high - low);
 		}
 	}
+#endif
 }
 
 ccl_device_inline void kernel_filter_nlm_calc_weight(const float *ccl_restrict difference_image,
@@ -92,7 +144,14 @@ ccl_device_inline void kernel_filter_nlm_calc_weight(const float *ccl_restrict d
 		int pos_dx = max(0, dx);
 		int neg_dx = min(0, dx);
 		for(int y = rect.y; y < rect.w; y++) {
-			for(int x = rect.x-neg_dx; x < rect.z-pos_dx; x++) {
+			int x = rect.x-neg_dx;
+#ifdef __KERNEL_AVX__
+			for(; x + 8 <= rect.z-pos_dx; x += 8) {
+				_mm256_storeu_ps(out_image + y*w+x, _mm256_add_ps(_mm256_loadu_ps(out_image + y*w+x),
+				                                                  _mm256_loadu_ps(difference_image + y*w+dx+x)));
+			}
+#endif
+			for(; x < rect.z-pos_dx; x++) {
 				out_image[y*w+x] += difference_image[y*w+dx+x];
 			}
 		}
@@ -106,6 +165,27 @@ ccl_device_inline void kernel_filter_nlm_calc_weight(const float *ccl_restrict d
 	}
 }
 
+ccl_device_inline void kernel_filter_nlm_update_output_pixel(int x, int y,
+                                                             int dx, int dy,
+                                                             const float *ccl_restrict difference_image,
+                                                             const float *ccl_restrict image,
+                                                             float *out_image,
+                                                             float *accum_image,
+                                                             int4 rect,
+                                                             int w,
+                                                             int f)
+{
+	const int low = max(rect.x, x-f);
+	const int high = min(rect.z, x+f+1);
+	float sum = 0.0f;
+	for(int x1 = low; x1 < high; x1++) {
+		sum += difference_image[y*w+x1];
+	}
+	float weight = sum * (1.0f/(high - low));
+	accum_image[y*w+x] += weight;
+	out_image[y*w+x] += weight*image[(y+dy)*w+(x+dx)];
+}
+
 ccl_device_inline void kernel_filter_nlm_update_output(int dx, int dy,
                                                        const float *ccl_restrict difference_image,
                                                        const float *ccl_restrict image,
@@ -116,16 +196,27 @@ ccl_device_inline void kernel_filter_nlm_update_output(int dx, int dy,
                                                        int f)
 {
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
-			const int low = max(rect.x, x-f);
-			const int high = min(rect.z, x+f+1);
-			float sum = 0.0f;
-			for(int x1 = low; x1 < high; x1++) {
-				sum += difference_image[y*w+x1];
+		int x = rect.x;
+#ifdef __KERNEL_AVX__
+		/* Pixels whose window is clipped by the rect are handled by the scalar
+		 * loop, so only the borders are computed one at a time. */
+		for(; x < min(rect.x+f, rect.z); x++) {
+			kernel_filter_nlm_update_output_pixel(x, y, dx, dy, difference_image, image, out_image, accum_image, rect, w, f);
+		}
+		const __m256 fac = _mm256_set1_ps(1.0f/(2*f+1));
+		for(; x + 8 + f <= rect.z; x += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for(int x1 = x-f; x1 <= x+f; x1++) {
+				sum = _mm256_add_ps(sum, _mm256_loadu_ps(difference_image + y*w+x1));
 			}
-			float weight = sum * (1.0f/(high - low));
-			accum_image[y*w+x] += weight;
-			out_image[y*w+x] += weight*image[(y+dy)*w+(x+dx)];
+			__m256 weight = _mm256_mul_ps(sum, fac);
+			_mm256_storeu_ps(accum_image + y*w+x, _mm256_add_ps(_mm256_loadu_ps(accum_image + y*w+x), weight));
+			__m256 color = _mm256_loadu_ps(image + (y+dy)*w+(x+dx));
+			_mm256_storeu_ps(out_image + y*w+x, _mm256_add_ps(_mm256_loadu_ps(out_image + y*w+x), _mm256_mul_ps(weight, color)));
+		}
+#endif
+		for(; x < rect.z; x++) {
+			kernel_filter_nlm_update_output_pixel(x, y, dx, dy, difference_image, image, out_image, accum_image, rect, w, f);
 		}
 	}
 }
@@ -180,7 +271,14 @@ ccl_device_inline void kernel_filter_nlm_normalize(float *out_image,
                                                    int w)
 {
 	for(int y = rect.y; y < rect.w; y++) {
-		for(int x = rect.x; x < rect.z; x++) {
+		int x = rect.x;
+#ifdef __KERNEL_AVX__
+		for(; x + 8 <= rect.z; x += 8) {
+			_mm256_storeu_ps(out_image + y*w+x, _mm256_div_ps(_mm256_loadu_ps(out_image + y*w+x),
+			                                                  _mm256_loadu_ps(accum_image + y*w+x)));
+		}
+#endif
+		for(; x < rect.z; x++) {
 			out_image[y*w+x] /= accum_image[y*w+x];
 		}
 	}
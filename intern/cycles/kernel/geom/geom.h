@@ -25,6 +25,7 @@
 #include "kernel/geom/geom_motion_triangle.h"
 #include "kernel/geom/geom_motion_triangle_intersect.h"
 #include "kernel/geom/geom_motion_triangle_shader.h"
+#include "kernel/geom/geom_curve_keys.h"
 #include "kernel/geom/geom_motion_curve.h"
 #include "kernel/geom/geom_curve.h"
 #include "kernel/geom/geom_volume.h"
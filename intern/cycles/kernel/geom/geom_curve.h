@@ -118,8 +118,7 @@ ccl_device float curve_thickness(KernelGlobals *kg, ShaderData *sd)
 		float4 P_curve[2];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			curve_keys_fetch(kg, sd->prim, k0, k1, P_curve);
 		}
 		else {
 			motion_curve_keys(kg, sd->object, sd->prim, sd->time, k0, k1, P_curve);
@@ -142,8 +141,7 @@ ccl_device float3 curve_motion_center_location(KernelGlobals *kg, ShaderData *sd
 
 	float4 P_curve[2];
 
-	P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-	P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+	curve_keys_fetch(kg, sd->prim, k0, k1, P_curve);
 
 	return float4_to_float3(P_curve[1]) * sd->u + float4_to_float3(P_curve[0]) * (1.0f - sd->u);
 }
@@ -273,8 +271,10 @@ ccl_device_curveintersect bool bvh_cardinal_curve_intersect(KernelGlobals *kg, I
 #if defined(__KERNEL_AVX2__) && defined(__KERNEL_SSE__) && (!defined(_MSC_VER) || _MSC_VER > 1800)
 		avxf P_curve_0_1, P_curve_2_3;
 		if(is_curve_primitive) {
-			P_curve_0_1 = _mm256_loadu2_m128(&kg->__curve_keys.data[k0].x, &kg->__curve_keys.data[ka].x);
-			P_curve_2_3 = _mm256_loadu2_m128(&kg->__curve_keys.data[kb].x, &kg->__curve_keys.data[k1].x);
+			float4 keys[4];
+			cardinal_curve_keys_fetch(kg, prim, ka, k0, k1, kb, keys);
+			P_curve_0_1 = _mm256_loadu2_m128(&keys[1].x, &keys[0].x);
+			P_curve_2_3 = _mm256_loadu2_m128(&keys[3].x, &keys[2].x);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE) ? kernel_tex_fetch(__prim_object, curveAddr) : object;
@@ -284,10 +284,7 @@ ccl_device_curveintersect bool bvh_cardinal_curve_intersect(KernelGlobals *kg, I
 		ssef P_curve[4];
 
 		if(is_curve_primitive) {
-			P_curve[0] = load4f(&kg->__curve_keys.data[ka].x);
-			P_curve[1] = load4f(&kg->__curve_keys.data[k0].x);
-			P_curve[2] = load4f(&kg->__curve_keys.data[k1].x);
-			P_curve[3] = load4f(&kg->__curve_keys.data[kb].x);
+			cardinal_curve_keys_fetch(kg, prim, ka, k0, k1, kb, (float4*)&P_curve);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -379,10 +376,7 @@ ccl_device_curveintersect bool bvh_cardinal_curve_intersect(KernelGlobals *kg, I
 		float4 P_curve[4];
 
 		if(is_curve_primitive) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			cardinal_curve_keys_fetch(kg, prim, ka, k0, k1, kb, P_curve);
 		}
 		else {
 			int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -728,8 +722,7 @@ ccl_device_curveintersect bool bvh_curve_intersect(KernelGlobals *kg, Intersecti
 	float4 P_curve[2];
 
 	if(is_curve_primitive) {
-		P_curve[0] = kernel_tex_fetch(__curve_keys, k0);
-		P_curve[1] = kernel_tex_fetch(__curve_keys, k1);
+		curve_keys_fetch(kg, prim, k0, k1, P_curve);
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -763,8 +756,7 @@ ccl_device_curveintersect bool bvh_curve_intersect(KernelGlobals *kg, Intersecti
 	ssef P_curve[2];
 	
 	if(is_curve_primitive) {
-		P_curve[0] = load4f(&kg->__curve_keys.data[k0].x);
-		P_curve[1] = load4f(&kg->__curve_keys.data[k1].x);
+		curve_keys_fetch(kg, prim, k0, k1, (float4*)&P_curve);
 	}
 	else {
 		int fobject = (object == OBJECT_NONE)? kernel_tex_fetch(__prim_object, curveAddr): object;
@@ -997,10 +989,7 @@ ccl_device_inline float3 bvh_curve_refine(KernelGlobals *kg, ShaderData *sd, con
 		float4 P_curve[4];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0] = kernel_tex_fetch(__curve_keys, ka);
-			P_curve[1] = kernel_tex_fetch(__curve_keys, k0);
-			P_curve[2] = kernel_tex_fetch(__curve_keys, k1);
-			P_curve[3] = kernel_tex_fetch(__curve_keys, kb);
+			cardinal_curve_keys_fetch(kg, sd->prim, ka, k0, k1, kb, P_curve);
 		}
 		else {
 			motion_cardinal_curve_keys(kg, sd->object, sd->prim, sd->time, ka, k0, k1, kb, P_curve);
@@ -1047,8 +1036,7 @@ ccl_device_inline float3 bvh_curve_refine(KernelGlobals *kg, ShaderData *sd, con
 		float4 P_curve[2];
 
 		if(sd->type & PRIMITIVE_CURVE) {
-			P_curve[0]= kernel_tex_fetch(__curve_keys, k0);
-			P_curve[1]= kernel_tex_fetch(__curve_keys, k1);
+			curve_keys_fetch(kg, sd->prim, k0, k1, P_curve);
 		}
 		else {
 			motion_curve_keys(kg, sd->object, sd->prim, sd->time, k0, k1, P_curve);
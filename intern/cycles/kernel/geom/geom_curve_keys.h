@@ -0,0 +1,87 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Curve Keys
+ *
+ * Curve keys are stored in 8 bytes each, as 16 bit fixed point positions
+ * relative to the bounds of their curve and a 16 bit radius relative to the
+ * largest radius of the curve. Per curve, __curve_bounds stores the bounds
+ * origin and the position scale, and the w component of __curves stores the
+ * radius scale.
+ *
+ * The key positions and radii on the host are snapped to the same grid, so
+ * BVH bounds computed there match what is intersected here.
+ *
+ * Without CURVE_KN_COMPACT_KEYS the keys are stored at full precision, as
+ * four floats each.
+ */
+
+#ifdef __HAIR__
+
+ccl_device_inline float4 curve_key_decode(KernelGlobals *kg, float4 bounds, float radius_scale, int k)
+{
+	if(!(kernel_data.curve.curveflags & CURVE_KN_COMPACT_KEYS)) {
+		return make_float4(__uint_as_float(kernel_tex_fetch(__curve_keys, k*4)),
+		                   __uint_as_float(kernel_tex_fetch(__curve_keys, k*4 + 1)),
+		                   __uint_as_float(kernel_tex_fetch(__curve_keys, k*4 + 2)),
+		                   __uint_as_float(kernel_tex_fetch(__curve_keys, k*4 + 3)));
+	}
+
+	const uint xy = kernel_tex_fetch(__curve_keys, k*2);
+	const uint zr = kernel_tex_fetch(__curve_keys, k*2 + 1);
+
+	return make_float4(bounds.x + (float)(xy & 0xffff) * bounds.w,
+	                   bounds.y + (float)(xy >> 16) * bounds.w,
+	                   bounds.z + (float)(zr & 0xffff) * bounds.w,
+	                   (float)(zr >> 16) * radius_scale);
+}
+
+/* return single curve key location and radius */
+ccl_device_inline float4 curve_key_fetch(KernelGlobals *kg, int prim, int k)
+{
+	const float4 bounds = kernel_tex_fetch(__curve_bounds, prim);
+	const float radius_scale = kernel_tex_fetch(__curves, prim).w;
+
+	return curve_key_decode(kg, bounds, radius_scale, k);
+}
+
+/* return 2 curve key locations */
+ccl_device_inline void curve_keys_fetch(KernelGlobals *kg, int prim, int k0, int k1, float4 keys[2])
+{
+	const float4 bounds = kernel_tex_fetch(__curve_bounds, prim);
+	const float radius_scale = kernel_tex_fetch(__curves, prim).w;
+
+	keys[0] = curve_key_decode(kg, bounds, radius_scale, k0);
+	keys[1] = curve_key_decode(kg, bounds, radius_scale, k1);
+}
+
+/* return 4 curve key locations */
+ccl_device_inline void cardinal_curve_keys_fetch(KernelGlobals *kg, int prim, int k0, int k1, int k2, int k3, float4 keys[4])
+{
+	const float4 bounds = kernel_tex_fetch(__curve_bounds, prim);
+	const float radius_scale = kernel_tex_fetch(__curves, prim).w;
+
+	keys[0] = curve_key_decode(kg, bounds, radius_scale, k0);
+	keys[1] = curve_key_decode(kg, bounds, radius_scale, k1);
+	keys[2] = curve_key_decode(kg, bounds, radius_scale, k2);
+	keys[3] = curve_key_decode(kg, bounds, radius_scale, k3);
+}
+
+#endif
+
+CCL_NAMESPACE_END
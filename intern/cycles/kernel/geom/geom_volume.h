@@ -115,6 +115,46 @@ ccl_device float3 volume_attribute_float3(KernelGlobals *kg, const ShaderData *s
 	return float4_to_float3(r);
 }
 
+#ifdef __KERNEL_CPU__
+/* Test if all voxel attributes of the object are stored as sparse grids and
+ * are empty at the shading position. Objects without voxel attributes or
+ * with dense ones are never considered empty. */
+ccl_device bool volume_sparse_grids_empty(KernelGlobals *kg, const ShaderData *sd)
+{
+	const uint attributes[] = {ATTR_STD_VOLUME_DENSITY,
+	                           ATTR_STD_VOLUME_COLOR,
+	                           ATTR_STD_VOLUME_FLAME,
+	                           ATTR_STD_VOLUME_HEAT,
+	                           ATTR_STD_VOLUME_VELOCITY};
+	bool found = false;
+	float3 P;
+
+	for(size_t i = 0; i < sizeof(attributes)/sizeof(attributes[0]); i++) {
+		const AttributeDescriptor desc = find_attribute(kg, sd, attributes[i]);
+
+		if(desc.offset == ATTR_STD_NOT_FOUND || desc.element != ATTR_ELEMENT_VOXEL) {
+			continue;
+		}
+
+		const SparseGridImage *grid = kernel_tex_image_sparse_grid(kg, desc.offset);
+		if(grid == NULL) {
+			return false;
+		}
+
+		if(!found) {
+			P = volume_normalized_position(kg, sd, sd->P);
+			found = true;
+		}
+
+		if(!grid->empty(P.x, P.y, P.z)) {
+			return false;
+		}
+	}
+
+	return found;
+}
+#endif
+
 #endif
 
 CCL_NAMESPACE_END
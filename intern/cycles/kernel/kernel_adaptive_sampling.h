@@ -0,0 +1,137 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Adaptive Sampling
+ *
+ * The auxiliary pass accumulates the combined pass from odd samples only,
+ * weighted by two. Both the full and the half buffer are then estimates of
+ * the same pixel value, and their difference is used as the per pixel error.
+ *
+ * The fourth component holds the convergence state of the pixel:
+ *  0: not converged, keep sampling
+ * <0: converged at this check, pending the neighborhood filter
+ * >0: converged, number of samples the pixel received
+ */
+
+ccl_device_inline ccl_global float4 *kernel_adaptive_aux(KernelGlobals *kg,
+                                                         ccl_global float *buffer)
+{
+	return (ccl_global float4*)(buffer + kernel_data.film.pass_adaptive_aux_buffer);
+}
+
+ccl_device_inline bool kernel_adaptive_pixel_converged(KernelGlobals *kg,
+                                                       ccl_global float *buffer)
+{
+	return kernel_data.film.pass_adaptive_aux_buffer &&
+	       kernel_adaptive_aux(kg, buffer)->w > 0.0f;
+}
+
+/* Test a pixel against the noise threshold, after sample has been added. */
+ccl_device void kernel_adaptive_stopping(KernelGlobals *kg,
+	ccl_global float *buffer, int sample, int x, int y, int offset, int stride)
+{
+	int index = offset + x + y*stride;
+	buffer += index*kernel_data.film.pass_stride;
+
+	ccl_global float4 *aux = kernel_adaptive_aux(kg, buffer);
+
+	if(aux->w > 0.0f)
+		return;
+
+	float inv_num_samples = 1.0f/(float)(sample + 1);
+	float4 I = *((ccl_global float4*)buffer) * inv_num_samples;
+	float4 A = *aux * inv_num_samples;
+
+	/* The per pixel error from section 2.1 of "A hierarchical automatic
+	 * stopping condition for Monte Carlo global illumination", with a small
+	 * epsilon to avoid division by zero on black pixels. */
+	float error = (fabsf(I.x - A.x) + fabsf(I.y - A.y) + fabsf(I.z - A.z)) /
+	              (1e-4f + sqrtf(max(I.x + I.y + I.z, 0.0f)));
+
+	aux->w = (error < kernel_data.integrator.adaptive_threshold)? -(float)(sample + 1): 0.0f;
+}
+
+/* Confirm pixels which converged at this check only if none of their direct
+ * neighbors in the tile still needs samples, so that noise near edges of
+ * converged regions is not left behind. Returns true if the pixel is
+ * converged. */
+ccl_device bool kernel_adaptive_filter(KernelGlobals *kg,
+	ccl_global float *buffer, int x, int y,
+	int sx, int sy, int sw, int sh, int offset, int stride)
+{
+	int pass_stride = kernel_data.film.pass_stride;
+	ccl_global float *pixel = buffer + (offset + x + y*stride)*pass_stride;
+	ccl_global float4 *aux = kernel_adaptive_aux(kg, pixel);
+
+	if(aux->w > 0.0f)
+		return true;
+	else if(aux->w == 0.0f)
+		return false;
+
+	for(int dy = max(y - 1, sy); dy <= min(y + 1, sy + sh - 1); dy++) {
+		for(int dx = max(x - 1, sx); dx <= min(x + 1, sx + sw - 1); dx++) {
+			ccl_global float *neighbor = buffer + (offset + dx + dy*stride)*pass_stride;
+			if(kernel_adaptive_aux(kg, neighbor)->w == 0.0f)
+				return false;
+		}
+	}
+
+	aux->w = -aux->w;
+	return true;
+}
+
+/* Scale converged pixels as if they received all samples of the tile. */
+ccl_device void kernel_adaptive_adjust(KernelGlobals *kg,
+	ccl_global float *buffer, int sample, int x, int y, int offset, int stride)
+{
+	int index = offset + x + y*stride;
+	int pass_stride = kernel_data.film.pass_stride;
+	buffer += index*pass_stride;
+
+	float num_samples = kernel_adaptive_aux(kg, buffer)->w;
+
+	if(num_samples <= 0.0f || num_samples >= (float)sample)
+		return;
+
+	float scale = (float)sample/num_samples;
+	int float_flag = kernel_data.film.pass_flag &
+	                 ~(kernel_data.film.pass_half_flag | kernel_data.film.pass_byte_flag);
+
+	for(int i = 0; i < pass_stride; i++) {
+		/* Skip passes that are only written on the first sample. */
+		if(i == kernel_data.film.pass_adaptive_aux_buffer) {
+			i += 3;
+			continue;
+		}
+		/* Compressed passes hold averages, which need no scaling. */
+		if(i == kernel_data.film.pass_compressed && kernel_data.film.pass_compressed_size) {
+			i += kernel_data.film.pass_compressed_size - 1;
+			continue;
+		}
+		if((float_flag & PASS_DEPTH) && i == kernel_data.film.pass_depth)
+			continue;
+		if((float_flag & PASS_OBJECT_ID) && i == kernel_data.film.pass_object_id)
+			continue;
+		if((float_flag & PASS_MATERIAL_ID) && i == kernel_data.film.pass_material_id)
+			continue;
+
+		buffer[i] *= scale;
+	}
+}
+
+CCL_NAMESPACE_END
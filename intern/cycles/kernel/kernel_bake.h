@@ -188,6 +188,21 @@ ccl_device bool is_aa_pass(ShaderEvalType type)
 	}
 }
 
+/* Parts of the pass filter which change the light pass computed by
+ * compute_light_pass(), zero when no light pass is needed. Passes with the
+ * same light filter share their light pass, the other parts only select
+ * which of its components are written.
+ * Keep it synced with BakeManager::light_pass_filter(). */
+ccl_device_inline int bake_light_pass_filter(int pass_filter)
+{
+	int light_filter = pass_filter & (BAKE_FILTER_AO | BAKE_FILTER_EMISSION | BAKE_FILTER_SUBSURFACE);
+
+	if(pass_filter & (BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT))
+		light_filter |= BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT;
+
+	return light_filter;
+}
+
 /* this helps with AA but it's not the real solution as it does not AA the geometry
  *  but it's better than nothing, thus committed */
 ccl_device_inline float bake_clamp_mirror_repeat(float u, float max)
@@ -265,99 +280,40 @@ ccl_device float3 kernel_bake_evaluate_direct_indirect(KernelGlobals *kg,
 	return out;
 }
 
-ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input, ccl_global float4 *output,
-                                     ShaderEvalType type, int pass_filter, int i, int offset, int sample)
+/* Evaluate a single bake pass, once the shader data and light passes of the
+ * pixel are set up. */
+ccl_device float3 kernel_bake_evaluate_pass(KernelGlobals *kg,
+                                            ShaderData *sd,
+                                            PathRadiance *L,
+                                            RNG *rng,
+                                            PathState *state,
+                                            float3 P,
+                                            ShaderEvalType type,
+                                            int pass_filter)
 {
-	ShaderData sd;
-	PathState state = {0};
-	uint4 in = input[i * 2];
-	uint4 diff = input[i * 2 + 1];
-
 	float3 out = make_float3(0.0f, 0.0f, 0.0f);
 
-	int object = in.x;
-	int prim = in.y;
-
-	if(prim == -1)
-		return;
-
-	float u = __uint_as_float(in.z);
-	float v = __uint_as_float(in.w);
-
-	float dudx = __uint_as_float(diff.x);
-	float dudy = __uint_as_float(diff.y);
-	float dvdx = __uint_as_float(diff.z);
-	float dvdy = __uint_as_float(diff.w);
-
-	int num_samples = kernel_data.integrator.aa_samples;
-
-	/* random number generator */
-	RNG rng = cmj_hash(offset + i, kernel_data.integrator.seed);
-
-	float filter_x, filter_y;
-	if(sample == 0) {
-		filter_x = filter_y = 0.5f;
-	}
-	else {
-		path_rng_2D(kg, &rng, sample, num_samples, PRNG_FILTER_U, &filter_x, &filter_y);
-	}
-
-	/* subpixel u/v offset */
-	if(sample > 0) {
-		u = bake_clamp_mirror_repeat(u + dudx*(filter_x - 0.5f) + dudy*(filter_y - 0.5f), 1.0f);
-		v = bake_clamp_mirror_repeat(v + dvdx*(filter_x - 0.5f) + dvdy*(filter_y - 0.5f), 1.0f - u);
-	}
-
-	/* triangle */
-	int shader;
-	float3 P, Ng;
-
-	triangle_point_normal(kg, object, prim, u, v, &P, &Ng, &shader);
-
-	/* light passes */
-	PathRadiance L;
-
-	shader_setup_from_sample(kg, &sd,
-	                         P, Ng, Ng,
-	                         shader, object, prim,
-	                         u, v, 1.0f, 0.5f,
-	                         !(kernel_tex_fetch(__object_flag, object) & SD_OBJECT_TRANSFORM_APPLIED),
-	                         LAMP_NONE);
-	sd.I = sd.N;
-
-	/* update differentials */
-	sd.dP.dx = sd.dPdu * dudx + sd.dPdv * dvdx;
-	sd.dP.dy = sd.dPdu * dudy + sd.dPdv * dvdy;
-	sd.du.dx = dudx;
-	sd.du.dy = dudy;
-	sd.dv.dx = dvdx;
-	sd.dv.dy = dvdy;
-
-	/* light passes if we need more than color */
-	if(pass_filter & ~BAKE_FILTER_COLOR)
-		compute_light_pass(kg, &sd, &L, rng, pass_filter, sample);
-
 	switch(type) {
 		/* data passes */
 		case SHADER_EVAL_NORMAL:
 		{
-			if((sd.flag & SD_HAS_BUMP)) {
-				shader_eval_surface(kg, &sd, &rng, &state, 0.f, 0, SHADER_CONTEXT_MAIN);
+			if((sd->flag & SD_HAS_BUMP)) {
+				shader_eval_surface(kg, sd, rng, state, 0.f, 0, SHADER_CONTEXT_MAIN);
 			}
 
 			/* compression: normal = (2 * color) - 1 */
-			out = sd.N * 0.5f + make_float3(0.5f, 0.5f, 0.5f);
+			out = sd->N * 0.5f + make_float3(0.5f, 0.5f, 0.5f);
 			break;
 		}
 		case SHADER_EVAL_UV:
 		{
-			out = primitive_uv(kg, &sd);
+			out = primitive_uv(kg, sd);
 			break;
 		}
 		case SHADER_EVAL_EMISSION:
 		{
-			shader_eval_surface(kg, &sd, &rng, &state, 0.f, 0, SHADER_CONTEXT_EMISSION);
-			out = shader_emissive_eval(kg, &sd);
+			shader_eval_surface(kg, sd, rng, state, 0.f, 0, SHADER_CONTEXT_EMISSION);
+			out = shader_emissive_eval(kg, sd);
 			break;
 		}
 
@@ -365,54 +321,54 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 		/* light passes */
 		case SHADER_EVAL_AO:
 		{
-			out = L.ao;
+			out = L->ao;
 			break;
 		}
 		case SHADER_EVAL_COMBINED:
 		{
 			if((pass_filter & BAKE_FILTER_COMBINED) == BAKE_FILTER_COMBINED) {
-				out = path_radiance_clamp_and_sum(kg, &L);
+				out = path_radiance_clamp_and_sum(kg, L);
 				break;
 			}
 
 			if((pass_filter & BAKE_FILTER_DIFFUSE_DIRECT) == BAKE_FILTER_DIFFUSE_DIRECT)
-				out += L.direct_diffuse;
+				out += L->direct_diffuse;
 			if((pass_filter & BAKE_FILTER_DIFFUSE_INDIRECT) == BAKE_FILTER_DIFFUSE_INDIRECT)
-				out += L.indirect_diffuse;
+				out += L->indirect_diffuse;
 
 			if((pass_filter & BAKE_FILTER_GLOSSY_DIRECT) == BAKE_FILTER_GLOSSY_DIRECT)
-				out += L.direct_glossy;
+				out += L->direct_glossy;
 			if((pass_filter & BAKE_FILTER_GLOSSY_INDIRECT) == BAKE_FILTER_GLOSSY_INDIRECT)
-				out += L.indirect_glossy;
+				out += L->indirect_glossy;
 
 			if((pass_filter & BAKE_FILTER_TRANSMISSION_DIRECT) == BAKE_FILTER_TRANSMISSION_DIRECT)
-				out += L.direct_transmission;
+				out += L->direct_transmission;
 			if((pass_filter & BAKE_FILTER_TRANSMISSION_INDIRECT) == BAKE_FILTER_TRANSMISSION_INDIRECT)
-				out += L.indirect_transmission;
+				out += L->indirect_transmission;
 
 			if((pass_filter & BAKE_FILTER_SUBSURFACE_DIRECT) == BAKE_FILTER_SUBSURFACE_DIRECT)
-				out += L.direct_subsurface;
+				out += L->direct_subsurface;
 			if((pass_filter & BAKE_FILTER_SUBSURFACE_INDIRECT) == BAKE_FILTER_SUBSURFACE_INDIRECT)
-				out += L.indirect_subsurface;
+				out += L->indirect_subsurface;
 
 			if((pass_filter & BAKE_FILTER_EMISSION) != 0)
-				out += L.emission;
+				out += L->emission;
 
 			break;
 		}
 		case SHADER_EVAL_SHADOW:
 		{
-			out = make_float3(L.shadow.x, L.shadow.y, L.shadow.z);
+			out = make_float3(L->shadow.x, L->shadow.y, L->shadow.z);
 			break;
 		}
 		case SHADER_EVAL_DIFFUSE:
 		{
 			out = kernel_bake_evaluate_direct_indirect(kg,
-			                                           &sd,
-			                                           &rng,
-			                                           &state,
-			                                           L.direct_diffuse,
-			                                           L.indirect_diffuse,
+			                                           sd,
+			                                           rng,
+			                                           state,
+			                                           L->direct_diffuse,
+			                                           L->indirect_diffuse,
 			                                           type,
 			                                           pass_filter);
 			break;
@@ -420,11 +376,11 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 		case SHADER_EVAL_GLOSSY:
 		{
 			out = kernel_bake_evaluate_direct_indirect(kg,
-			                                           &sd,
-			                                           &rng,
-			                                           &state,
-			                                           L.direct_glossy,
-			                                           L.indirect_glossy,
+			                                           sd,
+			                                           rng,
+			                                           state,
+			                                           L->direct_glossy,
+			                                           L->indirect_glossy,
 			                                           type,
 			                                           pass_filter);
 			break;
@@ -432,11 +388,11 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 		case SHADER_EVAL_TRANSMISSION:
 		{
 			out = kernel_bake_evaluate_direct_indirect(kg,
-			                                           &sd,
-			                                           &rng,
-			                                           &state,
-			                                           L.direct_transmission,
-			                                           L.indirect_transmission,
+			                                           sd,
+			                                           rng,
+			                                           state,
+			                                           L->direct_transmission,
+			                                           L->indirect_transmission,
 			                                           type,
 			                                           pass_filter);
 			break;
@@ -445,11 +401,11 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 		{
 #ifdef __SUBSURFACE__
 			out = kernel_bake_evaluate_direct_indirect(kg,
-			                                           &sd,
-			                                           &rng,
-			                                           &state,
-			                                           L.direct_subsurface,
-			                                           L.indirect_subsurface,
+			                                           sd,
+			                                           rng,
+			                                           state,
+			                                           L->direct_subsurface,
+			                                           L->indirect_subsurface,
 			                                           type,
 			                                           pass_filter);
 #endif
@@ -476,11 +432,11 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 #endif
 
 			/* setup shader data */
-			shader_setup_from_background(kg, &sd, &ray);
+			shader_setup_from_background(kg, sd, &ray);
 
 			/* evaluate */
 			int flag = 0; /* we can't know which type of BSDF this is for */
-			out = shader_eval_background(kg, &sd, &state, flag, SHADER_CONTEXT_MAIN);
+			out = shader_eval_background(kg, sd, state, flag, SHADER_CONTEXT_MAIN);
 			break;
 		}
 		default:
@@ -491,6 +447,124 @@ ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input,
 		}
 	}
 
+	return out;
+}
+
+ccl_device void kernel_bake_evaluate(KernelGlobals *kg, ccl_global uint4 *input, ccl_global float4 *output,
+                                     ShaderEvalType type, int pass_filter, int i, int offset, int sample)
+{
+	ShaderData sd;
+	PathState state = {0};
+	uint4 in = input[i * 2];
+	uint4 diff = input[i * 2 + 1];
+
+	int object = in.x;
+	int prim = in.y;
+
+	if(prim == -1)
+		return;
+
+	float u = __uint_as_float(in.z);
+	float v = __uint_as_float(in.w);
+
+	float dudx = __uint_as_float(diff.x);
+	float dudy = __uint_as_float(diff.y);
+	float dvdx = __uint_as_float(diff.z);
+	float dvdy = __uint_as_float(diff.w);
+
+	int num_samples = kernel_data.integrator.aa_samples;
+
+	/* random number generator */
+	RNG rng = cmj_hash(offset + i, kernel_data.integrator.seed);
+
+	float filter_x, filter_y;
+	if(sample == 0) {
+		filter_x = filter_y = 0.5f;
+	}
+	else {
+		path_rng_2D(kg, &rng, sample, num_samples, PRNG_FILTER_U, &filter_x, &filter_y);
+	}
+
+	/* subpixel u/v offset */
+	if(sample > 0) {
+		u = bake_clamp_mirror_repeat(u + dudx*(filter_x - 0.5f) + dudy*(filter_y - 0.5f), 1.0f);
+		v = bake_clamp_mirror_repeat(v + dvdx*(filter_x - 0.5f) + dvdy*(filter_y - 0.5f), 1.0f - u);
+	}
+
+	/* triangle */
+	int shader;
+	float3 P, Ng;
+
+	triangle_point_normal(kg, object, prim, u, v, &P, &Ng, &shader);
+
+	/* light passes */
+	PathRadiance L;
+
+	shader_setup_from_sample(kg, &sd,
+	                         P, Ng, Ng,
+	                         shader, object, prim,
+	                         u, v, 1.0f, 0.5f,
+	                         !(kernel_tex_fetch(__object_flag, object) & SD_OBJECT_TRANSFORM_APPLIED),
+	                         LAMP_NONE);
+	sd.I = sd.N;
+
+	/* update differentials */
+	sd.dP.dx = sd.dPdu * dudx + sd.dPdv * dvdx;
+	sd.dP.dy = sd.dPdu * dudy + sd.dPdv * dvdy;
+	sd.du.dx = dudx;
+	sd.du.dy = dudy;
+	sd.dv.dx = dvdx;
+	sd.dv.dy = dvdy;
+
+#ifdef __PASSES__
+	/* several passes in one sweep, sharing the shader setup and light passes */
+	if(type == SHADER_EVAL_MULTIPASS) {
+		const int num_passes = kernel_data.bake.num_passes;
+		const float3 N = sd.N;
+		int light_filter = 0;
+
+		for(int pass = 0; pass < num_passes; pass++) {
+			ShaderEvalType pass_type = (ShaderEvalType)kernel_data.bake.pass_type[pass];
+			const int pass_filter = kernel_data.bake.pass_filter[pass];
+
+			/* passes without anti-aliasing only take the unjittered first sample */
+			const bool aa_pass = is_aa_pass(pass_type);
+			if(!aa_pass && sample > 0)
+				continue;
+
+			/* undo bump mapping of previous passes */
+			sd.N = N;
+
+			/* the light pass is computed again for each distinct light filter,
+			 * passes are sorted by it so each one is only computed once */
+			const int pass_light_filter = bake_light_pass_filter(pass_filter);
+			if(pass_light_filter && pass_light_filter != light_filter) {
+				compute_light_pass(kg, &sd, &L, rng, pass_filter, sample);
+				light_filter = pass_light_filter;
+				sd.N = N;
+			}
+
+			float3 out = kernel_bake_evaluate_pass(kg, &sd, &L, &rng, &state, P,
+			                                       pass_type,
+			                                       pass_filter);
+
+			const float output_fac = aa_pass? 1.0f/num_samples: 1.0f;
+			const float4 scaled_result = make_float4(out.x, out.y, out.z, 1.0f) * output_fac;
+			const int index = i*num_passes + pass;
+
+			output[index] = (sample == 0)?  scaled_result: output[index] + scaled_result;
+		}
+
+		return;
+	}
+#endif
+
+	/* light passes if we need more than color */
+	if(pass_filter & ~BAKE_FILTER_COLOR)
+		compute_light_pass(kg, &sd, &L, rng, pass_filter, sample);
+
+	float3 out = kernel_bake_evaluate_pass(kg, &sd, &L, &rng, &state, P, type, pass_filter);
+
 	/* write output */
 	const float output_fac = is_aa_pass(type)? 1.0f/num_samples: 1.0f;
 	const float4 scaled_result = make_float4(out.x, out.y, out.z, 1.0f) * output_fac;
@@ -39,6 +39,9 @@ struct OSLShadingSystem;
 #  endif
 
 struct Intersection;
+struct SparseGridGlobals;
+struct TextureCacheGlobals;
+struct TextureCacheThreadData;
 struct VolumeStep;
 
 typedef struct KernelGlobals {
@@ -63,6 +66,15 @@ typedef struct KernelGlobals {
 	OSLThreadData *osl_tdata;
 #  endif
 
+	/* Out-of-core image textures, looked up instead of the image arrays above
+	 * for images which are not loaded into memory. */
+	TextureCacheGlobals *texture_cache;
+	TextureCacheThreadData *texture_cache_tdata;
+
+	/* Sparse volume grids, looked up instead of the image arrays above for
+	 * 3D images which are stored sparsely. */
+	SparseGridGlobals *sparse_grids;
+
 	/* **** Run-time data ****  */
 
 	/* Heap-allocated storage for transparent shadows intersections. */
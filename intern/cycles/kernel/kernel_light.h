@@ -807,10 +807,9 @@ ccl_device void triangle_light_sample(KernelGlobals *kg, int prim, int object,
 	object_transform_light_sample(kg, ls, object, time);
 }
 
-ccl_device float triangle_light_pdf(KernelGlobals *kg,
+ccl_device_inline float triangle_light_pdf_area(float pdf,
 	const float3 Ng, const float3 I, float t)
 {
-	float pdf = kernel_data.integrator.pdf_triangles;
 	float cos_pi = fabsf(dot(Ng, I));
 
 	if(cos_pi == 0.0f)
@@ -819,6 +818,12 @@ ccl_device float triangle_light_pdf(KernelGlobals *kg,
 	return t*t*pdf/cos_pi;
 }
 
+ccl_device float triangle_light_pdf(KernelGlobals *kg,
+	const float3 Ng, const float3 I, float t)
+{
+	return triangle_light_pdf_area(kernel_data.integrator.pdf_triangles, Ng, I, t);
+}
+
 /* Light Distribution */
 
 ccl_device int light_distribution_sample(KernelGlobals *kg, float randt)
@@ -848,6 +853,215 @@ ccl_device int light_distribution_sample(KernelGlobals *kg, float randt)
 	return clamp(first-1, 0, kernel_data.integrator.num_distribution-1);
 }
 
+/* Light Tree
+ *
+ * Bounding volume hierarchy over mesh light triangles and lamps with a
+ * position, built by the LightManager. Descending the tree, a child is picked
+ * proportional to an estimate of its contribution to the shading point, so
+ * that unlike the distribution above nearby lights facing the point are
+ * preferred. Based on "Importance Sampling of Many Lights with Adaptive Tree
+ * Splitting" by Conty Estevez and Kulla.
+ *
+ * Nodes are LIGHT_TREE_NODE_SIZE float4s, with the left child directly
+ * following its parent:
+ * 0: bounding box min, energy
+ * 1: bounding box max, distribution index for leaves
+ * 2: orientation cone axis, theta_o
+ * 3: theta_e, parent, right child or -1 for leaves, triangle area
+ *
+ * Triangles and lamps keep the same split as the distribution, so the pdfs
+ * used by sample all lights remain valid. Distant and background lamps are
+ * not in the tree and keep their uniform selection probability. */
+
+ccl_device float light_tree_node_importance(KernelGlobals *kg, float3 P, int node)
+{
+	float4 data0 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 0);
+
+	float energy = data0.w;
+	if(energy == 0.0f)
+		return 0.0f;
+
+	float4 data1 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 1);
+
+	float3 bbox_min = float4_to_float3(data0);
+	float3 bbox_max = float4_to_float3(data1);
+	float3 centroid = 0.5f*(bbox_min + bbox_max);
+	float radius_sq = 0.25f*len_squared(bbox_max - bbox_min);
+
+	float dist;
+	float3 V = normalize_len(P - centroid, &dist);
+	float dist_sq = dist*dist;
+
+	/* Inside the bounding sphere, any orientation can face the point. */
+	if(dist_sq <= radius_sq)
+		return energy/max(radius_sq, 1e-8f);
+
+	float4 data2 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 2);
+	float theta_o = data2.w;
+	float orientation = 1.0f;
+
+	if(theta_o < M_PI_F) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+		float theta_e = data3.x;
+
+		/* Smallest angle between the cone and the direction to P, reduced by
+		 * the angle subtended by the bounding sphere. */
+		float theta = safe_acosf(dot(float4_to_float3(data2), V));
+		float theta_u = safe_asinf(sqrtf(radius_sq/dist_sq));
+		float theta_prime = max(theta - theta_o - theta_u, 0.0f);
+
+		if(theta_prime >= theta_e)
+			return 0.0f;
+
+		orientation = max(cosf(theta_prime), 0.0f);
+	}
+
+	return energy*orientation/dist_sq;
+}
+
+ccl_device int light_tree_sample(KernelGlobals *kg, int root, float3 P, float randt, float *pdf)
+{
+	int node = root;
+	*pdf = 1.0f;
+
+	while(true) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+		int right = __float_as_int(data3.z);
+
+		if(right == -1)
+			return node;
+
+		int left = node + 1;
+		float importance_left = light_tree_node_importance(kg, P, left);
+		float importance_right = light_tree_node_importance(kg, P, right);
+		float total = importance_left + importance_right;
+
+		if(total == 0.0f)
+			return -1;
+
+		float prob_left = importance_left/total;
+
+		if(randt < prob_left) {
+			node = left;
+			randt = randt/prob_left;
+			*pdf *= prob_left;
+		}
+		else {
+			node = right;
+			randt = (randt - prob_left)/(1.0f - prob_left);
+			*pdf *= 1.0f - prob_left;
+		}
+
+		randt = min(randt, 1.0f - 1e-6f);
+	}
+}
+
+/* Probability of picking a leaf, walking up from the leaf to the root. */
+ccl_device float light_tree_pdf(KernelGlobals *kg, int root, float3 P, int node)
+{
+	float pdf = 1.0f;
+
+	while(node != root) {
+		float4 data3 = kernel_tex_fetch(__light_tree_nodes, node*LIGHT_TREE_NODE_SIZE + 3);
+		int parent = __float_as_int(data3.y);
+
+		float4 parent_data3 = kernel_tex_fetch(__light_tree_nodes, parent*LIGHT_TREE_NODE_SIZE + 3);
+		int left = parent + 1;
+		int right = __float_as_int(parent_data3.z);
+
+		float importance_left = light_tree_node_importance(kg, P, left);
+		float importance_right = light_tree_node_importance(kg, P, right);
+		float importance = (node == left)? importance_left: importance_right;
+
+		if(importance == 0.0f)
+			return 0.0f;
+
+		pdf *= importance/(importance_left + importance_right);
+		node = parent;
+	}
+
+	return pdf;
+}
+
+ccl_device_inline float light_tree_triangle_fraction(KernelGlobals *kg)
+{
+	return (kernel_data.integrator.num_all_lights)? 0.5f: 1.0f;
+}
+
+/* Pick an index into the light distribution. For triangles pdf is the area
+ * density, for lamps the selection probability relative to the uniform
+ * one of the distribution. */
+ccl_device int light_tree_distribution_sample(KernelGlobals *kg, float randt, float3 P, float *pdf)
+{
+	int num_triangles = kernel_data.integrator.light_tree_num_triangles;
+	int num_lights = kernel_data.integrator.num_all_lights;
+
+	if(kernel_data.integrator.pdf_triangles != 0.0f) {
+		float fraction = light_tree_triangle_fraction(kg);
+
+		if(randt < fraction) {
+			int leaf = light_tree_sample(kg, 0, P, randt/fraction, pdf);
+
+			if(leaf == -1)
+				return -1;
+
+			float4 data1 = kernel_tex_fetch(__light_tree_nodes, leaf*LIGHT_TREE_NODE_SIZE + 1);
+			float4 data3 = kernel_tex_fetch(__light_tree_nodes, leaf*LIGHT_TREE_NODE_SIZE + 3);
+
+			*pdf *= fraction/data3.w;
+			return __float_as_int(data1.w);
+		}
+
+		randt = (randt - fraction)/(1.0f - fraction);
+	}
+
+	int num_local = kernel_data.integrator.light_tree_num_local_lights;
+	float local_fraction = (float)num_local/(float)num_lights;
+
+	if(randt < local_fraction) {
+		int leaf = light_tree_sample(kg,
+		                             kernel_data.integrator.light_tree_lamp_root,
+		                             P,
+		                             randt/local_fraction,
+		                             pdf);
+
+		if(leaf == -1)
+			return -1;
+
+		float4 data1 = kernel_tex_fetch(__light_tree_nodes, leaf*LIGHT_TREE_NODE_SIZE + 1);
+
+		*pdf *= num_local;
+		return __float_as_int(data1.w);
+	}
+
+	/* Distant and background lamps are at the end of the distribution. */
+	int num_infinite = num_lights - num_local;
+	int index = (int)((randt - local_fraction)/(1.0f - local_fraction)*num_infinite);
+
+	*pdf = 1.0f;
+	return num_triangles + num_local + clamp(index, 0, num_infinite - 1);
+}
+
+/* Solid angle pdf of sampling a mesh light triangle hit from the ray origin,
+ * for multiple importance sampling. */
+ccl_device float light_tree_triangle_light_pdf(KernelGlobals *kg, ShaderData *sd, float t)
+{
+	if(!kernel_tex_fetch(__light_tree_leaf_map, sd->object*2 + 0))
+		return 0.0f;
+
+	uint offset = kernel_tex_fetch(__light_tree_leaf_map, sd->object*2 + 1);
+	uint leaf = kernel_tex_fetch(__light_tree_leaf_map, offset + sd->prim);
+
+	if(leaf == ~0)
+		return 0.0f;
+
+	float4 data3 = kernel_tex_fetch(__light_tree_nodes, leaf*LIGHT_TREE_NODE_SIZE + 3);
+	float3 P = sd->P + sd->I*t;
+	float pdf = light_tree_triangle_fraction(kg) * light_tree_pdf(kg, 0, P, leaf) / data3.w;
+
+	return triangle_light_pdf_area(pdf, sd->Ng, sd->I, t);
+}
+
 /* Generic Light */
 
 ccl_device bool light_select_reached_max_bounces(KernelGlobals *kg, int index, int bounce)
@@ -866,7 +1080,18 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
                                       LightSample *ls)
 {
 	/* sample index */
-	int index = light_distribution_sample(kg, randt);
+	int index;
+	float tree_pdf = 1.0f;
+
+	if(kernel_data.integrator.use_light_tree) {
+		index = light_tree_distribution_sample(kg, randt, P, &tree_pdf);
+
+		if(index == -1)
+			return false;
+	}
+	else {
+		index = light_distribution_sample(kg, randt);
+	}
 
 	/* fetch light data */
 	float4 l = kernel_tex_fetch(__light_distribution, index);
@@ -879,7 +1104,10 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 		triangle_light_sample(kg, prim, object, randu, randv, time, ls);
 		/* compute incoming direction, distance and pdf */
 		ls->D = normalize_len(ls->P - P, &ls->t);
-		ls->pdf = triangle_light_pdf(kg, ls->Ng, -ls->D, ls->t);
+		if(kernel_data.integrator.use_light_tree)
+			ls->pdf = triangle_light_pdf_area(tree_pdf, ls->Ng, -ls->D, ls->t);
+		else
+			ls->pdf = triangle_light_pdf(kg, ls->Ng, -ls->D, ls->t);
 		ls->shader |= shader_flag;
 		return (ls->pdf > 0.0f);
 	}
@@ -890,7 +1118,13 @@ ccl_device_noinline bool light_sample(KernelGlobals *kg,
 			return false;
 		}
 
-		return lamp_light_sample(kg, lamp, randu, randv, P, ls);
+		if(!lamp_light_sample(kg, lamp, randu, randv, P, ls))
+			return false;
+
+		/* Lamp pdfs exclude the selection probability, which is instead
+		 * compensated for in eval_fac. */
+		ls->eval_fac /= tree_pdf;
+		return true;
 	}
 }
 
@@ -14,50 +14,39 @@
  * limitations under the License.
  */
 
+#include "kernel/kernel_write_passes.h"
+
 CCL_NAMESPACE_BEGIN
 
-ccl_device_inline void kernel_write_pass_float(ccl_global float *buffer, int sample, float value)
+/* Write to a pass of any storage, type is the PassType of the pass. */
+
+ccl_device_inline void kernel_write_film_pass_float(KernelGlobals *kg, ccl_global float *buffer,
+                                                    int type, int offset, int sample, float value)
 {
-	ccl_global float *buf = buffer;
-#if defined(__SPLIT_KERNEL__)
-	atomic_add_and_fetch_float(buf, value);
-#else
-	*buf = (sample == 0)? value: *buf + value;
-#endif  /* __SPLIT_KERNEL__ */
+	if(kernel_data.film.pass_byte_flag & type)
+		kernel_write_pass_byte(buffer, offset, value);
+	else if(kernel_data.film.pass_half_flag & type)
+		kernel_write_pass_half(buffer, offset, sample, make_float4(value, 0.0f, 0.0f, 0.0f), 1);
+	else
+		kernel_write_pass_float(buffer + offset, sample, value);
 }
 
-ccl_device_inline void kernel_write_pass_float3(ccl_global float *buffer, int sample, float3 value)
+ccl_device_inline void kernel_write_film_pass_float3(KernelGlobals *kg, ccl_global float *buffer,
+                                                     int type, int offset, int sample, float3 value)
 {
-#if defined(__SPLIT_KERNEL__)
-	ccl_global float *buf_x = buffer + 0;
-	ccl_global float *buf_y = buffer + 1;
-	ccl_global float *buf_z = buffer + 2;
-
-	atomic_add_and_fetch_float(buf_x, value.x);
-	atomic_add_and_fetch_float(buf_y, value.y);
-	atomic_add_and_fetch_float(buf_z, value.z);
-#else
-	ccl_global float3 *buf = (ccl_global float3*)buffer;
-	*buf = (sample == 0)? value: *buf + value;
-#endif  /* __SPLIT_KERNEL__ */
+	if(kernel_data.film.pass_half_flag & type)
+		kernel_write_pass_half(buffer, offset, sample, make_float4(value.x, value.y, value.z, 0.0f), 3);
+	else
+		kernel_write_pass_float3(buffer + offset, sample, value);
 }
 
-ccl_device_inline void kernel_write_pass_float4(ccl_global float *buffer, int sample, float4 value)
+ccl_device_inline void kernel_write_film_pass_float4(KernelGlobals *kg, ccl_global float *buffer,
+                                                     int type, int offset, int sample, float4 value)
 {
-#if defined(__SPLIT_KERNEL__)
-	ccl_global float *buf_x = buffer + 0;
-	ccl_global float *buf_y = buffer + 1;
-	ccl_global float *buf_z = buffer + 2;
-	ccl_global float *buf_w = buffer + 3;
-
-	atomic_add_and_fetch_float(buf_x, value.x);
-	atomic_add_and_fetch_float(buf_y, value.y);
-	atomic_add_and_fetch_float(buf_z, value.z);
-	atomic_add_and_fetch_float(buf_w, value.w);
-#else
-	ccl_global float4 *buf = (ccl_global float4*)buffer;
-	*buf = (sample == 0)? value: *buf + value;
-#endif  /* __SPLIT_KERNEL__ */
+	if(kernel_data.film.pass_half_flag & type)
+		kernel_write_pass_half(buffer, offset, sample, value, 4);
+	else
+		kernel_write_pass_float4(buffer + offset, sample, value);
 }
 
 #ifdef __DENOISING_FEATURES__
@@ -212,25 +201,25 @@ ccl_device_inline void kernel_write_data_passes(KernelGlobals *kg, ccl_global fl
 			if(sample == 0) {
 				if(flag & PASS_DEPTH) {
 					float depth = camera_distance(kg, sd->P);
-					kernel_write_pass_float(buffer + kernel_data.film.pass_depth, sample, depth);
+					kernel_write_film_pass_float(kg, buffer, PASS_DEPTH, kernel_data.film.pass_depth, sample, depth);
 				}
 				if(flag & PASS_OBJECT_ID) {
 					float id = object_pass_id(kg, sd->object);
-					kernel_write_pass_float(buffer + kernel_data.film.pass_object_id, sample, id);
+					kernel_write_film_pass_float(kg, buffer, PASS_OBJECT_ID, kernel_data.film.pass_object_id, sample, id);
 				}
 				if(flag & PASS_MATERIAL_ID) {
 					float id = shader_pass_id(kg, sd);
-					kernel_write_pass_float(buffer + kernel_data.film.pass_material_id, sample, id);
+					kernel_write_film_pass_float(kg, buffer, PASS_MATERIAL_ID, kernel_data.film.pass_material_id, sample, id);
 				}
 			}
 
 			if(flag & PASS_NORMAL) {
 				float3 normal = sd->N;
-				kernel_write_pass_float3(buffer + kernel_data.film.pass_normal, sample, normal);
+				kernel_write_film_pass_float3(kg, buffer, PASS_NORMAL, kernel_data.film.pass_normal, sample, normal);
 			}
 			if(flag & PASS_UV) {
 				float3 uv = primitive_uv(kg, sd);
-				kernel_write_pass_float3(buffer + kernel_data.film.pass_uv, sample, uv);
+				kernel_write_film_pass_float3(kg, buffer, PASS_UV, kernel_data.film.pass_uv, sample, uv);
 			}
 			if(flag & PASS_MOTION) {
 				float4 speed = primitive_motion_vector(kg, sd);
@@ -287,44 +276,44 @@ ccl_device_inline void kernel_write_light_passes(KernelGlobals *kg, ccl_global f
 		return;
 	
 	if(flag & PASS_DIFFUSE_INDIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_diffuse_indirect, sample, L->indirect_diffuse);
+		kernel_write_film_pass_float3(kg, buffer, PASS_DIFFUSE_INDIRECT, kernel_data.film.pass_diffuse_indirect, sample, L->indirect_diffuse);
 	if(flag & PASS_GLOSSY_INDIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_glossy_indirect, sample, L->indirect_glossy);
+		kernel_write_film_pass_float3(kg, buffer, PASS_GLOSSY_INDIRECT, kernel_data.film.pass_glossy_indirect, sample, L->indirect_glossy);
 	if(flag & PASS_TRANSMISSION_INDIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_transmission_indirect, sample, L->indirect_transmission);
+		kernel_write_film_pass_float3(kg, buffer, PASS_TRANSMISSION_INDIRECT, kernel_data.film.pass_transmission_indirect, sample, L->indirect_transmission);
 	if(flag & PASS_SUBSURFACE_INDIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_subsurface_indirect, sample, L->indirect_subsurface);
+		kernel_write_film_pass_float3(kg, buffer, PASS_SUBSURFACE_INDIRECT, kernel_data.film.pass_subsurface_indirect, sample, L->indirect_subsurface);
 	if(flag & PASS_DIFFUSE_DIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_diffuse_direct, sample, L->direct_diffuse);
+		kernel_write_film_pass_float3(kg, buffer, PASS_DIFFUSE_DIRECT, kernel_data.film.pass_diffuse_direct, sample, L->direct_diffuse);
 	if(flag & PASS_GLOSSY_DIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_glossy_direct, sample, L->direct_glossy);
+		kernel_write_film_pass_float3(kg, buffer, PASS_GLOSSY_DIRECT, kernel_data.film.pass_glossy_direct, sample, L->direct_glossy);
 	if(flag & PASS_TRANSMISSION_DIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_transmission_direct, sample, L->direct_transmission);
+		kernel_write_film_pass_float3(kg, buffer, PASS_TRANSMISSION_DIRECT, kernel_data.film.pass_transmission_direct, sample, L->direct_transmission);
 	if(flag & PASS_SUBSURFACE_DIRECT)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_subsurface_direct, sample, L->direct_subsurface);
+		kernel_write_film_pass_float3(kg, buffer, PASS_SUBSURFACE_DIRECT, kernel_data.film.pass_subsurface_direct, sample, L->direct_subsurface);
 
 	if(flag & PASS_EMISSION)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_emission, sample, L->emission);
+		kernel_write_film_pass_float3(kg, buffer, PASS_EMISSION, kernel_data.film.pass_emission, sample, L->emission);
 	if(flag & PASS_BACKGROUND)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_background, sample, L->background);
+		kernel_write_film_pass_float3(kg, buffer, PASS_BACKGROUND, kernel_data.film.pass_background, sample, L->background);
 	if(flag & PASS_AO)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_ao, sample, L->ao);
+		kernel_write_film_pass_float3(kg, buffer, PASS_AO, kernel_data.film.pass_ao, sample, L->ao);
 
 	if(flag & PASS_DIFFUSE_COLOR)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_diffuse_color, sample, L->color_diffuse);
+		kernel_write_film_pass_float3(kg, buffer, PASS_DIFFUSE_COLOR, kernel_data.film.pass_diffuse_color, sample, L->color_diffuse);
 	if(flag & PASS_GLOSSY_COLOR)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_glossy_color, sample, L->color_glossy);
+		kernel_write_film_pass_float3(kg, buffer, PASS_GLOSSY_COLOR, kernel_data.film.pass_glossy_color, sample, L->color_glossy);
 	if(flag & PASS_TRANSMISSION_COLOR)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_transmission_color, sample, L->color_transmission);
+		kernel_write_film_pass_float3(kg, buffer, PASS_TRANSMISSION_COLOR, kernel_data.film.pass_transmission_color, sample, L->color_transmission);
 	if(flag & PASS_SUBSURFACE_COLOR)
-		kernel_write_pass_float3(buffer + kernel_data.film.pass_subsurface_color, sample, L->color_subsurface);
+		kernel_write_film_pass_float3(kg, buffer, PASS_SUBSURFACE_COLOR, kernel_data.film.pass_subsurface_color, sample, L->color_subsurface);
 	if(flag & PASS_SHADOW) {
 		float4 shadow = L->shadow;
 		shadow.w = kernel_data.film.pass_shadow_scale;
-		kernel_write_pass_float4(buffer + kernel_data.film.pass_shadow, sample, shadow);
+		kernel_write_film_pass_float4(kg, buffer, PASS_SHADOW, kernel_data.film.pass_shadow, sample, shadow);
 	}
 	if(flag & PASS_MIST)
-		kernel_write_pass_float(buffer + kernel_data.film.pass_mist, sample, 1.0f - L->mist);
+		kernel_write_film_pass_float(kg, buffer, PASS_MIST, kernel_data.film.pass_mist, sample, 1.0f - L->mist);
 #endif
 }
 
@@ -345,6 +334,13 @@ ccl_device_inline void kernel_write_result(KernelGlobals *kg, ccl_global float *
 
 		kernel_write_pass_float4(buffer, sample, make_float4(L_sum.x, L_sum.y, L_sum.z, alpha));
 
+		/* half buffer for adaptive sampling error estimation, the buffer is
+		 * cleared on reset so odd samples can always accumulate */
+		if(kernel_data.film.pass_adaptive_aux_buffer && (sample & 1)) {
+			kernel_write_pass_float4(buffer + kernel_data.film.pass_adaptive_aux_buffer,
+			                         sample, make_float4(L_sum.x*2.0f, L_sum.y*2.0f, L_sum.z*2.0f, 0.0f));
+		}
+
 		kernel_write_light_passes(kg, buffer, L, sample);
 
 #ifdef __DENOISING_FEATURES__
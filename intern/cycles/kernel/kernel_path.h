@@ -31,6 +31,7 @@
 #include "kernel/kernel_shader.h"
 #include "kernel/kernel_light.h"
 #include "kernel/kernel_passes.h"
+#include "kernel/kernel_adaptive_sampling.h"
 
 #ifdef __SUBSURFACE__
 #  include "kernel/kernel_subsurface.h"
@@ -435,7 +436,8 @@ ccl_device_inline float kernel_path_integrate(KernelGlobals *kg,
                                               Ray ray,
                                               ccl_global float *buffer,
                                               PathRadiance *L,
-                                              bool *is_shadow_catcher)
+                                              bool *is_shadow_catcher,
+                                              const Intersection *camera_isect)
 {
 	/* initialize */
 	float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
@@ -469,30 +471,40 @@ ccl_device_inline float kernel_path_integrate(KernelGlobals *kg,
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
 
-#ifdef __HAIR__
-		float difl = 0.0f, extmax = 0.0f;
-		uint lcg_state = 0;
-
-		if(kernel_data.bvh.have_curves) {
-			if((kernel_data.cam.resolution == 1) && (state.flag & PATH_RAY_CAMERA)) {	
-				float3 pixdiff = ray.dD.dx + ray.dD.dy;
-				/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
-				difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
-			}
+		bool hit;
 
-			extmax = kernel_data.curve.maximum_width;
-			lcg_state = lcg_state_init(rng, state.rng_offset, state.sample, 0x51633e2d);
+		if(camera_isect) {
+			/* Camera ray was already traced as part of a packet. */
+			isect = *camera_isect;
+			hit = (isect.prim != PRIM_NONE);
+			camera_isect = NULL;
 		}
+		else {
+#ifdef __HAIR__
+			float difl = 0.0f, extmax = 0.0f;
+			uint lcg_state = 0;
+
+			if(kernel_data.bvh.have_curves) {
+				if((kernel_data.cam.resolution == 1) && (state.flag & PATH_RAY_CAMERA)) {	
+					float3 pixdiff = ray.dD.dx + ray.dD.dy;
+					/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
+					difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
+				}
 
-		if(state.bounce > kernel_data.integrator.ao_bounces) {
-			visibility = PATH_RAY_SHADOW;
-			ray.t = kernel_data.background.ao_distance;
-		}
+				extmax = kernel_data.curve.maximum_width;
+				lcg_state = lcg_state_init(rng, state.rng_offset, state.sample, 0x51633e2d);
+			}
+
+			if(state.bounce > kernel_data.integrator.ao_bounces) {
+				visibility = PATH_RAY_SHADOW;
+				ray.t = kernel_data.background.ao_distance;
+			}
 
-		bool hit = scene_intersect(kg, ray, visibility, &isect, &lcg_state, difl, extmax);
+			hit = scene_intersect(kg, ray, visibility, &isect, &lcg_state, difl, extmax);
 #else
-		bool hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
+			hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #endif  /* __HAIR__ */
+		}
 
 #ifdef __KERNEL_DEBUG__
 		if(state.flag & PATH_RAY_CAMERA) {
@@ -796,6 +808,10 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* pixel converged with adaptive sampling */
+	if(kernel_adaptive_pixel_converged(kg, buffer))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -807,7 +823,7 @@ ccl_device void kernel_path_trace(KernelGlobals *kg,
 	bool is_shadow_catcher;
 
 	if(ray.t != 0.0f) {
-		float alpha = kernel_path_integrate(kg, &rng, sample, ray, buffer, &L, &is_shadow_catcher);
+		float alpha = kernel_path_integrate(kg, &rng, sample, ray, buffer, &L, &is_shadow_catcher, NULL);
 		kernel_write_result(kg, buffer, sample, &L, alpha, is_shadow_catcher);
 	}
 	else {
@@ -268,7 +268,8 @@ ccl_device float kernel_branched_path_integrate(KernelGlobals *kg,
                                                 Ray ray,
                                                 ccl_global float *buffer,
                                                 PathRadiance *L,
-                                                bool *is_shadow_catcher)
+                                                bool *is_shadow_catcher,
+                                                const Intersection *camera_isect)
 {
 	/* initialize */
 	float3 throughput = make_float3(1.0f, 1.0f, 1.0f);
@@ -298,25 +299,35 @@ ccl_device float kernel_branched_path_integrate(KernelGlobals *kg,
 		Intersection isect;
 		uint visibility = path_state_ray_visibility(kg, &state);
 
-#ifdef __HAIR__
-		float difl = 0.0f, extmax = 0.0f;
-		uint lcg_state = 0;
-
-		if(kernel_data.bvh.have_curves) {
-			if(kernel_data.cam.resolution == 1) {
-				float3 pixdiff = ray.dD.dx + ray.dD.dy;
-				/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
-				difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
-			}
+		bool hit;
 
-			extmax = kernel_data.curve.maximum_width;
-			lcg_state = lcg_state_init(rng, state.rng_offset, state.sample, 0x51633e2d);
+		if(camera_isect) {
+			/* Camera ray was already traced as part of a packet. */
+			isect = *camera_isect;
+			hit = (isect.prim != PRIM_NONE);
+			camera_isect = NULL;
 		}
+		else {
+#ifdef __HAIR__
+			float difl = 0.0f, extmax = 0.0f;
+			uint lcg_state = 0;
+
+			if(kernel_data.bvh.have_curves) {
+				if(kernel_data.cam.resolution == 1) {
+					float3 pixdiff = ray.dD.dx + ray.dD.dy;
+					/*pixdiff = pixdiff - dot(pixdiff, ray.D)*ray.D;*/
+					difl = kernel_data.curve.minimum_width * len(pixdiff) * 0.5f;
+				}
 
-		bool hit = scene_intersect(kg, ray, visibility, &isect, &lcg_state, difl, extmax);
+				extmax = kernel_data.curve.maximum_width;
+				lcg_state = lcg_state_init(rng, state.rng_offset, state.sample, 0x51633e2d);
+			}
+
+			hit = scene_intersect(kg, ray, visibility, &isect, &lcg_state, difl, extmax);
 #else
-		bool hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
+			hit = scene_intersect(kg, ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #endif  /* __HAIR__ */
+		}
 
 #ifdef __KERNEL_DEBUG__
 		debug_data.num_bvh_traversed_nodes += isect.num_traversed_nodes;
@@ -646,6 +657,10 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 	rng_state += index;
 	buffer += index*pass_stride;
 
+	/* pixel converged with adaptive sampling */
+	if(kernel_adaptive_pixel_converged(kg, buffer))
+		return;
+
 	/* initialize random numbers and ray */
 	RNG rng;
 	Ray ray;
@@ -657,7 +672,7 @@ ccl_device void kernel_branched_path_trace(KernelGlobals *kg,
 	bool is_shadow_catcher;
 
 	if(ray.t != 0.0f) {
-		float alpha = kernel_branched_path_integrate(kg, &rng, sample, ray, buffer, &L, &is_shadow_catcher);
+		float alpha = kernel_branched_path_integrate(kg, &rng, sample, ray, buffer, &L, &is_shadow_catcher, NULL);
 		kernel_write_result(kg, buffer, sample, &L, alpha, is_shadow_catcher);
 	}
 	else {
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+CCL_NAMESPACE_BEGIN
+
+/* Packet Path Tracing
+ *
+ * Camera rays of a run of neighboring pixels in a row are traced together
+ * with the packet BVH traversal, after which each path is integrated as
+ * usual starting from the precomputed camera ray intersection. */
+
+ccl_device void kernel_path_trace_packet(KernelGlobals *kg,
+	ccl_global float *buffer, ccl_global uint *rng_state,
+	int sample, int x, int y, int num_pixels, int offset, int stride)
+{
+	kernel_assert(num_pixels <= BVH_PACKET_SIZE);
+
+	int pass_stride = kernel_data.film.pass_stride;
+
+	RNG rng[BVH_PACKET_SIZE];
+	Ray rays[BVH_PACKET_SIZE];
+	Intersection isects[BVH_PACKET_SIZE];
+	int pixel_index[BVH_PACKET_SIZE];
+	int num_rays = 0;
+
+	/* Setup camera rays. */
+	for(int i = 0; i < num_pixels; i++) {
+		int index = offset + x + i + y*stride;
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+
+		/* pixel converged with adaptive sampling */
+		if(kernel_adaptive_pixel_converged(kg, pixel_buffer))
+			continue;
+
+		kernel_path_trace_setup(kg, rng_state + index, sample, x + i, y, &rng[num_rays], &rays[num_rays]);
+
+		if(rays[num_rays].t == 0.0f) {
+			kernel_write_result(kg, pixel_buffer, sample, NULL, 0.0f, false);
+			path_rng_end(kg, rng_state + index, rng[num_rays]);
+			continue;
+		}
+
+		pixel_index[num_rays++] = index;
+	}
+
+	/* Trace camera rays as one packet. Hair needs per ray minimum width, so
+	 * those scenes intersect the camera rays during integration. */
+	bool use_packet = !kernel_data.bvh.have_curves;
+
+	if(use_packet) {
+		scene_intersect_packet(kg, rays, isects, PATH_RAY_CAMERA, num_rays);
+	}
+
+	/* Integrate paths. */
+	for(int i = 0; i < num_rays; i++) {
+		int index = pixel_index[i];
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+		const Intersection *camera_isect = (use_packet)? &isects[i]: NULL;
+
+		PathRadiance L;
+		bool is_shadow_catcher;
+		float alpha;
+
+#ifdef __BRANCHED_PATH__
+		if(kernel_data.integrator.branched) {
+			alpha = kernel_branched_path_integrate(kg, &rng[i], sample, rays[i], pixel_buffer,
+			                                       &L, &is_shadow_catcher, camera_isect);
+		}
+		else
+#endif
+		{
+			alpha = kernel_path_integrate(kg, &rng[i], sample, rays[i], pixel_buffer,
+			                              &L, &is_shadow_catcher, camera_isect);
+		}
+
+		kernel_write_result(kg, pixel_buffer, sample, &L, alpha, is_shadow_catcher);
+		path_rng_end(kg, rng_state + index, rng[i]);
+	}
+}
+
+CCL_NAMESPACE_END
@@ -17,6 +17,99 @@
 CCL_NAMESPACE_BEGIN
 
 #if defined(__BRANCHED_PATH__) || defined(__SUBSURFACE__) || defined(__SHADOW_TRICKS__) || defined(__BAKING__)
+#  if defined(__EMISSION__) && defined(__KERNEL_CPU__)
+/* Trace a packet of opaque shadow rays and add the unblocked lights to L. */
+ccl_device_inline void kernel_path_surface_shadow_packet_accum(
+        KernelGlobals *kg,
+        ccl_addr_space PathState *state,
+        float3 throughput,
+        PathRadiance *L,
+        const Ray *light_rays,
+        const BsdfEval *L_lights,
+        const bool *is_lamps,
+        const float *samples_inv,
+        int num_rays)
+{
+	Intersection isects[BVH_PACKET_SIZE];
+	uint blocked = scene_intersect_packet(kg, light_rays, isects, PATH_RAY_SHADOW_OPAQUE, num_rays);
+
+	for(int k = 0; k < num_rays; k++) {
+		if(!(blocked & (1u << k))) {
+			path_radiance_accum_light(L, state, throughput*samples_inv[k], &L_lights[k],
+			                          make_float3(1.0f, 1.0f, 1.0f), samples_inv[k], is_lamps[k]);
+		}
+		else {
+			path_radiance_accum_total_light(L, state, throughput*samples_inv[k], &L_lights[k]);
+		}
+	}
+}
+
+/* Same as the lamp sampling in kernel_branched_path_surface_connect_light,
+ * but the shadow rays, which all start at the shading point, are traced in
+ * packets of BVH_PACKET_SIZE rays. */
+ccl_device_noinline void kernel_branched_path_surface_connect_lamps_packet(
+        KernelGlobals *kg,
+        RNG *rng,
+        ShaderData *sd,
+        ShaderData *emission_sd,
+        ccl_addr_space PathState *state,
+        float3 throughput,
+        float num_samples_adjust,
+        PathRadiance *L)
+{
+	Ray light_rays[BVH_PACKET_SIZE];
+	BsdfEval L_lights[BVH_PACKET_SIZE];
+	bool is_lamps[BVH_PACKET_SIZE];
+	float samples_inv[BVH_PACKET_SIZE];
+	int num_rays = 0;
+
+	for(int i = 0; i < kernel_data.integrator.num_all_lights; i++) {
+		if(UNLIKELY(light_select_reached_max_bounces(kg, i, state->bounce)))
+			continue;
+
+		int num_samples = ceil_to_int(num_samples_adjust*light_select_num_samples(kg, i));
+		float num_samples_inv = num_samples_adjust/(num_samples*kernel_data.integrator.num_all_lights);
+		RNG lamp_rng = cmj_hash(*rng, i);
+
+		for(int j = 0; j < num_samples; j++) {
+			float light_u, light_v;
+			path_branched_rng_2D(kg, &lamp_rng, state, j, num_samples, PRNG_LIGHT_U, &light_u, &light_v);
+			float terminate = path_branched_rng_light_termination(kg, &lamp_rng, state, j, num_samples);
+
+			LightSample ls;
+			if(lamp_light_sample(kg, i, light_u, light_v, sd->P, &ls)) {
+				if(kernel_data.integrator.pdf_triangles != 0.0f)
+					ls.pdf *= 2.0f;
+
+				Ray *light_ray = &light_rays[num_rays];
+#    ifdef __OBJECT_MOTION__
+				light_ray->time = sd->time;
+#    endif
+
+				if(direct_emission(kg, sd, emission_sd, &ls, state, light_ray,
+				                   &L_lights[num_rays], &is_lamps[num_rays], terminate))
+				{
+					samples_inv[num_rays] = num_samples_inv;
+
+					if(++num_rays == BVH_PACKET_SIZE) {
+						kernel_path_surface_shadow_packet_accum(kg, state, throughput, L,
+						                                        light_rays, L_lights, is_lamps,
+						                                        samples_inv, num_rays);
+						num_rays = 0;
+					}
+				}
+			}
+		}
+	}
+
+	if(num_rays > 0) {
+		kernel_path_surface_shadow_packet_accum(kg, state, throughput, L,
+		                                        light_rays, L_lights, is_lamps,
+		                                        samples_inv, num_rays);
+	}
+}
+#  endif  /* __EMISSION__ && __KERNEL_CPU__ */
+
 /* branched path tracing: connect path directly to position on one or more lights and add it to L */
 ccl_device_noinline void kernel_branched_path_surface_connect_light(
         KernelGlobals *kg,
@@ -44,36 +137,45 @@ ccl_device_noinline void kernel_branched_path_surface_connect_light(
 
 	if(sample_all_lights) {
 		/* lamp sampling */
-		for(int i = 0; i < kernel_data.integrator.num_all_lights; i++) {
-			if(UNLIKELY(light_select_reached_max_bounces(kg, i, state->bounce)))
-				continue;
-
-			int num_samples = ceil_to_int(num_samples_adjust*light_select_num_samples(kg, i));
-			float num_samples_inv = num_samples_adjust/(num_samples*kernel_data.integrator.num_all_lights);
-			RNG lamp_rng = cmj_hash(*rng, i);
-
-			for(int j = 0; j < num_samples; j++) {
-				float light_u, light_v;
-				path_branched_rng_2D(kg, &lamp_rng, state, j, num_samples, PRNG_LIGHT_U, &light_u, &light_v);
-				float terminate = path_branched_rng_light_termination(kg, &lamp_rng, state, j, num_samples);
-
-				LightSample ls;
-				if(lamp_light_sample(kg, i, light_u, light_v, sd->P, &ls)) {
-					/* The sampling probability returned by lamp_light_sample assumes that all lights were sampled.
-					 * However, this code only samples lamps, so if the scene also had mesh lights, the real probability is twice as high. */
-					if(kernel_data.integrator.pdf_triangles != 0.0f)
-						ls.pdf *= 2.0f;
-
-					if(direct_emission(kg, sd, emission_sd, &ls, state, &light_ray, &L_light, &is_lamp, terminate)) {
-						/* trace shadow ray */
-						float3 shadow;
-
-						if(!shadow_blocked(kg, emission_sd, state, &light_ray, &shadow)) {
-							/* accumulate */
-							path_radiance_accum_light(L, state, throughput*num_samples_inv, &L_light, shadow, num_samples_inv, is_lamp);
-						}
-						else {
-							path_radiance_accum_total_light(L, state, throughput*num_samples_inv, &L_light);
+#  ifdef __KERNEL_CPU__
+		if(shadow_blocked_packet_supported(kg, state)) {
+			kernel_branched_path_surface_connect_lamps_packet(kg, rng, sd, emission_sd, state,
+			                                                  throughput, num_samples_adjust, L);
+		}
+		else
+#  endif
+		{
+			for(int i = 0; i < kernel_data.integrator.num_all_lights; i++) {
+				if(UNLIKELY(light_select_reached_max_bounces(kg, i, state->bounce)))
+					continue;
+
+				int num_samples = ceil_to_int(num_samples_adjust*light_select_num_samples(kg, i));
+				float num_samples_inv = num_samples_adjust/(num_samples*kernel_data.integrator.num_all_lights);
+				RNG lamp_rng = cmj_hash(*rng, i);
+
+				for(int j = 0; j < num_samples; j++) {
+					float light_u, light_v;
+					path_branched_rng_2D(kg, &lamp_rng, state, j, num_samples, PRNG_LIGHT_U, &light_u, &light_v);
+					float terminate = path_branched_rng_light_termination(kg, &lamp_rng, state, j, num_samples);
+
+					LightSample ls;
+					if(lamp_light_sample(kg, i, light_u, light_v, sd->P, &ls)) {
+						/* The sampling probability returned by lamp_light_sample assumes that all lights were sampled.
+						 * However, this code only samples lamps, so if the scene also had mesh lights, the real probability is twice as high. */
+						if(kernel_data.integrator.pdf_triangles != 0.0f)
+							ls.pdf *= 2.0f;
+
+						if(direct_emission(kg, sd, emission_sd, &ls, state, &light_ray, &L_light, &is_lamp, terminate)) {
+							/* trace shadow ray */
+							float3 shadow;
+
+							if(!shadow_blocked(kg, emission_sd, state, &light_ray, &shadow)) {
+								/* accumulate */
+								path_radiance_accum_light(L, state, throughput*num_samples_inv, &L_light, shadow, num_samples_inv, is_lamp);
+							}
+							else {
+								path_radiance_accum_total_light(L, state, throughput*num_samples_inv, &L_light);
+							}
 						}
 					}
 				}
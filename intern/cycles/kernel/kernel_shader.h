@@ -1069,6 +1069,15 @@ ccl_device_inline void shader_eval_volume(KernelGlobals *kg,
 #endif
 		}
 
+#ifdef __KERNEL_CPU__
+		/* skip shading where the voxel data of the object is empty */
+		if(kernel_data.integrator.volume_skip_empty &&
+		   volume_sparse_grids_empty(kg, sd))
+		{
+			continue;
+		}
+#endif
+
 		/* evaluate shader */
 #ifdef __SVM__
 #  ifdef __OSL__
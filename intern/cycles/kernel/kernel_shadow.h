@@ -408,6 +408,34 @@ ccl_device bool shadow_blocked_transparent_stepped(
 #  endif  /* __KERNEL_GPU__ || !__SHADOW_RECORD_ALL__ */
 #endif /* __TRANSPARENT_SHADOWS__ */
 
+#ifdef __KERNEL_CPU__
+/* Shadow rays can be traced as a packet when a single opaque intersection
+ * test is all shadow_blocked() would do for them. */
+ccl_device_inline bool shadow_blocked_packet_supported(KernelGlobals *kg,
+                                                       ccl_addr_space PathState *state)
+{
+	if(!kernel_data.integrator.use_packet_traversal) {
+		return false;
+	}
+#  ifdef __TRANSPARENT_SHADOWS__
+	if(kernel_data.integrator.transparent_shadows) {
+		return false;
+	}
+#  endif
+#  ifdef __SHADOW_TRICKS__
+	if(state->catcher_object != OBJECT_NONE) {
+		return false;
+	}
+#  endif
+#  ifdef __VOLUME__
+	if(state->volume_stack[0].shader != SHADER_NONE) {
+		return false;
+	}
+#  endif
+	return true;
+}
+#endif  /* __KERNEL_CPU__ */
+
 ccl_device_inline bool shadow_blocked(KernelGlobals *kg,
                                       ShaderData *shadow_sd,
                                       ccl_addr_space PathState *state,
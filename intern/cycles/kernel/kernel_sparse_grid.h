@@ -0,0 +1,204 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_SPARSE_GRID_H__
+#define __KERNEL_SPARSE_GRID_H__
+
+/* Sparse volume grids for the CPU device.
+ *
+ * Voxel data of 3D builtin images (smoke and fire) is split into tiles of
+ * SPARSE_GRID_TILE_SIZE^3 voxels, and only tiles containing non-zero voxels
+ * are stored. Memory use then scales with the occupied part of the domain
+ * instead of its resolution. Lookups return the same values as the dense
+ * image texture would.
+ *
+ * Additionally every tile knows whether it or any of its neighbors contains
+ * data, which lets the volume integrator skip shading in empty space.
+ */
+
+#include "util/util_math.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+#define SPARSE_GRID_TILE_SHIFT 3
+#define SPARSE_GRID_TILE_SIZE (1 << SPARSE_GRID_TILE_SHIFT)
+#define SPARSE_GRID_TILE_MASK (SPARSE_GRID_TILE_SIZE - 1)
+#define SPARSE_GRID_TILE_VOXELS (SPARSE_GRID_TILE_SIZE * SPARSE_GRID_TILE_SIZE * SPARSE_GRID_TILE_SIZE)
+#define SPARSE_GRID_EMPTY_TILE -1
+
+struct SparseGridImage {
+	SparseGridImage()
+	: width(0), height(0), depth(0),
+	  tiles_x(0), tiles_y(0), tiles_z(0),
+	  channels(1),
+	  interpolation(INTERPOLATION_LINEAR),
+	  extension(EXTENSION_CLIP)
+	{
+	}
+
+	/* Resolution in voxels and in tiles. */
+	int width, height, depth;
+	int tiles_x, tiles_y, tiles_z;
+	/* Either 1 or 4. */
+	int channels;
+	InterpolationType interpolation;
+	ExtensionType extension;
+
+	/* Index of every tile in the voxels array, or SPARSE_GRID_EMPTY_TILE. */
+	vector<int> tiles;
+	/* Non-zero for tiles which or whose neighbors contain data. */
+	vector<uchar> tiles_active;
+	/* Voxels of all stored tiles, tiles at the border of the grid are
+	 * padded to full size. */
+	vector<float> voxels;
+
+	ccl_always_inline int tile_index(int x, int y, int z) const
+	{
+		return (x >> SPARSE_GRID_TILE_SHIFT) +
+		       tiles_x * ((y >> SPARSE_GRID_TILE_SHIFT) +
+		                  tiles_y * (z >> SPARSE_GRID_TILE_SHIFT));
+	}
+
+	ccl_always_inline float4 fetch(int x, int y, int z) const
+	{
+		const int tile = tiles[tile_index(x, y, z)];
+
+		if(tile == SPARSE_GRID_EMPTY_TILE) {
+			return (channels == 1)? make_float4(0.0f, 0.0f, 0.0f, 1.0f):
+			                        make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		const size_t voxel = (size_t)tile * SPARSE_GRID_TILE_VOXELS +
+		                     (x & SPARSE_GRID_TILE_MASK) +
+		                     SPARSE_GRID_TILE_SIZE * ((y & SPARSE_GRID_TILE_MASK) +
+		                                              SPARSE_GRID_TILE_SIZE * (z & SPARSE_GRID_TILE_MASK));
+
+		if(channels == 1) {
+			const float f = voxels[voxel];
+			return make_float4(f, f, f, 1.0f);
+		}
+
+		const float *data = &voxels[voxel * 4];
+		return make_float4(data[0], data[1], data[2], data[3]);
+	}
+
+	ccl_always_inline int wrap(int x, int size) const
+	{
+		if(extension == EXTENSION_REPEAT) {
+			x %= size;
+			return (x < 0)? x + size: x;
+		}
+		return clamp(x, 0, size - 1);
+	}
+
+	ccl_always_inline bool outside(float x, float y, float z) const
+	{
+		return (extension == EXTENSION_CLIP &&
+		        (x < 0.0f || y < 0.0f || z < 0.0f ||
+		         x > 1.0f || y > 1.0f || z > 1.0f));
+	}
+
+	/* Voxel indices and filter weights along one axis, returns the number
+	 * of filter taps. */
+	ccl_always_inline int filter_axis(float x,
+	                                  int size,
+	                                  int interp,
+	                                  int index[4],
+	                                  float weight[4]) const
+	{
+		if(interp == INTERPOLATION_CLOSEST) {
+			index[0] = wrap(float_to_int(floorf(x * (float)size)), size);
+			weight[0] = 1.0f;
+			return 1;
+		}
+
+		const float fx = x * (float)size - 0.5f;
+		const int ix = float_to_int(floorf(fx));
+		const float t = fx - (float)ix;
+
+		if(interp == INTERPOLATION_CUBIC || interp == INTERPOLATION_SMART) {
+			/* Cubic b-spline weights. */
+			weight[0] = (((-1.0f/6.0f) * t + 0.5f) * t - 0.5f) * t + (1.0f/6.0f);
+			weight[1] = ((0.5f * t - 1.0f) * t) * t + (2.0f/3.0f);
+			weight[2] = ((-0.5f * t + 0.5f) * t + 0.5f) * t + (1.0f/6.0f);
+			weight[3] = (1.0f/6.0f) * t * t * t;
+			for(int i = 0; i < 4; i++) {
+				index[i] = wrap(ix + i - 1, size);
+			}
+			return 4;
+		}
+
+		weight[0] = 1.0f - t;
+		weight[1] = t;
+		index[0] = wrap(ix, size);
+		index[1] = wrap(ix + 1, size);
+		return 2;
+	}
+
+	ccl_always_inline float4 interp_3d_ex(float x, float y, float z, int interp) const
+	{
+		if(outside(x, y, z)) {
+			return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		int ix[4], iy[4], iz[4];
+		float u[4], v[4], w[4];
+		const int nx = filter_axis(x, width, interp, ix, u);
+		const int ny = filter_axis(y, height, interp, iy, v);
+		const int nz = filter_axis(z, depth, interp, iz, w);
+
+		float4 r = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+		for(int k = 0; k < nz; k++) {
+			for(int j = 0; j < ny; j++) {
+				for(int i = 0; i < nx; i++) {
+					r += w[k] * v[j] * u[i] * fetch(ix[i], iy[j], iz[k]);
+				}
+			}
+		}
+		return r;
+	}
+
+	ccl_always_inline float4 interp_3d(float x, float y, float z) const
+	{
+		return interp_3d_ex(x, y, z, interpolation);
+	}
+
+	/* Test whether all voxels any filter can reach from this position are
+	 * zero, coordinates are normalized like for lookups. */
+	ccl_always_inline bool empty(float x, float y, float z) const
+	{
+		if(outside(x, y, z)) {
+			return true;
+		}
+
+		const int ix = wrap(float_to_int(floorf(x * (float)width)), width);
+		const int iy = wrap(float_to_int(floorf(y * (float)height)), height);
+		const int iz = wrap(float_to_int(floorf(z * (float)depth)), depth);
+
+		return !tiles_active[tile_index(ix, iy, iz)];
+	}
+};
+
+struct SparseGridGlobals {
+	/* Indexed by flattened image slot, NULL for dense images. */
+	vector<SparseGridImage*> images;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_SPARSE_GRID_H__ */
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_TEXTURE_CACHE_H__
+#define __KERNEL_TEXTURE_CACHE_H__
+
+/* Out-of-core image textures for the CPU device.
+ *
+ * When the texture cache is enabled, image files are not loaded into memory
+ * by the ImageManager. Lookups go through an OpenImageIO TextureSystem which
+ * reads tiles on demand and keeps them in an LRU cache of bounded size. Files
+ * which are already tiled and mipmapped (for example converted with maketx)
+ * are used as-is, other files are tiled on the fly.
+ */
+
+#include <OpenImageIO/texture.h>
+
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+struct TextureCacheImage {
+	TextureCacheImage()
+	: handle(NULL),
+	  interpolation(OIIO::TextureOpt::InterpBilinear),
+	  wrap(OIIO::TextureOpt::WrapPeriodic),
+	  use_alpha(true),
+	  unassociated_alpha(false)
+	{
+	}
+
+	OIIO::TextureSystem::TextureHandle *handle;
+	OIIO::TextureOpt::InterpMode interpolation;
+	OIIO::TextureOpt::Wrap wrap;
+	bool use_alpha;
+	/* The file stores unassociated alpha, which the cache keeps as is. */
+	bool unassociated_alpha;
+};
+
+struct TextureCacheGlobals {
+	TextureCacheGlobals()
+	: ts(NULL)
+	{
+	}
+
+	OIIO::TextureSystem *ts;
+
+	/* Indexed by flattened image slot, slots without a handle are regular
+	 * in-memory images. */
+	vector<TextureCacheImage> images;
+};
+
+/* Per render thread, owned by the device. */
+struct TextureCacheThreadData {
+	TextureCacheThreadData()
+	: info(NULL)
+	{
+	}
+
+	OIIO::TextureSystem::Perthread *info;
+};
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_TEXTURE_CACHE_H__ */
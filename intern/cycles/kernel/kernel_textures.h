@@ -47,7 +47,8 @@ KERNEL_TEX(float2, texture_float2, __tri_patch_uv)
 
 /* curves */
 KERNEL_TEX(float4, texture_float4, __curves)
-KERNEL_TEX(float4, texture_float4, __curve_keys)
+KERNEL_TEX(uint, texture_uint, __curve_keys)
+KERNEL_TEX(float4, texture_float4, __curve_bounds)
 
 /* patches */
 KERNEL_TEX(uint, texture_uint, __patches)
@@ -63,6 +64,8 @@ KERNEL_TEX(float4, texture_float4, __light_distribution)
 KERNEL_TEX(float4, texture_float4, __light_data)
 KERNEL_TEX(float2, texture_float2, __light_background_marginal_cdf)
 KERNEL_TEX(float2, texture_float2, __light_background_conditional_cdf)
+KERNEL_TEX(float4, texture_float4, __light_tree_nodes)
+KERNEL_TEX(uint, texture_uint, __light_tree_leaf_map)
 
 /* particles */
 KERNEL_TEX(float4, texture_float4, __particles)
@@ -38,6 +38,7 @@ CCL_NAMESPACE_BEGIN
 #define OBJECT_SIZE 		12
 #define OBJECT_VECTOR_SIZE	6
 #define LIGHT_SIZE		11
+#define LIGHT_TREE_NODE_SIZE	4
 #define FILTER_TABLE_SIZE	1024
 #define RAMP_TABLE_SIZE		256
 #define SHUTTER_TABLE_SIZE		256
@@ -56,6 +57,10 @@ CCL_NAMESPACE_BEGIN
 
 #define VOLUME_STACK_SIZE		16
 
+/* Maximum number of rays traced together by packet traversal, one bit per
+ * ray in the traversal masks. */
+#define BVH_PACKET_SIZE			16
+
 #define WORK_POOL_SIZE_GPU 64
 #define WORK_POOL_SIZE_CPU 1
 #ifdef __KERNEL_GPU__
@@ -270,6 +275,9 @@ typedef enum ShaderEvalType {
 
 	/* extra */
 	SHADER_EVAL_ENVIRONMENT,
+
+	/* several of the passes above, listed in KernelBake */
+	SHADER_EVAL_MULTIPASS,
 } ShaderEvalType;
 
 /* Path Tracing
@@ -398,6 +406,13 @@ typedef enum PassType {
 
 #define PASS_ALL (~0)
 
+/* Storage of accumulated pass values in the render buffer, see Pass::add. */
+typedef enum PassStorage {
+	PASS_STORAGE_FLOAT = 0,
+	PASS_STORAGE_HALF,
+	PASS_STORAGE_BYTE,
+} PassStorage;
+
 typedef enum DenoisingPassOffsets {
 	DENOISING_PASS_NORMAL             = 0,
 	DENOISING_PASS_NORMAL_VAR         = 3,
@@ -1183,7 +1198,13 @@ typedef struct KernelFilm {
 	int pass_denoising_data;
 	int pass_denoising_clean;
 	int denoising_flags;
-	int pad;
+	int pass_adaptive_aux_buffer;
+
+	/* Passes with half float and byte storage, their offsets are in bytes. */
+	int pass_half_flag;
+	int pass_byte_flag;
+	int pass_compressed;
+	int pass_compressed_size;
 
 #ifdef __KERNEL_DEBUG__
 	int pass_bvh_traversed_nodes;
@@ -1279,7 +1300,21 @@ typedef struct KernelIntegrator {
 	float light_inv_rr_threshold;
 
 	int start_sample;
-	int pad1, pad2, pad3;
+
+	/* adaptive sampling */
+	float adaptive_threshold;
+
+	/* light tree */
+	int use_light_tree;
+	int light_tree_lamp_root;
+	int light_tree_num_triangles;
+	int light_tree_num_local_lights;
+
+	/* packet traversal */
+	int use_packet_traversal;
+
+	/* sparse volume grids */
+	int volume_skip_empty;
 } KernelIntegrator;
 static_assert_align(KernelIntegrator, 16);
 
@@ -1305,6 +1340,7 @@ typedef enum CurveFlag {
 	CURVE_KN_INTERSECTCORRECTION = 16,		/* correct for width after determing closest midpoint? */
 	CURVE_KN_TRUETANGENTGNORMAL = 32,		/* use tangent normal for geometry? */
 	CURVE_KN_RIBBONS = 64,					/* use flat curve ribbons */
+	CURVE_KN_COMPACT_KEYS = 128,			/* 16 bit quantized curve keys? */
 } CurveFlag;
 
 typedef struct KernelCurves {
@@ -1322,6 +1358,18 @@ typedef struct KernelTables {
 } KernelTables;
 static_assert_align(KernelTables, 16);
 
+/* Passes evaluated together by SHADER_EVAL_MULTIPASS, the output holds
+ * num_passes values per pixel. */
+#define BAKE_MAX_PASSES 8
+
+typedef struct KernelBake {
+	int num_passes;
+	int pad1, pad2, pad3;
+	int pass_type[BAKE_MAX_PASSES];
+	int pass_filter[BAKE_MAX_PASSES];
+} KernelBake;
+static_assert_align(KernelBake, 16);
+
 typedef struct KernelData {
 	KernelCamera cam;
 	KernelFilm film;
@@ -1330,6 +1378,7 @@ typedef struct KernelData {
 	KernelBVH bvh;
 	KernelCurves curve;
 	KernelTables tables;
+	KernelBake bake;
 } KernelData;
 static_assert_align(KernelData, 16);
 
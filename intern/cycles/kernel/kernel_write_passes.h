@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KERNEL_WRITE_PASSES_H__
+#define __KERNEL_WRITE_PASSES_H__
+
+CCL_NAMESPACE_BEGIN
+
+ccl_device_inline void kernel_write_pass_float(ccl_global float *buffer, int sample, float value)
+{
+	ccl_global float *buf = buffer;
+#if defined(__SPLIT_KERNEL__)
+	atomic_add_and_fetch_float(buf, value);
+#else
+	*buf = (sample == 0)? value: *buf + value;
+#endif  /* __SPLIT_KERNEL__ */
+}
+
+ccl_device_inline void kernel_write_pass_float3(ccl_global float *buffer, int sample, float3 value)
+{
+#if defined(__SPLIT_KERNEL__)
+	ccl_global float *buf_x = buffer + 0;
+	ccl_global float *buf_y = buffer + 1;
+	ccl_global float *buf_z = buffer + 2;
+
+	atomic_add_and_fetch_float(buf_x, value.x);
+	atomic_add_and_fetch_float(buf_y, value.y);
+	atomic_add_and_fetch_float(buf_z, value.z);
+#else
+	ccl_global float3 *buf = (ccl_global float3*)buffer;
+	*buf = (sample == 0)? value: *buf + value;
+#endif  /* __SPLIT_KERNEL__ */
+}
+
+ccl_device_inline void kernel_write_pass_float4(ccl_global float *buffer, int sample, float4 value)
+{
+#if defined(__SPLIT_KERNEL__)
+	ccl_global float *buf_x = buffer + 0;
+	ccl_global float *buf_y = buffer + 1;
+	ccl_global float *buf_z = buffer + 2;
+	ccl_global float *buf_w = buffer + 3;
+
+	atomic_add_and_fetch_float(buf_x, value.x);
+	atomic_add_and_fetch_float(buf_y, value.y);
+	atomic_add_and_fetch_float(buf_z, value.z);
+	atomic_add_and_fetch_float(buf_w, value.w);
+#else
+	ccl_global float4 *buf = (ccl_global float4*)buffer;
+	*buf = (sample == 0)? value: *buf + value;
+#endif  /* __SPLIT_KERNEL__ */
+}
+
+/* Compressed Passes
+ *
+ * Half float passes hold the average of the samples written to them rather
+ * than the sum, so they keep their precision as samples accumulate. The
+ * average is followed by the number of samples in it, which weights the
+ * average on read for passes that are not written on every sample. Byte
+ * passes hold object and material IDs, written on the first sample only.
+ *
+ * Offsets of compressed passes are in bytes. Updates are not atomic, with the
+ * split kernel a sample of a pixel rendering concurrently with another sample
+ * of the same pixel may be left out of the average. */
+
+ccl_device_inline void kernel_write_pass_half(ccl_global float *buffer, int offset, int sample,
+                                              float4 value, int components)
+{
+	ccl_global ushort *buf = (ccl_global ushort*)((ccl_global uchar*)buffer + offset);
+	float v[4] = {value.x, value.y, value.z, value.w};
+
+	uint num_samples = (sample == 0)? 0: buf[components];
+	float weight = 1.0f/(float)(num_samples + 1);
+
+	for(int i = 0; i < components; i++) {
+		float mean = (num_samples == 0)? 0.0f: half_bits_to_float(buf[i]);
+		buf[i] = (ushort)float_to_half_bits(mean + (v[i] - mean)*weight);
+	}
+
+	buf[components] = (ushort)((num_samples < 0xffff)? num_samples + 1: 0xffff);
+}
+
+ccl_device_inline void kernel_write_pass_byte(ccl_global float *buffer, int offset, float value)
+{
+	ccl_global uchar *buf = (ccl_global uchar*)buffer + offset;
+	*buf = (uchar)clamp(value + 0.5f, 0.0f, 255.0f);
+}
+
+CCL_NAMESPACE_END
+
+#endif  /* __KERNEL_WRITE_PASSES_H__ */
@@ -59,9 +59,67 @@
 #include "kernel/kernel.h"
 #define KERNEL_ARCH cpu
 #include "kernel/kernels/cpu/kernel_cpu_impl.h"
+#include "kernel/kernel_texture_cache.h"
 
 CCL_NAMESPACE_BEGIN
 
+/* Texture Cache
+ *
+ * Lookups are not inlined into the architecture specific kernels, so only
+ * this file depends on the OpenImageIO headers. */
+
+bool kernel_tex_image_interp_cache(KernelGlobals *kg,
+                                   int tex,
+                                   float x, float y,
+                                   float2 dx, float2 dy,
+                                   float4 *r)
+{
+	const TextureCacheGlobals *tcg = kg->texture_cache;
+	if(tcg == NULL || (size_t)tex >= tcg->images.size() || tcg->images[tex].handle == NULL) {
+		return false;
+	}
+
+	const TextureCacheImage& image = tcg->images[tex];
+
+	OIIO::TextureOpt options;
+	options.interpmode = image.interpolation;
+	options.swrap = image.wrap;
+	options.twrap = image.wrap;
+	/* Missing channels, alpha in the first place, are filled with one. */
+	options.fill = 1.0f;
+
+	/* Images are stored bottom to top in Cycles, OIIO reads them top to
+	 * bottom, which flips t and its derivatives. The derivatives select the
+	 * MIP level, so distant and minified lookups only read the small levels. */
+	if(!tcg->ts->texture(image.handle,
+	                     kg->texture_cache_tdata->info,
+	                     options,
+	                     x, 1.0f - y,
+	                     dx.x, -dx.y,
+	                     dy.x, -dy.y,
+	                     4,
+	                     (float*)r))
+	{
+		*r = make_float4(TEX_IMAGE_MISSING_R,
+		                 TEX_IMAGE_MISSING_G,
+		                 TEX_IMAGE_MISSING_B,
+		                 TEX_IMAGE_MISSING_A);
+		return true;
+	}
+
+	/* Match how the image manager loads images. With alpha ignored, colors
+	 * are used as stored in the file. Otherwise they are associated with
+	 * alpha, which the cache keeps unassociated for files storing it so. */
+	if(!image.use_alpha) {
+		r->w = 1.0f;
+	}
+	else if(image.unassociated_alpha) {
+		*r = make_float4(r->x * r->w, r->y * r->w, r->z * r->w, r->w);
+	}
+
+	return true;
+}
+
 /* Memory Copy */
 
 void kernel_const_copy(KernelGlobals *kg, const char *name, void *host, size_t size)
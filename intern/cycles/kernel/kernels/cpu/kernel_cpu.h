@@ -24,6 +24,36 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
                                            int offset,
                                            int stride);
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int num_pixels,
+                                                  int offset,
+                                                  int stride);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_stopping)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int offset,
+                                                  int stride);
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_filter)(KernelGlobals *kg,
+                                                float *buffer,
+                                                int x, int y,
+                                                int sx, int sy, int sw, int sh,
+                                                int offset,
+                                                int stride);
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust)(KernelGlobals *kg,
+                                                float *buffer,
+                                                int sample,
+                                                int x, int y,
+                                                int offset,
+                                                int stride);
+
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
                                                 uchar4 *rgba,
                                                 float *buffer,
@@ -19,10 +19,37 @@
 
 #ifdef __KERNEL_CPU__
 
+#include "kernel/kernel_sparse_grid.h"
+
 CCL_NAMESPACE_BEGIN
 
-ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float x, float y)
+/* Lookup through the OpenImageIO texture cache, defined in kernel.cpp so the
+ * kernels don't need the OpenImageIO headers. Returns false when the image is
+ * not in the cache. Derivatives are in image space and select the MIP level. */
+bool kernel_tex_image_interp_cache(KernelGlobals *kg,
+                                   int tex,
+                                   float x, float y,
+                                   float2 dx, float2 dy,
+                                   float4 *r);
+
+ccl_device_inline const SparseGridImage *kernel_tex_image_sparse_grid(KernelGlobals *kg, int tex)
+{
+	const SparseGridGlobals *sgg = kg->sparse_grids;
+	return (sgg != NULL && (size_t)tex < sgg->images.size())? sgg->images[tex]: NULL;
+}
+
+ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg,
+                                               int tex,
+                                               float x, float y,
+                                               float2 dx, float2 dy)
 {
+	float4 r;
+	if(UNLIKELY(kg->texture_cache_tdata != NULL) &&
+	   kernel_tex_image_interp_cache(kg, tex, x, y, dx, dy, &r))
+	{
+		return r;
+	}
+
 	switch(kernel_tex_type(tex)) {
 		case IMAGE_DATA_TYPE_HALF:
 			return kg->texture_half_images[kernel_tex_index(tex)].interp(x, y);
@@ -40,8 +67,20 @@ ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float
 	}
 }
 
+ccl_device float4 kernel_tex_image_interp_impl(KernelGlobals *kg, int tex, float x, float y)
+{
+	return kernel_tex_image_interp_impl(kg, tex, x, y,
+	                                    make_float2(0.0f, 0.0f),
+	                                    make_float2(0.0f, 0.0f));
+}
+
 ccl_device float4 kernel_tex_image_interp_3d_impl(KernelGlobals *kg, int tex, float x, float y, float z)
 {
+	const SparseGridImage *grid = kernel_tex_image_sparse_grid(kg, tex);
+	if(grid) {
+		return grid->interp_3d(x, y, z);
+	}
+
 	switch(kernel_tex_type(tex)) {
 		case IMAGE_DATA_TYPE_HALF:
 			return kg->texture_half_images[kernel_tex_index(tex)].interp_3d(x, y, z);
@@ -61,6 +100,11 @@ ccl_device float4 kernel_tex_image_interp_3d_impl(KernelGlobals *kg, int tex, fl
 
 ccl_device float4 kernel_tex_image_interp_3d_ex_impl(KernelGlobals *kg, int tex, float x, float y, float z, int interpolation)
 {
+	const SparseGridImage *grid = kernel_tex_image_sparse_grid(kg, tex);
+	if(grid) {
+		return grid->interp_3d_ex(x, y, z, interpolation);
+	}
+
 	switch(kernel_tex_type(tex)) {
 		case IMAGE_DATA_TYPE_HALF:
 			return kg->texture_half_images[kernel_tex_index(tex)].interp_3d_ex(x, y, z, interpolation);
@@ -34,6 +34,7 @@
 #    include "kernel/kernel_film.h"
 #    include "kernel/kernel_path.h"
 #    include "kernel/kernel_path_branched.h"
+#    include "kernel/kernel_path_packet.h"
 #    include "kernel/kernel_bake.h"
 #  else
 #    include "kernel/split/kernel_split_common.h"
@@ -101,6 +102,67 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 #endif /* KERNEL_STUB */
 }
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_packet)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int num_pixels,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, path_trace_packet);
+#else
+	kernel_path_trace_packet(kg, buffer, rng_state, sample, x, y, num_pixels, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+/* Adaptive Sampling */
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_stopping)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  int sample,
+                                                  int x, int y,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_stopping);
+#else
+	kernel_adaptive_stopping(kg, buffer, sample, x, y, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+bool KERNEL_FUNCTION_FULL_NAME(adaptive_filter)(KernelGlobals *kg,
+                                                float *buffer,
+                                                int x, int y,
+                                                int sx, int sy, int sw, int sh,
+                                                int offset,
+                                                int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_filter);
+	return false;
+#else
+	return kernel_adaptive_filter(kg, buffer, x, y, sx, sy, sw, sh, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
+void KERNEL_FUNCTION_FULL_NAME(adaptive_adjust)(KernelGlobals *kg,
+                                                float *buffer,
+                                                int sample,
+                                                int x, int y,
+                                                int offset,
+                                                int stride)
+{
+#ifdef KERNEL_STUB
+	STUB_ASSERT(KERNEL_ARCH, adaptive_adjust);
+#else
+	kernel_adaptive_adjust(kg, buffer, sample, x, y, offset, stride);
+#endif /* KERNEL_STUB */
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
@@ -29,10 +29,15 @@ CCL_NAMESPACE_BEGIN
 #  define TEX_NUM_FLOAT4_IMAGES	TEX_NUM_FLOAT4_OPENCL
 #endif
 
-ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y, uint srgb, uint use_alpha)
+ccl_device float4 svm_image_texture(KernelGlobals *kg,
+                                    int id,
+                                    float x, float y,
+                                    float2 dx, float2 dy,
+                                    uint srgb, uint use_alpha)
 {
 #ifdef __KERNEL_CPU__
-	float4 r = kernel_tex_image_interp(id, x, y);
+	/* Derivatives are only used by the texture cache to select a MIP level. */
+	float4 r = kernel_tex_image_interp_d(id, x, y, dx, dy);
 #elif defined(__KERNEL_OPENCL__)
 	float4 r = kernel_tex_image_interp(kg, id, x, y);
 #else
@@ -180,6 +185,32 @@ ccl_device float4 svm_image_texture(KernelGlobals *kg, int id, float x, float y,
 	return r;
 }
 
+/* Screen space derivatives of the default UV map, for filtered lookups from
+ * the texture cache. SVM does not track derivatives through the node graph,
+ * so they are only used when the compiler found the image to be looked up
+ * with the default UV map without any mapping. */
+ccl_device_inline void svm_image_texture_uv_derivatives(KernelGlobals *kg,
+                                                        ShaderData *sd,
+                                                        float2 *dx, float2 *dy)
+{
+	*dx = make_float2(0.0f, 0.0f);
+	*dy = make_float2(0.0f, 0.0f);
+
+#if defined(__KERNEL_CPU__) && defined(__RAY_DIFFERENTIALS__)
+	if(kg->texture_cache_tdata == NULL)
+		return;
+
+	const AttributeDescriptor desc = find_attribute(kg, sd, ATTR_STD_UV);
+	if(desc.offset == ATTR_STD_NOT_FOUND)
+		return;
+
+	float3 duv_dx, duv_dy;
+	primitive_attribute_float3(kg, sd, desc, &duv_dx, &duv_dy);
+	*dx = make_float2(duv_dx.x, duv_dx.y);
+	*dy = make_float2(duv_dy.x, duv_dy.y);
+#endif
+}
+
 /* Remap coordnate from 0..1 box to -1..-1 */
 ccl_device_inline float3 texco_remap_square(float3 co)
 {
@@ -190,24 +221,33 @@ ccl_device void svm_node_tex_image(KernelGlobals *kg, ShaderData *sd, float *sta
 {
 	uint id = node.y;
 	uint co_offset, out_offset, alpha_offset, srgb;
+	uint projection, use_uv_derivatives, dummy;
 
 	decode_node_uchar4(node.z, &co_offset, &out_offset, &alpha_offset, &srgb);
+	decode_node_uchar4(node.w, &projection, &use_uv_derivatives, &dummy, &dummy);
 
 	float3 co = stack_load_float3(stack, co_offset);
 	float2 tex_co;
 	uint use_alpha = stack_valid(alpha_offset);
-	if(node.w == NODE_IMAGE_PROJ_SPHERE) {
+	if(projection == NODE_IMAGE_PROJ_SPHERE) {
 		co = texco_remap_square(co);
 		tex_co = map_to_sphere(co);
 	}
-	else if(node.w == NODE_IMAGE_PROJ_TUBE) {
+	else if(projection == NODE_IMAGE_PROJ_TUBE) {
 		co = texco_remap_square(co);
 		tex_co = map_to_tube(co);
 	}
 	else {
 		tex_co = make_float2(co.x, co.y);
 	}
-	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, srgb, use_alpha);
+	float2 dx, dy;
+	if(use_uv_derivatives) {
+		svm_image_texture_uv_derivatives(kg, sd, &dx, &dy);
+	}
+	else {
+		dx = dy = make_float2(0.0f, 0.0f);
+	}
+	float4 f = svm_image_texture(kg, id, tex_co.x, tex_co.y, dx, dy, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -292,13 +332,14 @@ ccl_device void svm_node_tex_image_box(KernelGlobals *kg, ShaderData *sd, float
 
 	float4 f = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 	uint use_alpha = stack_valid(alpha_offset);
+	const float2 zero = make_float2(0.0f, 0.0f);
 
 	if(weight.x > 0.0f)
-		f += weight.x*svm_image_texture(kg, id, co.y, co.z, srgb, use_alpha);
+		f += weight.x*svm_image_texture(kg, id, co.y, co.z, zero, zero, srgb, use_alpha);
 	if(weight.y > 0.0f)
-		f += weight.y*svm_image_texture(kg, id, co.x, co.z, srgb, use_alpha);
+		f += weight.y*svm_image_texture(kg, id, co.x, co.z, zero, zero, srgb, use_alpha);
 	if(weight.z > 0.0f)
-		f += weight.z*svm_image_texture(kg, id, co.y, co.x, srgb, use_alpha);
+		f += weight.z*svm_image_texture(kg, id, co.y, co.x, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -325,7 +366,8 @@ ccl_device void svm_node_tex_environment(KernelGlobals *kg, ShaderData *sd, floa
 		uv = direction_to_mirrorball(co);
 
 	uint use_alpha = stack_valid(alpha_offset);
-	float4 f = svm_image_texture(kg, id, uv.x, uv.y, srgb, use_alpha);
+	const float2 zero = make_float2(0.0f, 0.0f);
+	float4 f = svm_image_texture(kg, id, uv.x, uv.y, zero, zero, srgb, use_alpha);
 
 	if(stack_valid(out_offset))
 		stack_store_float3(stack, out_offset, make_float3(f.x, f.y, f.z));
@@ -17,6 +17,9 @@
 #include "render/bake.h"
 #include "render/integrator.h"
 
+#include "util/util_algorithm.h"
+#include "util/util_foreach.h"
+
 CCL_NAMESPACE_BEGIN
 
 BakeData::BakeData(const int object, const size_t tri_offset, const size_t num_pixels):
@@ -95,6 +98,12 @@ uint4 BakeData::differentials(int i)
 		  );
 }
 
+BakePass::BakePass(ShaderEvalType type, int pass_filter)
+: type(type),
+  pass_filter(pass_filter)
+{
+}
+
 BakeManager::BakeManager()
 {
 	m_bake_data = NULL;
@@ -131,21 +140,160 @@ void BakeManager::set_shader_limit(const size_t x, const size_t y)
 	m_shader_limit = (size_t)pow(2, ceil(log(m_shader_limit)/log(2)));
 }
 
+static void bake_copy_result(float *result, BakeData *bake_data, int /*pass*/, const float *pass_result)
+{
+	for(size_t i = 0; i < bake_data->size(); i++) {
+		if(bake_data->is_valid(i)) {
+			for(size_t j = 0; j < 4; j++) {
+				result[i*4 + j] = pass_result[i*4 + j];
+			}
+		}
+	}
+}
+
 bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[])
 {
-	size_t num_pixels = bake_data->size();
+	vector<BakePass> passes(1, BakePass(shader_type, pass_filter));
+	vector<BakeData*> objects(1, bake_data);
+
+	return bake_batch(device, dscene, scene, progress, passes, objects,
+	                  function_bind(&bake_copy_result, result, _1, _2, _3));
+}
+
+/* Orders passes of a sweep by their light filter, keeping the order of the
+ * passes otherwise. */
+struct BakePassLightFilterLess {
+	BakePassLightFilterLess(const vector<BakePass>& passes)
+	: passes(passes)
+	{
+	}
+
+	bool operator()(int a, int b) const
+	{
+		const int filter_a = BakeManager::light_pass_filter(passes[a].pass_filter);
+		const int filter_b = BakeManager::light_pass_filter(passes[b].pass_filter);
+
+		return (filter_a != filter_b)? filter_a < filter_b: a < b;
+	}
+
+	const vector<BakePass>& passes;
+};
+
+bool BakeManager::bake_batch(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress,
+                             const vector<BakePass>& passes, const vector<BakeData*>& objects,
+                             const BakeWriteResultFunc& write_result)
+{
+	/* Group passes which are evaluated in the same sweep. The environment pass
+	 * replaces the shader data of the pixel, so it always gets its own. */
+	vector<vector<int> > groups;
+	vector<int> group;
+
+	for(int i = 0; i < passes.size(); i++) {
+		if(passes[i].type == SHADER_EVAL_ENVIRONMENT) {
+			groups.push_back(vector<int>(1, i));
+			continue;
+		}
 
-	int num_samples = is_aa_pass(shader_type)? scene->integrator->aa_samples : 1;
+		group.push_back(i);
+
+		if(group.size() == BAKE_MAX_PASSES) {
+			groups.push_back(group);
+			group.clear();
+		}
+	}
+
+	if(!group.empty())
+		groups.push_back(group);
 
 	/* calculate the total pixel samples for the progress bar */
+	size_t num_pixels = 0;
+	foreach(BakeData *bake_data, objects)
+		num_pixels += bake_data->size();
+
 	total_pixel_samples = 0;
-	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
-		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
-		total_pixel_samples += shader_size * num_samples;
+	foreach(const vector<int>& pass_indices, groups) {
+		int num_samples = 1;
+		foreach(int pass, pass_indices) {
+			if(is_aa_pass(passes[pass].type))
+				num_samples = scene->integrator->aa_samples;
+		}
+		total_pixel_samples += num_pixels * num_samples;
 	}
 	progress.reset_sample();
 	progress.set_total_pixel_samples(total_pixel_samples);
 
+	foreach(vector<int>& pass_indices, groups) {
+		sort(pass_indices.begin(), pass_indices.end(), BakePassLightFilterLess(passes));
+	}
+
+	foreach(const vector<int>& pass_indices, groups) {
+		if(!bake_sweep(device, dscene, scene, progress, passes, pass_indices, objects, write_result)) {
+			m_is_baking = false;
+			return false;
+		}
+	}
+
+	m_is_baking = false;
+	return true;
+}
+
+/* Hand the results of all passes of an object over and clear them for the
+ * next object. */
+static void bake_write_object(BakeData *bake_data,
+                              const vector<int>& pass_indices,
+                              vector<float>& object_result,
+                              const BakeWriteResultFunc& write_result)
+{
+	const size_t size = bake_data->size();
+	object_result.resize(size * pass_indices.size() * 4, 0.0f);
+
+	for(int pass = 0; pass < pass_indices.size(); pass++) {
+		write_result(bake_data, pass_indices[pass], (size)? &object_result[pass * size * 4]: NULL);
+	}
+
+	object_result.clear();
+}
+
+bool BakeManager::bake_sweep(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress,
+                             const vector<BakePass>& passes, const vector<int>& pass_indices,
+                             const vector<BakeData*>& objects, const BakeWriteResultFunc& write_result)
+{
+	const int num_passes = pass_indices.size();
+	ShaderEvalType shader_type = passes[pass_indices[0]].type;
+	int pass_filter = passes[pass_indices[0]].pass_filter;
+	int num_samples = 1;
+
+	if(num_passes > 1) {
+		/* the kernel computes the light pass again for each distinct light
+		 * filter, so passes sharing one are listed next to each other */
+		KernelBake *kbake = &dscene->data.bake;
+		kbake->num_passes = num_passes;
+		shader_type = SHADER_EVAL_MULTIPASS;
+		pass_filter = 0;
+
+		for(int i = 0; i < num_passes; i++) {
+			const BakePass& pass = passes[pass_indices[i]];
+			kbake->pass_type[i] = pass.type;
+			kbake->pass_filter[i] = pass.pass_filter;
+		}
+	}
+
+	foreach(int pass, pass_indices) {
+		if(is_aa_pass(passes[pass].type))
+			num_samples = scene->integrator->aa_samples;
+	}
+
+	size_t num_pixels = 0;
+	foreach(BakeData *bake_data, objects)
+		num_pixels += bake_data->size();
+
+	/* Pixels of all objects are concatenated, so small objects share device
+	 * tasks. Objects are tracked separately for filling the input and reading
+	 * back the output. */
+	size_t input_object = 0, input_pixel = 0;
+	size_t output_object = 0, output_pixel = 0;
+	vector<float> object_result;
+
 	for(size_t shader_offset = 0; shader_offset < num_pixels; shader_offset += m_shader_limit) {
 		size_t shader_size = (size_t)fminf(num_pixels - shader_offset, m_shader_limit);
 
@@ -154,19 +302,19 @@ bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progre
 		uint4 *d_input_data = d_input.resize(shader_size * 2);
 		size_t d_input_size = 0;
 
-		for(size_t i = shader_offset; i < (shader_offset + shader_size); i++) {
-			d_input_data[d_input_size++] = bake_data->data(i);
-			d_input_data[d_input_size++] = bake_data->differentials(i);
-		}
+		for(size_t i = 0; i < shader_size; i++, input_pixel++) {
+			while(input_pixel == objects[input_object]->size()) {
+				input_object++;
+				input_pixel = 0;
+			}
 
-		if(d_input_size == 0) {
-			m_is_baking = false;
-			return false;
+			d_input_data[d_input_size++] = objects[input_object]->data(input_pixel);
+			d_input_data[d_input_size++] = objects[input_object]->differentials(input_pixel);
 		}
 
 		/* run device task */
 		device_vector<float4> d_output;
-		d_output.resize(shader_size);
+		d_output.resize(shader_size * num_passes);
 
 		/* needs to be up to data for attribute access */
 		device->const_copy_to("__data", &dscene->data, sizeof(dscene->data));
@@ -182,7 +330,7 @@ bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progre
 		task.shader_filter = pass_filter;
 		task.shader_x = 0;
 		task.offset = shader_offset;
-		task.shader_w = d_output.size();
+		task.shader_w = shader_size;
 		task.num_samples = num_samples;
 		task.get_cancel = function_bind(&Progress::get_cancel, &progress);
 		task.update_progress_sample = function_bind(&Progress::add_samples_update, &progress, _1, _2);
@@ -193,7 +341,6 @@ bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progre
 		if(progress.get_cancel()) {
 			device->mem_free(d_input);
 			device->mem_free(d_output);
-			m_is_baking = false;
 			return false;
 		}
 
@@ -201,25 +348,39 @@ bool BakeManager::bake(Device *device, DeviceScene *dscene, Scene *scene, Progre
 		device->mem_free(d_input);
 		device->mem_free(d_output);
 
-		/* read result */
-		int k = 0;
-
+		/* read result, handing finished objects over to the caller */
 		float4 *offset = (float4*)d_output.data_pointer;
 
-		size_t depth = 4;
-		for(size_t i=shader_offset; i < (shader_offset + shader_size); i++) {
-			size_t index = i * depth;
-			float4 out = offset[k++];
+		for(size_t i = 0; i < shader_size; i++, output_pixel++) {
+			while(output_pixel == objects[output_object]->size()) {
+				bake_write_object(objects[output_object], pass_indices, object_result, write_result);
+				output_object++;
+				output_pixel = 0;
+			}
+
+			BakeData *bake_data = objects[output_object];
+
+			if(object_result.empty())
+				object_result.resize(bake_data->size() * num_passes * 4, 0.0f);
 
-			if(bake_data->is_valid(i)) {
-				for(size_t j=0; j < 4; j++) {
-					result[index + j] = out[j];
+			if(bake_data->is_valid(output_pixel)) {
+				for(int pass = 0; pass < num_passes; pass++) {
+					float4 out = offset[i * num_passes + pass];
+					size_t index = (pass * bake_data->size() + output_pixel) * 4;
+
+					for(size_t j = 0; j < 4; j++) {
+						object_result[index + j] = out[j];
+					}
 				}
 			}
 		}
 	}
 
-	m_is_baking = false;
+	/* remaining objects, including the last one and objects without pixels */
+	for(; output_object < objects.size(); output_object++) {
+		bake_write_object(objects[output_object], pass_indices, object_result, write_result);
+	}
+
 	return true;
 }
 
@@ -276,4 +437,15 @@ int BakeManager::shader_type_to_pass_filter(ShaderEvalType type, const int pass_
 	}
 }
 
+/* Keep it synced with bake_light_pass_filter() in kernel_bake.h */
+int BakeManager::light_pass_filter(const int pass_filter)
+{
+	int light_filter = pass_filter & (BAKE_FILTER_AO | BAKE_FILTER_EMISSION | BAKE_FILTER_SUBSURFACE);
+
+	if(pass_filter & (BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT))
+		light_filter |= BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT;
+
+	return light_filter;
+}
+
 CCL_NAMESPACE_END
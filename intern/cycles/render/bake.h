@@ -20,6 +20,7 @@
 #include "device/device.h"
 #include "render/scene.h"
 
+#include "util/util_function.h"
 #include "util/util_progress.h"
 #include "util/util_vector.h"
 
@@ -51,6 +52,19 @@ private:
 	vector<float>m_dvdy;
 };
 
+/* Pass type and light components of a pass baked by BakeManager::bake_batch. */
+class BakePass {
+public:
+	BakePass(ShaderEvalType type, int pass_filter);
+
+	ShaderEvalType type;
+	int pass_filter;
+};
+
+/* Receives the result of one pass of one object, four floats per pixel,
+ * pixels without a primitive are zero. */
+typedef function<void(BakeData *bake_data, int pass, const float *result)> BakeWriteResultFunc;
+
 class BakeManager {
 public:
 	BakeManager();
@@ -65,10 +79,20 @@ public:
 
 	bool bake(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress, ShaderEvalType shader_type, const int pass_filter, BakeData *bake_data, float result[]);
 
+	/* Bake several passes for several objects with the scene as it is on the
+	 * device. Passes are evaluated together in one sweep over the pixels of
+	 * all objects, and the results of each object are passed to write_result
+	 * as soon as all of its pixels are done. Light passes need use_light_pass
+	 * of the film to be enabled. */
+	bool bake_batch(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress,
+	                const vector<BakePass>& passes, const vector<BakeData*>& objects,
+	                const BakeWriteResultFunc& write_result);
+
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
 	void device_free(Device *device, DeviceScene *dscene);
 
 	static int shader_type_to_pass_filter(ShaderEvalType type, const int pass_filter);
+	static int light_pass_filter(const int pass_filter);
 	static bool is_aa_pass(ShaderEvalType type);
 
 	bool need_update;
@@ -76,6 +100,10 @@ public:
 	size_t total_pixel_samples;
 
 private:
+	bool bake_sweep(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress,
+	                const vector<BakePass>& passes, const vector<int>& pass_indices,
+	                const vector<BakeData*>& objects, const BakeWriteResultFunc& write_result);
+
 	BakeData *m_bake_data;
 	bool m_is_baking;
 	size_t m_shader_limit;
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "render/buffers.h"
 #include "device/device.h"
@@ -24,7 +25,9 @@
 #include "util/util_hash.h"
 #include "util/util_image.h"
 #include "util/util_math.h"
+#include "util/util_logging.h"
 #include "util/util_opengl.h"
+#include "util/util_path.h"
 #include "util/util_time.h"
 #include "util/util_types.h"
 
@@ -44,6 +47,7 @@ BufferParams::BufferParams()
 
 	denoising_data_pass = false;
 	denoising_clean_pass = false;
+	adaptive_sampling_pass = false;
 
 	Pass::add(PASS_COMBINED, passes);
 }
@@ -65,19 +69,28 @@ bool BufferParams::modified(const BufferParams& params)
 		&& Pass::equals(passes, params.passes));
 }
 
+void BufferParams::add_pass(PassType type, PassStorage storage)
+{
+	Pass::add(type, passes, storage);
+}
+
 int BufferParams::get_passes_size()
 {
-	int size = 0;
+	int size = get_compressed_offset();
+	int compressed_size = 0;
 
 	for(size_t i = 0; i < passes.size(); i++)
-		size += passes[i].components;
+		if(passes[i].storage != PASS_STORAGE_FLOAT)
+			compressed_size += passes[i].compressed_size();
 
-	if(denoising_data_pass) {
-		size += DENOISING_PASS_SIZE_BASE;
-		if(denoising_clean_pass) size += DENOISING_PASS_SIZE_CLEAN;
+	size += divide_up(compressed_size, sizeof(float));
+	size = align_up(size, 4);
+
+	if(adaptive_sampling_pass) {
+		size += 4;
 	}
 
-	return align_up(size, 4);
+	return size;
 }
 
 int BufferParams::get_denoising_offset()
@@ -85,11 +98,46 @@ int BufferParams::get_denoising_offset()
 	int offset = 0;
 
 	for(size_t i = 0; i < passes.size(); i++)
-		offset += passes[i].components;
+		if(passes[i].storage == PASS_STORAGE_FLOAT)
+			offset += passes[i].components;
+
+	return offset;
+}
+
+int BufferParams::get_compressed_offset()
+{
+	int offset = get_denoising_offset();
+
+	if(denoising_data_pass) {
+		offset += DENOISING_PASS_SIZE_BASE;
+		if(denoising_clean_pass) offset += DENOISING_PASS_SIZE_CLEAN;
+	}
 
 	return offset;
 }
 
+const Pass *BufferParams::find_pass(PassType type, int& offset)
+{
+	int float_offset = 0;
+	int byte_offset = get_compressed_offset()*sizeof(float);
+
+	for(size_t i = 0; i < passes.size(); i++) {
+		const Pass& pass = passes[i];
+
+		if(pass.type == type) {
+			offset = (pass.storage == PASS_STORAGE_FLOAT)? float_offset: byte_offset;
+			return &pass;
+		}
+
+		if(pass.storage == PASS_STORAGE_FLOAT)
+			float_offset += pass.components;
+		else
+			byte_offset += pass.compressed_size();
+	}
+
+	return NULL;
+}
+
 /* Render Buffer Task */
 
 RenderTile::RenderTile()
@@ -106,6 +154,7 @@ RenderTile::RenderTile()
 
 	offset = 0;
 	stride = 0;
+	acquire_time = 0.0;
 
 	buffer = 0;
 	rng_state = 0;
@@ -170,6 +219,17 @@ bool RenderBuffers::copy_from_device(Device *from_device)
 	return true;
 }
 
+bool RenderBuffers::copy_to_device()
+{
+	if(!buffer.device_pointer)
+		return false;
+
+	device->mem_copy_to(buffer);
+	device->mem_copy_to(rng_state);
+
+	return true;
+}
+
 bool RenderBuffers::get_denoising_pass_rect(int offset, float exposure, int sample, int components, float *pixels)
 {
 	float scale = 1.0f/sample;
@@ -205,8 +265,118 @@ bool RenderBuffers::get_denoising_pass_rect(int offset, float exposure, int samp
 	return true;
 }
 
+/* Average of the samples accumulated in a pass at one pixel. Pixels that
+ * converged early with adaptive sampling received pixel_sample samples. */
+static float4 pass_pixel_average(const Pass& pass, int offset, const float *in, int sample, int pixel_sample)
+{
+	float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+	if(pass.storage == PASS_STORAGE_FLOAT) {
+		float scale = (pass.filter)? 1.0f/(float)sample: 1.0f;
+
+		for(int i = 0; i < pass.components; i++)
+			v[i] = in[offset + i]*scale;
+	}
+	else if(pass.storage == PASS_STORAGE_BYTE) {
+		v[0] = (float)((const uchar*)in)[offset];
+	}
+	else {
+		const ushort *h = (const ushort*)((const uchar*)in + offset);
+		int num_written = pass.compressed_size()/sizeof(ushort) - 1;
+		float scale = 1.0f;
+
+		/* The average only covers the samples that wrote to the pass, while
+		 * float passes are divided by all samples of the pixel. Weight it by
+		 * the share of samples written to match, unless the count saturated. */
+		if(pass.filter && h[num_written] < 0xffff)
+			scale = min((float)h[num_written]/(float)pixel_sample, 1.0f);
+
+		for(int i = 0; i < num_written; i++)
+			v[i] = half_bits_to_float(h[i])*scale;
+	}
+
+	return make_float4(v[0], v[1], v[2], v[3]);
+}
+
+bool RenderBuffers::get_compressed_pass_rect(const Pass& pass, int offset, float exposure, int sample, int components, float *pixels)
+{
+	if((components == 1) != (pass.components == 1) || components == 2)
+		return false;
+
+	int divide_offset = 0;
+	const Pass *divide_pass = NULL;
+
+	if(pass.divide_type != PASS_NONE)
+		divide_pass = params.find_pass(pass.divide_type, divide_offset);
+
+	float *in = (float*)buffer.data_pointer;
+	int pass_stride = params.get_passes_size();
+	int size = params.width*params.height;
+	float scale_exposure = (pass.exposure)? exposure: 1.0f;
+	/* the adaptive sampling pass is last, the sample count in its fourth component */
+	int adaptive_offset = (params.adaptive_sampling_pass)? pass_stride - 1: -1;
+
+	for(int i = 0; i < size; i++, in += pass_stride, pixels += components) {
+		int pixel_sample = sample;
+		if(adaptive_offset != -1 && in[adaptive_offset] > 0.0f && in[adaptive_offset] < (float)sample)
+			pixel_sample = (int)in[adaptive_offset];
+
+		float4 f = pass_pixel_average(pass, offset, in, sample, pixel_sample);
+
+		if(components == 1) {
+			if(pass.type == PASS_DEPTH)
+				pixels[0] = (f.x == 0.0f)? 1e10f: f.x;
+			else if(pass.type == PASS_MIST)
+				pixels[0] = saturate(f.x*scale_exposure);
+			else
+				pixels[0] = f.x*scale_exposure;
+			continue;
+		}
+
+		if(pass.type == PASS_SHADOW) {
+			float invw = (f.w > 0.0f)? 1.0f/f.w: 1.0f;
+			f = make_float4(f.x*invw, f.y*invw, f.z*invw, 1.0f);
+		}
+		else if(divide_pass) {
+			/* RGB lighting passes that need to divide out color */
+			float4 f_divide = pass_pixel_average(*divide_pass, divide_offset, in, sample, pixel_sample);
+			float3 rgb = safe_divide_even_color(float4_to_float3(f)*exposure, float4_to_float3(f_divide));
+			f = make_float4(rgb.x, rgb.y, rgb.z, 1.0f);
+		}
+		else {
+			f = make_float4(f.x*scale_exposure, f.y*scale_exposure, f.z*scale_exposure, saturate(f.w));
+		}
+
+		pixels[0] = f.x;
+		pixels[1] = f.y;
+		pixels[2] = f.z;
+		if(components == 4)
+			pixels[3] = f.w;
+	}
+
+	return true;
+}
+
 bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels)
 {
+	/* Compressed passes and passes divided by one hold averages rather than
+	 * sums, these are read separately. */
+	int compressed_offset;
+	const Pass *compressed_pass = params.find_pass(type, compressed_offset);
+
+	if(compressed_pass) {
+		int divide_offset;
+		const Pass *divide_pass = (compressed_pass->divide_type != PASS_NONE)?
+		        params.find_pass(compressed_pass->divide_type, divide_offset): NULL;
+
+		if(compressed_pass->storage != PASS_STORAGE_FLOAT ||
+		   (divide_pass && divide_pass->storage != PASS_STORAGE_FLOAT))
+		{
+			return get_compressed_pass_rect(*compressed_pass, compressed_offset, exposure,
+			                                sample, components, pixels);
+		}
+	}
+
 	int pass_offset = 0;
 
 	for(size_t j = 0; j < params.passes.size(); j++) {
@@ -366,6 +536,293 @@ bool RenderBuffers::get_pass_rect(PassType type, float exposure, int sample, int
 	return false;
 }
 
+/* Render Checkpoint */
+
+#define RENDER_CHECKPOINT_VERSION 2
+
+RenderCheckpoint::RenderCheckpoint(const string& filepath_, const string& fingerprint_)
+: filepath(filepath_),
+  fingerprint(fingerprint_),
+  last_write_time(time_dt()),
+  writing(false)
+{
+}
+
+RenderCheckpoint::~RenderCheckpoint()
+{
+	clear();
+}
+
+void RenderCheckpoint::clear()
+{
+	for(TileMap::iterator it = tiles.begin(); it != tiles.end(); it++)
+		delete it->second;
+	tiles.clear();
+}
+
+template<typename T>
+static bool checkpoint_read_vector(FILE *f, vector<T>& data, size_t size)
+{
+	data.resize(size);
+	return (size == 0) || fread(&data[0], sizeof(T), size, f) == size;
+}
+
+template<typename T>
+static bool checkpoint_write_vector(FILE *f, const vector<T>& data)
+{
+	return data.empty() || fwrite(&data[0], sizeof(T), data.size(), f) == data.size();
+}
+
+bool RenderCheckpoint::read()
+{
+	thread_scoped_lock lock(mutex);
+	FILE *f = path_fopen(filepath, "rb");
+
+	if(!f)
+		return false;
+
+	int version = 0, num_tiles = 0;
+	char file_fingerprint[32];
+	bool ok = fread(&version, sizeof(version), 1, f) == 1 &&
+	          version == RENDER_CHECKPOINT_VERSION &&
+	          fread(file_fingerprint, sizeof(file_fingerprint), 1, f) == 1;
+
+	/* rendered with a different scene or settings, these tiles would
+	 * mix with the new render */
+	if(ok && fingerprint.compare(0, string::npos, file_fingerprint, sizeof(file_fingerprint)) != 0) {
+		VLOG(1) << "Render checkpoint " << filepath << " is for a different scene, starting over.";
+		fclose(f);
+		return false;
+	}
+
+	ok = ok && fread(&num_tiles, sizeof(num_tiles), 1, f) == 1;
+
+	for(int i = 0; ok && i < num_tiles; i++) {
+		int header[7];
+
+		if(fread(header, sizeof(int), 7, f) != 7) {
+			ok = false;
+			break;
+		}
+
+		Tile *tile = new Tile();
+		tile->x = header[0];
+		tile->y = header[1];
+		tile->w = header[2];
+		tile->h = header[3];
+		tile->start_sample = header[4];
+		tile->sample = header[5];
+		tile->pass_stride = header[6];
+
+		Tile *&entry = tiles[pair<int, int>(tile->x, tile->y)];
+		delete entry;
+		entry = tile;
+
+		size_t num_pixels = (size_t)tile->w*tile->h;
+
+		ok = tile->w > 0 && tile->h > 0 && tile->pass_stride > 0 &&
+		     checkpoint_read_vector(f, tile->buffer, num_pixels*tile->pass_stride) &&
+		     checkpoint_read_vector(f, tile->rng_state, num_pixels);
+	}
+
+	fclose(f);
+
+	if(!ok) {
+		VLOG(1) << "Invalid render checkpoint " << filepath << ", starting over.";
+		clear();
+		return false;
+	}
+
+	VLOG(1) << "Resuming " << tiles.size() << " tiles from render checkpoint " << filepath << ".";
+	return true;
+}
+
+bool RenderCheckpoint::write_due(double interval)
+{
+	thread_scoped_lock lock(mutex);
+	double current_time = time_dt();
+
+	if(current_time - last_write_time < interval)
+		return false;
+
+	last_write_time = current_time;
+	return true;
+}
+
+bool RenderCheckpoint::write()
+{
+	thread_scoped_lock write_lock(write_mutex);
+
+	/* Take a copy of the snapshot pointers, so render threads are only
+	 * blocked for that and not for the file writing. */
+	thread_scoped_lock lock(mutex);
+	TileMap write_tiles = tiles;
+	writing = true;
+	lock.unlock();
+
+	/* write to a temporary file first, so that a render interrupted while
+	 * writing still has the previous checkpoint */
+	string filepath_tmp = path_temp_filepath(filepath);
+
+	path_create_directories(filepath);
+	FILE *f = path_fopen(filepath_tmp, "wb");
+	bool ok = (f != NULL);
+
+	if(f) {
+		int version = RENDER_CHECKPOINT_VERSION;
+		int num_tiles = write_tiles.size();
+		char file_fingerprint[32] = {0};
+		memcpy(file_fingerprint, fingerprint.c_str(), min(fingerprint.size(), sizeof(file_fingerprint)));
+
+		ok = fwrite(&version, sizeof(version), 1, f) == 1 &&
+		     fwrite(file_fingerprint, sizeof(file_fingerprint), 1, f) == 1 &&
+		     fwrite(&num_tiles, sizeof(num_tiles), 1, f) == 1;
+
+		for(TileMap::iterator it = write_tiles.begin(); ok && it != write_tiles.end(); it++) {
+			const Tile *tile = it->second;
+			int header[7] = {tile->x, tile->y, tile->w, tile->h,
+			                 tile->start_sample, tile->sample, tile->pass_stride};
+
+			ok = fwrite(header, sizeof(int), 7, f) == 7 &&
+			     checkpoint_write_vector(f, tile->buffer) &&
+			     checkpoint_write_vector(f, tile->rng_state);
+		}
+
+		ok = (fclose(f) == 0) && ok;
+
+		if(ok) {
+			/* replace the previous checkpoint in one step, so there is always
+			 * one on disk */
+			ok = path_rename_replace(filepath_tmp, filepath);
+		}
+
+		if(!ok) {
+			path_remove(filepath_tmp);
+		}
+	}
+
+	lock.lock();
+	writing = false;
+	foreach(Tile *tile, replaced_tiles) {
+		delete tile;
+	}
+	replaced_tiles.clear();
+	lock.unlock();
+
+	if(!ok) {
+		VLOG(1) << "Failed to write render checkpoint " << filepath << ".";
+		return false;
+	}
+
+	return true;
+}
+
+void RenderCheckpoint::remove()
+{
+	thread_scoped_lock write_lock(write_mutex);
+	thread_scoped_lock lock(mutex);
+
+	clear();
+	path_remove(filepath);
+}
+
+void RenderCheckpoint::add_tile(RenderTile& rtile, int start_sample)
+{
+	RenderBuffers *buffers = rtile.buffers;
+
+	/* bring tile into host memory */
+	buffers->copy_from_device();
+	buffers->device->mem_copy_from(buffers->rng_state, 0,
+	                               buffers->params.width, buffers->params.height,
+	                               sizeof(uint));
+
+	/* fill a new snapshot without holding the lock */
+	Tile *tile = new Tile();
+	tile->x = rtile.x;
+	tile->y = rtile.y;
+	tile->w = rtile.w;
+	tile->h = rtile.h;
+	tile->start_sample = start_sample;
+	tile->sample = rtile.sample;
+	tile->pass_stride = buffers->params.get_passes_size();
+	tile->buffer.resize((size_t)rtile.w*rtile.h*tile->pass_stride);
+	tile->rng_state.resize((size_t)rtile.w*rtile.h);
+
+	float *buffer = (float*)buffers->buffer.data_pointer;
+	uint *rng_state = (uint*)buffers->rng_state.data_pointer;
+
+	for(int y = 0; y < rtile.h; y++) {
+		int index = rtile.offset + rtile.x + (rtile.y + y)*rtile.stride;
+		size_t tile_index = (size_t)y*rtile.w;
+
+		memcpy(&tile->buffer[tile_index*tile->pass_stride],
+		       buffer + (size_t)index*tile->pass_stride,
+		       sizeof(float)*rtile.w*tile->pass_stride);
+		memcpy(&tile->rng_state[tile_index],
+		       rng_state + index,
+		       sizeof(uint)*rtile.w);
+	}
+
+	thread_scoped_lock lock(mutex);
+
+	Tile *&entry = tiles[pair<int, int>(rtile.x, rtile.y)];
+
+	if(entry) {
+		/* a write in progress may still be reading the old snapshot */
+		if(writing)
+			replaced_tiles.push_back(entry);
+		else
+			delete entry;
+	}
+
+	entry = tile;
+}
+
+int RenderCheckpoint::restore_tile(RenderTile& rtile, int min_sample, int max_sample)
+{
+	thread_scoped_lock lock(mutex);
+	TileMap::iterator it = tiles.find(pair<int, int>(rtile.x, rtile.y));
+
+	if(it == tiles.end())
+		return 0;
+
+	RenderBuffers *buffers = rtile.buffers;
+	const Tile *tile = it->second;
+
+	if(tile->w != rtile.w ||
+	   tile->h != rtile.h ||
+	   tile->pass_stride != buffers->params.get_passes_size() ||
+	   tile->start_sample != rtile.start_sample ||
+	   tile->sample <= rtile.start_sample ||
+	   tile->sample < min_sample ||
+	   tile->sample > max_sample)
+	{
+		return 0;
+	}
+
+	float *buffer = (float*)buffers->buffer.data_pointer;
+	uint *rng_state = (uint*)buffers->rng_state.data_pointer;
+
+	for(int y = 0; y < rtile.h; y++) {
+		int index = rtile.offset + rtile.x + (rtile.y + y)*rtile.stride;
+		size_t tile_index = (size_t)y*rtile.w;
+
+		memcpy(buffer + (size_t)index*tile->pass_stride,
+		       &tile->buffer[tile_index*tile->pass_stride],
+		       sizeof(float)*rtile.w*tile->pass_stride);
+		memcpy(rng_state + index,
+		       &tile->rng_state[tile_index],
+		       sizeof(uint)*rtile.w);
+	}
+
+	int sample = tile->sample;
+	lock.unlock();
+
+	buffers->copy_to_device();
+
+	return sample;
+}
+
 /* Display Buffer */
 
 DisplayBuffer::DisplayBuffer(Device *device_, bool linear)
@@ -24,9 +24,11 @@
 #include "kernel/kernel_types.h"
 
 #include "util/util_half.h"
+#include "util/util_map.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
 #include "util/util_types.h"
+#include "util/util_vector.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -54,15 +56,20 @@ public:
 	bool denoising_data_pass;
 	/* If only some light path types should be denoised, an additional pass is needed. */
 	bool denoising_clean_pass;
+	/* Half buffer and convergence state used by adaptive sampling. */
+	bool adaptive_sampling_pass;
 
 	/* functions */
 	BufferParams();
 
 	void get_offset_stride(int& offset, int& stride);
 	bool modified(const BufferParams& params);
-	void add_pass(PassType type);
+	void add_pass(PassType type, PassStorage storage = PASS_STORAGE_FLOAT);
 	int get_passes_size();
 	int get_denoising_offset();
+	int get_compressed_offset();
+	/* Find pass and its offset, in floats or in bytes for compressed passes. */
+	const Pass *find_pass(PassType type, int& offset);
 };
 
 /* Render Buffers */
@@ -85,11 +92,13 @@ public:
 	void reset(Device *device, BufferParams& params);
 
 	bool copy_from_device(Device *from_device = NULL);
+	bool copy_to_device();
 	bool get_pass_rect(PassType type, float exposure, int sample, int components, float *pixels);
 	bool get_denoising_pass_rect(int offset, float exposure, int sample, int components, float *pixels);
 
 protected:
 	void device_free();
+	bool get_compressed_pass_rect(const Pass& pass, int offset, float exposure, int sample, int components, float *pixels);
 };
 
 /* Display Buffer
@@ -147,6 +156,7 @@ public:
 	int offset;
 	int stride;
 	int tile_index;
+	double acquire_time;
 
 	device_ptr buffer;
 	device_ptr rng_state;
@@ -156,6 +166,68 @@ public:
 	RenderTile();
 };
 
+/* Render Checkpoint
+ *
+ * Copies of the render buffers and random number state of tiles, along with
+ * the samples they received, written to a file while rendering. A render
+ * that was interrupted continues each tile from its last snapshot instead of
+ * starting over. The file stores a fingerprint of the scene and render
+ * settings, checkpoints of a different fingerprint are ignored. */
+
+class RenderCheckpoint {
+public:
+	RenderCheckpoint(const string& filepath, const string& fingerprint);
+	~RenderCheckpoint();
+
+	/* Load tiles from an existing checkpoint file. */
+	bool read();
+	/* Write all tiles to the checkpoint file. Tiles can be added and restored
+	 * while writing, the file contains the snapshots from the start. */
+	bool write();
+	/* Remove the checkpoint file, once the render is done. */
+	void remove();
+
+	/* Returns true for one caller once interval seconds passed since the
+	 * last write, which should then write the checkpoint. */
+	bool write_due(double interval);
+
+	/* Store the current state of the tile, replacing an older snapshot.
+	 * start_sample is the first sample of the range rendered by the tile,
+	 * which differs from the tile start sample once it was restored. */
+	void add_tile(RenderTile& rtile, int start_sample);
+	/* Restore the tile from its snapshot, if one exists which continues the
+	 * same sample range and reached a sample between min_sample and
+	 * max_sample. Returns the sample the tile continues from, or 0 when
+	 * nothing was restored. */
+	int restore_tile(RenderTile& rtile, int min_sample, int max_sample);
+
+protected:
+	struct Tile {
+		int x, y, w, h;
+		int start_sample;
+		int sample;
+		int pass_stride;
+		vector<float> buffer;
+		vector<uint> rng_state;
+	};
+	typedef map<pair<int, int>, Tile*> TileMap;
+
+	void clear();
+
+	string filepath;
+	string fingerprint;
+	double last_write_time;
+
+	/* Snapshots are never modified once added, so a write only holds the
+	 * mutex to copy the map. Snapshots replaced while writing are freed
+	 * when the write is done. */
+	TileMap tiles;
+	bool writing;
+	vector<Tile*> replaced_tiles;
+	thread_mutex mutex;
+	thread_mutex write_mutex;
+};
+
 CCL_NAMESPACE_END
 
 #endif /* __BUFFERS_H__ */
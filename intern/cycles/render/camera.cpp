@@ -128,6 +128,8 @@ NODE_DEFINE(Camera)
 	SOCKET_FLOAT(border.bottom, "Border Bottom", 0);
 	SOCKET_FLOAT(border.top, "Border Top", 0);
 
+	SOCKET_FLOAT(offscreen_dicing_scale, "Offscreen Dicing Scale", 1.0f);
+
 	return type;
 }
 
@@ -273,6 +275,18 @@ void Camera::update()
 	full_dx = transform_direction(&cameratoworld, full_dx);
 	full_dy = transform_direction(&cameratoworld, full_dy);
 
+	/* view bounds, for dicing of geometry outside of the view */
+	float3 Pmin = transform_perspective(&full_rastertocamera, make_float3(0.0f, 0.0f, 0.0f));
+	float3 Pmax = transform_perspective(&full_rastertocamera, make_float3(full_width, full_height, 0.0f));
+	if(type == CAMERA_PERSPECTIVE) {
+		Pmin /= Pmin.z;
+		Pmax /= Pmax.z;
+	}
+	full_view_bounds.left = min(Pmin.x, Pmax.x);
+	full_view_bounds.right = max(Pmin.x, Pmax.x);
+	full_view_bounds.bottom = min(Pmin.y, Pmax.y);
+	full_view_bounds.top = max(Pmin.y, Pmax.y);
+
 	/* TODO(sergey): Support other types of camera. */
 	if(type == CAMERA_PERSPECTIVE) {
 		/* TODO(sergey): Move to an utility function and de-duplicate with
@@ -464,9 +478,14 @@ void Camera::device_update_volume(Device * /*device*/,
 	BoundBox viewplane_boundbox = viewplane_bounds_get();
 	for(size_t i = 0; i < scene->objects.size(); ++i) {
 		Object *object = scene->objects[i];
-		if(object->mesh->has_volume &&
-		   viewplane_boundbox.intersects(object->bounds))
-		{
+		if(!object->mesh->has_volume) {
+			continue;
+		}
+		bool intersects = viewplane_boundbox.intersects(object->bounds);
+		for(size_t j = 0; j < object->instances.size() && !intersects; ++j) {
+			intersects = viewplane_boundbox.intersects(object->instance_bounds(object->instances[j]));
+		}
+		if(intersects) {
 			/* TODO(sergey): Consider adding more grained check. */
 			kcam->is_inside_volume = 1;
 			break;
@@ -579,10 +598,48 @@ BoundBox Camera::viewplane_bounds_get()
 	return bounds;
 }
 
+float Camera::offscreen_distance(float3 P)
+{
+	/* Approximate distance from the view frustum, exact when the point is
+	 * outside of only one side. */
+	float3 p = transform_point(&worldtocamera, P);
+	const BoundBox2D& b = full_view_bounds;
+
+	if(type == CAMERA_ORTHOGRAPHIC) {
+		float3 d = make_float3(max(max(p.x - b.right, b.left - p.x), 0.0f),
+		                       max(max(p.y - b.top, b.bottom - p.y), 0.0f),
+		                       max(-p.z, 0.0f));
+		return len(d);
+	}
+
+	if(p.z <= 0.0f) {
+		/* Behind the camera. */
+		return len(p);
+	}
+
+	float right = (p.x - b.right*p.z) / sqrtf(1.0f + b.right*b.right);
+	float left = (b.left*p.z - p.x) / sqrtf(1.0f + b.left*b.left);
+	float top = (p.y - b.top*p.z) / sqrtf(1.0f + b.top*b.top);
+	float bottom = (b.bottom*p.z - p.y) / sqrtf(1.0f + b.bottom*b.bottom);
+
+	return max(max(max(right, left), max(top, bottom)), 0.0f);
+}
+
 float Camera::world_to_raster_size(float3 P)
 {
 	if(type == CAMERA_ORTHOGRAPHIC) {
-		return min(len(full_dx), len(full_dy));
+		float res = min(len(full_dx), len(full_dy));
+
+		if(offscreen_dicing_scale > 1.0f) {
+			/* Grow pixels with the distance from the view, relative to its size. */
+			float size = 0.5f*len(make_float2(full_view_bounds.right - full_view_bounds.left,
+			                                  full_view_bounds.top - full_view_bounds.bottom));
+			if(size > 0.0f) {
+				res += res * offscreen_distance(P) / size * (offscreen_dicing_scale - 1.0f);
+			}
+		}
+
+		return res;
 	}
 	else if(type == CAMERA_PERSPECTIVE) {
 		/* Calculate as if point is directly ahead of the camera. */
@@ -597,7 +654,15 @@ float Camera::world_to_raster_size(float3 P)
 		/* dPdx */
 		float dist = len(transform_point(&worldtocamera, P));
 		float3 D = normalize(Ddiff);
-		return len(dist*dDdx - dot(dist*dDdx, D)*D);
+		float res = len(dist*dDdx - dot(dist*dDdx, D)*D);
+
+		if(offscreen_dicing_scale > 1.0f) {
+			/* Grow pixels as if the point was further away by its distance
+			 * from the view, up to the scale factor. */
+			res += len(dDdx - dot(dDdx, D)*D) * offscreen_distance(P) * (offscreen_dicing_scale - 1.0f);
+		}
+
+		return res;
 	}
 	else {
 		// TODO(mai): implement for CAMERA_PANORAMA
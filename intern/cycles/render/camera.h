@@ -134,6 +134,9 @@ public:
 	BoundBox2D border;
 	BoundBox2D viewport_camera_border;
 
+	/* dicing rate is multiplied up to this factor for geometry outside of the view */
+	float offscreen_dicing_scale;
+
 	/* transformation */
 	Transform matrix;
 
@@ -163,6 +166,10 @@ public:
 	float3 full_dx;
 	float3 full_dy;
 
+	/* Extent of the full view in camera space, at unit distance for
+	 * perspective cameras. */
+	BoundBox2D full_view_bounds;
+
 	/* update */
 	bool need_update;
 	bool need_device_update;
@@ -194,6 +201,7 @@ public:
 private:
 	/* Private utility functions. */
 	float3 transform_raster_to_world(float raster_x, float raster_y);
+	float offscreen_distance(float3 P);
 };
 
 CCL_NAMESPACE_END
@@ -94,6 +94,7 @@ CurveSystemManager::CurveSystemManager()
 	use_encasing = true;
 	use_backfacing = false;
 	use_tangent_normal_geometry = false;
+	use_compact_keys = true;
 
 	need_update = true;
 	need_mesh_update = false;
@@ -142,6 +143,10 @@ void CurveSystemManager::device_update(Device *device,
 		kcurve->subdivisions = subdivisions;
 	}
 
+	/* keys are packed for the device by the mesh manager, for all primitives */
+	if(use_compact_keys)
+		kcurve->curveflags |= CURVE_KN_COMPACT_KEYS;
+
 	if(progress.get_cancel()) return;
 
 	need_update = false;
@@ -166,7 +171,8 @@ bool CurveSystemManager::modified(const CurveSystemManager& CurveSystemManager)
 		triangle_method == CurveSystemManager.triangle_method &&
 		resolution == CurveSystemManager.resolution &&
 		use_curves == CurveSystemManager.use_curves &&
-		subdivisions == CurveSystemManager.subdivisions);
+		subdivisions == CurveSystemManager.subdivisions &&
+		use_compact_keys == CurveSystemManager.use_compact_keys);
 }
 
 bool CurveSystemManager::modified_mesh(const CurveSystemManager& CurveSystemManager)
@@ -175,7 +181,8 @@ bool CurveSystemManager::modified_mesh(const CurveSystemManager& CurveSystemMana
 		curve_shape == CurveSystemManager.curve_shape &&
 		triangle_method == CurveSystemManager.triangle_method &&
 		resolution == CurveSystemManager.resolution &&
-		use_curves == CurveSystemManager.use_curves);
+		use_curves == CurveSystemManager.use_curves &&
+		use_compact_keys == CurveSystemManager.use_compact_keys);
 }
 
 void CurveSystemManager::tag_update(Scene * /*scene*/)
@@ -101,6 +101,7 @@ public:
 	bool use_encasing;
 	bool use_backfacing;
 	bool use_tangent_normal_geometry;
+	bool use_compact_keys;
 
 	bool need_update;
 	bool need_mesh_update;
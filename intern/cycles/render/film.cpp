@@ -34,12 +34,52 @@ CCL_NAMESPACE_BEGIN
 
 static bool compare_pass_order(const Pass& a, const Pass& b)
 {
+	if(a.storage != b.storage)
+		return (a.storage < b.storage);
 	if(a.components == b.components)
 		return (a.type < b.type);
 	return (a.components > b.components);
 }
 
-void Pass::add(PassType type, array<Pass>& passes)
+int Pass::compressed_size() const
+{
+	if(storage == PASS_STORAGE_BYTE)
+		return components;
+
+	/* Half float average of the components which are written, followed by
+	 * the number of samples. Only the shadow pass uses all four components
+	 * of a float4 pass. */
+	int num_written = (components == 4 && type != PASS_SHADOW)? 3: components;
+	return (num_written + 1)*sizeof(ushort);
+}
+
+bool Pass::supports_storage(PassType type, PassStorage storage)
+{
+	switch(storage) {
+		case PASS_STORAGE_FLOAT:
+			return true;
+		case PASS_STORAGE_HALF:
+			/* Combined is read by adaptive sampling and denoising and motion is
+			 * normalized by its weight, so these stay float. Debug passes are
+			 * counts that need more precision. */
+			return (type & (PASS_DEPTH|PASS_MIST|PASS_NORMAL|PASS_UV|
+			                PASS_OBJECT_ID|PASS_MATERIAL_ID|
+			                PASS_DIFFUSE_COLOR|PASS_GLOSSY_COLOR|
+			                PASS_TRANSMISSION_COLOR|PASS_SUBSURFACE_COLOR|
+			                PASS_DIFFUSE_INDIRECT|PASS_GLOSSY_INDIRECT|
+			                PASS_TRANSMISSION_INDIRECT|PASS_SUBSURFACE_INDIRECT|
+			                PASS_DIFFUSE_DIRECT|PASS_GLOSSY_DIRECT|
+			                PASS_TRANSMISSION_DIRECT|PASS_SUBSURFACE_DIRECT|
+			                PASS_EMISSION|PASS_BACKGROUND|PASS_AO|PASS_SHADOW)) != 0;
+		case PASS_STORAGE_BYTE:
+			/* IDs up to 255 are stored exactly. */
+			return (type == PASS_OBJECT_ID || type == PASS_MATERIAL_ID);
+	}
+
+	return false;
+}
+
+void Pass::add(PassType type, array<Pass>& passes, PassStorage storage)
 {
 	for(size_t i = 0; i < passes.size(); i++)
 		if(passes[i].type == type)
@@ -51,6 +91,7 @@ void Pass::add(PassType type, array<Pass>& passes)
 	pass.filter = true;
 	pass.exposure = false;
 	pass.divide_type = PASS_NONE;
+	pass.storage = (supports_storage(type, storage))? storage: PASS_STORAGE_FLOAT;
 
 	switch(type) {
 		case PASS_NONE:
@@ -167,11 +208,11 @@ void Pass::add(PassType type, array<Pass>& passes)
 	passes.push_back_slow(pass);
 
 	/* order from by components, to ensure alignment so passes with size 4
-	 * come first and then passes with size 1 */
+	 * come first and then passes with size 1, compressed passes go last */
 	sort(&passes[0], &passes[0] + passes.size(), compare_pass_order);
 
 	if(pass.divide_type != PASS_NONE)
-		Pass::add(pass.divide_type, passes);
+		Pass::add(pass.divide_type, passes, storage);
 }
 
 bool Pass::equals(const array<Pass>& A, const array<Pass>& B)
@@ -180,7 +221,7 @@ bool Pass::equals(const array<Pass>& A, const array<Pass>& B)
 		return false;
 	
 	for(int i = 0; i < A.size(); i++)
-		if(A[i].type != B[i].type)
+		if(A[i].type != B[i].type || A[i].storage != B[i].storage)
 			return false;
 	
 	return true;
@@ -282,6 +323,7 @@ NODE_DEFINE(Film)
 	SOCKET_BOOLEAN(denoising_data_pass,  "Generate Denoising Data Pass",  false);
 	SOCKET_BOOLEAN(denoising_clean_pass, "Generate Denoising Clean Pass", false);
 	SOCKET_INT(denoising_flags, "Denoising Flags", 0);
+	SOCKET_BOOLEAN(adaptive_sampling_pass, "Generate Adaptive Sampling Pass", false);
 
 	return type;
 }
@@ -315,103 +357,128 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 	kfilm->pass_flag = 0;
 	kfilm->pass_stride = 0;
 	kfilm->use_light_pass = use_light_visibility || use_sample_clamp;
+	kfilm->pass_half_flag = 0;
+	kfilm->pass_byte_flag = 0;
+
+	/* Compressed passes follow the float passes and denoising data, with
+	 * their offsets in bytes. */
+	int compressed_begin = 0;
+
+	for(size_t i = 0; i < passes.size(); i++)
+		if(passes[i].storage == PASS_STORAGE_FLOAT)
+			compressed_begin += passes[i].components;
+
+	if(denoising_data_pass) {
+		compressed_begin += DENOISING_PASS_SIZE_BASE;
+		if(denoising_clean_pass)
+			compressed_begin += DENOISING_PASS_SIZE_CLEAN;
+	}
+
+	int compressed_offset = compressed_begin*sizeof(float);
 
 	for(size_t i = 0; i < passes.size(); i++) {
 		Pass& pass = passes[i];
 		kfilm->pass_flag |= pass.type;
 
+		int offset = (pass.storage == PASS_STORAGE_FLOAT)? kfilm->pass_stride: compressed_offset;
+
+		if(pass.storage == PASS_STORAGE_HALF)
+			kfilm->pass_half_flag |= pass.type;
+		else if(pass.storage == PASS_STORAGE_BYTE)
+			kfilm->pass_byte_flag |= pass.type;
+
 		switch(pass.type) {
 			case PASS_COMBINED:
-				kfilm->pass_combined = kfilm->pass_stride;
+				kfilm->pass_combined = offset;
 				break;
 			case PASS_DEPTH:
-				kfilm->pass_depth = kfilm->pass_stride;
+				kfilm->pass_depth = offset;
 				break;
 			case PASS_MIST:
-				kfilm->pass_mist = kfilm->pass_stride;
+				kfilm->pass_mist = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_NORMAL:
-				kfilm->pass_normal = kfilm->pass_stride;
+				kfilm->pass_normal = offset;
 				break;
 			case PASS_UV:
-				kfilm->pass_uv = kfilm->pass_stride;
+				kfilm->pass_uv = offset;
 				break;
 			case PASS_MOTION:
-				kfilm->pass_motion = kfilm->pass_stride;
+				kfilm->pass_motion = offset;
 				break;
 			case PASS_MOTION_WEIGHT:
-				kfilm->pass_motion_weight = kfilm->pass_stride;
+				kfilm->pass_motion_weight = offset;
 				break;
 			case PASS_OBJECT_ID:
-				kfilm->pass_object_id = kfilm->pass_stride;
+				kfilm->pass_object_id = offset;
 				break;
 			case PASS_MATERIAL_ID:
-				kfilm->pass_material_id = kfilm->pass_stride;
+				kfilm->pass_material_id = offset;
 				break;
 			case PASS_DIFFUSE_COLOR:
-				kfilm->pass_diffuse_color = kfilm->pass_stride;
+				kfilm->pass_diffuse_color = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_GLOSSY_COLOR:
-				kfilm->pass_glossy_color = kfilm->pass_stride;
+				kfilm->pass_glossy_color = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_TRANSMISSION_COLOR:
-				kfilm->pass_transmission_color = kfilm->pass_stride;
+				kfilm->pass_transmission_color = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_SUBSURFACE_COLOR:
-				kfilm->pass_subsurface_color = kfilm->pass_stride;
+				kfilm->pass_subsurface_color = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_DIFFUSE_INDIRECT:
-				kfilm->pass_diffuse_indirect = kfilm->pass_stride;
+				kfilm->pass_diffuse_indirect = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_GLOSSY_INDIRECT:
-				kfilm->pass_glossy_indirect = kfilm->pass_stride;
+				kfilm->pass_glossy_indirect = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_TRANSMISSION_INDIRECT:
-				kfilm->pass_transmission_indirect = kfilm->pass_stride;
+				kfilm->pass_transmission_indirect = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_SUBSURFACE_INDIRECT:
-				kfilm->pass_subsurface_indirect = kfilm->pass_stride;
+				kfilm->pass_subsurface_indirect = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_DIFFUSE_DIRECT:
-				kfilm->pass_diffuse_direct = kfilm->pass_stride;
+				kfilm->pass_diffuse_direct = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_GLOSSY_DIRECT:
-				kfilm->pass_glossy_direct = kfilm->pass_stride;
+				kfilm->pass_glossy_direct = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_TRANSMISSION_DIRECT:
-				kfilm->pass_transmission_direct = kfilm->pass_stride;
+				kfilm->pass_transmission_direct = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_SUBSURFACE_DIRECT:
-				kfilm->pass_subsurface_direct = kfilm->pass_stride;
+				kfilm->pass_subsurface_direct = offset;
 				kfilm->use_light_pass = 1;
 				break;
 
 			case PASS_EMISSION:
-				kfilm->pass_emission = kfilm->pass_stride;
+				kfilm->pass_emission = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_BACKGROUND:
-				kfilm->pass_background = kfilm->pass_stride;
+				kfilm->pass_background = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_AO:
-				kfilm->pass_ao = kfilm->pass_stride;
+				kfilm->pass_ao = offset;
 				kfilm->use_light_pass = 1;
 				break;
 			case PASS_SHADOW:
-				kfilm->pass_shadow = kfilm->pass_stride;
+				kfilm->pass_shadow = offset;
 				kfilm->use_light_pass = 1;
 				break;
 
@@ -421,16 +488,16 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 
 #ifdef WITH_CYCLES_DEBUG
 			case PASS_BVH_TRAVERSED_NODES:
-				kfilm->pass_bvh_traversed_nodes = kfilm->pass_stride;
+				kfilm->pass_bvh_traversed_nodes = offset;
 				break;
 			case PASS_BVH_TRAVERSED_INSTANCES:
-				kfilm->pass_bvh_traversed_instances = kfilm->pass_stride;
+				kfilm->pass_bvh_traversed_instances = offset;
 				break;
 			case PASS_BVH_INTERSECTIONS:
-				kfilm->pass_bvh_intersections = kfilm->pass_stride;
+				kfilm->pass_bvh_intersections = offset;
 				break;
 			case PASS_RAY_BOUNCES:
-				kfilm->pass_ray_bounces = kfilm->pass_stride;
+				kfilm->pass_ray_bounces = offset;
 				break;
 #endif
 
@@ -438,7 +505,10 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 				break;
 		}
 
-		kfilm->pass_stride += pass.components;
+		if(pass.storage == PASS_STORAGE_FLOAT)
+			kfilm->pass_stride += pass.components;
+		else
+			compressed_offset += pass.compressed_size();
 	}
 
 	kfilm->pass_denoising_data = 0;
@@ -455,7 +525,19 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 		}
 	}
 
+	kfilm->pass_compressed = kfilm->pass_stride;
+	kfilm->pass_compressed_size = divide_up(compressed_offset - compressed_begin*sizeof(float), sizeof(float));
+	kfilm->pass_stride += kfilm->pass_compressed_size;
+
 	kfilm->pass_stride = align_up(kfilm->pass_stride, 4);
+
+	/* float4 aligned, as it is accessed together with the combined pass */
+	kfilm->pass_adaptive_aux_buffer = 0;
+	if(adaptive_sampling_pass) {
+		kfilm->pass_adaptive_aux_buffer = kfilm->pass_stride;
+		kfilm->pass_stride += 4;
+	}
+
 	kfilm->pass_alpha_threshold = pass_alpha_threshold;
 
 	/* update filter table */
@@ -472,6 +554,7 @@ void Film::device_update(Device *device, DeviceScene *dscene, Scene *scene)
 	pass_stride = kfilm->pass_stride;
 	denoising_data_offset = kfilm->pass_denoising_data;
 	denoising_clean_offset = kfilm->pass_denoising_clean;
+	adaptive_sampling_offset = kfilm->pass_adaptive_aux_buffer;
 
 	need_update = false;
 }
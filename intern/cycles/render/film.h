@@ -45,10 +45,18 @@ public:
 	bool filter;
 	bool exposure;
 	PassType divide_type;
+	/* Half float and byte passes are packed after the float passes and the
+	 * denoising data, see kernel_passes.h for how they accumulate samples. */
+	PassStorage storage;
 
-	static void add(PassType type, array<Pass>& passes);
+	/* Size in bytes of a pass with half float or byte storage. */
+	int compressed_size() const;
+
+	/* Storage falls back to float if the pass type does not support it. */
+	static void add(PassType type, array<Pass>& passes, PassStorage storage = PASS_STORAGE_FLOAT);
 	static bool equals(const array<Pass>& A, const array<Pass>& B);
 	static bool contains(const array<Pass>& passes, PassType);
+	static bool supports_storage(PassType type, PassStorage storage);
 };
 
 class Film : public Node {
@@ -60,11 +68,13 @@ public:
 	bool denoising_data_pass;
 	bool denoising_clean_pass;
 	int denoising_flags;
+	bool adaptive_sampling_pass;
 	float pass_alpha_threshold;
 
 	int pass_stride;
 	int denoising_data_offset;
 	int denoising_clean_offset;
+	int adaptive_sampling_offset;
 
 	FilterType filter_type;
 	float filter_width;
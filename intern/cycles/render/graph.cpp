@@ -26,6 +26,7 @@
 #include "util/util_foreach.h"
 #include "util/util_queue.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -191,6 +192,14 @@ bool ShaderNode::equals(const ShaderNode& other)
 	return true;
 }
 
+void ShaderNode::hash(MD5Hash& md5)
+{
+	Node::hash(md5);
+
+	int values[2] = {bump, get_closure_type()};
+	md5.append((const uint8_t*)values, sizeof(values));
+}
+
 /* Graph */
 
 ShaderGraph::ShaderGraph()
@@ -1047,6 +1056,51 @@ int ShaderGraph::get_num_closures()
 	return num_closures;
 }
 
+void ShaderGraph::hash(MD5Hash& md5, bool only_values)
+{
+	/* Nodes are identified by their position in id order, which is the order
+	 * the compiler visits them in, links by the position of their node and
+	 * the index of the output. */
+	vector<ShaderNode*> sorted_nodes(nodes.begin(), nodes.end());
+	sort(sorted_nodes.begin(), sorted_nodes.end(), ShaderNodeIDComparator());
+
+	map<ShaderNode*, int> node_index;
+	for(size_t i = 0; i < sorted_nodes.size(); i++) {
+		node_index[sorted_nodes[i]] = i;
+	}
+
+	foreach(ShaderNode *node, sorted_nodes) {
+		if(only_values)
+			node->hash_values(md5);
+		else
+			node->hash(md5);
+
+		foreach(ShaderInput *input, node->inputs) {
+			int link[2] = {-1, -1};
+
+			if(input->link) {
+				ShaderNode *parent = input->link->parent;
+				link[0] = node_index[parent];
+				for(size_t i = 0; i < parent->outputs.size(); i++) {
+					if(parent->outputs[i] == input->link) {
+						link[1] = i;
+						break;
+					}
+				}
+			}
+
+			md5.append((const uint8_t*)link, sizeof(link));
+		}
+	}
+}
+
+void ShaderGraph::add_images(ImageManager *image_manager)
+{
+	foreach(ShaderNode *node, nodes) {
+		node->add_images(image_manager);
+	}
+}
+
 void ShaderGraph::dump_graph(const char *filename)
 {
 	FILE *fd = fopen(filename, "w");
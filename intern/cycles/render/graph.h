@@ -32,6 +32,8 @@
 CCL_NAMESPACE_BEGIN
 
 class AttributeRequestSet;
+class ImageManager;
+class MD5Hash;
 class Scene;
 class Shader;
 class ShaderInput;
@@ -195,6 +197,19 @@ public:
 	 * is to be handled in the subclass.
 	 */
 	virtual bool equals(const ShaderNode& other);
+
+	/* Hash of the node settings which affect the compiled shader.
+	 *
+	 * Like equals(), subclasses with state that is not stored in sockets
+	 * need to add it.
+	 */
+	virtual void hash(MD5Hash& md5);
+
+	/* Acquire slots for the images used by the node from the image manager,
+	 * so they are known before compilation. Normally this happens when the
+	 * node is compiled.
+	 */
+	virtual void add_images(ImageManager * /*image_manager*/) {}
 };
 
 
@@ -264,6 +279,12 @@ public:
 
 	int get_num_closures();
 
+	/* Structural hash of the graph, graphs with equal nodes connected in the
+	 * same way compile to the same program. With only_values, image slots and
+	 * pointers are left out, so the hash is the same between runs. */
+	void hash(MD5Hash& md5, bool only_values = false);
+	void add_images(ImageManager *image_manager);
+
 	void dump_graph(const char *filename);
 
 protected:
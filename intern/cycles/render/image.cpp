@@ -17,9 +17,15 @@
 #include "device/device.h"
 #include "render/image.h"
 #include "render/scene.h"
+#include "render/sparse_grid.h"
 
+#include "kernel/kernel_texture_cache.h"
+
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_map.h"
+#include "util/util_md5.h"
 #include "util/util_path.h"
 #include "util/util_progress.h"
 #include "util/util_texture.h"
@@ -45,6 +51,10 @@ ImageManager::ImageManager(const DeviceInfo& info)
 	need_update = true;
 	pack_images = false;
 	osl_texture_system = NULL;
+	texture_cache = NULL;
+	use_sparse_volumes = false;
+	use_image_cache = false;
+	image_cache_size = 0;
 	animation_frame = 0;
 
 	/* In case of multiple devices used we need to know type of an actual
@@ -85,6 +95,10 @@ ImageManager::~ImageManager()
 		for(size_t slot = 0; slot < images[type].size(); slot++)
 			assert(!images[type][slot]);
 	}
+
+	if(texture_cache) {
+		TextureSystem::destroy(texture_cache);
+	}
 }
 
 void ImageManager::set_pack_images(bool pack_images_)
@@ -389,6 +403,8 @@ int ImageManager::add_image(const string& filename,
 	img->extension = extension;
 	img->users = 1;
 	img->use_alpha = use_alpha;
+	img->cache_data = NULL;
+	img->cache_size = 0;
 
 	images[type][slot] = img;
 
@@ -533,6 +549,16 @@ bool ImageManager::file_load_image(Image *img,
                                    device_vector<DeviceType>& tex_img)
 {
 	const StorageType alpha_one = (FileFormat == TypeDesc::UINT8)? 255 : 1;
+
+	/* Image files are mapped from the decoded image cache when possible. */
+	string cache_key;
+	if(use_image_cache && !img->builtin_data) {
+		cache_key = image_cache_key(img, type, FileFormat, texture_limit);
+		if(!cache_key.empty() && image_cache_read(img, cache_key, tex_img)) {
+			return true;
+		}
+	}
+
 	ImageInput *in = NULL;
 	int width, height, depth, components;
 	if(!file_load_image_generic(img, &in, width, height, depth, components)) {
@@ -702,9 +728,160 @@ bool ImageManager::file_load_image(Image *img,
 		       &scaled_pixels[0],
 		       scaled_pixels.size() * sizeof(StorageType));
 	}
+	if(!cache_key.empty()) {
+		image_cache_write(cache_key, tex_img);
+	}
 	return true;
 }
 
+/* Decoded Image Cache
+ *
+ * Image files are stored after decoding, conversion to the storage type of
+ * their slot and scaling to the texture limit, in a file named after an MD5
+ * hash of the file path, modification time and size, and the load options.
+ * Later renders map the cached pixels into memory and reference them from
+ * the device vector, without decoding or copying them. Mapped files are
+ * touched, and the least recently used are removed once the cache grows
+ * beyond its size limit. */
+
+#define IMAGE_CACHE_VERSION 1
+/* Keeps the pixels aligned for SIMD loads. */
+#define IMAGE_CACHE_HEADER_SIZE 64
+
+struct ImageCacheHeader {
+	int version;
+	int element_size;
+	uint64_t width;
+	uint64_t height;
+	uint64_t depth;
+};
+
+template<typename T>
+static void image_cache_hash_value(MD5Hash& md5, const T& value)
+{
+	md5.append((const uint8_t*)&value, sizeof(T));
+}
+
+static string image_cache_filepath(const string& key)
+{
+	return path_cache_get(path_join("images", key + ".img"));
+}
+
+string ImageManager::image_cache_key(Image *img,
+                                     ImageDataType type,
+                                     TypeDesc::BASETYPE format,
+                                     int texture_limit)
+{
+	uint64_t modified_time = path_modified_time(img->filename);
+
+	if(modified_time == 0) {
+		return "";
+	}
+
+	MD5Hash md5;
+	image_cache_hash_value(md5, (int)IMAGE_CACHE_VERSION);
+	md5.append((const uint8_t*)img->filename.c_str(), img->filename.size());
+	image_cache_hash_value(md5, modified_time);
+	image_cache_hash_value(md5, (uint64_t)path_file_size(img->filename));
+	image_cache_hash_value(md5, img->use_alpha);
+	image_cache_hash_value(md5, (int)format);
+	image_cache_hash_value(md5, (int)type);
+	image_cache_hash_value(md5, texture_limit);
+
+	return md5.get_hex();
+}
+
+template<typename T>
+bool ImageManager::image_cache_read(Image *img,
+                                    const string& key,
+                                    device_vector<T>& tex_img)
+{
+	string filepath = image_cache_filepath(key);
+	size_t size;
+	void *data = path_map_file(filepath, &size);
+
+	if(!data) {
+		return false;
+	}
+
+	const ImageCacheHeader *header = (const ImageCacheHeader*)data;
+	bool ok = size >= IMAGE_CACHE_HEADER_SIZE &&
+	          header->version == IMAGE_CACHE_VERSION &&
+	          header->element_size == sizeof(T);
+
+	if(ok) {
+		size_t num_elements = header->width *
+		                      max(header->height, (uint64_t)1) *
+		                      max(header->depth, (uint64_t)1);
+		ok = size == IMAGE_CACHE_HEADER_SIZE + num_elements*sizeof(T);
+	}
+
+	if(!ok) {
+		VLOG(1) << "Invalid image cache file " << filepath << ", decoding image.";
+		path_unmap_file(data, size);
+		return false;
+	}
+
+	img->cache_data = data;
+	img->cache_size = size;
+	tex_img.reference((T*)((uchar*)data + IMAGE_CACHE_HEADER_SIZE),
+	                  header->width,
+	                  header->height,
+	                  header->depth);
+
+	/* keep recently used files from being evicted */
+	path_touch(filepath);
+
+	VLOG(2) << "Mapped image " << img->filename << " from cache " << filepath << ".";
+	return true;
+}
+
+template<typename T>
+void ImageManager::image_cache_write(const string& key,
+                                     device_vector<T>& tex_img)
+{
+	string filepath = image_cache_filepath(key);
+	/* write to a temporary file first, so other processes sharing the cache
+	 * never map a partially written file */
+	string filepath_tmp = path_temp_filepath(filepath);
+
+	path_create_directories(filepath);
+	FILE *f = path_fopen(filepath_tmp, "wb");
+
+	if(!f) {
+		VLOG(1) << "Failed to open image cache file " << filepath_tmp << " for writing.";
+		return;
+	}
+
+	uchar header_data[IMAGE_CACHE_HEADER_SIZE] = {0};
+	ImageCacheHeader *header = (ImageCacheHeader*)header_data;
+	header->version = IMAGE_CACHE_VERSION;
+	header->element_size = sizeof(T);
+	header->width = tex_img.data_width;
+	header->height = tex_img.data_height;
+	header->depth = tex_img.data_depth;
+
+	bool ok = fwrite(header_data, IMAGE_CACHE_HEADER_SIZE, 1, f) == 1 &&
+	          (tex_img.data_size == 0 ||
+	           fwrite((void*)tex_img.data_pointer, sizeof(T), tex_img.data_size, f) == tex_img.data_size);
+
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || rename(filepath_tmp.c_str(), filepath.c_str()) != 0) {
+		VLOG(1) << "Failed to write image cache file " << filepath << ".";
+		path_remove(filepath_tmp);
+	}
+}
+
+void ImageManager::image_cache_unmap(Image *img)
+{
+	if(img->cache_data) {
+		path_unmap_file(img->cache_data, img->cache_size);
+		img->cache_data = NULL;
+		img->cache_size = 0;
+	}
+}
+
 void ImageManager::device_load_image(Device *device,
                                      DeviceScene *dscene,
                                      Scene *scene,
@@ -720,9 +897,18 @@ void ImageManager::device_load_image(Device *device,
 	if(osl_texture_system && !img->builtin_data)
 		return;
 
+	if(use_texture_cache(img)) {
+		device_load_texture_cache_image(device, type, slot);
+		return;
+	}
+
 	string filename = path_filename(images[type][slot]->filename);
 	progress->set_status("Updating Images", "Loading " + filename);
 
+	/* Release the cache file mapping of a previous load, the device texture
+	 * referencing it is freed below before anything is read again. */
+	image_cache_unmap(img);
+
 	const int texture_limit = scene->params.texture_limit;
 
 	/* Slot assignment */
@@ -754,6 +940,11 @@ void ImageManager::device_load_image(Device *device,
 			pixels[3] = TEX_IMAGE_MISSING_A;
 		}
 
+		sparse_grid_free(device, flat_slot);
+		if(use_sparse_grid(img, type)) {
+			device_load_sparse_grid(device, img, flat_slot, 4, tex_img);
+		}
+
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(),
@@ -783,6 +974,11 @@ void ImageManager::device_load_image(Device *device,
 			pixels[0] = TEX_IMAGE_MISSING_R;
 		}
 
+		sparse_grid_free(device, flat_slot);
+		if(use_sparse_grid(img, type)) {
+			device_load_sparse_grid(device, img, flat_slot, 1, tex_img);
+		}
+
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(),
@@ -925,7 +1121,18 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageD
 			((OSL::TextureSystem*)osl_texture_system)->invalidate(filename);
 #endif
 		}
+		else if(use_texture_cache(img)) {
+			TextureCacheGlobals *tcg = (TextureCacheGlobals*)device->texture_cache_memory();
+			const int flat_slot = type_index_to_flattened_slot(slot, type);
+
+			texture_cache->invalidate(ustring(img->filename));
+			if((size_t)flat_slot < tcg->images.size()) {
+				tcg->images[flat_slot] = TextureCacheImage();
+			}
+		}
 		else {
+			sparse_grid_free(device, type_index_to_flattened_slot(slot, type));
+
 			device_memory *tex_img = NULL;
 			switch(type) {
 				case IMAGE_DATA_TYPE_FLOAT4:
@@ -982,6 +1189,8 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageD
 
 				delete tex_img;
 			}
+
+			image_cache_unmap(img);
 		}
 
 		delete images[type][slot];
@@ -990,8 +1199,15 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageD
 	}
 }
 
-void ImageManager::device_prepare_update(DeviceScene *dscene)
+void ImageManager::device_prepare_update(Device *device,
+                                         DeviceScene *dscene,
+                                         Scene *scene)
 {
+	texture_cache_init(device, scene);
+	sparse_grids_init(device, scene);
+	use_image_cache = scene->params.use_image_cache;
+	image_cache_size = scene->params.image_cache_size;
+
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		switch(type) {
 			case IMAGE_DATA_TYPE_FLOAT4:
@@ -1032,39 +1248,289 @@ void ImageManager::device_update(Device *device,
 	}
 
 	/* Make sure arrays are proper size. */
-	device_prepare_update(dscene);
+	device_prepare_update(device, dscene, scene);
+
+	/* Images to load with their file size, builtin images count as empty. */
+	vector<pair<size_t, int> > load_slots;
 
-	TaskPool pool;
 	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
 		for(size_t slot = 0; slot < images[type].size(); slot++) {
-			if(!images[type][slot])
+			Image *img = images[type][slot];
+
+			if(!img)
 				continue;
 
-			if(images[type][slot]->users == 0) {
+			if(img->users == 0) {
 				device_free_image(device, dscene, (ImageDataType)type, slot);
 			}
-			else if(images[type][slot]->need_load) {
-				if(!osl_texture_system || images[type][slot]->builtin_data)
-					pool.push(function_bind(&ImageManager::device_load_image,
-					                        this,
-					                        device,
-					                        dscene,
-					                        scene,
-					                        (ImageDataType)type,
-					                        slot,
-					                        &progress));
+			else if(img->need_load) {
+				if(!osl_texture_system || img->builtin_data) {
+					size_t file_size = (img->builtin_data)? 0: path_file_size(img->filename);
+					int flat_slot = type_index_to_flattened_slot(slot, (ImageDataType)type);
+					load_slots.push_back(pair<size_t, int>(file_size, flat_slot));
+				}
 			}
 		}
 	}
 
+	/* Start with the largest files, so their decoding does not end up
+	 * being the only work left at the end of the update. */
+	sort(load_slots.begin(), load_slots.end());
+
+	TaskPool pool;
+	for(int i = (int)load_slots.size() - 1; i >= 0; i--) {
+		ImageDataType type;
+		int slot = flattened_slot_to_type_index(load_slots[i].second, &type);
+
+		pool.push(function_bind(&ImageManager::device_load_image,
+		                        this,
+		                        device,
+		                        dscene,
+		                        scene,
+		                        type,
+		                        slot,
+		                        &progress));
+	}
+
 	pool.wait_work();
 
+	/* Evict least recently used images once all loads are done. Images
+	 * mapped by this update stay valid when their file is removed. */
+	if(use_image_cache && image_cache_size > 0 && !load_slots.empty()) {
+		path_cache_trim(path_cache_get("images"),
+		                (uint64_t)image_cache_size * 1024 * 1024);
+	}
+
 	if(pack_images)
 		device_pack_images(device, dscene, progress);
 
 	need_update = false;
 }
 
+bool ImageManager::use_texture_cache(Image *img)
+{
+	/* Builtin images are provided by the host application as pixels and can
+	 * not be read by the texture system. */
+	return texture_cache && !img->builtin_data;
+}
+
+void ImageManager::texture_cache_init(Device *device, Scene *scene)
+{
+	const int cache_size = scene->params.texture_cache_size;
+	TextureCacheGlobals *tcg = (TextureCacheGlobals*)device->texture_cache_memory();
+
+	/* OSL has its own texture system for image files. */
+	if(cache_size <= 0 || tcg == NULL || osl_texture_system) {
+		return;
+	}
+
+	if(texture_cache == NULL) {
+		/* Don't use the shared texture system, so the memory limit is not
+		 * overwritten by other users of it. */
+		texture_cache = TextureSystem::create(false);
+		texture_cache->attribute("automip", 1);
+		texture_cache->attribute("autotile", 64);
+		texture_cache->attribute("gray_to_rgb", 1);
+		/* Keep colors of images with alpha ignored as stored in the file,
+		 * the kernel associates alpha for the other images. */
+		texture_cache->attribute("unassociatedalpha", 1);
+		VLOG(1) << "Using texture cache of " << cache_size << " MB.";
+	}
+	texture_cache->attribute("max_memory_MB", (float)cache_size);
+
+	tcg->ts = texture_cache;
+
+	/* Make room for all slots, so images can be added from multiple threads. */
+	size_t num_slots = tcg->images.size();
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		if(images[type].size() > 0) {
+			num_slots = max(num_slots,
+			                (size_t)type_index_to_flattened_slot(images[type].size(),
+			                                                     (ImageDataType)type));
+		}
+	}
+	tcg->images.resize(num_slots);
+}
+
+void ImageManager::texture_cache_free(Device *device)
+{
+	if(texture_cache == NULL) {
+		return;
+	}
+
+	VLOG(2) << texture_cache->getstats();
+
+	TextureCacheGlobals *tcg = (TextureCacheGlobals*)device->texture_cache_memory();
+	if(tcg) {
+		tcg->images.clear();
+		tcg->ts = NULL;
+	}
+
+	TextureSystem::destroy(texture_cache);
+	texture_cache = NULL;
+}
+
+void ImageManager::device_load_texture_cache_image(Device *device,
+                                                   ImageDataType type,
+                                                   int slot)
+{
+	Image *img = images[type][slot];
+	TextureCacheGlobals *tcg = (TextureCacheGlobals*)device->texture_cache_memory();
+	const int flat_slot = type_index_to_flattened_slot(slot, type);
+	TextureCacheImage& cache_image = tcg->images[flat_slot];
+	ustring filename(img->filename);
+
+	/* Reload of an image which is already in the cache. */
+	if(cache_image.handle) {
+		texture_cache->invalidate(filename);
+	}
+
+	cache_image.handle = texture_cache->get_texture_handle(filename);
+	cache_image.use_alpha = img->use_alpha;
+
+	switch(img->interpolation) {
+		case INTERPOLATION_CLOSEST:
+			cache_image.interpolation = TextureOpt::InterpClosest;
+			break;
+		case INTERPOLATION_CUBIC:
+			cache_image.interpolation = TextureOpt::InterpBicubic;
+			break;
+		case INTERPOLATION_SMART:
+			cache_image.interpolation = TextureOpt::InterpSmartBicubic;
+			break;
+		case INTERPOLATION_LINEAR:
+		default:
+			cache_image.interpolation = TextureOpt::InterpBilinear;
+			break;
+	}
+
+	switch(img->extension) {
+		case EXTENSION_EXTEND:
+			cache_image.wrap = TextureOpt::WrapClamp;
+			break;
+		case EXTENSION_CLIP:
+			cache_image.wrap = TextureOpt::WrapBlack;
+			break;
+		case EXTENSION_REPEAT:
+		default:
+			cache_image.wrap = TextureOpt::WrapPeriodic;
+			break;
+	}
+
+	if(!texture_cache->good(cache_image.handle)) {
+		VLOG(1) << "Texture cache failed to open '" << img->filename << "'.";
+	}
+	else {
+		int unassociated_alpha = 0;
+		texture_cache->get_texture_info(filename, 0,
+		                                ustring("oiio:UnassociatedAlpha"),
+		                                TypeDesc::INT,
+		                                &unassociated_alpha);
+		cache_image.unassociated_alpha = (unassociated_alpha != 0);
+	}
+
+	img->need_load = false;
+}
+
+bool ImageManager::use_sparse_grid(Image *img, ImageDataType type)
+{
+	/* Only builtin images can be 3D, image files are always 2D. */
+	return use_sparse_volumes &&
+	       img->builtin_data &&
+	       (type == IMAGE_DATA_TYPE_FLOAT4 || type == IMAGE_DATA_TYPE_FLOAT);
+}
+
+void ImageManager::sparse_grids_init(Device *device, Scene *scene)
+{
+	SparseGridGlobals *sgg = (SparseGridGlobals*)device->sparse_grid_memory();
+
+	if(sgg == NULL || pack_images || !scene->params.use_sparse_volumes) {
+		use_sparse_volumes = false;
+		return;
+	}
+
+	use_sparse_volumes = true;
+
+	/* Make room for all slots, so grids can be added from multiple threads. */
+	size_t num_slots = sgg->images.size();
+	for(int type = 0; type < IMAGE_DATA_NUM_TYPES; type++) {
+		if(images[type].size() > 0) {
+			num_slots = max(num_slots,
+			                (size_t)type_index_to_flattened_slot(images[type].size(),
+			                                                     (ImageDataType)type));
+		}
+	}
+	sgg->images.resize(num_slots, NULL);
+}
+
+void ImageManager::sparse_grids_free(Device *device)
+{
+	SparseGridGlobals *sgg = (SparseGridGlobals*)device->sparse_grid_memory();
+
+	if(sgg == NULL) {
+		return;
+	}
+
+	foreach(SparseGridImage *grid, sgg->images) {
+		delete grid;
+	}
+	sgg->images.clear();
+}
+
+void ImageManager::sparse_grid_free(Device *device, int flat_slot)
+{
+	SparseGridGlobals *sgg = (SparseGridGlobals*)device->sparse_grid_memory();
+
+	if(sgg == NULL || (size_t)flat_slot >= sgg->images.size()) {
+		return;
+	}
+
+	delete sgg->images[flat_slot];
+	sgg->images[flat_slot] = NULL;
+}
+
+template<typename T>
+void ImageManager::device_load_sparse_grid(Device *device,
+                                           Image *img,
+                                           int flat_slot,
+                                           int channels,
+                                           device_vector<T>& tex_img)
+{
+	SparseGridGlobals *sgg = (SparseGridGlobals*)device->sparse_grid_memory();
+
+	if(tex_img.data_depth <= 1) {
+		return;
+	}
+
+	/* Slots are allocated up front by sparse_grids_init(), the vector can not
+	 * be resized here since images load from multiple threads. Keep the dense
+	 * texture if the slot was not accounted for. */
+	assert((size_t)flat_slot < sgg->images.size());
+	if((size_t)flat_slot >= sgg->images.size()) {
+		return;
+	}
+
+	SparseGridImage *grid = sparse_grid_build((float*)tex_img.data_pointer,
+	                                          tex_img.data_width,
+	                                          tex_img.data_height,
+	                                          tex_img.data_depth,
+	                                          channels,
+	                                          img->interpolation,
+	                                          img->extension);
+
+	const size_t dense_size = tex_img.size() * sizeof(T);
+	VLOG(1) << "Sparse grid for " << img->filename << ": "
+	        << string_human_readable_size(sparse_grid_memory_size(grid))
+	        << " instead of " << string_human_readable_size(dense_size) << ".";
+
+	sgg->images[flat_slot] = grid;
+
+	/* Keep a single voxel texture, so the slot stays valid for the device. */
+	tex_img.clear();
+	T *pixels = tex_img.resize(1, 1, 1);
+	memset(pixels, 0, sizeof(T));
+}
+
 void ImageManager::device_update_slot(Device *device,
                                       DeviceScene *dscene,
                                       Scene *scene,
@@ -1127,7 +1593,7 @@ void ImageManager::device_pack_images_type(
 			continue;
 		}
 		device_vector<T>& tex_img = *cpu_textures[slot];
-		size += tex_img.size();
+		size += tex_img.data_size;
 	}
 	/* Now we know how much memory we need, so we can allocate and fill. */
 	T *pixels = device_image->resize(size);
@@ -1146,7 +1612,7 @@ void ImageManager::device_pack_images_type(
 		memcpy(pixels + offset,
 		       (void*)tex_img.data_pointer,
 		       tex_img.memory_size());
-		offset += tex_img.size();
+		offset += tex_img.data_size;
 	}
 }
 
@@ -1245,6 +1711,9 @@ void ImageManager::device_free(Device *device, DeviceScene *dscene)
 		images[type].clear();
 	}
 
+	texture_cache_free(device);
+	sparse_grids_free(device);
+
 	dscene->tex_float4_image.clear();
 	dscene->tex_byte4_image.clear();
 	dscene->tex_half4_image.clear();
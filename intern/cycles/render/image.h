@@ -17,6 +17,8 @@
 #ifndef __IMAGE_H__
 #define __IMAGE_H__
 
+#include <OpenImageIO/texture.h>
+
 #include "device/device.h"
 #include "device/device_memory.h"
 
@@ -59,7 +61,7 @@ public:
 	                      bool use_alpha);
 	ImageDataType get_image_metadata(const string& filename, void *builtin_data, bool& is_linear);
 
-	void device_prepare_update(DeviceScene *dscene);
+	void device_prepare_update(Device *device, DeviceScene *dscene, Scene *scene);
 	void device_update(Device *device,
 	                   DeviceScene *dscene,
 	                   Scene *scene,
@@ -110,6 +112,11 @@ public:
 		ExtensionType extension;
 
 		int users;
+
+		/* Mapping of the decoded image cache file the pixels are read from,
+		 * NULL when they are stored in the device vector itself. */
+		void *cache_data;
+		size_t cache_size;
 	};
 
 private:
@@ -125,6 +132,50 @@ private:
 	void *osl_texture_system;
 	bool pack_images;
 
+	/* Texture system used by the CPU device to read image files on demand,
+	 * NULL when images are loaded into memory. */
+	TextureSystem *texture_cache;
+
+	bool use_texture_cache(Image *img);
+	void texture_cache_init(Device *device, Scene *scene);
+	void texture_cache_free(Device *device);
+	void device_load_texture_cache_image(Device *device,
+	                                     ImageDataType type,
+	                                     int slot);
+
+	/* Sparse volume grids, used by the CPU device for 3D builtin images. */
+	bool use_sparse_volumes;
+
+	bool use_sparse_grid(Image *img, ImageDataType type);
+	void sparse_grids_init(Device *device, Scene *scene);
+	void sparse_grids_free(Device *device);
+	void sparse_grid_free(Device *device, int flat_slot);
+	template<typename T>
+	void device_load_sparse_grid(Device *device,
+	                             Image *img,
+	                             int flat_slot,
+	                             int channels,
+	                             device_vector<T>& tex_img);
+
+	/* Disk cache of decoded images, to skip decoding and conversion on
+	 * repeated renders. */
+	bool use_image_cache;
+	/* Size in megabytes, zero for no limit. */
+	int image_cache_size;
+
+	string image_cache_key(Image *img,
+	                       ImageDataType type,
+	                       TypeDesc::BASETYPE format,
+	                       int texture_limit);
+	template<typename T>
+	bool image_cache_read(Image *img,
+	                      const string& key,
+	                      device_vector<T>& tex_img);
+	template<typename T>
+	void image_cache_write(const string& key,
+	                       device_vector<T>& tex_img);
+	void image_cache_unmap(Image *img);
+
 	bool file_load_image_generic(Image *img, ImageInput **in, int &width, int &height, int &depth, int &components);
 
 	template<TypeDesc::BASETYPE FileFormat,
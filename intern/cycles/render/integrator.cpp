@@ -47,6 +47,7 @@ NODE_DEFINE(Integrator)
 
 	SOCKET_INT(volume_max_steps, "Volume Max Steps", 1024);
 	SOCKET_FLOAT(volume_step_size, "Volume Step Size", 0.1f);
+	SOCKET_BOOLEAN(volume_skip_empty, "Volume Skip Empty", false);
 
 	SOCKET_BOOLEAN(caustics_reflective, "Reflective Caustics", true);
 	SOCKET_BOOLEAN(caustics_refractive, "Refractive Caustics", true);
@@ -69,6 +70,11 @@ NODE_DEFINE(Integrator)
 	SOCKET_BOOLEAN(sample_all_lights_direct, "Sample All Lights Direct", true);
 	SOCKET_BOOLEAN(sample_all_lights_indirect, "Sample All Lights Indirect", true);
 	SOCKET_FLOAT(light_sampling_threshold, "Light Sampling Threshold", 0.05f);
+	SOCKET_BOOLEAN(use_light_tree, "Use Light Tree", false);
+	SOCKET_BOOLEAN(use_packet_traversal, "Use Packet Traversal", false);
+
+	SOCKET_FLOAT(adaptive_threshold, "Adaptive Threshold", 0.0f);
+	SOCKET_INT(adaptive_min_samples, "Adaptive Min Samples", 0);
 
 	static NodeEnum method_enum;
 	method_enum.insert("path", PATH);
@@ -141,6 +147,7 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 
 	kintegrator->volume_max_steps = volume_max_steps;
 	kintegrator->volume_step_size = volume_step_size;
+	kintegrator->volume_skip_empty = volume_skip_empty;
 
 	kintegrator->caustics_reflective = caustics_reflective;
 	kintegrator->caustics_refractive = caustics_refractive;
@@ -183,6 +190,9 @@ void Integrator::device_update(Device *device, DeviceScene *dscene, Scene *scene
 		kintegrator->light_inv_rr_threshold = 0.0f;
 	}
 
+	kintegrator->adaptive_threshold = adaptive_threshold;
+	kintegrator->use_packet_traversal = use_packet_traversal;
+
 	/* sobol directions table */
 	int max_samples = 1;
 
@@ -236,6 +246,9 @@ void Integrator::tag_update(Scene *scene)
 			break;
 		}
 	}
+	if(use_light_tree != scene->light_manager->use_light_tree) {
+		scene->light_manager->tag_update(scene);
+	}
 	need_update = true;
 }
 
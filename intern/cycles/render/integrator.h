@@ -47,6 +47,7 @@ public:
 
 	int volume_max_steps;
 	float volume_step_size;
+	bool volume_skip_empty;
 
 	bool caustics_reflective;
 	bool caustics_refractive;
@@ -72,6 +73,16 @@ public:
 	bool sample_all_lights_indirect;
 	float light_sampling_threshold;
 
+	/* Select lights with a tree taking distance and orientation into account. */
+	bool use_light_tree;
+
+	/* Trace camera and shadow rays in packets on the CPU. */
+	bool use_packet_traversal;
+
+	/* Noise threshold for adaptive sampling, 0 disables it. */
+	float adaptive_threshold;
+	int adaptive_min_samples;
+
 	enum Method {
 		BRANCHED_PATH = 0,
 		PATH = 1,
@@ -19,6 +19,7 @@
 #include "render/integrator.h"
 #include "render/film.h"
 #include "render/light.h"
+#include "render/light_tree.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
@@ -174,6 +175,7 @@ LightManager::LightManager()
 {
 	need_update = true;
 	use_light_visibility = false;
+	use_light_tree = false;
 }
 
 LightManager::~LightManager()
@@ -245,6 +247,56 @@ bool LightManager::object_usable_as_light(Object *object) {
 	return false;
 }
 
+/* Estimate of the power of an emission shader for the light tree. Shaders
+ * with varying emission count as unit strength. */
+static float light_tree_shader_energy(Shader *shader)
+{
+	float3 emission;
+
+	if(shader->is_constant_emission(&emission)) {
+		return max(average(emission), 0.0f);
+	}
+	return 1.0f;
+}
+
+static LightTreeEmitter light_tree_lamp_emitter(Scene *scene, Light *light, int distribution_index)
+{
+	Shader *shader = (light->shader) ? light->shader : scene->default_light;
+	float3 dir = safe_normalize(light->dir);
+	bool has_dir = (len_squared(dir) > 0.0f);
+
+	LightTreeEmitter emitter;
+	emitter.energy = light_tree_shader_energy(shader);
+	emitter.area = 0.0f;
+	emitter.distribution_index = distribution_index;
+
+	if(light->type == LIGHT_AREA) {
+		float3 axisu = light->axisu*(light->sizeu*light->size);
+		float3 axisv = light->axisv*(light->sizev*light->size);
+		float3 corner = light->co - 0.5f*(axisu + axisv);
+
+		emitter.bounds = BoundBox(corner);
+		emitter.bounds.grow(corner + axisu);
+		emitter.bounds.grow(corner + axisv);
+		emitter.bounds.grow(corner + axisu + axisv);
+
+		/* Area lamps are one sided. */
+		if(has_dir) {
+			emitter.cone = LightTreeCone(dir, 0.0f, M_PI_2_F);
+		}
+	}
+	else {
+		emitter.bounds = BoundBox(light->co);
+		emitter.bounds.grow(light->co, light->size);
+
+		if(light->type == LIGHT_SPOT && has_dir) {
+			emitter.cone = LightTreeCone(dir, 0.0f, min(light->spot_angle*0.5f, M_PI_2_F));
+		}
+	}
+
+	return emitter;
+}
+
 void LightManager::device_update_distribution(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
 {
 	progress.set_status("Updating Lights", "Computing distribution");
@@ -266,12 +318,37 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		}
 	}
 
+	/* Objects usable as light with their object index and transform, compact
+	 * instances follow all objects. */
+	vector<Object*> light_objects;
+	vector<int> light_object_ids;
+	vector<const Transform*> light_object_tfms;
+	int object_id = 0;
+
+	foreach(Object *object, scene->objects) {
+		if(object_usable_as_light(object)) {
+			light_objects.push_back(object);
+			light_object_ids.push_back(object_id);
+			light_object_tfms.push_back(&object->tfm);
+		}
+		object_id++;
+	}
 	foreach(Object *object, scene->objects) {
+		if(object_usable_as_light(object)) {
+			foreach(const ObjectInstance& instance, object->instances) {
+				light_objects.push_back(object);
+				light_object_ids.push_back(object_id++);
+				light_object_tfms.push_back(&instance.tfm);
+			}
+		}
+		else {
+			object_id += object->instances.size();
+		}
+	}
+
+	foreach(Object *object, light_objects) {
 		if(progress.get_cancel()) return;
 
-		if(!object_usable_as_light(object)) {
-			continue;
-		}
 		/* Count triangles. */
 		Mesh *mesh = object->mesh;
 		size_t mesh_num_triangles = mesh->num_triangles();
@@ -290,26 +367,36 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 	size_t num_distribution = num_triangles + num_lights;
 	VLOG(1) << "Total " << num_distribution << " of light distribution primitives.";
 
+	/* light tree */
+	use_light_tree = scene->integrator->use_light_tree;
+
+	vector<LightTreeEmitter> triangle_emitters;
+	vector<LightTreeEmitter> lamp_emitters;
+	vector<uint> leaf_map;
+	vector<uint> triangle_leaf_slots;
+
+	if(use_light_tree) {
+		/* Two entries per object: whether it has mesh lights, and the offset
+		 * of its triangles in the map relative to the mesh triangle offset. */
+		leaf_map.resize(object_id*2, 0);
+	}
+
 	/* emission area */
 	float4 *distribution = dscene->light_distribution.resize(num_distribution + 1);
 	float totarea = 0.0f;
 
 	/* triangles */
 	size_t offset = 0;
-	int j = 0;
 
-	foreach(Object *object, scene->objects) {
+	for(size_t j = 0; j < light_objects.size(); j++) {
 		if(progress.get_cancel()) return;
 
-		if(!object_usable_as_light(object)) {
-			j++;
-			continue;
-		}
 		/* Sum area. */
+		Object *object = light_objects[j];
 		Mesh *mesh = object->mesh;
 		bool transform_applied = mesh->transform_applied;
-		Transform tfm = object->tfm;
-		int object_id = j;
+		Transform tfm = *light_object_tfms[j];
+		int object_id = light_object_ids[j];
 		int shader_flag = 0;
 
 		if(!(object->visibility & PATH_RAY_DIFFUSE)) {
@@ -330,6 +417,19 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		}
 
 		size_t mesh_num_triangles = mesh->num_triangles();
+		size_t leaf_map_offset = leaf_map.size();
+		vector<float> shader_energy;
+
+		if(use_light_tree) {
+			leaf_map[object_id*2 + 0] = 1;
+			leaf_map[object_id*2 + 1] = leaf_map_offset - mesh->tri_offset;
+			leaf_map.resize(leaf_map_offset + mesh_num_triangles, ~0);
+
+			foreach(Shader *shader, mesh->used_shaders) {
+				shader_energy.push_back(light_tree_shader_energy(shader));
+			}
+		}
+
 		for(size_t i = 0; i < mesh_num_triangles; i++) {
 			int shader_index = mesh->shader[i];
 			Shader *shader = (shader_index < mesh->used_shaders.size())
@@ -337,6 +437,8 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 			                         : scene->default_surface;
 
 			if(shader->use_mis && shader->has_surface_emission) {
+				int distribution_index = offset;
+
 				distribution[offset].x = totarea;
 				distribution[offset].y = __int_as_float(i + mesh->tri_offset);
 				distribution[offset].z = __int_as_float(shader_flag);
@@ -354,11 +456,27 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 					p3 = transform_point(&tfm, p3);
 				}
 
-				totarea += triangle_area(p1, p2, p3);
+				float area = triangle_area(p1, p2, p3);
+				totarea += area;
+
+				if(use_light_tree) {
+					/* Mesh lights emit from both sides, so the default
+					 * omnidirectional cone is used. */
+					LightTreeEmitter emitter;
+					emitter.bounds = BoundBox(p1);
+					emitter.bounds.grow(p2);
+					emitter.bounds.grow(p3);
+					emitter.energy = (shader_index < shader_energy.size())
+					                         ? area*shader_energy[shader_index]
+					                         : area;
+					emitter.area = area;
+					emitter.distribution_index = distribution_index;
+
+					triangle_emitters.push_back(emitter);
+					triangle_leaf_slots.push_back(leaf_map_offset + i);
+				}
 			}
 		}
-
-		j++;
 	}
 
 	float trianglearea = totarea;
@@ -367,26 +485,47 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 	float lightarea = (totarea > 0.0f) ? totarea / num_lights : 1.0f;
 	bool use_lamp_mis = false;
 
+	/* With the light tree, lamps with a position come first so that the
+	 * distant and background lamps are a contiguous range at the end. */
+	int num_passes = (use_light_tree)? 2: 1;
 	int light_index = 0;
-	foreach(Light *light, scene->lights) {
-		if(!light->is_enabled)
-			continue;
 
-		distribution[offset].x = totarea;
-		distribution[offset].y = __int_as_float(~light_index);
-		distribution[offset].z = 1.0f;
-		distribution[offset].w = light->size;
-		totarea += lightarea;
+	for(int pass = 0; pass < num_passes; pass++) {
+		light_index = 0;
 
-		if(light->size > 0.0f && light->use_mis)
-			use_lamp_mis = true;
-		if(light->type == LIGHT_BACKGROUND) {
-			num_background_lights++;
-			background_mis = light->use_mis;
-		}
+		foreach(Light *light, scene->lights) {
+			if(!light->is_enabled)
+				continue;
 
-		light_index++;
-		offset++;
+			if(use_light_tree) {
+				bool is_infinite = (light->type == LIGHT_DISTANT ||
+				                    light->type == LIGHT_BACKGROUND);
+
+				if(is_infinite != (pass == 1)) {
+					light_index++;
+					continue;
+				}
+				if(!is_infinite) {
+					lamp_emitters.push_back(light_tree_lamp_emitter(scene, light, offset));
+				}
+			}
+
+			distribution[offset].x = totarea;
+			distribution[offset].y = __int_as_float(~light_index);
+			distribution[offset].z = 1.0f;
+			distribution[offset].w = light->size;
+			totarea += lightarea;
+
+			if(light->size > 0.0f && light->use_mis)
+				use_lamp_mis = true;
+			if(light->type == LIGHT_BACKGROUND) {
+				num_background_lights++;
+				background_mis = light->use_mis;
+			}
+
+			light_index++;
+			offset++;
+		}
 	}
 
 	/* normalize cumulative distribution functions */
@@ -449,6 +588,21 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		/* CDF */
 		device->tex_alloc("__light_distribution", dscene->light_distribution);
 
+		/* Light tree */
+		kintegrator->use_light_tree = false;
+
+		if(use_light_tree) {
+			kintegrator->light_tree_num_triangles = num_triangles;
+			kintegrator->light_tree_num_local_lights = lamp_emitters.size();
+
+			device_update_light_tree(device,
+			                         dscene,
+			                         triangle_emitters,
+			                         lamp_emitters,
+			                         leaf_map,
+			                         triangle_leaf_slots);
+		}
+
 		/* Portals */
 		if(num_portals > 0) {
 			kintegrator->portal_offset = light_index;
@@ -473,11 +627,56 @@ void LightManager::device_update_distribution(Device *device, DeviceScene *dscen
 		kintegrator->num_portals = 0;
 		kintegrator->portal_offset = 0;
 		kintegrator->portal_pdf = 0.0f;
+		kintegrator->use_light_tree = false;
 
 		kfilm->pass_shadow_scale = 1.0f;
 	}
 }
 
+void LightManager::device_update_light_tree(Device *device,
+                                            DeviceScene *dscene,
+                                            const vector<LightTreeEmitter>& triangle_emitters,
+                                            const vector<LightTreeEmitter>& lamp_emitters,
+                                            vector<uint>& leaf_map,
+                                            const vector<uint>& triangle_leaf_slots)
+{
+	KernelIntegrator *kintegrator = &dscene->data.integrator;
+
+	/* Both trees are packed into the same array, the mesh light tree is
+	 * always at the start. */
+	vector<float4> nodes;
+
+	LightTree triangle_tree(triangle_emitters);
+	triangle_tree.pack(nodes);
+
+	LightTree lamp_tree(lamp_emitters);
+	int lamp_root = lamp_tree.pack(nodes);
+
+	if(nodes.size() == 0) {
+		/* Only distant and background lamps, nothing to gain. */
+		return;
+	}
+
+	for(size_t i = 0; i < triangle_leaf_slots.size(); i++) {
+		leaf_map[triangle_leaf_slots[i]] = triangle_tree.leaf_nodes[i];
+	}
+
+	VLOG(1) << "Light tree with " << triangle_emitters.size() << " triangles and "
+	        << lamp_emitters.size() << " lamps, "
+	        << nodes.size()/LIGHT_TREE_NODE_SIZE << " nodes.";
+
+	dscene->light_tree_nodes.copy(&nodes[0], nodes.size());
+	device->tex_alloc("__light_tree_nodes", dscene->light_tree_nodes);
+
+	if(leaf_map.size()) {
+		dscene->light_tree_leaf_map.copy(&leaf_map[0], leaf_map.size());
+		device->tex_alloc("__light_tree_leaf_map", dscene->light_tree_leaf_map);
+	}
+
+	kintegrator->use_light_tree = true;
+	kintegrator->light_tree_lamp_root = lamp_root;
+}
+
 static void background_cdf(int start,
                            int end,
                            int res,
@@ -848,11 +1047,15 @@ void LightManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->light_data);
 	device->tex_free(dscene->light_background_marginal_cdf);
 	device->tex_free(dscene->light_background_conditional_cdf);
+	device->tex_free(dscene->light_tree_nodes);
+	device->tex_free(dscene->light_tree_leaf_map);
 
 	dscene->light_distribution.clear();
 	dscene->light_data.clear();
 	dscene->light_background_marginal_cdf.clear();
 	dscene->light_background_conditional_cdf.clear();
+	dscene->light_tree_nodes.clear();
+	dscene->light_tree_leaf_map.clear();
 }
 
 void LightManager::tag_update(Scene * /*scene*/)
@@ -28,6 +28,7 @@ CCL_NAMESPACE_BEGIN
 
 class Device;
 class DeviceScene;
+struct LightTreeEmitter;
 class Object;
 class Progress;
 class Scene;
@@ -80,6 +81,7 @@ public:
 class LightManager {
 public:
 	bool use_light_visibility;
+	bool use_light_tree;
 	bool need_update;
 
 	LightManager();
@@ -114,6 +116,12 @@ protected:
 	                              DeviceScene *dscene,
 	                              Scene *scene,
 	                              Progress& progress);
+	void device_update_light_tree(Device *device,
+	                              DeviceScene *dscene,
+	                              const vector<LightTreeEmitter>& triangle_emitters,
+	                              const vector<LightTreeEmitter>& lamp_emitters,
+	                              vector<uint>& leaf_map,
+	                              const vector<uint>& triangle_leaf_slots);
 
 	/* Check whether light manager can use the object as a light-emissive. */
 	bool object_usable_as_light(Object *object);
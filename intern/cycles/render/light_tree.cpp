@@ -0,0 +1,173 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/light_tree.h"
+
+#include "kernel/kernel_types.h"
+
+#include "util/util_algorithm.h"
+#include "util/util_math.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Cone */
+
+void LightTreeCone::grow(const LightTreeCone& other)
+{
+	theta_e = max(theta_e, other.theta_e);
+
+	if(is_omnidirectional()) {
+		return;
+	}
+	if(other.is_omnidirectional()) {
+		theta_o = M_PI_F;
+		return;
+	}
+
+	/* Smallest cone containing both, see "Importance Sampling of Many Lights
+	 * with Adaptive Tree Splitting" by Conty Estevez and Kulla. */
+	const LightTreeCone& wide = (other.theta_o > theta_o)? other: *this;
+	const LightTreeCone& narrow = (other.theta_o > theta_o)? *this: other;
+
+	float cos_theta_d = dot(wide.axis, narrow.axis);
+	float theta_d = safe_acosf(cos_theta_d);
+
+	if(min(theta_d + narrow.theta_o, M_PI_F) <= wide.theta_o) {
+		*this = LightTreeCone(wide.axis, wide.theta_o, theta_e);
+		return;
+	}
+
+	float new_theta_o = 0.5f*(wide.theta_o + theta_d + narrow.theta_o);
+
+	if(new_theta_o >= M_PI_F) {
+		theta_o = M_PI_F;
+		return;
+	}
+
+	/* Rotate the axis of the wide cone towards the narrow one. */
+	float3 ortho = narrow.axis - wide.axis*cos_theta_d;
+	float ortho_len = len(ortho);
+
+	if(ortho_len < 1e-6f) {
+		theta_o = M_PI_F;
+		return;
+	}
+
+	float theta_r = new_theta_o - wide.theta_o;
+	axis = normalize(wide.axis*cosf(theta_r) + ortho*(sinf(theta_r)/ortho_len));
+	theta_o = new_theta_o;
+}
+
+/* Light Tree */
+
+struct LightTreeCentroidCompare {
+	LightTreeCentroidCompare(const vector<LightTreeEmitter>& emitters, int axis)
+	: emitters(emitters), axis(axis)
+	{
+	}
+
+	bool operator()(int a, int b) const
+	{
+		return emitters[a].bounds.center()[axis] < emitters[b].bounds.center()[axis];
+	}
+
+	const vector<LightTreeEmitter>& emitters;
+	int axis;
+};
+
+LightTree::LightTree(const vector<LightTreeEmitter>& emitters_)
+: emitters(emitters_)
+{
+}
+
+int LightTree::pack(vector<float4>& nodes)
+{
+	size_t num_emitters = emitters.size();
+
+	leaf_nodes.resize(num_emitters);
+	order.resize(num_emitters);
+
+	for(size_t i = 0; i < num_emitters; i++) {
+		order[i] = i;
+	}
+
+	if(num_emitters == 0) {
+		return -1;
+	}
+
+	return recursive_pack(nodes, -1, 0, num_emitters);
+}
+
+int LightTree::recursive_pack(vector<float4>& nodes, int parent, int start, int end)
+{
+	int index = nodes.size()/LIGHT_TREE_NODE_SIZE;
+	nodes.resize(nodes.size() + LIGHT_TREE_NODE_SIZE);
+
+	/* Bounds of the emitters in this node. */
+	BoundBox bounds = BoundBox::empty;
+	BoundBox centroid_bounds = BoundBox::empty;
+	LightTreeCone cone = emitters[order[start]].cone;
+	float energy = 0.0f;
+
+	for(int i = start; i < end; i++) {
+		const LightTreeEmitter& emitter = emitters[order[i]];
+
+		bounds.grow(emitter.bounds);
+		centroid_bounds.grow(emitter.bounds.center());
+		cone.grow(emitter.cone);
+		energy += emitter.energy;
+	}
+
+	int distribution_index = -1;
+	int right = -1;
+	float area = 0.0f;
+
+	if(end - start == 1) {
+		const LightTreeEmitter& emitter = emitters[order[start]];
+
+		leaf_nodes[order[start]] = index;
+		distribution_index = emitter.distribution_index;
+		area = emitter.area;
+	}
+	else {
+		/* Split at the median along the largest extent of the centroids,
+		 * which keeps the tree balanced and the build fast for scenes with
+		 * many mesh light triangles. */
+		float3 extent = centroid_bounds.size();
+		int axis = (extent.x > extent.y)? ((extent.x > extent.z)? 0: 2):
+		                                  ((extent.y > extent.z)? 1: 2);
+		int middle = (start + end)/2;
+
+		nth_element(order.begin() + start,
+		            order.begin() + middle,
+		            order.begin() + end,
+		            LightTreeCentroidCompare(emitters, axis));
+
+		recursive_pack(nodes, index, start, middle);
+		right = recursive_pack(nodes, index, middle, end);
+	}
+
+	float4 *node = &nodes[index*LIGHT_TREE_NODE_SIZE];
+
+	node[0] = make_float4(bounds.min.x, bounds.min.y, bounds.min.z, energy);
+	node[1] = make_float4(bounds.max.x, bounds.max.y, bounds.max.z, __int_as_float(distribution_index));
+	node[2] = make_float4(cone.axis.x, cone.axis.y, cone.axis.z, cone.theta_o);
+	node[3] = make_float4(cone.theta_e, __int_as_float(parent), __int_as_float(right), area);
+
+	return index;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LIGHT_TREE_H__
+#define __LIGHT_TREE_H__
+
+#include "util/util_boundbox.h"
+#include "util/util_types.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Orientation Cone
+ *
+ * Bounds the emission of a set of emitters: all normals lie within theta_o
+ * of the axis, and each emitter emits within theta_e around its normal. */
+
+struct LightTreeCone {
+	LightTreeCone()
+	: axis(make_float3(0.0f, 0.0f, 1.0f)),
+	  theta_o(M_PI_F),
+	  theta_e(M_PI_2_F)
+	{
+	}
+
+	LightTreeCone(const float3& axis_, float theta_o_, float theta_e_)
+	: axis(axis_),
+	  theta_o(theta_o_),
+	  theta_e(theta_e_)
+	{
+	}
+
+	bool is_omnidirectional() const
+	{
+		return theta_o >= M_PI_F;
+	}
+
+	void grow(const LightTreeCone& other);
+
+	float3 axis;
+	float theta_o;
+	float theta_e;
+};
+
+/* Emitter in the light tree, either a mesh light triangle or a lamp with a
+ * position. Infinite lamps are not part of the tree. */
+
+struct LightTreeEmitter {
+	BoundBox bounds;
+	LightTreeCone cone;
+	float energy;
+	/* Surface area of triangles, needed to convert the selection probability
+	 * to an area density. */
+	float area;
+	/* Index into the light distribution. */
+	int distribution_index;
+};
+
+/* Light Tree
+ *
+ * Binary bounding volume hierarchy over emitters, with one emitter per leaf.
+ * Nodes are packed depth first into the __light_tree_nodes texture, so the
+ * left child of a node directly follows it, see kernel_light.h for the
+ * layout and traversal. */
+
+class LightTree {
+public:
+	explicit LightTree(const vector<LightTreeEmitter>& emitters);
+
+	/* Append the nodes to the packed array and return the index of the root.
+	 * Afterwards leaf_nodes holds the leaf node index of each emitter. */
+	int pack(vector<float4>& nodes);
+
+	vector<int> leaf_nodes;
+
+protected:
+	int recursive_pack(vector<float4>& nodes, int parent, int start, int end);
+
+	const vector<LightTreeEmitter>& emitters;
+	vector<int> order;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __LIGHT_TREE_H__ */
@@ -37,6 +37,8 @@
 #include "util/util_logging.h"
 #include "util/util_progress.h"
 #include "util/util_set.h"
+#include "util/util_string.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -361,6 +363,71 @@ void Mesh::Curve::cardinal_keys_for_step(const float3 *curve_keys,
 	}
 }
 
+/* Curve keys are stored on the device as 16 bit fixed point positions
+ * relative to the bounds of their curve, and 16 bit radii relative to the
+ * largest radius of the curve, see geom_curve_keys.h. */
+
+#define CURVE_KEY_QUANTIZE_MAX 65535
+
+static uint curve_key_quantize(float f, float scale)
+{
+	if(!(scale > 0.0f)) {
+		return 0;
+	}
+	return (uint)clamp((int)(f / scale + 0.5f), 0, CURVE_KEY_QUANTIZE_MAX);
+}
+
+static void curve_key_dequantize(const uint key[2],
+                                 const float4 bounds,
+                                 const float radius_scale,
+                                 float3 *co,
+                                 float *radius)
+{
+	*co = make_float3(bounds.x + (float)(key[0] & 0xffff) * bounds.w,
+	                  bounds.y + (float)(key[0] >> 16) * bounds.w,
+	                  bounds.z + (float)(key[1] & 0xffff) * bounds.w);
+	*radius = (float)(key[1] >> 16) * radius_scale;
+}
+
+void Mesh::Curve::compact_bounds(const float3 *curve_keys,
+                                 const float *curve_radius,
+                                 float4 *r_bounds,
+                                 float *r_radius_scale) const
+{
+	BoundBox bounds = BoundBox::empty;
+	float max_radius = 0.0f;
+
+	for(int i = 0; i < num_keys; i++) {
+		bounds.grow(curve_keys[first_key + i]);
+		max_radius = max(max_radius, curve_radius[first_key + i]);
+	}
+
+	const float3 size = bounds.size();
+	const float extent = max(max(size.x, size.y), size.z);
+
+	*r_bounds = make_float4(bounds.min.x,
+	                        bounds.min.y,
+	                        bounds.min.z,
+	                        extent / CURVE_KEY_QUANTIZE_MAX);
+	*r_radius_scale = max_radius / CURVE_KEY_QUANTIZE_MAX;
+}
+
+void Mesh::Curve::compact_key(const float3 *curve_keys,
+                              const float *curve_radius,
+                              const float4 bounds,
+                              const float radius_scale,
+                              int k,
+                              uint r_key[2]) const
+{
+	const float3 co = curve_keys[first_key + k] - float4_to_float3(bounds);
+	const float radius = curve_radius[first_key + k];
+
+	r_key[0] = curve_key_quantize(co.x, bounds.w) |
+	           (curve_key_quantize(co.y, bounds.w) << 16);
+	r_key[1] = curve_key_quantize(co.z, bounds.w) |
+	           (curve_key_quantize(radius, radius_scale) << 16);
+}
+
 /* SubdFace */
 
 float3 Mesh::SubdFace::normal(const Mesh *mesh) const
@@ -939,24 +1006,68 @@ void Mesh::pack_verts(const vector<uint>& tri_prim_index,
 	}
 }
 
-void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset)
+void Mesh::quantize_curve_keys()
 {
-	size_t curve_keys_size = curve_keys.size();
-
-	/* pack curve keys */
-	if(curve_keys_size) {
-		float3 *keys_ptr = curve_keys.data();
-		float *radius_ptr = curve_radius.data();
+	/* Snap keys to the grid they are stored with on the device, so the BVH
+	 * is built from the same keys as the kernel intersects. */
+	size_t curve_num = num_curves();
 
-		for(size_t i = 0; i < curve_keys_size; i++)
-			curve_key_co[i] = make_float4(keys_ptr[i].x, keys_ptr[i].y, keys_ptr[i].z, radius_ptr[i]);
+	for(size_t i = 0; i < curve_num; i++) {
+		Curve curve = get_curve(i);
+		float4 bounds;
+		float radius_scale;
+
+		curve.compact_bounds(curve_keys.data(), curve_radius.data(), &bounds, &radius_scale);
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			uint key[2];
+			curve.compact_key(curve_keys.data(), curve_radius.data(), bounds, radius_scale, k, key);
+			curve_key_dequantize(key,
+			                     bounds,
+			                     radius_scale,
+			                     &curve_keys[curve.first_key + k],
+			                     &curve_radius[curve.first_key + k]);
+		}
 	}
+}
 
-	/* pack curve segments */
+void Mesh::pack_curves(Scene *scene,
+                       uint *curve_key_data,
+                       float4 *curve_data,
+                       float4 *curve_bounds,
+                       size_t curvekey_offset)
+{
+	/* pack curve keys and segments */
 	size_t curve_num = num_curves();
+	bool use_compact_keys = scene->curve_system_manager->use_compact_keys;
 
 	for(size_t i = 0; i < curve_num; i++) {
 		Curve curve = get_curve(i);
+		float4 bounds;
+		float radius_scale;
+
+		curve.compact_bounds(curve_keys.data(), curve_radius.data(), &bounds, &radius_scale);
+
+		for(int k = 0; k < curve.num_keys; k++) {
+			if(use_compact_keys) {
+				curve.compact_key(curve_keys.data(),
+				                  curve_radius.data(),
+				                  bounds,
+				                  radius_scale,
+				                  k,
+				                  &curve_key_data[(curve.first_key + k) * 2]);
+			}
+			else {
+				const float3 co = curve_keys[curve.first_key + k];
+				uint *key = &curve_key_data[(curve.first_key + k) * 4];
+
+				key[0] = __float_as_uint(co.x);
+				key[1] = __float_as_uint(co.y);
+				key[2] = __float_as_uint(co.z);
+				key[3] = __float_as_uint(curve_radius[curve.first_key + k]);
+			}
+		}
+
 		int shader_id = curve_shader[i];
 		Shader *shader = (shader_id < used_shaders.size()) ?
 			used_shaders[shader_id] : scene->default_surface;
@@ -966,7 +1077,8 @@ void Mesh::pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, s
 			__int_as_float(curve.first_key + curvekey_offset),
 			__int_as_float(curve.num_keys),
 			__int_as_float(shader_id),
-			0.0f);
+			radius_scale);
+		curve_bounds[i] = bounds;
 	}
 }
 
@@ -1051,6 +1163,8 @@ void Mesh::compute_bvh(DeviceScene *dscene,
 			BVHParams bparams;
 			bparams.use_spatial_split = params->use_bvh_spatial_split;
 			bparams.use_qbvh = params->use_qbvh;
+			bparams.use_cache = params->use_bvh_cache;
+			bparams.cache_size = params->bvh_cache_size;
 			bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
 			                              params->use_bvh_unaligned_nodes;
 			bparams.num_motion_triangle_steps = params->num_bvh_time_steps;
@@ -1141,7 +1255,7 @@ void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<Att
 	og->attribute_map.clear();
 	og->object_names.clear();
 
-	og->attribute_map.resize(scene->objects.size()*ATTR_PRIM_TYPES);
+	og->attribute_map.resize(scene->object_manager->num_device_objects(scene)*ATTR_PRIM_TYPES);
 
 	for(size_t i = 0; i < scene->objects.size(); i++) {
 		/* set object name to object index map */
@@ -1241,6 +1355,21 @@ void MeshManager::update_osl_attributes(Device *device, Scene *scene, vector<Att
 			}
 		}
 	}
+
+	/* compact instances use the attributes of their object */
+	size_t index = scene->objects.size();
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		Object *object = scene->objects[i];
+
+		for(size_t j = 0; j < object->instances.size(); j++, index++) {
+			og->object_names.push_back(object->name);
+
+			for(int prim = 0; prim < ATTR_PRIM_TYPES; prim++) {
+				og->attribute_map[index*ATTR_PRIM_TYPES + prim] = og->attribute_map[i*ATTR_PRIM_TYPES + prim];
+			}
+		}
+	}
 #else
 	(void)device;
 	(void)scene;
@@ -1263,7 +1392,8 @@ void MeshManager::update_svm_attributes(Device *device, DeviceScene *dscene, Sce
 		return;
 
 	/* create attribute map */
-	uint4 *attr_map = dscene->attributes_map.resize(attr_map_stride*scene->objects.size());
+	size_t num_objects = scene->object_manager->num_device_objects(scene);
+	uint4 *attr_map = dscene->attributes_map.resize(attr_map_stride*num_objects);
 	memset(attr_map, 0, dscene->attributes_map.size()*sizeof(uint));
 
 	for(size_t i = 0; i < scene->objects.size(); i++) {
@@ -1353,6 +1483,18 @@ void MeshManager::update_svm_attributes(Device *device, DeviceScene *dscene, Sce
 		}
 	}
 
+	/* compact instances use the attributes of their object */
+	uint4 *instance_attr_map = attr_map + attr_map_stride*scene->objects.size();
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		size_t num_instances = scene->objects[i]->instances.size();
+
+		for(size_t j = 0; j < num_instances; j++) {
+			memcpy(instance_attr_map, attr_map + attr_map_stride*i, sizeof(uint4)*attr_map_stride);
+			instance_attr_map += attr_map_stride;
+		}
+	}
+
 	/* copy to device */
 	dscene->data.bvh.attributes_map_stride = attr_map_stride;
 	device->tex_alloc("__attributes_map", dscene->attributes_map);
@@ -1764,15 +1906,31 @@ void MeshManager::device_update_mesh(Device *device,
 	if(curve_size != 0) {
 		progress.set_status("Updating Mesh", "Copying Strands to device");
 
-		float4 *curve_keys = dscene->curve_keys.resize(curve_key_size);
+		/* full precision keys take four floats */
+		size_t key_stride = (scene->curve_system_manager->use_compact_keys)? 2: 4;
+
+		uint *curve_keys = dscene->curve_keys.resize(curve_key_size * key_stride);
 		float4 *curves = dscene->curves.resize(curve_size);
+		float4 *curve_bounds = dscene->curve_bounds.resize(curve_size);
 
 		foreach(Mesh *mesh, scene->meshes) {
-			mesh->pack_curves(scene, &curve_keys[mesh->curvekey_offset], &curves[mesh->curve_offset], mesh->curvekey_offset);
+			mesh->pack_curves(scene,
+			                  &curve_keys[mesh->curvekey_offset * key_stride],
+			                  &curves[mesh->curve_offset],
+			                  &curve_bounds[mesh->curve_offset],
+			                  mesh->curvekey_offset);
 			if(progress.get_cancel()) return;
 		}
 
+		VLOG(1) << "Curve keys memory usage: "
+		        << string_human_readable_size(dscene->curve_keys.memory_size() +
+		                                      dscene->curve_bounds.memory_size())
+		        << " (uncompressed "
+		        << string_human_readable_size(curve_key_size * sizeof(float4))
+		        << ").";
+
 		device->tex_alloc("__curve_keys", dscene->curve_keys);
+		device->tex_alloc("__curve_bounds", dscene->curve_bounds);
 		device->tex_alloc("__curves", dscene->curves);
 	}
 
@@ -1820,6 +1978,8 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 	BVHParams bparams;
 	bparams.top_level = true;
 	bparams.use_qbvh = scene->params.use_qbvh;
+	bparams.use_cache = scene->params.use_bvh_cache;
+	bparams.cache_size = scene->params.bvh_cache_size;
 	bparams.use_spatial_split = scene->params.use_bvh_spatial_split;
 	bparams.use_unaligned_nodes = dscene->data.bvh.have_curves &&
 	                              scene->params.use_bvh_unaligned_nodes;
@@ -1944,7 +2104,7 @@ void MeshManager::device_update_displacement_images(Device *device,
 			}
 		}
 	}
-	image_manager->device_prepare_update(dscene);
+	image_manager->device_prepare_update(device, dscene, scene);
 	foreach(int slot, bump_images) {
 		pool.push(function_bind(&ImageManager::device_update_slot,
 		                        image_manager,
@@ -1979,6 +2139,11 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 				mesh->add_undisplaced();
 			}
 
+			if(mesh->num_curves() && scene->curve_system_manager->use_compact_keys) {
+				mesh->quantize_curve_keys();
+				mesh->compute_bounds();
+			}
+
 			if(progress.get_cancel()) return;
 		}
 	}
@@ -1995,6 +2160,45 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	/* Scale dicing rates so the estimated number of micropolygons of all
+	 * subdivided meshes stays within the budget. */
+	float dicing_rate_scale = 1.0f;
+
+	if(total_tess_needed && scene->params.micropolygon_budget > 0) {
+		size_t budget = (size_t)scene->params.micropolygon_budget * 1000000;
+		size_t num_tessellated = 0;
+		size_t num_estimated = 0;
+
+		progress.set_status("Updating Mesh", "Estimating tessellation");
+
+		foreach(Mesh *mesh, scene->meshes) {
+			if(mesh->subdivision_type == Mesh::SUBDIVISION_NONE || !mesh->subd_params) {
+				continue;
+			}
+
+			if(mesh->need_update && mesh->num_subd_verts == 0) {
+				DiagSplit dsplit(*mesh->subd_params);
+				num_estimated += mesh->estimate_tessellation(&dsplit);
+			}
+			else {
+				num_tessellated += mesh->num_triangles();
+			}
+		}
+
+		/* Meshes which are already tessellated are kept as they are. */
+		size_t remaining = (budget > num_tessellated)? budget - num_tessellated: 1;
+
+		if(num_estimated > remaining) {
+			dicing_rate_scale = sqrtf((float)num_estimated / (float)remaining);
+		}
+
+		VLOG(1) << "Estimated " << num_estimated << " micropolygons for "
+		        << total_tess_needed << " meshes, budget "
+		        << remaining << ", dicing rate scale " << dicing_rate_scale << ".";
+
+		if(progress.get_cancel()) return;
+	}
+
 	size_t i = 0;
 	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update &&
@@ -2010,7 +2214,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 			progress.set_status("Updating Mesh", msg);
 
-			DiagSplit dsplit(*mesh->subd_params);
+			SubdParams subd_params = *mesh->subd_params;
+			subd_params.dicing_rate *= dicing_rate_scale;
+
+			DiagSplit dsplit(subd_params);
 			mesh->tessellate(&dsplit);
 
 			i++;
@@ -2086,6 +2293,7 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		}
 	}
 
+	double bvh_start_time = time_dt();
 	TaskPool pool;
 
 	i = 0;
@@ -2109,6 +2317,8 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 	VLOG(2) << "Objects BVH build pool statistics:\n"
 	        << summary.full_report();
 
+	scene->update_times.bvh += time_dt() - bvh_start_time;
+
 	foreach(Shader *shader, scene->shaders) {
 		shader->need_update_attributes = false;
 	}
@@ -2128,7 +2338,10 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	if(progress.get_cancel()) return;
 
-	device_update_bvh(device, dscene, scene, progress);
+	{
+		scoped_accumulate_timer timer(&scene->update_times.bvh);
+		device_update_bvh(device, dscene, scene, progress);
+	}
 	if(progress.get_cancel()) return;
 
 	device_update_mesh(device, dscene, scene, false, progress);
@@ -2166,6 +2379,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	device->tex_free(dscene->tri_patch_uv);
 	device->tex_free(dscene->curves);
 	device->tex_free(dscene->curve_keys);
+	device->tex_free(dscene->curve_bounds);
 	device->tex_free(dscene->patches);
 	device->tex_free(dscene->attributes_map);
 	device->tex_free(dscene->attributes_float);
@@ -2188,6 +2402,7 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->tri_patch_uv.clear();
 	dscene->curves.clear();
 	dscene->curve_keys.clear();
+	dscene->curve_bounds.clear();
 	dscene->patches.clear();
 	dscene->attributes_map.clear();
 	dscene->attributes_float.clear();
@@ -43,6 +43,7 @@ class SceneParams;
 class AttributeRequest;
 struct SubdParams;
 class DiagSplit;
+class LinearQuadPatch;
 struct PackedPatchTable;
 
 /* Mesh */
@@ -138,6 +139,18 @@ public:
 		                            size_t k0, size_t k1,
 		                            size_t k2, size_t k3,
 		                            float4 r_keys[4]) const;
+
+		/* Quantization of the keys for the compact device storage. */
+		void compact_bounds(const float3 *curve_keys,
+		                    const float *curve_radius,
+		                    float4 *r_bounds,
+		                    float *r_radius_scale) const;
+		void compact_key(const float3 *curve_keys,
+		                 const float *curve_radius,
+		                 const float4 bounds,
+		                 const float radius_scale,
+		                 int k,
+		                 uint r_key[2]) const;
 	};
 
 	Curve get_curve(size_t i) const
@@ -271,6 +284,7 @@ public:
 	void add_face_normals();
 	void add_vertex_normals();
 	void add_undisplaced();
+	void quantize_curve_keys();
 
 	void pack_normals(Scene *scene, uint *shader, float4 *vnormal);
 	void pack_verts(const vector<uint>& tri_prim_index,
@@ -279,7 +293,11 @@ public:
 	                float2 *tri_patch_uv,
 	                size_t vert_offset,
 	                size_t tri_offset);
-	void pack_curves(Scene *scene, float4 *curve_key_co, float4 *curve_data, size_t curvekey_offset);
+	void pack_curves(Scene *scene,
+	                 uint *curve_key_data,
+	                 float4 *curve_data,
+	                 float4 *curve_bounds,
+	                 size_t curvekey_offset);
 	void pack_patches(uint *patch_data, uint vert_offset, uint face_offset, uint corner_offset);
 
 	void compute_bvh(DeviceScene *dscene,
@@ -310,6 +328,14 @@ public:
 	bool is_instanced() const;
 
 	void tessellate(DiagSplit *split);
+
+	/* Approximate number of triangles tessellate() creates, without
+	 * evaluating the limit surface. */
+	size_t estimate_tessellation(DiagSplit *split);
+
+protected:
+	void linear_quad_patch(int f, LinearQuadPatch *patch);
+	void linear_ngon_patch(int f, int corner, LinearQuadPatch *patch);
 };
 
 /* Mesh Manager */
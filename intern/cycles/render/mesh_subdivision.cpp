@@ -24,6 +24,7 @@
 
 #include "util/util_foreach.h"
 #include "util/util_algorithm.h"
+#include "util/util_task.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -335,6 +336,184 @@ struct OsdPatch : Patch {
 
 #endif
 
+/* Tessellation is done in two parallel passes over chunks of consecutive
+ * subpatches: splitting into subpatches with edge factors, then dicing each
+ * chunk into its own range of the mesh arrays once the number of verts and
+ * triangles of all chunks is known. Chunks keep the order of the serial code,
+ * so the resulting mesh is the same regardless of the number of threads. */
+
+#define TESSELLATE_CHUNK_SIZE 64
+
+static void tessellate_split_task(DiagSplit *split,
+                                  QuadDice::SubPatch *subpatches,
+                                  size_t num_subpatches)
+{
+	for(size_t i = 0; i < num_subpatches; i++) {
+		split->split_quad(subpatches[i].patch, &subpatches[i]);
+	}
+}
+
+static void tessellate_dice_task(DiagSplit *split,
+                                 size_t vert_offset,
+                                 size_t tri_offset)
+{
+	QuadDice dice(split->params);
+	dice.set_offset(vert_offset, tri_offset);
+
+	for(size_t i = 0; i < split->subpatches_quad.size(); i++) {
+		dice.dice(split->subpatches_quad[i], split->edgefactors_quad[i]);
+	}
+}
+
+static void tessellate_quad_subpatches(Patch *patch,
+                                       vector<QuadDice::SubPatch>& subpatches)
+{
+	/* Quad faces need to be split at least once to line up with split ngons, we do this
+	 * here in this manner because if we do it later edge factors may end up slightly off.
+	 */
+	QuadDice::SubPatch subpatch;
+	subpatch.patch = patch;
+
+	subpatch.P00 = make_float2(0.0f, 0.0f);
+	subpatch.P10 = make_float2(0.5f, 0.0f);
+	subpatch.P01 = make_float2(0.0f, 0.5f);
+	subpatch.P11 = make_float2(0.5f, 0.5f);
+	subpatches.push_back(subpatch);
+
+	subpatch.P00 = make_float2(0.5f, 0.0f);
+	subpatch.P10 = make_float2(1.0f, 0.0f);
+	subpatch.P01 = make_float2(0.5f, 0.5f);
+	subpatch.P11 = make_float2(1.0f, 0.5f);
+	subpatches.push_back(subpatch);
+
+	subpatch.P00 = make_float2(0.0f, 0.5f);
+	subpatch.P10 = make_float2(0.5f, 0.5f);
+	subpatch.P01 = make_float2(0.0f, 1.0f);
+	subpatch.P11 = make_float2(0.5f, 1.0f);
+	subpatches.push_back(subpatch);
+
+	subpatch.P00 = make_float2(0.5f, 0.5f);
+	subpatch.P10 = make_float2(1.0f, 0.5f);
+	subpatch.P01 = make_float2(0.5f, 1.0f);
+	subpatch.P11 = make_float2(1.0f, 1.0f);
+	subpatches.push_back(subpatch);
+}
+
+static void tessellate_ngon_subpatch(Patch *patch,
+                                     vector<QuadDice::SubPatch>& subpatches)
+{
+	QuadDice::SubPatch subpatch;
+	subpatch.patch = patch;
+	subpatch.P00 = make_float2(0.0f, 0.0f);
+	subpatch.P10 = make_float2(1.0f, 0.0f);
+	subpatch.P01 = make_float2(0.0f, 1.0f);
+	subpatch.P11 = make_float2(1.0f, 1.0f);
+	subpatches.push_back(subpatch);
+}
+
+void Mesh::linear_quad_patch(int f, LinearQuadPatch *patch)
+{
+	SubdFace& face = subd_faces[f];
+	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+	float3 *vN = attr_vN->data_float3();
+
+	float3 *hull = patch->hull;
+	float3 *normals = patch->normals;
+
+	patch->patch_index = face.ptex_offset;
+	patch->shader = face.shader;
+
+	for(int i = 0; i < 4; i++) {
+		hull[i] = verts[subd_face_corners[face.start_corner+i]];
+	}
+
+	if(face.smooth) {
+		for(int i = 0; i < 4; i++) {
+			normals[i] = vN[subd_face_corners[face.start_corner+i]];
+		}
+	}
+	else {
+		float3 N = face.normal(this);
+		for(int i = 0; i < 4; i++) {
+			normals[i] = N;
+		}
+	}
+
+	swap(hull[2], hull[3]);
+	swap(normals[2], normals[3]);
+}
+
+void Mesh::linear_ngon_patch(int f, int corner, LinearQuadPatch *patch)
+{
+	SubdFace& face = subd_faces[f];
+	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
+	float3 *vN = attr_vN->data_float3();
+
+	float3 center_vert = make_float3(0.0f, 0.0f, 0.0f);
+	float3 center_normal = make_float3(0.0f, 0.0f, 0.0f);
+
+	float inv_num_corners = 1.0f/float(face.num_corners);
+	for(int i = 0; i < face.num_corners; i++) {
+		center_vert += verts[subd_face_corners[face.start_corner + i]] * inv_num_corners;
+		center_normal += vN[subd_face_corners[face.start_corner + i]] * inv_num_corners;
+	}
+
+	float3 *hull = patch->hull;
+	float3 *normals = patch->normals;
+
+	patch->patch_index = face.ptex_offset + corner;
+	patch->shader = face.shader;
+
+	hull[0] = verts[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
+	hull[1] = verts[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
+	hull[2] = verts[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
+	hull[3] = center_vert;
+
+	hull[1] = (hull[1] + hull[0]) * 0.5;
+	hull[2] = (hull[2] + hull[0]) * 0.5;
+
+	if(face.smooth) {
+		normals[0] = vN[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
+		normals[1] = vN[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
+		normals[2] = vN[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
+		normals[3] = center_normal;
+
+		normals[1] = (normals[1] + normals[0]) * 0.5;
+		normals[2] = (normals[2] + normals[0]) * 0.5;
+	}
+	else {
+		float3 N = face.normal(this);
+		for(int i = 0; i < 4; i++) {
+			normals[i] = N;
+		}
+	}
+}
+
+size_t Mesh::estimate_tessellation(DiagSplit *split)
+{
+	/* Estimate from the linear patches of the cage, which is close enough
+	 * to the limit surface for budgeting. */
+	size_t num_tris = 0;
+
+	for(int f = 0; f < subd_faces.size(); f++) {
+		SubdFace& face = subd_faces[f];
+		LinearQuadPatch patch;
+
+		if(face.is_quad()) {
+			linear_quad_patch(f, &patch);
+			num_tris += split->estimate_triangles(&patch);
+		}
+		else {
+			for(int corner = 0; corner < face.num_corners; corner++) {
+				linear_ngon_patch(f, corner, &patch);
+				num_tris += split->estimate_triangles(&patch);
+			}
+		}
+	}
+
+	return num_tris;
+}
+
 void Mesh::tessellate(DiagSplit *split)
 {
 #ifdef WITH_OPENSUBDIV
@@ -362,149 +541,126 @@ void Mesh::tessellate(DiagSplit *split)
 
 	int num_faces = subd_faces.size();
 
-	Attribute *attr_vN = subd_attributes.find(ATTR_STD_VERTEX_NORMAL);
-	float3* vN = attr_vN->data_float3();
+	/* One patch per quad and per ngon corner, allocated up front so they
+	 * can be referenced by subpatches during the parallel passes. */
+	size_t num_patches = 0;
+	size_t num_quads = 0;
 
 	for(int f = 0; f < num_faces; f++) {
 		SubdFace& face = subd_faces[f];
 
 		if(face.is_quad()) {
-			/* quad */
-			QuadDice::SubPatch subpatch;
+			num_patches++;
+			num_quads++;
+		}
+		else {
+			num_patches += face.num_corners;
+		}
+	}
 
-			LinearQuadPatch quad_patch;
+	vector<LinearQuadPatch> linear_patches;
 #ifdef WITH_OPENSUBDIV
-			OsdPatch osd_patch(&osd_data);
+	vector<OsdPatch> osd_patches;
 
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				osd_patch.patch_index = face.ptex_offset;
+	if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+		osd_patches.resize(num_patches, OsdPatch(&osd_data));
+	}
+	else
+#endif
+	{
+		linear_patches.resize(num_patches);
+	}
+
+	vector<QuadDice::SubPatch> subpatches;
+	subpatches.reserve(num_patches + 3*num_quads);
+
+	size_t p = 0;
+	for(int f = 0; f < num_faces; f++) {
+		SubdFace& face = subd_faces[f];
+		int num_face_patches = face.is_quad()? 1: face.num_corners;
 
-				subpatch.patch = &osd_patch;
+		for(int corner = 0; corner < num_face_patches; corner++, p++) {
+			Patch *patch;
+
+#ifdef WITH_OPENSUBDIV
+			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
+				patch = &osd_patches[p];
+				patch->patch_index = face.ptex_offset + corner;
+				patch->shader = face.shader;
 			}
 			else
 #endif
 			{
-				float3 *hull = quad_patch.hull;
-				float3 *normals = quad_patch.normals;
-
-				quad_patch.patch_index = face.ptex_offset;
-
-				for(int i = 0; i < 4; i++) {
-					hull[i] = verts[subd_face_corners[face.start_corner+i]];
-				}
-
-				if(face.smooth) {
-					for(int i = 0; i < 4; i++) {
-						normals[i] = vN[subd_face_corners[face.start_corner+i]];
-					}
+				if(face.is_quad()) {
+					linear_quad_patch(f, &linear_patches[p]);
 				}
 				else {
-					float3 N = face.normal(this);
-					for(int i = 0; i < 4; i++) {
-						normals[i] = N;
-					}
+					linear_ngon_patch(f, corner, &linear_patches[p]);
 				}
 
-				swap(hull[2], hull[3]);
-				swap(normals[2], normals[3]);
-
-				subpatch.patch = &quad_patch;
+				patch = &linear_patches[p];
 			}
 
-			subpatch.patch->shader = face.shader;
-
-			/* Quad faces need to be split at least once to line up with split ngons, we do this
-			 * here in this manner because if we do it later edge factors may end up slightly off.
-			 */
-			subpatch.P00 = make_float2(0.0f, 0.0f);
-			subpatch.P10 = make_float2(0.5f, 0.0f);
-			subpatch.P01 = make_float2(0.0f, 0.5f);
-			subpatch.P11 = make_float2(0.5f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.0f);
-			subpatch.P10 = make_float2(1.0f, 0.0f);
-			subpatch.P01 = make_float2(0.5f, 0.5f);
-			subpatch.P11 = make_float2(1.0f, 0.5f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.0f, 0.5f);
-			subpatch.P10 = make_float2(0.5f, 0.5f);
-			subpatch.P01 = make_float2(0.0f, 1.0f);
-			subpatch.P11 = make_float2(0.5f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
-
-			subpatch.P00 = make_float2(0.5f, 0.5f);
-			subpatch.P10 = make_float2(1.0f, 0.5f);
-			subpatch.P01 = make_float2(0.5f, 1.0f);
-			subpatch.P11 = make_float2(1.0f, 1.0f);
-			split->split_quad(subpatch.patch, &subpatch);
+			if(face.is_quad()) {
+				tessellate_quad_subpatches(patch, subpatches);
+			}
+			else {
+				tessellate_ngon_subpatch(patch, subpatches);
+			}
 		}
-		else {
-			/* ngon */
-#ifdef WITH_OPENSUBDIV
-			if(subdivision_type == SUBDIVISION_CATMULL_CLARK) {
-				OsdPatch patch(&osd_data);
+	}
 
-				patch.shader = face.shader;
+	/* split */
+	size_t num_chunks = divide_up(subpatches.size(), TESSELLATE_CHUNK_SIZE);
+	vector<DiagSplit> splits(num_chunks, *split);
 
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					patch.patch_index = face.ptex_offset + corner;
+	TaskPool pool;
 
-					split->split_quad(&patch);
-				}
-			}
-			else
-#endif
-			{
-				float3 center_vert = make_float3(0.0f, 0.0f, 0.0f);
-				float3 center_normal = make_float3(0.0f, 0.0f, 0.0f);
+	for(size_t chunk = 0; chunk < num_chunks; chunk++) {
+		size_t start = chunk*TESSELLATE_CHUNK_SIZE;
+		size_t num = min(subpatches.size() - start, (size_t)TESSELLATE_CHUNK_SIZE);
 
-				float inv_num_corners = 1.0f/float(face.num_corners);
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					center_vert += verts[subd_face_corners[face.start_corner + corner]] * inv_num_corners;
-					center_normal += vN[subd_face_corners[face.start_corner + corner]] * inv_num_corners;
-				}
+		pool.push(function_bind(&tessellate_split_task,
+		                        &splits[chunk],
+		                        &subpatches[start],
+		                        num), false);
+	}
 
-				for(int corner = 0; corner < face.num_corners; corner++) {
-					LinearQuadPatch patch;
-					float3 *hull = patch.hull;
-					float3 *normals = patch.normals;
+	pool.wait_work();
 
-					patch.patch_index = face.ptex_offset + corner;
+	/* count verts and triangles of every chunk */
+	vector<size_t> chunk_vert_offset(num_chunks + 1, 0);
+	vector<size_t> chunk_tri_offset(num_chunks + 1, 0);
 
-					patch.shader = face.shader;
+	for(size_t chunk = 0; chunk < num_chunks; chunk++) {
+		DiagSplit& chunk_split = splits[chunk];
+		size_t num_verts = 0, num_tris = 0;
 
-					hull[0] = verts[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
-					hull[1] = verts[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
-					hull[2] = verts[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
-					hull[3] = center_vert;
+		for(size_t i = 0; i < chunk_split.edgefactors_quad.size(); i++) {
+			size_t sub_verts, sub_tris;
+			QuadDice::count(chunk_split.edgefactors_quad[i], &sub_verts, &sub_tris);
 
-					hull[1] = (hull[1] + hull[0]) * 0.5;
-					hull[2] = (hull[2] + hull[0]) * 0.5;
+			num_verts += sub_verts;
+			num_tris += sub_tris;
+		}
 
-					if(face.smooth) {
-						normals[0] = vN[subd_face_corners[face.start_corner + mod(corner + 0, face.num_corners)]];
-						normals[1] = vN[subd_face_corners[face.start_corner + mod(corner + 1, face.num_corners)]];
-						normals[2] = vN[subd_face_corners[face.start_corner + mod(corner - 1, face.num_corners)]];
-						normals[3] = center_normal;
+		chunk_vert_offset[chunk + 1] = chunk_vert_offset[chunk] + num_verts;
+		chunk_tri_offset[chunk + 1] = chunk_tri_offset[chunk] + num_tris;
+	}
 
-						normals[1] = (normals[1] + normals[0]) * 0.5;
-						normals[2] = (normals[2] + normals[0]) * 0.5;
-					}
-					else {
-						float3 N = face.normal(this);
-						for(int i = 0; i < 4; i++) {
-							normals[i] = N;
-						}
-					}
+	/* dice */
+	EdgeDice edge_dice(split->params);
+	edge_dice.reserve(chunk_vert_offset[num_chunks], chunk_tri_offset[num_chunks]);
 
-					split->split_quad(&patch);
-				}
-			}
-		}
+	for(size_t chunk = 0; chunk < num_chunks; chunk++) {
+		pool.push(function_bind(&tessellate_dice_task,
+		                        &splits[chunk],
+		                        edge_dice.vert_offset + chunk_vert_offset[chunk],
+		                        edge_dice.tri_offset + chunk_tri_offset[chunk]), false);
 	}
 
+	pool.wait_work();
+
 	/* interpolate center points for attributes */
 	foreach(Attribute& attr, subd_attributes.attributes) {
 #ifdef WITH_OPENSUBDIV
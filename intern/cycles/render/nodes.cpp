@@ -28,6 +28,7 @@
 #include "util/util_sky_model.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_transform.h"
 
 CCL_NAMESPACE_BEGIN
@@ -294,13 +295,19 @@ void ImageTextureNode::attributes(Shader *shader, AttributeRequestSet *attribute
 	ShaderNode::attributes(shader, attributes);
 }
 
-void ImageTextureNode::compile(SVMCompiler& compiler)
+void ImageTextureNode::hash(MD5Hash& md5)
 {
-	ShaderInput *vector_in = input("Vector");
-	ShaderOutput *color_out = output("Color");
-	ShaderOutput *alpha_out = output("Alpha");
+	ShaderNode::hash(md5);
 
-	image_manager = compiler.image_manager;
+	/* The slot is compiled into the program. */
+	md5.append((const uint8_t*)&builtin_data, sizeof(builtin_data));
+	md5.append((const uint8_t*)&animated, sizeof(animated));
+	md5.append((const uint8_t*)&slot, sizeof(slot));
+}
+
+void ImageTextureNode::add_images(ImageManager *image_manager_)
+{
+	image_manager = image_manager_;
 	if(is_float == -1) {
 		bool is_float_bool;
 		slot = image_manager->add_image(filename.string(),
@@ -314,9 +321,41 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 		                                use_alpha);
 		is_float = (int)is_float_bool;
 	}
+}
+
+/* Whether the image is looked up with the default UV map, which is the only
+ * texture coordinate the kernel has derivatives for. */
+static bool image_vector_is_default_uv(ShaderInput *vector_in, TextureMapping& tex_mapping)
+{
+	if(!tex_mapping.skip() || vector_in->link == NULL)
+		return false;
+
+	ShaderNode *node = vector_in->link->parent;
+
+	if(node->type == TextureCoordinateNode::node_type) {
+		TextureCoordinateNode *texco = (TextureCoordinateNode*)node;
+		return vector_in->link->name() == "UV" && !texco->from_dupli;
+	}
+	else if(node->type == UVMapNode::node_type) {
+		UVMapNode *uvmap = (UVMapNode*)node;
+		return uvmap->attribute == "" && !uvmap->from_dupli;
+	}
+
+	return false;
+}
+
+void ImageTextureNode::compile(SVMCompiler& compiler)
+{
+	ShaderInput *vector_in = input("Vector");
+	ShaderOutput *color_out = output("Color");
+	ShaderOutput *alpha_out = output("Alpha");
+
+	add_images(compiler.image_manager);
 
 	if(slot != -1) {
 		int srgb = (is_linear || color_space != NODE_COLOR_SPACE_COLOR)? 0: 1;
+		int use_uv_derivatives = (projection == NODE_IMAGE_PROJ_FLAT &&
+		                          image_vector_is_default_uv(vector_in, tex_mapping))? 1: 0;
 		int vector_offset = tex_mapping.compile_begin(compiler, vector_in);
 
 		if(projection != NODE_IMAGE_PROJ_BOX) {
@@ -327,7 +366,7 @@ void ImageTextureNode::compile(SVMCompiler& compiler)
 					compiler.stack_assign_if_linked(color_out),
 					compiler.stack_assign_if_linked(alpha_out),
 					srgb),
-				projection);
+				compiler.encode_uchar4(projection, use_uv_derivatives));
 		}
 		else {
 			compiler.add_node(NODE_TEX_IMAGE_BOX,
@@ -492,13 +531,18 @@ void EnvironmentTextureNode::attributes(Shader *shader, AttributeRequestSet *att
 	ShaderNode::attributes(shader, attributes);
 }
 
-void EnvironmentTextureNode::compile(SVMCompiler& compiler)
+void EnvironmentTextureNode::hash(MD5Hash& md5)
 {
-	ShaderInput *vector_in = input("Vector");
-	ShaderOutput *color_out = output("Color");
-	ShaderOutput *alpha_out = output("Alpha");
+	ShaderNode::hash(md5);
 
-	image_manager = compiler.image_manager;
+	md5.append((const uint8_t*)&builtin_data, sizeof(builtin_data));
+	md5.append((const uint8_t*)&animated, sizeof(animated));
+	md5.append((const uint8_t*)&slot, sizeof(slot));
+}
+
+void EnvironmentTextureNode::add_images(ImageManager *image_manager_)
+{
+	image_manager = image_manager_;
 	if(slot == -1) {
 		bool is_float_bool;
 		slot = image_manager->add_image(filename.string(),
@@ -512,6 +556,15 @@ void EnvironmentTextureNode::compile(SVMCompiler& compiler)
 		                                use_alpha);
 		is_float = (int)is_float_bool;
 	}
+}
+
+void EnvironmentTextureNode::compile(SVMCompiler& compiler)
+{
+	ShaderInput *vector_in = input("Vector");
+	ShaderOutput *color_out = output("Color");
+	ShaderOutput *alpha_out = output("Alpha");
+
+	add_images(compiler.image_manager);
 
 	if(slot != -1) {
 		int srgb = (is_linear || color_space != NODE_COLOR_SPACE_COLOR)? 0: 1;
@@ -1406,6 +1459,33 @@ void PointDensityTextureNode::attributes(Shader *shader,
 	ShaderNode::attributes(shader, attributes);
 }
 
+void PointDensityTextureNode::hash(MD5Hash& md5)
+{
+	ShaderNode::hash(md5);
+
+	md5.append((const uint8_t*)&builtin_data, sizeof(builtin_data));
+	md5.append((const uint8_t*)&slot, sizeof(slot));
+}
+
+void PointDensityTextureNode::add_images(ImageManager *image_manager_)
+{
+	/* Only load the image when it is actually read. */
+	if(output("Density")->links.empty() && output("Color")->links.empty()) {
+		return;
+	}
+
+	image_manager = image_manager_;
+	if(slot == -1) {
+		bool is_float, is_linear;
+		slot = image_manager->add_image(filename.string(), builtin_data,
+		                                false, 0,
+		                                is_float, is_linear,
+		                                interpolation,
+		                                EXTENSION_CLIP,
+		                                true);
+	}
+}
+
 void PointDensityTextureNode::compile(SVMCompiler& compiler)
 {
 	ShaderInput *vector_in = input("Vector");
@@ -1415,18 +1495,8 @@ void PointDensityTextureNode::compile(SVMCompiler& compiler)
 	const bool use_density = !density_out->links.empty();
 	const bool use_color = !color_out->links.empty();
 
-	image_manager = compiler.image_manager;
-
 	if(use_density || use_color) {
-		if(slot == -1) {
-			bool is_float, is_linear;
-			slot = image_manager->add_image(filename.string(), builtin_data,
-			                                false, 0,
-			                                is_float, is_linear,
-			                                interpolation,
-			                                EXTENSION_CLIP,
-			                                true);
-		}
+		add_images(compiler.image_manager);
 
 		if(slot != -1) {
 			compiler.stack_assign(vector_in);
@@ -104,6 +104,9 @@ public:
 		       builtin_data == image_node.builtin_data &&
 		       animated == image_node.animated;
 	}
+
+	virtual void hash(MD5Hash& md5);
+	virtual void add_images(ImageManager *image_manager);
 };
 
 class EnvironmentTextureNode : public ImageSlotTextureNode {
@@ -133,6 +136,9 @@ public:
 		       builtin_data == env_node.builtin_data &&
 		       animated == env_node.animated;
 	}
+
+	virtual void hash(MD5Hash& md5);
+	virtual void add_images(ImageManager *image_manager);
 };
 
 class SkyTextureNode : public TextureNode {
@@ -275,6 +281,9 @@ public:
 		return ShaderNode::equals(other) &&
 		       builtin_data == point_dendity_node.builtin_data;
 	}
+
+	virtual void hash(MD5Hash& md5);
+	virtual void add_images(ImageManager *image_manager);
 };
 
 class MappingNode : public ShaderNode {
@@ -23,6 +23,7 @@
 #include "render/particles.h"
 #include "render/scene.h"
 
+#include "util/util_algorithm.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
 #include "util/util_map.h"
@@ -122,6 +123,12 @@ void Object::compute_bounds(bool motion_blur)
 	}
 }
 
+BoundBox Object::instance_bounds(const ObjectInstance& instance) const
+{
+	/* meshes of objects with instances never have their transform applied */
+	return mesh->bounds.transformed(&instance.tfm);
+}
+
 void Object::apply_transform(bool apply_to_motion)
 {
 	if(!mesh || tfm == transform_identity())
@@ -274,8 +281,20 @@ ObjectManager::~ObjectManager()
 {
 }
 
+size_t ObjectManager::num_device_objects(Scene *scene)
+{
+	size_t num_objects = scene->objects.size();
+
+	foreach(Object *ob, scene->objects) {
+		num_objects += ob->instances.size();
+	}
+
+	return num_objects;
+}
+
 void ObjectManager::device_update_object_transform(UpdateObejctTransformState *state,
                                                    Object *ob,
+                                                   const ObjectInstance *instance,
                                                    int object_index)
 {
 	float4 *objects = state->objects;
@@ -285,8 +304,10 @@ void ObjectManager::device_update_object_transform(UpdateObejctTransformState *s
 	uint flag = 0;
 
 	/* Compute transformations. */
-	Transform tfm = ob->tfm;
+	Transform tfm = (instance)? instance->tfm: ob->tfm;
 	Transform itfm = transform_inverse(tfm);
+	/* Instances are never motion blurred. */
+	bool use_motion = ob->use_motion && !instance;
 
 	/* Compute surface area. for uniform scale we can do avoid the many
 	 * transform calls and share computation for instances.
@@ -296,7 +317,8 @@ void ObjectManager::device_update_object_transform(UpdateObejctTransformState *s
 	float uniform_scale;
 	float surface_area = 0.0f;
 	float pass_id = ob->pass_id;
-	float random_number = (float)ob->random_id * (1.0f/(float)0xFFFFFFFF);
+	uint random_id = (instance)? instance->random_id: ob->random_id;
+	float random_number = (float)random_id * (1.0f/(float)0xFFFFFFFF);
 	int particle_index = (ob->particle_system)
 	        ? ob->particle_index + state->particle_offset[ob->particle_system]
 	        : 0;
@@ -365,11 +387,11 @@ void ObjectManager::device_update_object_transform(UpdateObejctTransformState *s
 
 		/* In case of missing motion information for previous/next frame,
 		 * assume there is no motion. */
-		if(!ob->use_motion || mtfm.pre == transform_empty()) {
-			mtfm.pre = ob->tfm;
+		if(!use_motion || mtfm.pre == transform_empty()) {
+			mtfm.pre = tfm;
 		}
-		if(!ob->use_motion || mtfm.post == transform_empty()) {
-			mtfm.post = ob->tfm;
+		if(!use_motion || mtfm.post == transform_empty()) {
+			mtfm.post = tfm;
 		}
 
 		if(!mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION)) {
@@ -385,7 +407,7 @@ void ObjectManager::device_update_object_transform(UpdateObejctTransformState *s
 	}
 #ifdef __OBJECT_MOTION__
 	else if(state->need_motion == Scene::MOTION_BLUR) {
-		if(ob->use_motion) {
+		if(use_motion) {
 			/* decompose transformations for interpolation. */
 			DecompMotionTransform decomp;
 
@@ -407,8 +429,11 @@ void ObjectManager::device_update_object_transform(UpdateObejctTransformState *s
 	int numverts = mesh->verts.size();
 	int numkeys = mesh->curve_keys.size();
 
-	objects[offset+9] = make_float4(ob->dupli_generated[0], ob->dupli_generated[1], ob->dupli_generated[2], __int_as_float(numkeys));
-	objects[offset+10] = make_float4(ob->dupli_uv[0], ob->dupli_uv[1], __int_as_float(numsteps), __int_as_float(numverts));
+	float3 dupli_generated = (instance)? instance->dupli_generated: ob->dupli_generated;
+	float2 dupli_uv = (instance)? instance->dupli_uv: ob->dupli_uv;
+
+	objects[offset+9] = make_float4(dupli_generated[0], dupli_generated[1], dupli_generated[2], __int_as_float(numkeys));
+	objects[offset+10] = make_float4(dupli_uv[0], dupli_uv[1], __int_as_float(numsteps), __int_as_float(numverts));
 
 	/* Object flag. */
 	if(ob->use_holdout) {
@@ -434,10 +459,10 @@ bool ObjectManager::device_update_object_transform_pop_work(
 	static const int OBJECTS_PER_TASK = 32;
 	bool have_work = false;
 	state->queue_lock.lock();
-	int num_scene_objects = state->scene->objects.size();
-	if(state->queue_start_object < num_scene_objects) {
+	int num_device_objects = state->num_device_objects;
+	if(state->queue_start_object < num_device_objects) {
 		int count = min(OBJECTS_PER_TASK,
-		                num_scene_objects - state->queue_start_object);
+		                num_device_objects - state->queue_start_object);
 		*start_index = state->queue_start_object;
 		*num_objects = count;
 		state->queue_start_object += count;
@@ -455,10 +480,26 @@ void ObjectManager::device_update_object_transform_task(
 	                                              &start_index,
 	                                              &num_objects))
 	{
+		const vector<Object*>& scene_objects = state->scene->objects;
+		const vector<int>& instance_offset = state->instance_offset;
+
 		for(int i = 0; i < num_objects; ++i) {
 			const int object_index = start_index + i;
-			Object *ob = state->scene->objects[object_index];
-			device_update_object_transform(state, ob, object_index);
+
+			if(object_index < scene_objects.size()) {
+				Object *ob = scene_objects[object_index];
+				device_update_object_transform(state, ob, NULL, object_index);
+			}
+			else {
+				/* Last object with instances starting at or before this
+				 * index, objects without instances share its offset. */
+				int ob_index = upper_bound(instance_offset.begin(),
+				                           instance_offset.end(),
+				                           object_index) - instance_offset.begin() - 1;
+				Object *ob = scene_objects[ob_index];
+				const ObjectInstance *instance = &ob->instances[object_index - instance_offset[ob_index]];
+				device_update_object_transform(state, ob, instance, object_index);
+			}
 		}
 	}
 }
@@ -476,10 +517,19 @@ void ObjectManager::device_update_transforms(Device *device,
 	state.scene = scene;
 	state.queue_start_object = 0;
 
+	/* Compact instances follow all scene objects. */
+	int num_objects = scene->objects.size();
+	state.instance_offset.resize(scene->objects.size());
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		state.instance_offset[i] = num_objects;
+		num_objects += scene->objects[i]->instances.size();
+	}
+	state.num_device_objects = num_objects;
+
 	state.object_flag = object_flag;
-	state.objects = dscene->objects.resize(OBJECT_SIZE*scene->objects.size());
+	state.objects = dscene->objects.resize(OBJECT_SIZE*num_objects);
 	if(state.need_motion == Scene::MOTION_PASS) {
-		state.objects_vector = dscene->objects_vector.resize(OBJECT_VECTOR_SIZE*scene->objects.size());
+		state.objects_vector = dscene->objects_vector.resize(OBJECT_VECTOR_SIZE*num_objects);
 	}
 	else {
 		state.objects_vector = NULL;
@@ -498,15 +548,21 @@ void ObjectManager::device_update_transforms(Device *device,
 	 * thread to avoid threading overhead. However, this threshold is might
 	 * need some tweaks to make mid-complex scenes optimal.
 	 */
-	if(scene->objects.size() < 64) {
+	if(num_objects < 64) {
 		int object_index = 0;
 		foreach(Object *ob, scene->objects) {
-			device_update_object_transform(&state, ob, object_index);
+			device_update_object_transform(&state, ob, NULL, object_index);
 			object_index++;
 			if(progress.get_cancel()) {
 				return;
 			}
 		}
+		foreach(Object *ob, scene->objects) {
+			foreach(const ObjectInstance& instance, ob->instances) {
+				device_update_object_transform(&state, ob, &instance, object_index);
+				object_index++;
+			}
+		}
 	}
 	else {
 		const int num_threads = TaskScheduler::num_threads();
@@ -538,7 +594,10 @@ void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *sc
 	if(!need_update)
 		return;
 
-	VLOG(1) << "Total " << scene->objects.size() << " objects.";
+	size_t num_objects = num_device_objects(scene);
+
+	VLOG(1) << "Total " << scene->objects.size() << " objects, "
+	        << num_objects - scene->objects.size() << " instances.";
 
 	device_free(device, dscene);
 
@@ -546,7 +605,7 @@ void ObjectManager::device_update(Device *device, DeviceScene *dscene, Scene *sc
 		return;
 
 	/* object info flag */
-	uint *object_flag = dscene->object_flag.resize(scene->objects.size());
+	uint *object_flag = dscene->object_flag.resize(num_objects);
 
 	/* set object transform matrices, before applying static transforms */
 	progress.set_status("Updating Objects", "Copying Transformations to device");
@@ -580,19 +639,37 @@ void ObjectManager::device_update_flags(Device *device,
 	/* object info flag */
 	uint *object_flag = dscene->object_flag.get_data();
 
-	vector<Object *> volume_objects;
-	bool has_volume_objects = false;
+	/* bounds by object index, compact instances follow all objects */
+	vector<Object *> objects;
+	vector<BoundBox> objects_bounds;
+	objects.reserve(num_device_objects(scene));
+	objects_bounds.reserve(objects.capacity());
+
 	foreach(Object *object, scene->objects) {
-		if(object->mesh->has_volume) {
+		objects.push_back(object);
+		objects_bounds.push_back(object->bounds);
+	}
+	foreach(Object *object, scene->objects) {
+		foreach(const ObjectInstance& instance, object->instances) {
+			objects.push_back(object);
+			objects_bounds.push_back((bounds_valid)? object->instance_bounds(instance): BoundBox::empty);
+		}
+	}
+
+	vector<size_t> volume_objects;
+	bool has_volume_objects = false;
+	for(size_t i = 0; i < objects.size(); i++) {
+		if(objects[i]->mesh->has_volume) {
 			if(bounds_valid) {
-				volume_objects.push_back(object);
+				volume_objects.push_back(i);
 			}
 			has_volume_objects = true;
 		}
 	}
 
-	int object_index = 0;
-	foreach(Object *object, scene->objects) {
+	for(size_t object_index = 0; object_index < objects.size(); object_index++) {
+		Object *object = objects[object_index];
+
 		if(object->mesh->has_volume) {
 			object_flag[object_index] |= SD_OBJECT_HAS_VOLUME;
 		}
@@ -607,11 +684,11 @@ void ObjectManager::device_update_flags(Device *device,
 		}
 
 		if(bounds_valid) {
-			foreach(Object *volume_object, volume_objects) {
-				if(object == volume_object) {
+			foreach(size_t volume_index, volume_objects) {
+				if(object_index == volume_index) {
 					continue;
 				}
-				if(object->bounds.intersects(volume_object->bounds)) {
+				if(objects_bounds[object_index].intersects(objects_bounds[volume_index])) {
 					object_flag[object_index] |= SD_OBJECT_INTERSECTS_VOLUME;
 					break;
 				}
@@ -623,7 +700,6 @@ void ObjectManager::device_update_flags(Device *device,
 			 */
 			object_flag[object_index] |= SD_OBJECT_INTERSECTS_VOLUME;
 		}
-		++object_index;
 	}
 
 	/* allocate object flag */
@@ -659,6 +735,22 @@ void ObjectManager::device_update_patch_map_offsets(Device *device, DeviceScene
 		object_index++;
 	}
 
+	/* compact instances share the patch map of their object */
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		size_t num_instances = scene->objects[i]->instances.size();
+
+		for(size_t j = 0; j < num_instances; j++) {
+			int offset = object_index*OBJECT_SIZE + 11;
+
+			if(objects[offset].x != objects[i*OBJECT_SIZE + 11].x) {
+				objects[offset].x = objects[i*OBJECT_SIZE + 11].x;
+				update = true;
+			}
+
+			object_index++;
+		}
+	}
+
 	if(update) {
 		device->tex_free(dscene->objects);
 		device->tex_alloc("__objects", dscene->objects);
@@ -696,12 +788,14 @@ void ObjectManager::apply_static_transforms(DeviceScene *dscene, Scene *scene, u
 	bool have_instancing = false;
 
 	foreach(Object *object, scene->objects) {
+		/* compact instances are users of the mesh as well */
+		int users = 1 + object->instances.size();
 		map<Mesh*, int>::iterator it = mesh_users.find(object->mesh);
 
 		if(it == mesh_users.end())
-			mesh_users[object->mesh] = 1;
+			mesh_users[object->mesh] = users;
 		else
-			it->second++;
+			it->second += users;
 	}
 
 	if(progress.get_cancel()) return;
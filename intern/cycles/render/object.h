@@ -36,6 +36,26 @@ class Progress;
 class Scene;
 struct Transform;
 
+/* Compact instance of an object, for the duplis of a particle system or group
+ * that only differ from the object in transform, random id and the dupli
+ * coordinates. Instances share everything else with their object, and get
+ * their own object index on the device after all scene objects. */
+
+struct ObjectInstance {
+	Transform tfm;
+	float3 dupli_generated;
+	float2 dupli_uv;
+	uint random_id;
+
+	bool operator==(const ObjectInstance& other) const
+	{
+		return tfm == other.tfm &&
+		       dupli_generated == other.dupli_generated &&
+		       dupli_uv == other.dupli_uv &&
+		       random_id == other.random_id;
+	}
+};
+
 /* Object */
 
 class Object : public Node {
@@ -60,6 +80,9 @@ public:
 
 	ParticleSystem *particle_system;
 	int particle_index;
+
+	/* Rendered in addition to the object itself, without motion. */
+	vector<ObjectInstance> instances;
 	
 	Object();
 	~Object();
@@ -67,6 +90,7 @@ public:
 	void tag_update(Scene *scene);
 
 	void compute_bounds(bool motion_blur);
+	BoundBox instance_bounds(const ObjectInstance& instance) const;
 	void apply_transform(bool apply_to_motion);
 
 	vector<float> motion_times();
@@ -88,6 +112,11 @@ public:
 	~ObjectManager();
 
 	void device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress);
+
+	/* Number of objects on the device, scene objects followed by the compact
+	 * instances of each object in the same order. */
+	size_t num_device_objects(Scene *scene);
+
 	void device_update_transforms(Device *device,
 	                              DeviceScene *dscene,
 	                              Scene *scene,
@@ -128,6 +157,9 @@ protected:
 		 */
 		map<Mesh*, float> surface_area_map;
 
+		/* Object index of the first compact instance of each object. */
+		vector<int> instance_offset;
+
 		/* Packed object arrays. Those will be filled in. */
 		uint *object_flag;
 		float4 *objects;
@@ -147,9 +179,12 @@ protected:
 
 		/* First unused object index in the queue. */
 		int queue_start_object;
+		/* Number of object indices, including compact instances. */
+		int num_device_objects;
 	};
 	void device_update_object_transform(UpdateObejctTransformState *state,
 	                                    Object *ob,
+	                                    const ObjectInstance *instance,
 	                                    const int object_index);
 	void device_update_object_transform_task(UpdateObejctTransformState *state);
 	bool device_update_object_transform_pop_work(
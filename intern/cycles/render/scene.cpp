@@ -37,6 +37,7 @@
 #include "util/util_guarded_allocator.h"
 #include "util/util_logging.h"
 #include "util/util_progress.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -73,22 +74,27 @@ Scene::~Scene()
 
 void Scene::free_memory(bool final)
 {
-	foreach(Shader *s, shaders)
-		delete s;
-	foreach(Mesh *m, meshes)
-		delete m;
-	foreach(Object *o, objects)
-		delete o;
-	foreach(Light *l, lights)
-		delete l;
-	foreach(ParticleSystem *p, particle_systems)
-		delete p;
-
-	shaders.clear();
-	meshes.clear();
-	objects.clear();
-	lights.clear();
-	particle_systems.clear();
+	/* with persistent data host side scene data is kept between renders,
+	 * so the next frame only needs to synchronize changes and can refit
+	 * mesh BVHs instead of building them from scratch */
+	if(!params.persistent_data || final) {
+		foreach(Shader *s, shaders)
+			delete s;
+		foreach(Mesh *m, meshes)
+			delete m;
+		foreach(Object *o, objects)
+			delete o;
+		foreach(Light *l, lights)
+			delete l;
+		foreach(ParticleSystem *p, particle_systems)
+			delete p;
+
+		shaders.clear();
+		meshes.clear();
+		objects.clear();
+		lights.clear();
+		particle_systems.clear();
+	}
 
 	if(device) {
 		camera->device_free(device, &dscene, this);
@@ -137,6 +143,7 @@ void Scene::device_update(Device *device_, Progress& progress)
 		device = device_;
 
 	bool print_stats = need_data_update();
+	scoped_accumulate_timer total_timer(&update_times.total);
 
 	/* The order of updates is important, because there's dependencies between
 	 * the different managers, using data computed by previous managers.
@@ -152,7 +159,10 @@ void Scene::device_update(Device *device_, Progress& progress)
 	image_manager->set_pack_images(device->info.pack_images);
 
 	progress.set_status("Updating Shaders");
-	shader_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.shaders);
+		shader_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -167,27 +177,42 @@ void Scene::device_update(Device *device_, Progress& progress)
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Meshes Flags");
-	mesh_manager->device_update_flags(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.meshes);
+		mesh_manager->device_update_flags(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects");
-	object_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.objects);
+		object_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Meshes");
-	mesh_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.meshes);
+		mesh_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Objects Flags");
-	object_manager->device_update_flags(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.objects);
+		object_manager->device_update_flags(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Images");
-	image_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.images);
+		image_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -207,7 +232,10 @@ void Scene::device_update(Device *device_, Progress& progress)
 	if(progress.get_cancel() || device->have_error()) return;
 
 	progress.set_status("Updating Lights");
-	light_manager->device_update(device, &dscene, this, progress);
+	{
+		scoped_accumulate_timer timer(&update_times.lights);
+		light_manager->device_update(device, &dscene, this, progress);
+	}
 
 	if(progress.get_cancel() || device->have_error()) return;
 
@@ -319,7 +347,13 @@ bool Scene::need_reset()
 void Scene::reset()
 {
 	shader_manager->reset(this);
-	shader_manager->add_default(this);
+
+	/* default shaders are kept along with the other shaders when using
+	 * persistent data */
+	if(shaders.empty())
+		shader_manager->add_default(this);
+	else
+		shader_manager->need_update = true;
 
 	/* ensure all objects are updated */
 	camera->tag_update();
@@ -79,7 +79,8 @@ public:
 	device_vector<float2> tri_patch_uv;
 
 	device_vector<float4> curves;
-	device_vector<float4> curve_keys;
+	device_vector<uint> curve_keys;
+	device_vector<float4> curve_bounds;
 
 	device_vector<uint> patches;
 
@@ -98,6 +99,8 @@ public:
 	device_vector<float4> light_data;
 	device_vector<float2> light_background_marginal_cdf;
 	device_vector<float2> light_background_conditional_cdf;
+	device_vector<float4> light_tree_nodes;
+	device_vector<uint> light_tree_leaf_map;
 
 	/* particles */
 	device_vector<float4> particles;
@@ -146,8 +149,22 @@ public:
 	bool use_bvh_unaligned_nodes;
 	int num_bvh_time_steps;
 	bool use_qbvh;
+	bool use_bvh_cache;
+	/* Size in megabytes, zero for no limit. */
+	int bvh_cache_size;
+	/* Cache decoded image files on disk, to skip decoding in later renders. */
+	bool use_image_cache;
+	/* Size in megabytes, zero for no limit. */
+	int image_cache_size;
 	bool persistent_data;
 	int texture_limit;
+	/* Size in megabytes, zero loads all images into memory. */
+	int texture_cache_size;
+	/* Store 3D builtin images as sparse grids, CPU only. */
+	bool use_sparse_volumes;
+	/* Micropolygons in millions adaptive subdivision may create for the
+	 * whole scene, zero for no limit. */
+	int micropolygon_budget;
 
 	SceneParams()
 	{
@@ -157,8 +174,15 @@ public:
 		use_bvh_unaligned_nodes = true;
 		num_bvh_time_steps = 0;
 		use_qbvh = false;
+		use_bvh_cache = false;
+		bvh_cache_size = 4096;
+		use_image_cache = false;
+		image_cache_size = 8192;
 		persistent_data = false;
 		texture_limit = 0;
+		texture_cache_size = 0;
+		use_sparse_volumes = false;
+		micropolygon_budget = 0;
 	}
 
 	bool modified(const SceneParams& params)
@@ -168,8 +192,50 @@ public:
 		&& use_bvh_unaligned_nodes == params.use_bvh_unaligned_nodes
 		&& num_bvh_time_steps == params.num_bvh_time_steps
 		&& use_qbvh == params.use_qbvh
+		&& use_bvh_cache == params.use_bvh_cache
+		&& bvh_cache_size == params.bvh_cache_size
+		&& use_image_cache == params.use_image_cache
+		&& image_cache_size == params.image_cache_size
 		&& persistent_data == params.persistent_data
-		&& texture_limit == params.texture_limit); }
+		&& texture_limit == params.texture_limit
+		&& texture_cache_size == params.texture_cache_size
+		&& use_sparse_volumes == params.use_sparse_volumes
+		&& micropolygon_budget == params.micropolygon_budget); }
+};
+
+/* Scene Update Times
+ *
+ * Time in seconds spent in the stages of Scene::device_update, accumulated
+ * over all updates of the scene. Used for benchmarking. */
+
+struct SceneUpdateTimes {
+	SceneUpdateTimes()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		shaders = 0.0;
+		meshes = 0.0;
+		bvh = 0.0;
+		objects = 0.0;
+		images = 0.0;
+		lights = 0.0;
+		total = 0.0;
+	}
+
+	/* Shader compilation, for SVM this includes compiling the graphs. */
+	double shaders;
+	/* Mesh attributes, displacement and BVH. */
+	double meshes;
+	/* Part of the mesh time spent building or loading BVHs. */
+	double bvh;
+	double objects;
+	/* Image loading and upload. */
+	double images;
+	double lights;
+	double total;
 };
 
 /* Scene */
@@ -213,6 +279,9 @@ public:
 	/* parameters */
 	SceneParams params;
 
+	/* timing */
+	SceneUpdateTimes update_times;
+
 	/* mutex must be locked manually by callers */
 	thread_mutex mutex;
 
@@ -17,21 +17,26 @@
 #include <string.h>
 #include <limits.h>
 
+#include "render/background.h"
 #include "render/buffers.h"
 #include "render/camera.h"
 #include "device/device.h"
+#include "render/film.h"
 #include "render/graph.h"
 #include "render/integrator.h"
+#include "render/light.h"
 #include "render/mesh.h"
 #include "render/object.h"
 #include "render/scene.h"
 #include "render/session.h"
+#include "render/shader.h"
 #include "render/bake.h"
 
 #include "util/util_foreach.h"
 #include "util/util_function.h"
 #include "util/util_logging.h"
 #include "util/util_math.h"
+#include "util/util_md5.h"
 #include "util/util_opengl.h"
 #include "util/util_task.h"
 #include "util/util_time.h"
@@ -69,6 +74,8 @@ Session::Session(const SessionParams& params_)
 
 	reset_time = 0.0;
 	last_update_time = 0.0;
+	denoise_start_time = 0.0;
+	denoise_end_time = 0.0;
 
 	delayed_reset.do_reset = false;
 	delayed_reset.samples = 0;
@@ -79,6 +86,8 @@ Session::Session(const SessionParams& params_)
 	pause = false;
 	kernels_loaded = false;
 
+	checkpoint = NULL;
+
 	/* TODO(sergey): Check if it's indeed optimal value for the split kernel. */
 	max_closure_global = 1;
 }
@@ -362,8 +371,18 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	Tile *tile;
 	int device_num = device->device_number(tile_device);
 
-	if(!tile_manager.next_tile(tile, device_num))
-		return false;
+	while(!tile_manager.next_tile(tile, device_num)) {
+		/* Instead of exiting while other threads are still rendering, wait
+		 * for their tiles to finish so the neighbors that become ready for
+		 * denoising are spread over all threads. Network devices acquire and
+		 * release tiles from a single thread, so they can't wait here. */
+		if(!tile_manager.denoising_pending() || tile_device->info.type == DEVICE_NETWORK)
+			return false;
+		if(progress.get_cancel() && params.progressive_refine == false)
+			return false;
+
+		denoising_cond.wait(tile_lock);
+	}
 	
 	/* fill render tile */
 	rtile.x = tile_manager.state.buffer.full_x + tile->x;
@@ -375,6 +394,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.resolution = tile_manager.state.resolution_divider;
 	rtile.tile_index = tile->index;
 	rtile.task = (tile->state == Tile::DENOISE)? RenderTile::DENOISE: RenderTile::PATH_TRACE;
+	rtile.acquire_time = time_dt();
 
 	tile_lock.unlock();
 
@@ -446,6 +466,22 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 	rtile.buffers = tile->buffers;
 	rtile.sample = 0;
 
+	if(checkpoint && rtile.task == RenderTile::PATH_TRACE) {
+		/* continue from the samples stored in the checkpoint, tiles with
+		 * adaptive sampling can only be restored once finished */
+		int end_sample = rtile.start_sample + rtile.num_samples;
+		int min_sample = (scene->film->adaptive_sampling_pass)? end_sample: rtile.start_sample + 1;
+		int sample = checkpoint->restore_tile(rtile, min_sample, end_sample);
+
+		if(sample) {
+			progress.add_samples((uint64_t)rtile.w*rtile.h*(sample - rtile.start_sample), sample);
+
+			rtile.start_sample = sample;
+			rtile.num_samples = end_sample - sample;
+			rtile.sample = sample;
+		}
+	}
+
 	if(store_rtile) {
 		render_tiles[tile->index] = rtile;
 		tile_lock.unlock();
@@ -462,6 +498,11 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 
 void Session::update_tile_sample(RenderTile& rtile)
 {
+	/* adaptive sampling rescales pixels once the tile is finished, so
+	 * partially rendered tiles can't be continued */
+	if(!scene->film->adaptive_sampling_pass)
+		checkpoint_tile(rtile);
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	if(update_render_tile_cb) {
@@ -477,10 +518,24 @@ void Session::update_tile_sample(RenderTile& rtile)
 
 void Session::release_tile(RenderTile& rtile)
 {
+	checkpoint_tile(rtile);
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	progress.add_finished_tile(rtile.task == RenderTile::DENOISE);
 
+	double release_time = time_dt();
+
+	if(rtile.task == RenderTile::DENOISE) {
+		if(denoise_tile_times.empty() || rtile.acquire_time < denoise_start_time)
+			denoise_start_time = rtile.acquire_time;
+		denoise_end_time = release_time;
+		denoise_tile_times.push_back(release_time - rtile.acquire_time);
+	}
+	else {
+		path_trace_tile_times.push_back(release_time - rtile.acquire_time);
+	}
+
 	bool delete_tile;
 
 	if(tile_manager.finish_tile(rtile.tile_index, delete_tile)) {
@@ -498,9 +553,132 @@ void Session::release_tile(RenderTile& rtile)
 		}
 	}
 
+	/* Wake up threads waiting for tiles to become ready for denoising. */
+	denoising_cond.notify_all();
+
 	update_status_time();
 }
 
+/* Hash of everything that affects the render result, so checkpoints of a
+ * render with different settings or scene contents are not resumed. Node
+ * inputs referencing other nodes are pointers, those are hashed as indices. */
+static string checkpoint_fingerprint(Scene *scene, BufferParams& params, int samples)
+{
+	MD5Hash md5;
+	map<Node*, int> node_index;
+
+	for(size_t i = 0; i < scene->shaders.size(); i++)
+		node_index[scene->shaders[i]] = i;
+	for(size_t i = 0; i < scene->meshes.size(); i++)
+		node_index[scene->meshes[i]] = i;
+
+	int resolution[7] = {params.full_x, params.full_y,
+	                     params.full_width, params.full_height,
+	                     params.width, params.height,
+	                     samples};
+	md5.append((const uint8_t*)resolution, sizeof(resolution));
+
+	for(size_t i = 0; i < params.passes.size(); i++) {
+		int type = params.passes[i].type;
+		md5.append((const uint8_t*)&type, sizeof(type));
+	}
+
+	/* includes the seed and sampling settings */
+	scene->integrator->hash_values(md5);
+	scene->film->hash_values(md5);
+	scene->camera->hash_values(md5);
+	scene->background->hash_values(md5);
+	int background_shader = node_index[scene->background->shader];
+	md5.append((const uint8_t*)&background_shader, sizeof(background_shader));
+
+	foreach(Shader *shader, scene->shaders) {
+		shader->hash_values(md5);
+		shader->graph->hash(md5, true);
+	}
+
+	foreach(Mesh *mesh, scene->meshes) {
+		mesh->hash_values(md5);
+
+		foreach(Shader *shader, mesh->used_shaders) {
+			int index = node_index[shader];
+			md5.append((const uint8_t*)&index, sizeof(index));
+		}
+	}
+
+	foreach(Object *object, scene->objects) {
+		object->hash_values(md5);
+		int index = node_index[object->mesh];
+		md5.append((const uint8_t*)&index, sizeof(index));
+
+		foreach(const ObjectInstance& instance, object->instances) {
+			md5.append((const uint8_t*)&instance.tfm, sizeof(instance.tfm));
+			md5.append((const uint8_t*)&instance.dupli_generated.x, sizeof(float)*3);
+			md5.append((const uint8_t*)&instance.dupli_uv, sizeof(instance.dupli_uv));
+			md5.append((const uint8_t*)&instance.random_id, sizeof(instance.random_id));
+		}
+	}
+
+	foreach(Light *light, scene->lights) {
+		light->hash_values(md5);
+		int index = node_index[light->shader];
+		md5.append((const uint8_t*)&index, sizeof(index));
+	}
+
+	return md5.get_hex();
+}
+
+void Session::checkpoint_begin()
+{
+	/* only tiles with their own buffers can be restored, without touching
+	 * tiles which are being rendered by other devices */
+	if(params.checkpoint_path.empty() || buffers || params.progressive_refine)
+		return;
+
+	string fingerprint;
+	{
+		thread_scoped_lock scene_lock(scene->mutex);
+		fingerprint = checkpoint_fingerprint(scene,
+		                                     tile_manager.params,
+		                                     tile_manager.num_samples);
+	}
+
+	checkpoint = new RenderCheckpoint(params.checkpoint_path, fingerprint);
+	checkpoint->read();
+}
+
+void Session::checkpoint_tile(RenderTile& rtile)
+{
+	if(!checkpoint || rtile.task != RenderTile::PATH_TRACE)
+		return;
+
+	/* without progressive refine all tiles render the same sample range */
+	if(rtile.sample > rtile.start_sample)
+		checkpoint->add_tile(rtile, tile_manager.state.sample);
+
+	/* only the thread which found the write due does it, the others keep
+	 * rendering meanwhile */
+	if(checkpoint->write_due(params.checkpoint_interval)) {
+		VLOG(1) << "Writing render checkpoint " << params.checkpoint_path << ".";
+		checkpoint->write();
+	}
+}
+
+void Session::checkpoint_end()
+{
+	if(!checkpoint)
+		return;
+
+	/* keep the checkpoint of renders which failed, a finished render has no
+	 * use for it anymore and one cancelled by the user is not resumed */
+	if(progress.get_error())
+		checkpoint->write();
+	else
+		checkpoint->remove();
+
+	delete checkpoint;
+	checkpoint = NULL;
+}
+
 void Session::map_neighbor_tiles(RenderTile *tiles, Device *tile_device)
 {
 	thread_scoped_lock tile_lock(tile_mutex);
@@ -768,10 +946,14 @@ void Session::run()
 		/* reset number of rendered samples */
 		progress.reset_sample();
 
+		checkpoint_begin();
+
 		if(device_use_gl)
 			run_gpu();
 		else
 			run_cpu();
+
+		checkpoint_end();
 	}
 
 	/* progress update */
@@ -802,6 +984,14 @@ void Session::reset_(BufferParams& buffer_params, int samples)
 	tile_manager.reset(buffer_params, samples);
 	progress.reset_sample();
 
+	{
+		thread_scoped_lock tile_lock(tile_mutex);
+		path_trace_tile_times.clear();
+		denoise_tile_times.clear();
+		denoise_start_time = 0.0;
+		denoise_end_time = 0.0;
+	}
+
 	bool show_progress = params.background || tile_manager.get_num_effective_samples() != INT_MAX;
 	progress.set_total_pixel_samples(show_progress? tile_manager.state.total_pixel_samples : 0);
 
@@ -977,8 +1167,14 @@ void Session::render()
 	task.need_finish_queue = params.progressive_refine;
 	task.integrator_branched = scene->integrator->method == Integrator::BRANCHED_PATH;
 	task.requested_tile_size = params.tile_size;
+	task.packet_traversal = scene->integrator->use_packet_traversal;
 	task.passes_size = tile_manager.params.get_passes_size();
 
+	if(scene->film->adaptive_sampling_pass && scene->integrator->adaptive_threshold > 0.0f) {
+		task.adaptive_sampling = true;
+		task.adaptive_min_samples = scene->integrator->adaptive_min_samples;
+	}
+
 	if(params.use_denoising) {
 		task.denoising_radius = params.denoising_radius;
 		task.denoising_strength = params.denoising_strength;
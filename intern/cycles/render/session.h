@@ -36,6 +36,7 @@ class DeviceRequestedFeatures;
 class DisplayBuffer;
 class Progress;
 class RenderBuffers;
+class RenderCheckpoint;
 class Scene;
 
 /* Session Parameters */
@@ -68,6 +69,11 @@ public:
 	double text_timeout;
 	double progressive_update_timeout;
 
+	/* File to periodically store tiles in during background renders, so an
+	 * interrupted render can resume. Empty disables checkpoints. */
+	string checkpoint_path;
+	double checkpoint_interval;
+
 	ShadingSystem shadingsystem;
 
 	SessionParams()
@@ -96,6 +102,8 @@ public:
 		text_timeout = 1.0;
 		progressive_update_timeout = 1.0;
 
+		checkpoint_interval = 300.0;
+
 		shadingsystem = SHADINGSYSTEM_SVM;
 		tile_order = TILE_CENTER;
 	}
@@ -121,6 +129,8 @@ public:
 		&& reset_timeout == params.reset_timeout
 		&& text_timeout == params.text_timeout
 		&& progressive_update_timeout == params.progressive_update_timeout
+		&& checkpoint_path == params.checkpoint_path
+		&& checkpoint_interval == params.checkpoint_interval
 		&& tile_order == params.tile_order
 		&& shadingsystem == params.shadingsystem); }
 
@@ -142,6 +152,15 @@ public:
 	TileManager tile_manager;
 	Stats stats;
 
+	/* Time spent on each tile from acquiring until releasing it, for path
+	 * tracing and denoising tiles. Used for benchmarking. */
+	vector<double> path_trace_tile_times;
+	vector<double> denoise_tile_times;
+	/* Wall clock time from acquiring the first until releasing the last
+	 * denoising tile. */
+	double denoise_start_time;
+	double denoise_end_time;
+
 	function<void(RenderTile&)> write_render_tile_cb;
 	function<void(RenderTile&, bool)> update_render_tile_cb;
 
@@ -211,6 +230,7 @@ protected:
 	thread_condition_variable pause_cond;
 	thread_mutex pause_mutex;
 	thread_mutex tile_mutex;
+	thread_condition_variable denoising_cond;
 	thread_mutex buffers_mutex;
 	thread_mutex display_mutex;
 
@@ -224,6 +244,12 @@ protected:
 
 	vector<RenderTile> render_tiles;
 
+	/* checkpoints */
+	RenderCheckpoint *checkpoint;
+	void checkpoint_begin();
+	void checkpoint_tile(RenderTile& rtile);
+	void checkpoint_end();
+
 	DeviceRequestedFeatures get_requested_device_features();
 
 	/* ** Split kernel routines ** */
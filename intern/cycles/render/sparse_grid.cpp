@@ -0,0 +1,177 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "render/sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+static bool sparse_grid_tile_has_data(const float *voxels,
+                                      int width, int height, int depth,
+                                      int channels,
+                                      int tx, int ty, int tz)
+{
+	const int x_end = min((tx + 1) * SPARSE_GRID_TILE_SIZE, width);
+	const int y_end = min((ty + 1) * SPARSE_GRID_TILE_SIZE, height);
+	const int z_end = min((tz + 1) * SPARSE_GRID_TILE_SIZE, depth);
+
+	for(int z = tz * SPARSE_GRID_TILE_SIZE; z < z_end; z++) {
+		for(int y = ty * SPARSE_GRID_TILE_SIZE; y < y_end; y++) {
+			const size_t row = ((size_t)z * height + y) * width;
+			for(int x = tx * SPARSE_GRID_TILE_SIZE; x < x_end; x++) {
+				const float *voxel = voxels + (row + x) * channels;
+				for(int c = 0; c < channels; c++) {
+					if(voxel[c] != 0.0f) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+static void sparse_grid_tile_copy(SparseGridImage *grid,
+                                  const float *voxels,
+                                  int tx, int ty, int tz,
+                                  int tile)
+{
+	const int channels = grid->channels;
+	float *tile_voxels = &grid->voxels[(size_t)tile * SPARSE_GRID_TILE_VOXELS * channels];
+
+	for(int lz = 0; lz < SPARSE_GRID_TILE_SIZE; lz++) {
+		const int z = min(tz * SPARSE_GRID_TILE_SIZE + lz, grid->depth - 1);
+		for(int ly = 0; ly < SPARSE_GRID_TILE_SIZE; ly++) {
+			const int y = min(ty * SPARSE_GRID_TILE_SIZE + ly, grid->height - 1);
+			const size_t row = ((size_t)z * grid->height + y) * grid->width;
+			for(int lx = 0; lx < SPARSE_GRID_TILE_SIZE; lx++) {
+				/* Padding voxels are never read, copy the border to keep
+				 * them deterministic. */
+				const int x = min(tx * SPARSE_GRID_TILE_SIZE + lx, grid->width - 1);
+				const float *voxel = voxels + (row + x) * channels;
+				for(int c = 0; c < channels; c++) {
+					*(tile_voxels++) = voxel[c];
+				}
+			}
+		}
+	}
+}
+
+static void sparse_grid_tiles_dilate(SparseGridImage *grid)
+{
+	const int tiles_x = grid->tiles_x;
+	const int tiles_y = grid->tiles_y;
+	const int tiles_z = grid->tiles_z;
+	const bool periodic = (grid->extension == EXTENSION_REPEAT);
+
+	grid->tiles_active.clear();
+	grid->tiles_active.resize(grid->tiles.size(), 0);
+
+	for(int tz = 0; tz < tiles_z; tz++) {
+		for(int ty = 0; ty < tiles_y; ty++) {
+			for(int tx = 0; tx < tiles_x; tx++) {
+				if(grid->tiles[tx + tiles_x * (ty + tiles_y * tz)] == SPARSE_GRID_EMPTY_TILE) {
+					continue;
+				}
+
+				/* Filters reach at most two voxels into neighbor tiles. */
+				for(int dz = -1; dz <= 1; dz++) {
+					for(int dy = -1; dy <= 1; dy++) {
+						for(int dx = -1; dx <= 1; dx++) {
+							int nx = tx + dx, ny = ty + dy, nz = tz + dz;
+
+							if(periodic) {
+								nx = (nx + tiles_x) % tiles_x;
+								ny = (ny + tiles_y) % tiles_y;
+								nz = (nz + tiles_z) % tiles_z;
+							}
+							else if(nx < 0 || ny < 0 || nz < 0 ||
+							        nx >= tiles_x || ny >= tiles_y || nz >= tiles_z)
+							{
+								continue;
+							}
+
+							grid->tiles_active[nx + tiles_x * (ny + tiles_y * nz)] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+SparseGridImage *sparse_grid_build(const float *voxels,
+                                   int width, int height, int depth,
+                                   int channels,
+                                   InterpolationType interpolation,
+                                   ExtensionType extension)
+{
+	assert(channels == 1 || channels == 4);
+
+	SparseGridImage *grid = new SparseGridImage();
+	grid->width = width;
+	grid->height = height;
+	grid->depth = depth;
+	grid->tiles_x = (width + SPARSE_GRID_TILE_MASK) >> SPARSE_GRID_TILE_SHIFT;
+	grid->tiles_y = (height + SPARSE_GRID_TILE_MASK) >> SPARSE_GRID_TILE_SHIFT;
+	grid->tiles_z = (depth + SPARSE_GRID_TILE_MASK) >> SPARSE_GRID_TILE_SHIFT;
+	grid->channels = channels;
+	grid->interpolation = interpolation;
+	grid->extension = extension;
+
+	const size_t num_tiles = (size_t)grid->tiles_x * grid->tiles_y * grid->tiles_z;
+	grid->tiles.resize(num_tiles);
+
+	/* Find occupied tiles first, so voxels are allocated only once. */
+	int num_active = 0;
+	for(int tz = 0, tile = 0; tz < grid->tiles_z; tz++) {
+		for(int ty = 0; ty < grid->tiles_y; ty++) {
+			for(int tx = 0; tx < grid->tiles_x; tx++, tile++) {
+				if(sparse_grid_tile_has_data(voxels, width, height, depth, channels, tx, ty, tz)) {
+					grid->tiles[tile] = num_active++;
+				}
+				else {
+					grid->tiles[tile] = SPARSE_GRID_EMPTY_TILE;
+				}
+			}
+		}
+	}
+
+	grid->voxels.resize((size_t)num_active * SPARSE_GRID_TILE_VOXELS * channels);
+
+	for(int tz = 0, tile = 0; tz < grid->tiles_z; tz++) {
+		for(int ty = 0; ty < grid->tiles_y; ty++) {
+			for(int tx = 0; tx < grid->tiles_x; tx++, tile++) {
+				if(grid->tiles[tile] != SPARSE_GRID_EMPTY_TILE) {
+					sparse_grid_tile_copy(grid, voxels, tx, ty, tz, grid->tiles[tile]);
+				}
+			}
+		}
+	}
+
+	sparse_grid_tiles_dilate(grid);
+
+	return grid;
+}
+
+size_t sparse_grid_memory_size(const SparseGridImage *grid)
+{
+	return grid->tiles.size() * sizeof(int) +
+	       grid->tiles_active.size() * sizeof(uchar) +
+	       grid->voxels.size() * sizeof(float);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SPARSE_GRID_H__
+#define __SPARSE_GRID_H__
+
+#include "kernel/kernel_sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Build a sparse grid from dense voxels with 1 or 4 channels, stored x first
+ * like image textures. Tiles where all voxels are zero are not stored. */
+SparseGridImage *sparse_grid_build(const float *voxels,
+                                   int width, int height, int depth,
+                                   int channels,
+                                   InterpolationType interpolation,
+                                   ExtensionType extension);
+
+/* Memory used by the grid, in bytes. */
+size_t sparse_grid_memory_size(const SparseGridImage *grid);
+
+CCL_NAMESPACE_END
+
+#endif /* __SPARSE_GRID_H__ */
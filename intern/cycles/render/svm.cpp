@@ -26,6 +26,7 @@
 #include "util/util_debug.h"
 #include "util/util_logging.h"
 #include "util/util_foreach.h"
+#include "util/util_md5.h"
 #include "util/util_progress.h"
 #include "util/util_task.h"
 
@@ -39,23 +40,98 @@ SVMShaderManager::SVMShaderManager()
 
 SVMShaderManager::~SVMShaderManager()
 {
+	foreach(ProgramCache::value_type& it, program_cache) {
+		delete it.second;
+	}
 }
 
 void SVMShaderManager::reset(Scene * /*scene*/)
 {
 }
 
+SVMShaderManager::CachedProgram::CachedProgram()
+{
+	compiled = false;
+	used = false;
+}
+
+void SVMShaderManager::CachedProgram::store_flags(const Shader *shader)
+{
+	has_surface = shader->has_surface;
+	has_surface_emission = shader->has_surface_emission;
+	has_surface_transparent = shader->has_surface_transparent;
+	has_surface_bssrdf = shader->has_surface_bssrdf;
+	has_bssrdf_bump = shader->has_bssrdf_bump;
+	has_volume = shader->has_volume;
+	has_displacement = shader->has_displacement;
+	has_surface_spatial_varying = shader->has_surface_spatial_varying;
+	has_volume_spatial_varying = shader->has_volume_spatial_varying;
+	has_object_dependency = shader->has_object_dependency;
+	has_integrator_dependency = shader->has_integrator_dependency;
+}
+
+void SVMShaderManager::CachedProgram::apply_flags(Shader *shader) const
+{
+	shader->has_surface = has_surface;
+	shader->has_surface_emission = has_surface_emission;
+	shader->has_surface_transparent = has_surface_transparent;
+	shader->has_surface_bssrdf = has_surface_bssrdf;
+	shader->has_bssrdf_bump = has_bssrdf_bump;
+	shader->has_volume = has_volume;
+	shader->has_displacement = has_displacement;
+	shader->has_surface_spatial_varying = has_surface_spatial_varying;
+	shader->has_volume_spatial_varying = has_volume_spatial_varying;
+	shader->has_object_dependency = has_object_dependency;
+	shader->has_integrator_dependency = has_integrator_dependency;
+}
+
+void SVMShaderManager::device_update_finalize(Scene *scene,
+                                              Shader *shader,
+                                              Progress *progress,
+                                              string *key)
+{
+	if(progress->get_cancel()) {
+		return;
+	}
+	assert(shader->graph);
+
+	SVMCompiler compiler(scene->shader_manager, scene->image_manager);
+	compiler.finalize(scene, shader);
+
+	/* Everything besides the graphs which affects the generated program. */
+	MD5Hash md5;
+	int settings[4] = {shader->used,
+	                   shader->displacement_method,
+	                   shader == scene->default_background,
+	                   shader->graph_bump != NULL};
+	md5.append((const uint8_t*)settings, sizeof(settings));
+
+	/* Unused shaders compile to an empty program. Image slots are part of
+	 * the program, so they need to be known before hashing. */
+	if(shader->used) {
+		shader->graph->add_images(scene->image_manager);
+		shader->graph->hash(md5);
+
+		if(shader->graph_bump) {
+			shader->graph_bump->add_images(scene->image_manager);
+			shader->graph_bump->hash(md5);
+		}
+	}
+
+	*key = md5.get_hex();
+}
+
 void SVMShaderManager::device_update_shader(Scene *scene,
                                             Shader *shader,
                                             Progress *progress,
-                                            vector<int4> *global_svm_nodes)
+                                            CachedProgram *program)
 {
 	if(progress->get_cancel()) {
 		return;
 	}
 	assert(shader->graph);
 
-	vector<int4> svm_nodes;
+	vector<int4>& svm_nodes = program->svm_nodes;
 	svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
 
 	SVMCompiler::Summary summary;
@@ -63,31 +139,12 @@ void SVMShaderManager::device_update_shader(Scene *scene,
 	compiler.background = (shader == scene->default_background);
 	compiler.compile(scene, shader, svm_nodes, 0, &summary);
 
+	program->store_flags(shader);
+	program->compiled = true;
+
 	VLOG(2) << "Compilation summary:\n"
 	        << "Shader name: " << shader->name << "\n"
 	        << summary.full_report();
-
-	nodes_lock_.lock();
-	if(shader->use_mis && shader->has_surface_emission) {
-		scene->light_manager->need_update = true;
-	}
-
-	/* The copy needs to be done inside the lock, if another thread resizes the array 
-	 * while memcpy is running, it'll be copying into possibly invalid/freed ram. 
-	 */
-	size_t global_nodes_size = global_svm_nodes->size();
-	global_svm_nodes->resize(global_nodes_size + svm_nodes.size());
-	
-	/* Offset local SVM nodes to a global address space. */
-	int4& jump_node = global_svm_nodes->at(shader->id);
-	jump_node.y = svm_nodes[0].y + global_nodes_size - 1;
-	jump_node.z = svm_nodes[0].z + global_nodes_size - 1;
-	jump_node.w = svm_nodes[0].w + global_nodes_size - 1;
-	/* Copy new nodes to global storage. */
-	memcpy(&global_svm_nodes->at(global_nodes_size),
-	       &svm_nodes[1],
-	       sizeof(int4) * (svm_nodes.size() - 1));
-	nodes_lock_.unlock();
 }
 
 void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
@@ -105,22 +162,19 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	/* determine which shaders are in use */
 	device_update_shaders_used(scene);
 
-	/* svm_nodes */
-	vector<int4> svm_nodes;
+	size_t num_shaders = scene->shaders.size();
 	size_t i;
 
-	for(i = 0; i < scene->shaders.size(); i++) {
-		svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
-	}
-
+	/* finalize graphs and compute their hashes */
+	vector<string> keys(num_shaders);
 	TaskPool task_pool;
-	foreach(Shader *shader, scene->shaders) {
-		task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
+	for(i = 0; i < num_shaders; i++) {
+		task_pool.push(function_bind(&SVMShaderManager::device_update_finalize,
 		                             this,
 		                             scene,
-		                             shader,
+		                             scene->shaders[i],
 		                             &progress,
-		                             &svm_nodes),
+		                             &keys[i]),
 		               false);
 	}
 	task_pool.wait_work();
@@ -129,10 +183,81 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 		return;
 	}
 
+	/* look up programs, compiling every graph which is not cached only once */
+	vector<CachedProgram*> programs(num_shaders);
+	size_t num_compiled = 0;
+	for(i = 0; i < num_shaders; i++) {
+		CachedProgram *&program = program_cache[keys[i]];
+		if(program == NULL) {
+			program = new CachedProgram();
+			task_pool.push(function_bind(&SVMShaderManager::device_update_shader,
+			                             this,
+			                             scene,
+			                             scene->shaders[i],
+			                             &progress,
+			                             program),
+			               false);
+			num_compiled++;
+		}
+		program->used = true;
+		programs[i] = program;
+	}
+	task_pool.wait_work();
+
+	VLOG(1) << "Compiled " << num_compiled << " of "
+	        << num_shaders << " shaders, others are cached or shared.";
+
+	/* free programs which are no longer used or were not finished */
+	for(ProgramCache::iterator it = program_cache.begin(); it != program_cache.end(); ) {
+		CachedProgram *program = it->second;
+		if(!program->used || !program->compiled) {
+			delete program;
+			program_cache.erase(it++);
+		}
+		else {
+			program->used = false;
+			++it;
+		}
+	}
+
+	if(progress.get_cancel()) {
+		return;
+	}
+
+	/* svm_nodes */
+	vector<int4> svm_nodes;
+
+	for(i = 0; i < num_shaders; i++) {
+		svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+	}
+
+	for(i = 0; i < num_shaders; i++) {
+		Shader *shader = scene->shaders[i];
+		const CachedProgram *program = programs[i];
+		const vector<int4>& local_svm_nodes = program->svm_nodes;
+
+		program->apply_flags(shader);
+
+		if(shader->use_mis && shader->has_surface_emission) {
+			scene->light_manager->need_update = true;
+		}
+
+		/* Offset local SVM nodes to a global address space. */
+		size_t global_nodes_size = svm_nodes.size();
+		int4& jump_node = svm_nodes[shader->id];
+		jump_node.y = local_svm_nodes[0].y + global_nodes_size - 1;
+		jump_node.z = local_svm_nodes[0].z + global_nodes_size - 1;
+		jump_node.w = local_svm_nodes[0].w + global_nodes_size - 1;
+		/* Copy nodes to global storage. */
+		svm_nodes.insert(svm_nodes.end(),
+		                 local_svm_nodes.begin() + 1,
+		                 local_svm_nodes.end());
+	}
+
 	dscene->svm_nodes.copy((uint4*)&svm_nodes[0], svm_nodes.size());
 	device->tex_alloc("__svm_nodes", dscene->svm_nodes);
 
-	for(i = 0; i < scene->shaders.size(); i++) {
+	for(i = 0; i < num_shaders; i++) {
 		Shader *shader = scene->shaders[i];
 		shader->need_update = false;
 	}
@@ -142,7 +267,7 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	need_update = false;
 
 	VLOG(1) << "Shader manager updated "
-	        << scene->shaders.size() << " shaders in "
+	        << num_shaders << " shaders in "
 	        << time_dt() - start_time << " seconds.";
 }
 
@@ -792,17 +917,12 @@ void SVMCompiler::compile_type(Shader *shader, ShaderGraph *graph, ShaderType ty
 	}
 }
 
-void SVMCompiler::compile(Scene *scene,
-                          Shader *shader,
-                          vector<int4>& svm_nodes,
-                          int index,
-                          Summary *summary)
+void SVMCompiler::finalize(Scene *scene,
+                           Shader *shader,
+                           Summary *summary)
 {
 	/* copy graph for shader with bump mapping */
 	ShaderNode *node = shader->graph->output();
-	int start_num_svm_nodes = svm_nodes.size();
-
-	const double time_start = time_dt();
 
 	if(node->input("Surface")->link && node->input("Displacement")->link)
 		if(!shader->graph_bump)
@@ -823,6 +943,19 @@ void SVMCompiler::compile(Scene *scene,
 		                             shader->has_integrator_dependency,
 		                             shader->displacement_method == DISPLACE_BOTH);
 	}
+}
+
+void SVMCompiler::compile(Scene *scene,
+                          Shader *shader,
+                          vector<int4>& svm_nodes,
+                          int index,
+                          Summary *summary)
+{
+	int start_num_svm_nodes = svm_nodes.size();
+
+	const double time_start = time_dt();
+
+	finalize(scene, shader, summary);
 
 	current_shader = shader;
 
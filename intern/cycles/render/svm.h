@@ -21,6 +21,7 @@
 #include "render/graph.h"
 #include "render/shader.h"
 
+#include "util/util_map.h"
 #include "util/util_set.h"
 #include "util/util_string.h"
 #include "util/util_thread.h"
@@ -49,13 +50,49 @@ public:
 	void device_free(Device *device, DeviceScene *dscene, Scene *scene);
 
 protected:
-	/* Lock used to synchronize threaded nodes compilation. */
-	thread_spin_lock nodes_lock_;
+	/* Compiled program of a shader graph.
+	 *
+	 * Programs are cached by the hash of the finalized graph, so shaders with
+	 * identical graphs share one program and unchanged graphs are not compiled
+	 * again on the next update.
+	 */
+	struct CachedProgram {
+		CachedProgram();
+
+		void store_flags(const Shader *shader);
+		void apply_flags(Shader *shader) const;
+
+		/* Local SVM nodes, the first one is the jump node of the shader. */
+		vector<int4> svm_nodes;
+
+		/* Shader flags set by the compiler. */
+		bool has_surface;
+		bool has_surface_emission;
+		bool has_surface_transparent;
+		bool has_surface_bssrdf;
+		bool has_bssrdf_bump;
+		bool has_volume;
+		bool has_displacement;
+		bool has_surface_spatial_varying;
+		bool has_volume_spatial_varying;
+		bool has_object_dependency;
+		bool has_integrator_dependency;
+
+		bool compiled;
+		bool used;
+	};
+
+	typedef map<string, CachedProgram*> ProgramCache;
+	ProgramCache program_cache;
 
+	void device_update_finalize(Scene *scene,
+	                            Shader *shader,
+	                            Progress *progress,
+	                            string *key);
 	void device_update_shader(Scene *scene,
 	                          Shader *shader,
 	                          Progress *progress,
-	                          vector<int4> *global_svm_nodes);
+	                          CachedProgram *program);
 };
 
 /* Graph Compiler */
@@ -99,6 +136,9 @@ public:
 	};
 
 	SVMCompiler(ShaderManager *shader_manager, ImageManager *image_manager);
+	void finalize(Scene *scene,
+	              Shader *shader,
+	              Summary *summary = NULL);
 	void compile(Scene *scene,
 	             Shader *shader,
 	             vector<int4>& svm_nodes,
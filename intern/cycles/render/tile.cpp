@@ -149,6 +149,7 @@ void TileManager::reset(BufferParams& params_, int num_samples_)
 	state.render_tiles.clear();
 	state.denoising_tiles.clear();
 	state.tiles.clear();
+	state.num_active_tiles = 0;
 }
 
 void TileManager::set_samples(int num_samples_)
@@ -197,6 +198,7 @@ int TileManager::gen_tiles(bool sliced)
 	state.denoising_tiles.clear();
 	state.render_tiles.resize(num);
 	state.denoising_tiles.resize(num);
+	state.num_active_tiles = 0;
 	state.tile_stride = tile_w;
 	vector<list<int> >::iterator tile_list;
 	tile_list = state.render_tiles.begin();
@@ -396,6 +398,7 @@ bool TileManager::check_neighbor_state(int index, Tile::State min_state)
 bool TileManager::finish_tile(int index, bool &delete_tile)
 {
 	delete_tile = false;
+	state.num_active_tiles--;
 
 	switch(state.tiles[index].state) {
 		case Tile::RENDER:
@@ -454,6 +457,7 @@ bool TileManager::next_tile(Tile* &tile, int device)
 		int idx = state.denoising_tiles[logical_device].front();
 		state.denoising_tiles[logical_device].pop_front();
 		tile = &state.tiles[idx];
+		state.num_active_tiles++;
 		return true;
 	}
 
@@ -463,9 +467,15 @@ bool TileManager::next_tile(Tile* &tile, int device)
 	int idx = state.render_tiles[logical_device].front();
 	state.render_tiles[logical_device].pop_front();
 	tile = &state.tiles[idx];
+	state.num_active_tiles++;
 	return true;
 }
 
+bool TileManager::denoising_pending()
+{
+	return schedule_denoising && state.num_active_tiles > 0;
+}
+
 bool TileManager::done()
 {
 	int end_sample = (range_num_samples == -1)
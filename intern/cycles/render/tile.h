@@ -83,6 +83,9 @@ public:
 		 * Each list in each vector is for one logical device. */
 		vector<list<int> > render_tiles;
 		vector<list<int> > denoising_tiles;
+
+		/* Number of tiles returned by next_tile() which are not finished yet. */
+		int num_active_tiles;
 	} state;
 
 	int num_samples;
@@ -99,6 +102,10 @@ public:
 	bool finish_tile(int index, bool& delete_tile);
 	bool done();
 
+	/* Returns true when tiles that are currently being processed may still
+	 * make other tiles ready for denoising once they are finished. */
+	bool denoising_pending();
+
 	void set_tile_order(TileOrder tile_order_) { tile_order = tile_order_; }
 
 	/* ** Sample range rendering. ** */
@@ -29,36 +29,48 @@ CCL_NAMESPACE_BEGIN
 EdgeDice::EdgeDice(const SubdParams& params_)
 : params(params_)
 {
-	mesh_P = NULL;
-	mesh_N = NULL;
-	vert_offset = 0;
-
-	params.mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+	Mesh *mesh = params.mesh;
+	Attribute *attr_vN = mesh->attributes.find(ATTR_STD_VERTEX_NORMAL);
+	Attribute *attr_ptex_uv = mesh->attributes.find(ATTR_STD_PTEX_UV);
+	Attribute *attr_ptex_face_id = mesh->attributes.find(ATTR_STD_PTEX_FACE_ID);
 
-	if(params.ptex) {
-		params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-	}
+	mesh_P = mesh->verts.data();
+	mesh_N = (attr_vN)? attr_vN->data_float3(): NULL;
+	mesh_ptex_uv = (params.ptex && attr_ptex_uv)? attr_ptex_uv->data_float3(): NULL;
+	mesh_ptex_face_id = (params.ptex && attr_ptex_face_id)? attr_ptex_face_id->data_float(): NULL;
+	vert_offset = mesh->verts.size();
+	tri_offset = mesh->num_triangles();
 }
 
-void EdgeDice::reserve(int num_verts)
+void EdgeDice::reserve(size_t num_verts, size_t num_tris)
 {
 	Mesh *mesh = params.mesh;
 
 	vert_offset = mesh->verts.size();
 	tri_offset = mesh->num_triangles();
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(vert_offset + num_verts > mesh->verts.capacity()) {
-		mesh->reserve_mesh(size_t((vert_offset + num_verts) * 1.2), mesh->num_triangles());
+	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+	Attribute *attr_ptex_uv = NULL;
+	Attribute *attr_ptex_face_id = NULL;
+
+	if(params.ptex) {
+		attr_ptex_uv = mesh->attributes.add(ATTR_STD_PTEX_UV);
+		attr_ptex_face_id = mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
 	}
 
-	mesh->resize_mesh(vert_offset + num_verts, tri_offset);
-
-	Attribute *attr_vN = mesh->attributes.add(ATTR_STD_VERTEX_NORMAL);
+	mesh->resize_mesh(vert_offset + num_verts, tri_offset + num_tris);
+	mesh->num_subd_verts += num_verts;
 
 	mesh_P = mesh->verts.data();
 	mesh_N = attr_vN->data_float3();
+	mesh_ptex_uv = (attr_ptex_uv)? attr_ptex_uv->data_float3(): NULL;
+	mesh_ptex_face_id = (attr_ptex_face_id)? attr_ptex_face_id->data_float(): NULL;
+}
+
+void EdgeDice::set_offset(size_t vert_offset_, size_t tri_offset_)
+{
+	vert_offset = vert_offset_;
+	tri_offset = tri_offset_;
 }
 
 int EdgeDice::add_vert(Patch *patch, float2 uv)
@@ -73,16 +85,10 @@ int EdgeDice::add_vert(Patch *patch, float2 uv)
 	mesh_N[vert_offset] = N;
 	params.mesh->vert_patch_uv[vert_offset] = make_float2(uv.x, uv.y);
 
-	if(params.ptex) {
-		Attribute *attr_ptex_uv = params.mesh->attributes.add(ATTR_STD_PTEX_UV);
-		params.mesh->attributes.resize();
-
-		float3 *ptex_uv = attr_ptex_uv->data_float3();
-		ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
+	if(mesh_ptex_uv) {
+		mesh_ptex_uv[vert_offset] = make_float3(uv.x, uv.y, 0.0f);
 	}
 
-	params.mesh->num_subd_verts++;
-
 	return vert_offset++;
 }
 
@@ -90,19 +96,17 @@ void EdgeDice::add_triangle(Patch *patch, int v0, int v1, int v2)
 {
 	Mesh *mesh = params.mesh;
 
-	/* todo: optimize so we can reserve in advance, this is like push_back_slow() */
-	if(mesh->triangles.size() == mesh->triangles.capacity())
-		mesh->reserve_mesh(mesh->verts.size(), size_t(max(mesh->num_triangles() + 1, 1) * 1.2));
+	assert(tri_offset < mesh->num_triangles());
 
-	mesh->add_triangle(v0, v1, v2, patch->shader, true);
-	params.mesh->triangle_patch[params.mesh->num_triangles()-1] = patch->patch_index;
+	mesh->triangles[tri_offset*3 + 0] = v0;
+	mesh->triangles[tri_offset*3 + 1] = v1;
+	mesh->triangles[tri_offset*3 + 2] = v2;
+	mesh->shader[tri_offset] = patch->shader;
+	mesh->smooth[tri_offset] = true;
+	mesh->triangle_patch[tri_offset] = patch->patch_index;
 
-	if(params.ptex) {
-		Attribute *attr_ptex_face_id = params.mesh->attributes.add(ATTR_STD_PTEX_FACE_ID);
-		params.mesh->attributes.resize();
-
-		float *ptex_face_id = attr_ptex_face_id->data_float();
-		ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
+	if(mesh_ptex_face_id) {
+		mesh_ptex_face_id[tri_offset] = (float)patch->ptex_face_id();
 	}
 
 	tri_offset++;
@@ -152,11 +156,26 @@ QuadDice::QuadDice(const SubdParams& params_)
 {
 }
 
-void QuadDice::reserve(EdgeFactors& ef, int Mu, int Mv)
+void QuadDice::grid_size(const EdgeFactors& ef, int *Mu, int *Mv)
+{
+	/* Inner grid size. Scaling it with scale_factor() doesn't work very
+	 * well, especially at grazing angles. */
+	*Mu = max(max(ef.tu0, ef.tu1), 2); // XXX handle 0 & 1?
+	*Mv = max(max(ef.tv0, ef.tv1), 2); // XXX handle 0 & 1?
+}
+
+void QuadDice::count(const EdgeFactors& ef, size_t *num_verts, size_t *num_tris)
 {
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
+
 	/* XXX need to make this also work for edge factor 0 and 1 */
-	int num_verts = (ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1) + (Mu - 1)*(Mv - 1);
-	EdgeDice::reserve(num_verts);
+	size_t num_side = ef.tu0 + ef.tu1 + ef.tv0 + ef.tv1;
+
+	/* Corners, verts on the sides and the inner grid. */
+	*num_verts = num_side + (size_t)(Mu - 1)*(Mv - 1);
+	/* Inner grid, and stitching of the sides to the inner grid. */
+	*num_tris = 2*(size_t)(Mu - 2)*(Mv - 2) + num_side + 2*(Mu - 2) + 2*(Mv - 2);
 }
 
 float2 QuadDice::map_uv(SubPatch& sub, float u, float v)
@@ -307,22 +326,11 @@ void QuadDice::add_grid(SubPatch& sub, int Mu, int Mv, int offset)
 
 void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 {
-	/* compute inner grid size with scale factor */
-	int Mu = max(ef.tu0, ef.tu1);
-	int Mv = max(ef.tv0, ef.tv1);
+	/* compute inner grid size */
+	int Mu, Mv;
+	grid_size(ef, &Mu, &Mv);
 
-#if 0 /* Doesnt work very well, especially at grazing angles. */
-	float S = scale_factor(sub, ef, Mu, Mv);
-#else
-	float S = 1.0f;
-#endif
-
-	Mu = max((int)ceil(S*Mu), 2); // XXX handle 0 & 1?
-	Mv = max((int)ceil(S*Mv), 2); // XXX handle 0 & 1?
-
-	/* reserve space for new verts */
-	int offset = params.mesh->verts.size();
-	reserve(ef, Mu, Mv);
+	int offset = vert_offset;
 
 	/* corners and inner grid */
 	add_corners(sub);
@@ -345,8 +353,6 @@ void QuadDice::dice(SubPatch& sub, EdgeFactors& ef)
 	/* right side */
 	add_side_v(sub, outer, inner, Mu, Mv, ef.tv1, 1, offset);
 	stitch_triangles(sub.patch, outer, inner);
-
-	assert(vert_offset == params.mesh->verts.size());
 }
 
 CCL_NAMESPACE_END
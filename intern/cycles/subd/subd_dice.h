@@ -63,12 +63,18 @@ public:
 	SubdParams params;
 	float3 *mesh_P;
 	float3 *mesh_N;
+	float3 *mesh_ptex_uv;
+	float *mesh_ptex_face_id;
 	size_t vert_offset;
 	size_t tri_offset;
 
 	explicit EdgeDice(const SubdParams& params);
 
-	void reserve(int num_verts);
+	/* Grow the mesh by the given number of verts and triangles. This is done
+	 * once for all patches before dicing, so patches can be diced in parallel
+	 * into their own range of the mesh arrays. */
+	void reserve(size_t num_verts, size_t num_tris);
+	void set_offset(size_t vert_offset, size_t tri_offset);
 
 	int add_vert(Patch *patch, float2 uv);
 	void add_triangle(Patch *patch, int v0, int v1, int v2);
@@ -109,7 +115,9 @@ public:
 
 	explicit QuadDice(const SubdParams& params);
 
-	void reserve(EdgeFactors& ef, int Mu, int Mv);
+	/* Number of verts and triangles dice() creates for the edge factors. */
+	static void count(const EdgeFactors& ef, size_t *num_verts, size_t *num_tris);
+
 	float3 eval_projected(SubPatch& sub, float u, float v);
 
 	float2 map_uv(SubPatch& sub, float u, float v);
@@ -129,7 +137,11 @@ public:
 	float quad_area(const float3& a, const float3& b, const float3& c, const float3& d);
 	float scale_factor(SubPatch& sub, EdgeFactors& ef, int Mu, int Mv);
 
+	/* Dice into the mesh starting at the current offset. */
 	void dice(SubPatch& sub, EdgeFactors& ef);
+
+protected:
+	static void grid_size(const EdgeFactors& ef, int *Mu, int *Mv);
 };
 
 CCL_NAMESPACE_END
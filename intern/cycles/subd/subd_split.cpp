@@ -36,6 +36,11 @@ DiagSplit::DiagSplit(const SubdParams& params_)
 
 void DiagSplit::dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef)
 {
+	ef.tu0 = max(ef.tu0, 1);
+	ef.tu1 = max(ef.tu1, 1);
+	ef.tv0 = max(ef.tv0, 1);
+	ef.tv1 = max(ef.tv1, 1);
+
 	subpatches_quad.push_back(sub);
 	edgefactors_quad.push_back(ef);
 }
@@ -51,7 +56,7 @@ float3 DiagSplit::to_world(Patch *patch, float2 uv)
 	return P;
 }
 
-int DiagSplit::T(Patch *patch, float2 Pstart, float2 Pend)
+void DiagSplit::edge_length(Patch *patch, float2 Pstart, float2 Pend, float *Lsum_, float *Lmax_)
 {
 	float3 Plast = make_float3(0.0f, 0.0f, 0.0f);
 	float Lsum = 0.0f;
@@ -82,6 +87,15 @@ int DiagSplit::T(Patch *patch, float2 Pstart, float2 Pend)
 		Plast = P;
 	}
 
+	*Lsum_ = Lsum;
+	*Lmax_ = Lmax;
+}
+
+int DiagSplit::T(Patch *patch, float2 Pstart, float2 Pend)
+{
+	float Lsum, Lmax;
+	edge_length(patch, Pstart, Pend, &Lsum, &Lmax);
+
 	int tmin = (int)ceil(Lsum/params.dicing_rate);
 	int tmax = (int)ceil((params.test_steps-1)*Lmax/params.dicing_rate); // XXX paper says N instead of N-1, seems wrong?
 
@@ -239,23 +253,26 @@ void DiagSplit::split_quad(Patch *patch, QuadDice::SubPatch *subpatch)
 	limit_edge_factors(sub_split, ef_split, 1 << params.max_level);
 
 	split(sub_split, ef_split);
+}
 
-	QuadDice dice(params);
-
-	for(size_t i = 0; i < subpatches_quad.size(); i++) {
-		QuadDice::SubPatch& sub = subpatches_quad[i];
-		QuadDice::EdgeFactors& ef = edgefactors_quad[i];
-
-		ef.tu0 = max(ef.tu0, 1);
-		ef.tu1 = max(ef.tu1, 1);
-		ef.tv0 = max(ef.tv0, 1);
-		ef.tv1 = max(ef.tv1, 1);
-
-		dice.dice(sub, ef);
-	}
-
-	subpatches_quad.clear();
-	edgefactors_quad.clear();
+size_t DiagSplit::estimate_triangles(Patch *patch)
+{
+	float2 P00 = make_float2(0.0f, 0.0f);
+	float2 P10 = make_float2(1.0f, 0.0f);
+	float2 P01 = make_float2(0.0f, 1.0f);
+	float2 P11 = make_float2(1.0f, 1.0f);
+
+	float Lu0, Lu1, Lv0, Lv1, Lmax;
+	edge_length(patch, P00, P10, &Lu0, &Lmax);
+	edge_length(patch, P01, P11, &Lu1, &Lmax);
+	edge_length(patch, P00, P01, &Lv0, &Lmax);
+	edge_length(patch, P10, P11, &Lv1, &Lmax);
+
+	float max_t = (float)(1 << params.max_level);
+	float tu = clamp(max(Lu0, Lu1)/params.dicing_rate, 1.0f, max_t);
+	float tv = clamp(max(Lv0, Lv1)/params.dicing_rate, 1.0f, max_t);
+
+	return (size_t)(2.0f*tu*tv);
 }
 
 CCL_NAMESPACE_END
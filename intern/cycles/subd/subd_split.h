@@ -44,6 +44,7 @@ public:
 	explicit DiagSplit(const SubdParams& params);
 
 	float3 to_world(Patch *patch, float2 uv);
+	void edge_length(Patch *patch, float2 Pstart, float2 Pend, float *Lsum, float *Lmax);
 	int T(Patch *patch, float2 Pstart, float2 Pend);
 	void partition_edge(Patch *patch, float2 *P, int *t0, int *t1,
 		float2 Pstart, float2 Pend, int t);
@@ -51,7 +52,13 @@ public:
 	void dispatch(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef);
 	void split(QuadDice::SubPatch& sub, QuadDice::EdgeFactors& ef, int depth=0);
 
+	/* Split the patch into subpatches ready for dicing, which are appended
+	 * to subpatches_quad and edgefactors_quad. */
 	void split_quad(Patch *patch, QuadDice::SubPatch *subpatch=NULL);
+
+	/* Approximate number of triangles the patch is diced into, without
+	 * splitting it. */
+	size_t estimate_triangles(Patch *patch);
 };
 
 CCL_NAMESPACE_END
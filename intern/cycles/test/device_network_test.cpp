@@ -0,0 +1,316 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "device/device_network.h"
+
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/scene.h"
+#include "render/session.h"
+
+#include "util/util_stats.h"
+#include "util/util_string.h"
+#include "util/util_task.h"
+#include "util/util_thread.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Half of the data compresses well, the other half not at all, and it spans
+ * more than one compression block. */
+void fill_test_data(vector<uint8_t>& data)
+{
+	uint32_t state = 12345;
+
+	for(size_t i = 0; i < data.size(); i++) {
+		if(i < data.size()/2) {
+			data[i] = (uint8_t)(i / 4096);
+		}
+		else {
+			state = state * 1664525u + 1013904223u;
+			data[i] = (uint8_t)(state >> 24);
+		}
+	}
+}
+
+void send_buffer(tcp::socket *socket, vector<uint8_t> *data)
+{
+	NetworkError error;
+	RPCSend snd(*socket, &error, "buffer");
+	snd.write();
+	snd.write_buffer_compressed(&(*data)[0], data->size());
+}
+
+/* Server on a free loopback port, running its own CPU device and serving a
+ * single client connection. */
+class LoopbackServer {
+public:
+	explicit LoopbackServer(const DeviceInfo& info)
+	: acceptor(io_service), server_thread(NULL)
+	{
+		device = Device::create(info, device_stats, true);
+		network_listen(acceptor, 0);
+	}
+
+	~LoopbackServer()
+	{
+		join();
+		delete device;
+	}
+
+	void start()
+	{
+		server_thread = new thread(function_bind(&device_network_server_accept,
+		                                         device, &acceptor, &stats));
+	}
+
+	void join()
+	{
+		if(server_thread) {
+			server_thread->join();
+			delete server_thread;
+			server_thread = NULL;
+		}
+	}
+
+	string address()
+	{
+		return string_printf("127.0.0.1:%d", (int)acceptor.local_endpoint().port());
+	}
+
+	NetworkServerStats stats;
+
+protected:
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor;
+	thread *server_thread;
+	Device *device;
+	Stats device_stats;
+};
+
+/* Two servers behind a multi device, as when rendering on a farm. */
+class DeviceNetworkMultiTest : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		TaskScheduler::init();
+
+		DeviceInfo cpu_info = Device::available_devices()[0];
+		ASSERT_EQ(cpu_info.type, DEVICE_CPU);
+
+		vector<DeviceInfo> subdevices;
+
+		for(int i = 0; i < 2; i++) {
+			servers[i] = new LoopbackServer(cpu_info);
+			servers[i]->start();
+			subdevices.push_back(Device::get_network_device(servers[i]->address()));
+		}
+
+		multi_info = Device::get_multi_device(subdevices);
+	}
+
+	void TearDown()
+	{
+		for(int i = 0; i < 2; i++)
+			delete servers[i];
+
+		TaskScheduler::exit();
+	}
+
+	/* Wait for the servers to see the client disconnect. */
+	void join_servers()
+	{
+		for(int i = 0; i < 2; i++)
+			servers[i]->join();
+	}
+
+	LoopbackServer *servers[2];
+	DeviceInfo multi_info;
+	Stats stats;
+};
+
+}  // namespace
+
+TEST(device_network, parse_address)
+{
+	string host;
+	int port;
+
+	EXPECT_TRUE(network_parse_address("render01", &host, &port));
+	EXPECT_EQ(host, "render01");
+	EXPECT_EQ(port, SERVER_PORT);
+
+	EXPECT_TRUE(network_parse_address("127.0.0.1:5130", &host, &port));
+	EXPECT_EQ(host, "127.0.0.1");
+	EXPECT_EQ(port, 5130);
+}
+
+TEST(device_network, parse_address_ipv6)
+{
+	string host;
+	int port;
+
+	EXPECT_TRUE(network_parse_address("[::1]:5130", &host, &port));
+	EXPECT_EQ(host, "::1");
+	EXPECT_EQ(port, 5130);
+
+	EXPECT_TRUE(network_parse_address("[fe80::1]", &host, &port));
+	EXPECT_EQ(host, "fe80::1");
+	EXPECT_EQ(port, SERVER_PORT);
+
+	/* without brackets the last group is part of the address, not a port */
+	EXPECT_TRUE(network_parse_address("fe80::1:5130", &host, &port));
+	EXPECT_EQ(host, "fe80::1:5130");
+	EXPECT_EQ(port, SERVER_PORT);
+}
+
+TEST(device_network, parse_address_invalid)
+{
+	string host;
+	int port;
+
+	EXPECT_FALSE(network_parse_address("", &host, &port));
+	EXPECT_FALSE(network_parse_address(":5130", &host, &port));
+	EXPECT_FALSE(network_parse_address("render01:", &host, &port));
+	EXPECT_FALSE(network_parse_address("render01:http", &host, &port));
+	EXPECT_FALSE(network_parse_address("render01:70000", &host, &port));
+	EXPECT_FALSE(network_parse_address("render01:0", &host, &port));
+	EXPECT_FALSE(network_parse_address("[::1", &host, &port));
+	EXPECT_FALSE(network_parse_address("[::1]5130", &host, &port));
+	EXPECT_FALSE(network_parse_address("[]:5130", &host, &port));
+}
+
+TEST(device_network, content_hash)
+{
+	vector<uint8_t> a(100000), b(100000);
+	fill_test_data(a);
+	fill_test_data(b);
+
+	EXPECT_EQ(network_content_hash(&a[0], a.size()),
+	          network_content_hash(&b[0], b.size()));
+
+	b[a.size() - 1] ^= 1;
+	EXPECT_NE(network_content_hash(&a[0], a.size()),
+	          network_content_hash(&b[0], b.size()));
+}
+
+TEST(device_network, compressed_buffer_loopback)
+{
+	boost::asio::io_service io_service;
+	tcp::acceptor acceptor(io_service,
+	                       tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+	tcp::socket client(io_service), server(io_service);
+
+	client.connect(acceptor.local_endpoint());
+	acceptor.accept(server);
+
+	vector<uint8_t> data(NETWORK_COMPRESS_BLOCK_SIZE + 100000);
+	fill_test_data(data);
+
+	/* Send from a thread, the buffer does not fit in the socket buffers. */
+	thread sender(function_bind(&send_buffer, &client, &data));
+
+	NetworkError error;
+	RPCReceive rcv(server, &error);
+	EXPECT_EQ(rcv.name, "buffer");
+
+	vector<uint8_t> result(data.size());
+	rcv.read_buffer_compressed(&result[0], result.size());
+
+	sender.join();
+
+	EXPECT_FALSE(error.have_error());
+	EXPECT_TRUE(result == data);
+}
+
+TEST_F(DeviceNetworkMultiTest, read_only_upload_skipped)
+{
+	vector<uint8_t> data(NETWORK_DEDUP_MIN_SIZE*2);
+	fill_test_data(data);
+
+	Device *device = Device::create(multi_info, stats, true);
+	ASSERT_FALSE(device->have_error());
+
+	device_vector<uint8_t> a, b;
+	a.copy(&data[0], data.size());
+	b.copy(&data[0], data.size());
+
+	device->mem_alloc("a", a, MEM_READ_ONLY);
+	device->mem_copy_to(a);
+	device->mem_alloc("b", b, MEM_READ_ONLY);
+	device->mem_copy_to(b);
+
+	EXPECT_FALSE(device->have_error());
+
+	device->mem_free(a);
+	device->mem_free(b);
+	delete device;
+
+	join_servers();
+
+	/* both uploads are hashed, the second one is found on the server */
+	for(int i = 0; i < 2; i++) {
+		EXPECT_EQ(servers[i]->stats.num_hashed_uploads, 2) << "server " << i;
+		EXPECT_EQ(servers[i]->stats.num_skipped_uploads, 1) << "server " << i;
+	}
+}
+
+TEST_F(DeviceNetworkMultiTest, tiles_on_all_servers)
+{
+	const int size = 64, tile_size = 16;
+
+	SessionParams session_params;
+	session_params.device = multi_info;
+	session_params.background = true;
+	session_params.samples = 1;
+	session_params.tile_size = make_int2(tile_size, tile_size);
+
+	Session *session = new Session(session_params);
+	session->scene = new Scene(SceneParams(), session_params.device);
+	session->scene->camera->width = size;
+	session->scene->camera->height = size;
+	session->scene->camera->compute_auto_viewplane();
+
+	BufferParams buffer_params;
+	buffer_params.width = size;
+	buffer_params.height = size;
+	buffer_params.full_width = size;
+	buffer_params.full_height = size;
+
+	session->reset(buffer_params, session_params.samples);
+	session->start();
+	session->wait();
+
+	EXPECT_FALSE(session->device->have_error());
+
+	/* deleting the session disconnects from the servers */
+	delete session;
+	join_servers();
+
+	int num_tiles = 0;
+	for(int i = 0; i < 2; i++) {
+		EXPECT_GT(servers[i]->stats.num_tiles, 0) << "server " << i;
+		num_tiles += servers[i]->stats.num_tiles;
+	}
+
+	EXPECT_EQ(num_tiles, (size/tile_size)*(size/tile_size));
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "render/bake.h"
+#include "render/film.h"
+#include "render/graph.h"
+#include "render/integrator.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_task.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Two planes lit by a point light, the upper one partly occluding the lower
+ * one, baked on the CPU. The lower plane mixes diffuse with subsurface
+ * scattering, the upper one has the default surface shader. */
+class RenderBakeTest : public ::testing::Test {
+protected:
+	RenderBakeTest()
+	: device(NULL),
+	  scene(NULL)
+	{
+	}
+
+	void SetUp()
+	{
+		TaskScheduler::init();
+
+		DeviceInfo device_info = Device::available_devices()[0];
+		ASSERT_EQ(device_info.type, DEVICE_CPU);
+
+		device = Device::create(device_info, stats, true);
+		scene = new Scene(SceneParams(), device_info);
+
+		add_plane(0.0f, 2.0f, add_subsurface_shader());
+		add_plane(0.5f, 1.0f, scene->default_surface);
+		add_light(make_float3(0.5f, 0.5f, 3.0f));
+
+		scene->integrator->aa_samples = 4;
+		scene->integrator->tag_update(scene);
+
+		/* light passes need use_light_pass of the film */
+		Pass::add(PASS_LIGHT, scene->film->passes);
+		scene->film->tag_update(scene);
+
+		scene->bake_manager->set_baking(true);
+		ASSERT_TRUE(device->load_kernels(DeviceRequestedFeatures()));
+		scene->device_update(device, progress);
+
+		/* small device tasks, so they span several objects */
+		scene->bake_manager->set_shader_limit(4, 4);
+	}
+
+	void TearDown()
+	{
+		foreach(BakeData *bake_data, objects)
+			delete bake_data;
+
+		delete scene;
+		delete device;
+
+		TaskScheduler::exit();
+	}
+
+	Shader *add_subsurface_shader()
+	{
+		ShaderGraph *graph = new ShaderGraph();
+
+		DiffuseBsdfNode *diffuse = new DiffuseBsdfNode();
+		graph->add(diffuse);
+
+		SubsurfaceScatteringNode *subsurface = new SubsurfaceScatteringNode();
+		subsurface->radius = make_float3(0.2f, 0.2f, 0.2f);
+		graph->add(subsurface);
+
+		MixClosureNode *mix = new MixClosureNode();
+		mix->fac = 0.5f;
+		graph->add(mix);
+
+		graph->connect(diffuse->output("BSDF"), mix->input("Closure1"));
+		graph->connect(subsurface->output("BSSRDF"), mix->input("Closure2"));
+		graph->connect(mix->output("Closure"), graph->output()->input("Surface"));
+
+		Shader *shader = new Shader();
+		shader->name = "subsurface";
+		shader->graph = graph;
+		scene->shaders.push_back(shader);
+		return shader;
+	}
+
+	void add_light(float3 co)
+	{
+		ShaderGraph *graph = new ShaderGraph();
+
+		EmissionNode *emission = new EmissionNode();
+		emission->color = make_float3(1.0f, 1.0f, 1.0f);
+		emission->strength = 100.0f;
+		graph->add(emission);
+
+		graph->connect(emission->output("Emission"), graph->output()->input("Surface"));
+
+		Shader *shader = new Shader();
+		shader->name = "light";
+		shader->graph = graph;
+		scene->shaders.push_back(shader);
+
+		Light *light = new Light();
+		light->type = LIGHT_POINT;
+		light->co = co;
+		light->size = 0.1f;
+		light->shader = shader;
+		scene->lights.push_back(light);
+	}
+
+	void add_plane(float z, float size, Shader *shader)
+	{
+		Mesh *mesh = new Mesh();
+		mesh->used_shaders.push_back(shader);
+		mesh->reserve_mesh(4, 2);
+		mesh->add_vertex(make_float3(-size, -size, z));
+		mesh->add_vertex(make_float3(size, -size, z));
+		mesh->add_vertex(make_float3(size, size, z));
+		mesh->add_vertex(make_float3(-size, size, z));
+		mesh->add_triangle(0, 1, 2, 0, false);
+		mesh->add_triangle(0, 2, 3, 0, false);
+		scene->meshes.push_back(mesh);
+
+		Object *object = new Object();
+		object->mesh = mesh;
+		object->tfm = transform_identity();
+		scene->objects.push_back(object);
+	}
+
+	/* Pixels spread over both triangles of the object, with some of them
+	 * not covered by the object. */
+	BakeData *add_bake_data(int object, int num_pixels)
+	{
+		BakeData *bake_data = new BakeData(object, scene->objects[object]->mesh->tri_offset, num_pixels);
+
+		for(int i = 0; i < num_pixels; i++) {
+			if(i % 7 == 3) {
+				bake_data->set_null(i);
+				continue;
+			}
+
+			float uv[2] = {((i % 8) + 0.5f) / 16.0f, ((i / 8) % 8 + 0.5f) / 16.0f};
+			bake_data->set(i, i % 2, uv, 0.01f, 0.0f, 0.0f, 0.01f);
+		}
+
+		objects.push_back(bake_data);
+		return bake_data;
+	}
+
+	vector<float> bake(const BakePass& pass, BakeData *bake_data)
+	{
+		vector<float> result(bake_data->size() * 4, 0.0f);
+
+		EXPECT_TRUE(scene->bake_manager->bake(device, &scene->dscene, scene, progress,
+		                                      pass.type, pass.pass_filter,
+		                                      bake_data, result.data()));
+
+		return result;
+	}
+
+	static void write_result(vector<vector<float> > *results,
+	                         const vector<BakeData*>& objects,
+	                         int num_passes,
+	                         BakeData *bake_data,
+	                         int pass,
+	                         const float *pass_result)
+	{
+		int object = 0;
+		while(objects[object] != bake_data)
+			object++;
+
+		vector<float>& result = (*results)[object * num_passes + pass];
+		result.resize(bake_data->size() * 4, 0.0f);
+
+		for(size_t i = 0; i < bake_data->size(); i++) {
+			if(bake_data->is_valid(i)) {
+				for(int j = 0; j < 4; j++) {
+					result[i*4 + j] = pass_result[i*4 + j];
+				}
+			}
+		}
+	}
+
+	/* Results of all objects and passes, object by object. */
+	vector<vector<float> > bake_batch(const vector<BakePass>& passes)
+	{
+		vector<vector<float> > results(objects.size() * passes.size());
+
+		EXPECT_TRUE(scene->bake_manager->bake_batch(device, &scene->dscene, scene, progress,
+		                                            passes, objects,
+		                                            function_bind(&write_result, &results, objects,
+		                                                          (int)passes.size(), _1, _2, _3)));
+
+		return results;
+	}
+
+	static void expect_results_equal(const vector<float>& single, const vector<float>& batch)
+	{
+		ASSERT_EQ(single.size(), batch.size());
+
+		for(size_t i = 0; i < single.size(); i++) {
+			EXPECT_NEAR(single[i], batch[i], 1e-6f) << "index " << i;
+		}
+	}
+
+	Device *device;
+	Scene *scene;
+	Stats stats;
+	Progress progress;
+	vector<BakeData*> objects;
+};
+
+}  /* namespace */
+
+TEST_F(RenderBakeTest, multipass_matches_single_pass)
+{
+	/* Data passes and one light pass, which is what the single light pass
+	 * bake computes as well. */
+	vector<BakePass> passes;
+	passes.push_back(BakePass(SHADER_EVAL_NORMAL, 0));
+	passes.push_back(BakePass(SHADER_EVAL_AO, BAKE_FILTER_AO));
+	passes.push_back(BakePass(SHADER_EVAL_UV, 0));
+	passes.push_back(BakePass(SHADER_EVAL_DIFFUSE_COLOR, 0));
+	passes.push_back(BakePass(SHADER_EVAL_EMISSION, 0));
+
+	BakeData *bake_data = add_bake_data(0, 45);
+
+	vector<vector<float> > batch = bake_batch(passes);
+
+	for(int pass = 0; pass < passes.size(); pass++) {
+		expect_results_equal(bake(passes[pass], bake_data), batch[pass]);
+	}
+
+	/* the occluder shows up in the ambient occlusion */
+	float ao_min = 1.0f, ao_max = 0.0f;
+	for(size_t i = 0; i < bake_data->size(); i++) {
+		if(bake_data->is_valid(i)) {
+			ao_min = min(ao_min, batch[1][i*4]);
+			ao_max = max(ao_max, batch[1][i*4]);
+		}
+	}
+	EXPECT_LT(ao_min, ao_max);
+
+	/* Light passes with different light filters, which change how the light
+	 * pass is computed. Ambient occlusion adds to the direct diffuse light,
+	 * and subsurface scattering skips the BSDF lighting. */
+	const int diffuse_filter = BAKE_FILTER_DIFFUSE | BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT;
+	const int subsurface_filter = BAKE_FILTER_SUBSURFACE | BAKE_FILTER_DIRECT | BAKE_FILTER_INDIRECT;
+
+	vector<BakePass> ao_passes;
+	ao_passes.push_back(BakePass(SHADER_EVAL_DIFFUSE, BAKE_FILTER_DIFFUSE | BAKE_FILTER_DIRECT));
+	ao_passes.push_back(BakePass(SHADER_EVAL_AO, BAKE_FILTER_AO));
+
+	vector<BakePass> subsurface_passes;
+	subsurface_passes.push_back(BakePass(SHADER_EVAL_DIFFUSE, diffuse_filter));
+	subsurface_passes.push_back(BakePass(SHADER_EVAL_SUBSURFACE, subsurface_filter));
+	subsurface_passes.push_back(BakePass(SHADER_EVAL_NORMAL, 0));
+
+	const vector<BakePass> *pass_sets[2] = {&ao_passes, &subsurface_passes};
+
+	for(int set = 0; set < 2; set++) {
+		const vector<BakePass>& set_passes = *pass_sets[set];
+		vector<vector<float> > set_batch = bake_batch(set_passes);
+
+		for(int pass = 0; pass < set_passes.size(); pass++) {
+			expect_results_equal(bake(set_passes[pass], bake_data), set_batch[pass]);
+		}
+
+		/* the light reaches the baked plane */
+		float diffuse_max = 0.0f;
+		for(size_t i = 0; i < bake_data->size(); i++) {
+			diffuse_max = max(diffuse_max, set_batch[0][i*4]);
+		}
+		EXPECT_GT(diffuse_max, 0.0f);
+	}
+}
+
+TEST_F(RenderBakeTest, multi_object_matches_single_object)
+{
+	/* Pixel noise depends on the position of the pixel in the batch, so only
+	 * passes without sampling noise are compared. */
+	vector<BakePass> passes;
+	passes.push_back(BakePass(SHADER_EVAL_NORMAL, 0));
+	passes.push_back(BakePass(SHADER_EVAL_UV, 0));
+	passes.push_back(BakePass(SHADER_EVAL_DIFFUSE_COLOR, 0));
+
+	add_bake_data(0, 37);
+	add_bake_data(1, 23);
+	add_bake_data(0, 0);
+
+	vector<vector<float> > batch = bake_batch(passes);
+
+	for(int object = 0; object < objects.size(); object++) {
+		for(int pass = 0; pass < passes.size(); pass++) {
+			expect_results_equal(bake(passes[pass], objects[object]),
+			                     batch[object * passes.size() + pass]);
+		}
+	}
+}
+
+CCL_NAMESPACE_END
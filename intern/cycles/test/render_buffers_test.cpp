@@ -0,0 +1,271 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/buffers.h"
+#include "render/film.h"
+
+#include "util/util_half.h"
+#include "util/util_math.h"
+#include "util/util_types.h"
+
+#include "kernel/kernel_write_passes.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Buffers with float, half float and byte passes, filled the way the kernel
+ * writes them and read back the way they are passed on to Blender. */
+class RenderBuffersTest : public ::testing::Test {
+protected:
+	enum { W = 2, H = 1, SAMPLES = 3 };
+
+	RenderBuffersTest()
+	: buffers(NULL)
+	{
+	}
+
+	void SetUp()
+	{
+		BufferParams params;
+		params.width = params.full_width = W;
+		params.height = params.full_height = H;
+		params.add_pass(PASS_DEPTH, PASS_STORAGE_HALF);
+		params.add_pass(PASS_OBJECT_ID, PASS_STORAGE_BYTE);
+		params.add_pass(PASS_NORMAL, PASS_STORAGE_HALF);
+		/* Added first so it stays float, rather than taking the storage of
+		 * the pass it divides. */
+		params.add_pass(PASS_DIFFUSE_COLOR, PASS_STORAGE_FLOAT);
+		params.add_pass(PASS_DIFFUSE_DIRECT, PASS_STORAGE_HALF);
+
+		buffers.params = params;
+		buffers.buffer.resize(params.get_passes_size()*W*H);
+		memset(buffers.buffer.get_data(), 0, buffers.buffer.memory_size());
+	}
+
+	float *pixel(int x)
+	{
+		return buffers.buffer.get_data() + x*buffers.params.get_passes_size();
+	}
+
+	int offset(PassType type)
+	{
+		int offset = -1;
+		EXPECT_TRUE(buffers.params.find_pass(type, offset) != NULL);
+		return offset;
+	}
+
+	/* Sample values of a pixel, samples differ so averaging is tested. */
+	float depth(int x, int sample) { return 1.5f + x + sample; }
+	float object_id(int x) { return (x == 0)? 7.0f: 300.0f; }
+	float3 normal(int x) { return make_float3(0.25f, -0.5f, (x == 0)? 1.0f: -1.0f); }
+	float3 color(int x) { return make_float3(0.5f, 0.25f, (x == 0)? 1.0f: 0.125f); }
+	float3 light(int sample) { return make_float3(1.0f, 2.0f, 4.0f)*(float)(sample + 1); }
+
+	void write_samples()
+	{
+		for(int sample = 0; sample < SAMPLES; sample++) {
+			for(int x = 0; x < W; x++) {
+				float *buffer = pixel(x);
+
+				kernel_write_pass_float4(buffer + offset(PASS_COMBINED), sample,
+				                         make_float4(1.0f, 1.0f, 1.0f, 1.0f));
+				kernel_write_pass_half(buffer, offset(PASS_DEPTH), sample,
+				                       make_float4(depth(x, sample), 0.0f, 0.0f, 0.0f), 1);
+				if(sample == 0) {
+					kernel_write_pass_byte(buffer, offset(PASS_OBJECT_ID), object_id(x));
+				}
+
+				float3 N = normal(x);
+				kernel_write_pass_half(buffer, offset(PASS_NORMAL), sample,
+				                       make_float4(N.x, N.y, N.z, 0.0f), 3);
+
+				float3 direct = color(x)*light(sample);
+				kernel_write_pass_half(buffer, offset(PASS_DIFFUSE_DIRECT), sample,
+				                       make_float4(direct.x, direct.y, direct.z, 0.0f), 3);
+				kernel_write_pass_float4(buffer + offset(PASS_DIFFUSE_COLOR), sample,
+				                         make_float4(color(x).x, color(x).y, color(x).z, 0.0f));
+			}
+		}
+	}
+
+	RenderBuffers buffers;
+};
+
+}  /* namespace */
+
+TEST_F(RenderBuffersTest, layout)
+{
+	/* Float passes first, then half float and byte passes with offsets in
+	 * bytes, each sorted by number of components and type. */
+	const int compressed = buffers.params.get_compressed_offset()*sizeof(float);
+	EXPECT_EQ(compressed, 8*sizeof(float));
+	EXPECT_EQ(offset(PASS_COMBINED), 0);
+	EXPECT_EQ(offset(PASS_DIFFUSE_COLOR), 4);
+	EXPECT_EQ(offset(PASS_NORMAL), compressed);
+	EXPECT_EQ(offset(PASS_DIFFUSE_DIRECT), compressed + 4*sizeof(ushort));
+	EXPECT_EQ(offset(PASS_DEPTH), compressed + 8*sizeof(ushort));
+	EXPECT_EQ(offset(PASS_OBJECT_ID), compressed + 10*sizeof(ushort));
+
+	/* The compressed passes take 21 bytes, rounded up to whole floats and
+	 * the pass stride to a multiple of four. */
+	EXPECT_EQ(buffers.params.get_passes_size(), 16);
+}
+
+TEST_F(RenderBuffersTest, float_pass)
+{
+	write_samples();
+
+	float pixels[W*H*4];
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_COMBINED, 1.0f, SAMPLES, 4, pixels));
+
+	for(int x = 0; x < W; x++) {
+		for(int i = 0; i < 4; i++) {
+			EXPECT_EQ(pixels[x*4 + i], 1.0f);
+		}
+	}
+}
+
+TEST_F(RenderBuffersTest, half_pass)
+{
+	write_samples();
+
+	float pixels[W*H*3];
+
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_DEPTH, 1.0f, SAMPLES, 1, pixels));
+	for(int x = 0; x < W; x++) {
+		/* Average of the three samples, exact in half float. */
+		EXPECT_EQ(pixels[x], depth(x, 1));
+	}
+
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_NORMAL, 1.0f, SAMPLES, 3, pixels));
+	for(int x = 0; x < W; x++) {
+		EXPECT_EQ(pixels[x*3 + 0], normal(x).x);
+		EXPECT_EQ(pixels[x*3 + 1], normal(x).y);
+		EXPECT_EQ(pixels[x*3 + 2], normal(x).z);
+	}
+}
+
+TEST_F(RenderBuffersTest, half_pass_divided_by_float_pass)
+{
+	write_samples();
+
+	float pixels[W*H*3];
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_DIFFUSE_DIRECT, 1.0f, SAMPLES, 3, pixels));
+
+	/* Direct light with the color divided out is the average light. */
+	const float3 average = light(1);
+	for(int x = 0; x < W; x++) {
+		EXPECT_NEAR(pixels[x*3 + 0], average.x, average.x*1e-3f);
+		EXPECT_NEAR(pixels[x*3 + 1], average.y, average.y*1e-3f);
+		EXPECT_NEAR(pixels[x*3 + 2], average.z, average.z*1e-3f);
+	}
+}
+
+TEST_F(RenderBuffersTest, byte_pass)
+{
+	write_samples();
+
+	float pixels[W*H];
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_OBJECT_ID, 1.0f, SAMPLES, 1, pixels));
+
+	/* IDs are exact, and clamped to the largest byte value. */
+	EXPECT_EQ(pixels[0], 7.0f);
+	EXPECT_EQ(pixels[1], 255.0f);
+}
+
+/* Emission written on some samples only, with the pixel on the right
+ * converging early when adaptive sampling is used. Half float passes must
+ * read back like float passes: the sum of the samples divided by the number
+ * of samples the pixel received. */
+static void read_partial_emission(PassStorage storage, bool adaptive, float pixels[6])
+{
+	const int num_samples = 4;
+	const int converged_samples = 2;
+
+	BufferParams params;
+	params.width = params.full_width = 2;
+	params.height = params.full_height = 1;
+	params.add_pass(PASS_EMISSION, storage);
+	params.adaptive_sampling_pass = adaptive;
+
+	RenderBuffers buffers(NULL);
+	buffers.params = params;
+	buffers.buffer.resize(params.get_passes_size()*2);
+	memset(buffers.buffer.get_data(), 0, buffers.buffer.memory_size());
+
+	int pass_stride = params.get_passes_size();
+	int offset;
+	ASSERT_TRUE(params.find_pass(PASS_EMISSION, offset) != NULL);
+	ASSERT_EQ(params.find_pass(PASS_EMISSION, offset)->storage, storage);
+
+	for(int x = 0; x < 2; x++) {
+		float *buffer = buffers.buffer.get_data() + x*pass_stride;
+		int pixel_samples = (adaptive && x == 1)? converged_samples: num_samples;
+
+		for(int sample = 0; sample < pixel_samples; sample++) {
+			/* emission is only hit on the first and last sample */
+			if(sample != 0 && sample != num_samples - 1)
+				continue;
+
+			float4 value = make_float4(0.5f, 1.0f, 2.0f, 0.0f)*(float)(sample + 1 + x);
+			if(storage == PASS_STORAGE_FLOAT)
+				kernel_write_pass_float4(buffer + offset, sample, value);
+			else
+				kernel_write_pass_half(buffer, offset, sample, value, 3);
+		}
+
+		if(adaptive) {
+			/* converged state, and the scaling of float passes done by
+			 * kernel_adaptive_adjust */
+			buffer[pass_stride - 1] = (float)pixel_samples;
+			if(storage == PASS_STORAGE_FLOAT) {
+				for(int i = 0; i < 4; i++)
+					buffer[offset + i] *= (float)num_samples/pixel_samples;
+			}
+		}
+	}
+
+	ASSERT_TRUE(buffers.get_pass_rect(PASS_EMISSION, 1.0f, num_samples, 3, pixels));
+}
+
+TEST(render_buffers, half_pass_partial_samples)
+{
+	float float_pixels[6], half_pixels[6];
+	read_partial_emission(PASS_STORAGE_FLOAT, false, float_pixels);
+	read_partial_emission(PASS_STORAGE_HALF, false, half_pixels);
+
+	for(int i = 0; i < 6; i++) {
+		EXPECT_GT(float_pixels[i], 0.0f);
+		EXPECT_NEAR(half_pixels[i], float_pixels[i], float_pixels[i]*1e-3f) << "component " << i;
+	}
+}
+
+TEST(render_buffers, half_pass_adaptive_samples)
+{
+	float float_pixels[6], half_pixels[6];
+	read_partial_emission(PASS_STORAGE_FLOAT, true, float_pixels);
+	read_partial_emission(PASS_STORAGE_HALF, true, half_pixels);
+
+	for(int i = 0; i < 6; i++) {
+		EXPECT_GT(float_pixels[i], 0.0f);
+		EXPECT_NEAR(half_pixels[i], float_pixels[i], float_pixels[i]*1e-3f) << "component " << i;
+	}
+}
+
+CCL_NAMESPACE_END
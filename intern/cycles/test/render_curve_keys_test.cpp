@@ -0,0 +1,128 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/mesh.h"
+
+#include "util/util_math.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int NUM_CURVES = 3;
+const int NUM_KEYS = 5;
+/* number of steps of the 16 bit grid over the curve extent */
+const float QUANTIZE_STEPS = 65535.0f;
+
+/* Strands of different extent and distance from the origin. */
+class CurveKeysTest : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		const float3 origins[NUM_CURVES] = {make_float3(0.0f, 0.0f, 0.0f),
+		                                    make_float3(-3.7f, 12.5f, 0.25f),
+		                                    make_float3(1000.0f, -250.0f, 31.0f)};
+		const float lengths[NUM_CURVES] = {0.01f, 1.3f, 7.0f};
+
+		mesh.reserve_curves(NUM_CURVES, NUM_CURVES*NUM_KEYS);
+
+		for(int i = 0; i < NUM_CURVES; i++) {
+			mesh.add_curve(mesh.curve_keys.size(), 0);
+
+			for(int k = 0; k < NUM_KEYS; k++) {
+				float t = (float)k / (NUM_KEYS - 1);
+				float3 co = origins[i] + lengths[i] * make_float3(t,
+				                                                  0.3f * sinf(7.0f * t),
+				                                                  t * t - 0.17f * t);
+				mesh.add_curve_key(co, 0.02f * (1.0f - 0.9f * t) + 0.001f * i);
+			}
+		}
+	}
+
+	/* Largest error allowed for a key of a curve: a fraction of a grid step,
+	 * plus rounding of the float result. */
+	void curve_tolerance(int curve, float grid_fraction, float *r_co, float *r_radius)
+	{
+		Mesh::Curve c = mesh.get_curve(curve);
+		BoundBox bounds = BoundBox::empty;
+		float max_radius = 0.0f;
+
+		for(int k = 0; k < c.num_keys; k++) {
+			bounds.grow(mesh.curve_keys[c.first_key + k]);
+			max_radius = max(max_radius, mesh.curve_radius[c.first_key + k]);
+		}
+
+		float3 size = bounds.size();
+		float extent = max(max(size.x, size.y), size.z);
+		float magnitude = max(len(bounds.min), len(bounds.max));
+
+		*r_co = grid_fraction * extent / QUANTIZE_STEPS + 4.0f * FLT_EPSILON * magnitude;
+		*r_radius = grid_fraction * max_radius / QUANTIZE_STEPS + 4.0f * FLT_EPSILON * max_radius;
+	}
+
+	void expect_near_keys(const array<float3>& keys,
+	                      const array<float>& radius,
+	                      float grid_fraction)
+	{
+		for(int i = 0; i < NUM_CURVES; i++) {
+			float co_tolerance, radius_tolerance;
+			curve_tolerance(i, grid_fraction, &co_tolerance, &radius_tolerance);
+
+			Mesh::Curve curve = mesh.get_curve(i);
+			for(int k = 0; k < curve.num_keys; k++) {
+				int key = curve.first_key + k;
+
+				EXPECT_NEAR(mesh.curve_keys[key].x, keys[key].x, co_tolerance) << "curve " << i << " key " << k;
+				EXPECT_NEAR(mesh.curve_keys[key].y, keys[key].y, co_tolerance) << "curve " << i << " key " << k;
+				EXPECT_NEAR(mesh.curve_keys[key].z, keys[key].z, co_tolerance) << "curve " << i << " key " << k;
+				EXPECT_NEAR(mesh.curve_radius[key], radius[key], radius_tolerance) << "curve " << i << " key " << k;
+			}
+		}
+	}
+
+	Mesh mesh;
+};
+
+}  // namespace
+
+TEST_F(CurveKeysTest, round_trip_error)
+{
+	array<float3> keys = mesh.curve_keys;
+	array<float> radius = mesh.curve_radius;
+
+	mesh.quantize_curve_keys();
+
+	expect_near_keys(keys, radius, 0.5f);
+}
+
+TEST_F(CurveKeysTest, round_trip_stable)
+{
+	/* Keys already on the grid only move by float rounding, so keys that are
+	 * quantized on the host decode to the same keys on the device. */
+	mesh.quantize_curve_keys();
+
+	array<float3> keys = mesh.curve_keys;
+	array<float> radius = mesh.curve_radius;
+
+	mesh.quantize_curve_keys();
+
+	expect_near_keys(keys, radius, 0.0f);
+}
+
+CCL_NAMESPACE_END
@@ -21,6 +21,7 @@
 #include "render/scene.h"
 #include "render/nodes.h"
 #include "util/util_logging.h"
+#include "util/util_md5.h"
 #include "util/util_string.h"
 #include "util/util_vector.h"
 
@@ -1677,4 +1678,62 @@ TEST(render_graph, constant_fold_convert_color_float_color)
 	graph.finalize(&scene);
 }
 
+/*
+ * Tests:
+ *  - Graphs with equal nodes and links hash equal, regardless of node names.
+ *  - Changing a value or a link changes the hash.
+ */
+TEST(render_graph, hash_structure)
+{
+	DEFINE_COMMON_VARIABLES(builder, log);
+
+	EXPECT_ANY_MESSAGE(log);
+
+	ShaderGraph graph_same, graph_value, graph_link;
+	ShaderGraphBuilder builder_same(&graph_same);
+	ShaderGraphBuilder builder_value(&graph_value);
+	ShaderGraphBuilder builder_link(&graph_link);
+
+	builder
+		.add_attribute("Attribute")
+		.add_node(ShaderNodeBuilder<NoiseTextureNode>("Noise")
+		          .set("Scale", 2.0f))
+		.add_connection("Attribute::Vector", "Noise::Vector")
+		.output_color("Noise::Color");
+
+	builder_same
+		.add_attribute("Attribute")
+		.add_node(ShaderNodeBuilder<NoiseTextureNode>("OtherNoise")
+		          .set("Scale", 2.0f))
+		.add_connection("Attribute::Vector", "OtherNoise::Vector")
+		.output_color("OtherNoise::Color");
+
+	builder_value
+		.add_attribute("Attribute")
+		.add_node(ShaderNodeBuilder<NoiseTextureNode>("Noise")
+		          .set("Scale", 3.0f))
+		.add_connection("Attribute::Vector", "Noise::Vector")
+		.output_color("Noise::Color");
+
+	builder_link
+		.add_attribute("Attribute")
+		.add_node(ShaderNodeBuilder<NoiseTextureNode>("Noise")
+		          .set("Scale", 2.0f))
+		.add_connection("Attribute::Vector", "Noise::Vector")
+		.output_color("Noise::Fac");
+
+	ShaderGraph *graphs[4] = {&graph, &graph_same, &graph_value, &graph_link};
+	string hashes[4];
+	for(int i = 0; i < 4; i++) {
+		graphs[i]->finalize(&scene);
+		MD5Hash md5;
+		graphs[i]->hash(md5);
+		hashes[i] = md5.get_hex();
+	}
+
+	EXPECT_EQ(hashes[0], hashes[1]);
+	EXPECT_NE(hashes[0], hashes[2]);
+	EXPECT_NE(hashes[0], hashes[3]);
+}
+
 CCL_NAMESPACE_END
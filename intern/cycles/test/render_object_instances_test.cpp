@@ -0,0 +1,219 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "kernel/kernel_types.h"
+#include "render/graph.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/shader.h"
+#include "util/util_progress.h"
+#include "util/util_stats.h"
+#include "util/util_task.h"
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int NUM_INSTANCES = 4;
+
+/* An emissive and a diffuse quad, each placed four times, either as separate
+ * objects or as one object with compact instances. Both must end up with the
+ * same data on the device. */
+class RenderObjectInstancesTest : public ::testing::Test {
+protected:
+	void SetUp()
+	{
+		TaskScheduler::init();
+
+		device_info = Device::available_devices()[0];
+		ASSERT_EQ(device_info.type, DEVICE_CPU);
+
+		device = Device::create(device_info, stats, true);
+		ASSERT_TRUE(device->load_kernels(DeviceRequestedFeatures()));
+	}
+
+	void TearDown()
+	{
+		delete device;
+
+		TaskScheduler::exit();
+	}
+
+	Scene *create_scene(bool use_instances)
+	{
+		Scene *scene = new Scene(SceneParams(), device_info);
+
+		add_quads(scene, add_emission_shader(scene), 0.0f, use_instances);
+		add_quads(scene, scene->default_surface, 4.0f, use_instances);
+
+		scene->device_update(device, progress);
+		return scene;
+	}
+
+	Shader *add_emission_shader(Scene *scene)
+	{
+		ShaderGraph *graph = new ShaderGraph();
+
+		EmissionNode *emission = new EmissionNode();
+		emission->color = make_float3(1.0f, 1.0f, 1.0f);
+		emission->strength = 1.0f;
+		graph->add(emission);
+
+		graph->connect(emission->output("Emission"), graph->output()->input("Surface"));
+
+		Shader *shader = new Shader();
+		shader->name = "emission";
+		shader->graph = graph;
+		scene->shaders.push_back(shader);
+		return shader;
+	}
+
+	static Transform instance_tfm(int i, float y)
+	{
+		return transform_translate(make_float3(3.0f*i, y, 0.0f)) *
+		       transform_rotate(0.3f*i, make_float3(0.0f, 0.0f, 1.0f)) *
+		       transform_scale(make_float3(1.0f + 0.5f*i, 1.0f + 0.5f*i, 1.0f + 0.5f*i));
+	}
+
+	void add_quads(Scene *scene, Shader *shader, float y, bool use_instances)
+	{
+		Mesh *mesh = new Mesh();
+		mesh->used_shaders.push_back(shader);
+		mesh->reserve_mesh(4, 2);
+		mesh->add_vertex(make_float3(-1.0f, -1.0f, 0.0f));
+		mesh->add_vertex(make_float3(1.0f, -1.0f, 0.0f));
+		mesh->add_vertex(make_float3(1.0f, 1.0f, 0.0f));
+		mesh->add_vertex(make_float3(-1.0f, 1.0f, 0.0f));
+		mesh->add_triangle(0, 1, 2, 0, false);
+		mesh->add_triangle(0, 2, 3, 0, false);
+		scene->meshes.push_back(mesh);
+
+		Object *instanced = NULL;
+
+		for(int i = 0; i < NUM_INSTANCES; i++) {
+			ObjectInstance instance;
+			instance.tfm = instance_tfm(i, y);
+			instance.dupli_generated = make_float3(0.1f*i, 0.2f*i, 0.3f*i);
+			instance.dupli_uv = make_float2(0.25f*i, 0.5f);
+			instance.random_id = 12345u*(i + 1);
+
+			if(instanced) {
+				instanced->instances.push_back(instance);
+				continue;
+			}
+
+			Object *object = new Object();
+			object->mesh = mesh;
+			object->tfm = instance.tfm;
+			object->dupli_generated = instance.dupli_generated;
+			object->dupli_uv = instance.dupli_uv;
+			object->random_id = instance.random_id;
+			scene->objects.push_back(object);
+
+			if(use_instances) {
+				instanced = object;
+			}
+		}
+	}
+
+	DeviceInfo device_info;
+	Device *device;
+	Stats stats;
+	Progress progress;
+};
+
+/* Object index on the device of the i-th quad of a kind. */
+int object_index(bool use_instances, int kind, int i)
+{
+	if(!use_instances) {
+		return kind*NUM_INSTANCES + i;
+	}
+	else if(i == 0) {
+		return kind;
+	}
+	else {
+		return 2 + kind*(NUM_INSTANCES - 1) + (i - 1);
+	}
+}
+
+}  // namespace
+
+TEST_F(RenderObjectInstancesTest, same_device_data)
+{
+	Scene *objects_scene = create_scene(false);
+	Scene *instances_scene = create_scene(true);
+
+	DeviceScene& objects = objects_scene->dscene;
+	DeviceScene& instances = instances_scene->dscene;
+
+	ASSERT_EQ(instances_scene->objects.size(), 2);
+	ASSERT_EQ(objects.object_flag.size(), 2*NUM_INSTANCES);
+	ASSERT_EQ(instances.object_flag.size(), objects.object_flag.size());
+	ASSERT_EQ(instances.objects.size(), objects.objects.size());
+
+	for(int kind = 0; kind < 2; kind++) {
+		for(int i = 0; i < NUM_INSTANCES; i++) {
+			int a = object_index(false, kind, i);
+			int b = object_index(true, kind, i);
+
+			EXPECT_EQ(objects.object_flag.get_data()[a], instances.object_flag.get_data()[b]);
+
+			/* transforms, properties and dupli coordinates, the patch map
+			 * offset is only written for subdivision meshes */
+			for(int j = 0; j < OBJECT_SIZE - 1; j++) {
+				float4 fa = objects.objects.get_data()[a*OBJECT_SIZE + j];
+				float4 fb = instances.objects.get_data()[b*OBJECT_SIZE + j];
+
+				EXPECT_EQ(fa.x, fb.x) << "object " << a << " row " << j;
+				EXPECT_EQ(fa.y, fb.y) << "object " << a << " row " << j;
+				EXPECT_EQ(fa.z, fb.z) << "object " << a << " row " << j;
+				EXPECT_EQ(fa.w, fb.w) << "object " << a << " row " << j;
+			}
+		}
+	}
+
+	/* every quad is an instance in the top level BVH */
+	EXPECT_EQ(objects.data.bvh.have_instancing, 1);
+	EXPECT_EQ(instances.data.bvh.have_instancing, 1);
+	EXPECT_EQ(instances.prim_object.size(), objects.prim_object.size());
+
+	/* all emissive quads are in the light distribution, with the same area */
+	ASSERT_EQ(instances.light_distribution.size(), objects.light_distribution.size());
+	ASSERT_EQ(objects.light_distribution.size(), NUM_INSTANCES*2 + 1);
+
+	for(int i = 0; i < NUM_INSTANCES*2; i++) {
+		float4 da = objects.light_distribution.get_data()[i];
+		float4 db = instances.light_distribution.get_data()[i];
+
+		/* two triangles per quad, in the order of the device objects */
+		EXPECT_EQ(__float_as_int(da.w), object_index(false, 0, i/2));
+		EXPECT_EQ(__float_as_int(db.w), object_index(true, 0, i/2));
+		EXPECT_EQ(__float_as_int(da.y), __float_as_int(db.y));
+		EXPECT_NEAR(da.x, db.x, 1e-5f);
+	}
+
+	delete instances_scene;
+	delete objects_scene;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Grid with a single blob of data, not aligned to tiles. */
+class SparseGridTest : public ::testing::Test {
+protected:
+	enum { W = 40, H = 17, D = 12 };
+
+	void SetUp()
+	{
+		voxels.resize(W * H * D, 0.0f);
+		for(int z = 2; z < 5; z++) {
+			for(int y = 9; y < 11; y++) {
+				for(int x = 6; x < 10; x++) {
+					voxel(x, y, z) = 1.0f + x + 10.0f * y + 100.0f * z;
+				}
+			}
+		}
+	}
+
+	float& voxel(int x, int y, int z)
+	{
+		return voxels[x + W * (y + H * z)];
+	}
+
+	vector<float> voxels;
+};
+
+}  /* namespace */
+
+TEST_F(SparseGridTest, tiles)
+{
+	SparseGridImage *grid = sparse_grid_build(&voxels[0], W, H, D, 1,
+	                                          INTERPOLATION_CLOSEST,
+	                                          EXTENSION_CLIP);
+
+	EXPECT_EQ(grid->tiles_x, 5);
+	EXPECT_EQ(grid->tiles_y, 3);
+	EXPECT_EQ(grid->tiles_z, 2);
+	/* The blob crosses a tile border along x only. */
+	EXPECT_EQ(grid->voxels.size(), (size_t)(2 * SPARSE_GRID_TILE_VOXELS));
+
+	for(int z = 0; z < D; z++) {
+		for(int y = 0; y < H; y++) {
+			for(int x = 0; x < W; x++) {
+				EXPECT_EQ(grid->fetch(x, y, z).x, voxel(x, y, z));
+			}
+		}
+	}
+
+	delete grid;
+}
+
+TEST_F(SparseGridTest, interpolation)
+{
+	SparseGridImage *grid = sparse_grid_build(&voxels[0], W, H, D, 1,
+	                                          INTERPOLATION_LINEAR,
+	                                          EXTENSION_CLIP);
+
+	/* Halfway between voxel centers of (7, 9, 3) and (8, 10, 4). */
+	const float x = 8.0f / W, y = 10.0f / H, z = 4.0f / D;
+	float expected = 0.0f;
+	for(int k = 3; k <= 4; k++) {
+		for(int j = 9; j <= 10; j++) {
+			for(int i = 7; i <= 8; i++) {
+				expected += 0.125f * voxel(i, j, k);
+			}
+		}
+	}
+
+	float4 r = grid->interp_3d(x, y, z);
+	EXPECT_NEAR(r.x, expected, 1e-3f);
+	EXPECT_EQ(r.w, 1.0f);
+
+	/* Clipped lookups outside of the grid. */
+	EXPECT_EQ(grid->interp_3d(-0.1f, y, z).x, 0.0f);
+
+	delete grid;
+}
+
+TEST_F(SparseGridTest, empty)
+{
+	SparseGridImage *grid = sparse_grid_build(&voxels[0], W, H, D, 1,
+	                                          INTERPOLATION_LINEAR,
+	                                          EXTENSION_CLIP);
+
+	/* Inside the blob, and in a neighbor tile which filters can reach. */
+	EXPECT_FALSE(grid->empty(7.5f / W, 9.5f / H, 3.5f / D));
+	EXPECT_FALSE(grid->empty(16.5f / W, 9.5f / H, 3.5f / D));
+	/* Two tiles away from the blob, and outside of the grid. */
+	EXPECT_TRUE(grid->empty(35.5f / W, 9.5f / H, 3.5f / D));
+	EXPECT_TRUE(grid->empty(1.5f, 0.5f, 0.5f));
+
+	delete grid;
+
+	voxels.clear();
+	voxels.resize(W * H * D, 0.0f);
+	grid = sparse_grid_build(&voxels[0], W, H, D, 1,
+	                         INTERPOLATION_LINEAR,
+	                         EXTENSION_CLIP);
+
+	EXPECT_TRUE(grid->voxels.empty());
+	EXPECT_TRUE(grid->empty(0.5f, 0.5f, 0.5f));
+	EXPECT_EQ(grid->interp_3d(0.5f, 0.5f, 0.5f).x, 0.0f);
+
+	delete grid;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "render/buffers.h"
+#include "render/tile.h"
+
+#include "util/util_foreach.h"
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+/* Image of 3x3 tiles, scheduled for denoising like a final render. */
+class TileManagerTest : public ::testing::Test {
+protected:
+	TileManagerTest()
+	: manager(false, 1, make_int2(16, 16), INT_MAX, false, true, TILE_BOTTOM_TO_TOP, 1)
+	{
+	}
+
+	void SetUp()
+	{
+		BufferParams params;
+		params.width = params.full_width = 48;
+		params.height = params.full_height = 48;
+
+		manager.schedule_denoising = true;
+		manager.reset(params, 1);
+		manager.next();
+	}
+
+	void acquire_all(vector<Tile*>& tiles)
+	{
+		Tile *tile;
+		while(manager.next_tile(tile)) {
+			tiles.push_back(tile);
+		}
+	}
+
+	void finish(Tile *tile)
+	{
+		bool delete_tile;
+		manager.finish_tile(tile->index, delete_tile);
+	}
+
+	TileManager manager;
+};
+
+}  /* namespace */
+
+TEST_F(TileManagerTest, denoise_when_neighbors_finish)
+{
+	vector<Tile*> render_tiles;
+	acquire_all(render_tiles);
+	ASSERT_EQ(render_tiles.size(), 9);
+	EXPECT_TRUE(manager.denoising_pending());
+
+	/* Once the corner tile and its neighbors are rendered the corner can be
+	 * denoised, while the other tiles are still waiting. */
+	Tile *tile;
+	foreach(Tile *render_tile, render_tiles) {
+		if(render_tile->x < 32 && render_tile->y < 32) {
+			finish(render_tile);
+		}
+	}
+
+	ASSERT_TRUE(manager.next_tile(tile));
+	EXPECT_EQ(tile->state, Tile::DENOISE);
+	EXPECT_EQ(tile->x, 0);
+	EXPECT_EQ(tile->y, 0);
+	EXPECT_FALSE(manager.next_tile(tile));
+	EXPECT_TRUE(manager.denoising_pending());
+
+	finish(tile);
+	foreach(Tile *render_tile, render_tiles) {
+		if(render_tile->state == Tile::RENDER) {
+			finish(render_tile);
+		}
+	}
+
+	vector<Tile*> denoise_tiles;
+	acquire_all(denoise_tiles);
+	EXPECT_EQ(denoise_tiles.size(), 8);
+
+	foreach(Tile *denoise_tile, denoise_tiles) {
+		EXPECT_EQ(denoise_tile->state, Tile::DENOISE);
+		finish(denoise_tile);
+	}
+
+	EXPECT_FALSE(manager.denoising_pending());
+	EXPECT_FALSE(manager.next_tile(tile));
+}
+
+TEST_F(TileManagerTest, no_pending_without_denoising)
+{
+	manager.schedule_denoising = false;
+
+	vector<Tile*> render_tiles;
+	acquire_all(render_tiles);
+	EXPECT_EQ(render_tiles.size(), 9);
+	EXPECT_FALSE(manager.denoising_pending());
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2011-2017 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_half.h"
+
+CCL_NAMESPACE_BEGIN
+
+TEST(util_half, exact)
+{
+	const float values[] = {0.0f, 1.0f, -1.0f, 0.5f, 2048.0f, 65504.0f, -65504.0f, 6.103515625e-05f};
+
+	for(size_t i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+		EXPECT_EQ(half_bits_to_float(float_to_half_bits(values[i])), values[i]);
+	}
+}
+
+TEST(util_half, round)
+{
+	/* 2049 is halfway between 2048 and 2050, and the mantissa rounds up. */
+	EXPECT_EQ(half_bits_to_float(float_to_half_bits(2049.0f)), 2050.0f);
+	EXPECT_EQ(half_bits_to_float(float_to_half_bits(2048.9f)), 2048.0f);
+	EXPECT_NEAR(half_bits_to_float(float_to_half_bits(0.1f)), 0.1f, 1e-4f);
+}
+
+TEST(util_half, clamp)
+{
+	EXPECT_EQ(half_bits_to_float(float_to_half_bits(1e10f)), 65504.0f);
+	EXPECT_EQ(half_bits_to_float(float_to_half_bits(-1e10f)), -65504.0f);
+	EXPECT_EQ(half_bits_to_float(float_to_half_bits(1e-10f)), 0.0f);
+}
+
+CCL_NAMESPACE_END
@@ -18,6 +18,11 @@
 
 #include "util/util_path.h"
 
+#ifndef _WIN32
+#  include <stdlib.h>
+#  include <utime.h>
+#endif
+
 CCL_NAMESPACE_BEGIN
 
 /* ******** Tests for path_filename() ******** */
@@ -398,4 +403,105 @@ TEST(util_path_is_relative, relative_unixdir_on_windows)
 }
 #endif /* _WIN32 */
 
+/* ******** Tests for path_temp_filepath() ******** */
+
+TEST(util_path_temp_filepath, unique)
+{
+	string a = path_temp_filepath("foo.bvh");
+	string b = path_temp_filepath("foo.bvh");
+	EXPECT_NE(a, b);
+	EXPECT_TRUE(string_startswith(a, "foo.bvh."));
+	EXPECT_TRUE(string_endswith(a, ".tmp"));
+}
+
+/* ******** Tests for path_cache_trim() ******** */
+
+#ifndef _WIN32
+static string cache_trim_test_dir()
+{
+	char dir[] = "/tmp/cycles_path_cache_trim_XXXXXX";
+	return (mkdtemp(dir) != NULL)? dir: "";
+}
+
+static void cache_trim_test_file(const string& path, size_t size, time_t modified_time)
+{
+	vector<uint8_t> binary(size, 0);
+	path_write_binary(path, binary);
+
+	struct utimbuf times;
+	times.actime = modified_time;
+	times.modtime = modified_time;
+	utime(path.c_str(), &times);
+}
+
+TEST(util_path_cache_trim, removes_least_recently_modified)
+{
+	string dir = cache_trim_test_dir();
+	ASSERT_FALSE(dir.empty());
+
+	const time_t now = time(NULL);
+	string a = path_join(dir, "a"), b = path_join(dir, "b"), c = path_join(dir, "c");
+	cache_trim_test_file(b, 100, now - 300);
+	cache_trim_test_file(a, 100, now - 200);
+	cache_trim_test_file(c, 100, now - 100);
+
+	/* within the limit, nothing to do */
+	path_cache_trim(dir, 300);
+	EXPECT_TRUE(path_exists(a));
+	EXPECT_TRUE(path_exists(b));
+	EXPECT_TRUE(path_exists(c));
+
+	path_cache_trim(dir, 250);
+	EXPECT_TRUE(path_exists(a));
+	EXPECT_FALSE(path_exists(b));
+	EXPECT_TRUE(path_exists(c));
+
+	/* a recently read file is kept */
+	path_touch(a);
+	path_cache_trim(dir, 100);
+	EXPECT_TRUE(path_exists(a));
+	EXPECT_FALSE(path_exists(c));
+
+	path_remove(a);
+	path_remove(dir);
+}
+
+TEST(util_path_cache_trim, keeps_recent_temp_files)
+{
+	string dir = cache_trim_test_dir();
+	ASSERT_FALSE(dir.empty());
+
+	const time_t now = time(NULL);
+	string recent = path_join(dir, "recent.tmp"), stale = path_join(dir, "stale.tmp");
+	cache_trim_test_file(recent, 100, now);
+	cache_trim_test_file(stale, 100, now - 24*60*60);
+
+	path_cache_trim(dir, 0);
+	EXPECT_TRUE(path_exists(recent));
+	EXPECT_FALSE(path_exists(stale));
+
+	path_remove(recent);
+	path_remove(dir);
+}
+
+TEST(util_path_rename_replace, replaces_existing_file)
+{
+	string dir = cache_trim_test_dir();
+	ASSERT_FALSE(dir.empty());
+
+	string path = path_join(dir, "checkpoint"), path_tmp = path_temp_filepath(path);
+	string text_old = "old", text_new = "new", text;
+	path_write_text(path, text_old);
+	path_write_text(path_tmp, text_new);
+
+	EXPECT_TRUE(path_rename_replace(path_tmp, path));
+	EXPECT_FALSE(path_exists(path_tmp));
+	EXPECT_TRUE(path_read_text(path, text));
+	EXPECT_EQ(text, "new");
+
+	path_remove(path);
+	path_remove(dir);
+}
+#endif /* !_WIN32 */
+
 CCL_NAMESPACE_END
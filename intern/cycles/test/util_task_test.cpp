@@ -16,7 +16,9 @@
 
 #include "testing/testing.h"
 
+#include "util/util_system.h"
 #include "util/util_task.h"
+#include "util/util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -25,6 +27,23 @@ namespace {
 void task_run() {
 }
 
+/* Small amount of work, so the benchmark measures scheduling overhead. */
+void task_run_work(int /*thread_id*/) {
+	volatile float value = 0.0f;
+	for(int i = 0; i < 100; ++i) {
+		value = value * 0.5f + 1.0f;
+	}
+}
+
+/* Tasks pushing their subtasks to the front, like the BVH builder. */
+void task_run_recursive(TaskPool *pool, int depth, int /*thread_id*/) {
+	task_run_work(0);
+	if(depth > 0) {
+		pool->push(function_bind(task_run_recursive, pool, depth - 1, _1), true);
+		pool->push(function_bind(task_run_recursive, pool, depth - 1, _1), true);
+	}
+}
+
 }  // namespace
 
 TEST(util_task, basic) {
@@ -53,4 +72,59 @@ TEST(util_task, multiple_times) {
 	}
 }
 
+TEST(util_task, recursive) {
+	TaskScheduler::init(0);
+	TaskPool pool;
+	pool.push(function_bind(task_run_recursive, &pool, 10, _1));
+	TaskPool::Summary summary;
+	pool.wait_work(&summary);
+	TaskScheduler::exit();
+	EXPECT_EQ(summary.num_tasks_handled, (1 << 11) - 1);
+}
+
+/* Task throughput from one thread up to all system threads, for tasks pushed
+ * from the main thread and for tasks pushing subtasks from worker threads.
+ * This is a benchmark, run it with --gtest_also_run_disabled_tests. */
+TEST(util_task, DISABLED_scaling) {
+	const int num_tasks = 200000;
+	const int depth = 16;
+	const int max_threads = system_cpu_thread_count();
+
+	printf("Threads  Flat (tasks/s)  Recursive (tasks/s)\n");
+
+	for(int num_threads = 1; ; num_threads = (num_threads * 2 < max_threads)? num_threads * 2: max_threads) {
+		TaskScheduler::init(num_threads);
+
+		TaskPool flat_pool;
+		TaskPool::Summary flat_summary;
+		double flat_time = time_dt();
+		for(int i = 0; i < num_tasks; ++i) {
+			flat_pool.push(function_bind(task_run_work, _1));
+		}
+		flat_pool.wait_work(&flat_summary);
+		flat_time = time_dt() - flat_time;
+
+		TaskPool recursive_pool;
+		TaskPool::Summary recursive_summary;
+		double recursive_time = time_dt();
+		recursive_pool.push(function_bind(task_run_recursive, &recursive_pool, depth, _1));
+		recursive_pool.wait_work(&recursive_summary);
+		recursive_time = time_dt() - recursive_time;
+
+		TaskScheduler::exit();
+
+		EXPECT_EQ(flat_summary.num_tasks_handled, num_tasks);
+		EXPECT_EQ(recursive_summary.num_tasks_handled, (1 << (depth + 1)) - 1);
+
+		printf("%7d  %14.0f  %19.0f\n",
+		       num_threads,
+		       flat_summary.num_tasks_handled / flat_time,
+		       recursive_summary.num_tasks_handled / recursive_time);
+
+		if(num_threads == max_threads) {
+			break;
+		}
+	}
+}
+
 CCL_NAMESPACE_END
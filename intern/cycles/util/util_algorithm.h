@@ -25,7 +25,9 @@ using std::sort;
 using std::swap;
 using std::max;
 using std::min;
+using std::nth_element;
 using std::remove;
+using std::upper_bound;
 
 CCL_NAMESPACE_END
 
@@ -137,6 +137,32 @@ ccl_device_inline half float_to_half(float f)
 
 #endif
 
+/* Conversion between floats and the bits of a half float, usable on all
+ * devices. Rounds to nearest, flushes denormals to zero and clamps to the
+ * largest finite half, which includes infinity and NaN. */
+
+ccl_device_inline uint float_to_half_bits(float f)
+{
+	const uint u = __float_as_uint(f);
+	const uint sign = (u >> 16) & 0x8000;
+	const uint absolute = u & 0x7fffffff;
+
+	if(absolute < 0x38800000)
+		return sign;
+	else if(absolute >= 0x477ff000)
+		return sign | 0x7bff;
+
+	return sign | ((absolute - 0x38000000 + 0x1000) >> 13);
+}
+
+ccl_device_inline float half_bits_to_float(uint h)
+{
+	const uint sign = (h & 0x8000) << 16;
+	const uint absolute = h & 0x7fff;
+
+	return __uint_as_float(sign | ((absolute == 0)? 0: (absolute << 13) + 0x38000000));
+}
+
 CCL_NAMESPACE_END
 
 #endif /* __UTIL_HALF_H__ */
@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#include "util/util_atomic.h"
 #include "util/util_debug.h"
+#include "util/util_foreach.h"
 #include "util/util_md5.h"
 #include "util/util_path.h"
 #include "util/util_string.h"
@@ -25,7 +27,9 @@
 
 OIIO_NAMESPACE_USING
 
+#include <algorithm>
 #include <stdio.h>
+#include <time.h>
 
 #include <sys/stat.h>
 
@@ -33,11 +37,15 @@ OIIO_NAMESPACE_USING
 #  define DIR_SEP '\\'
 #  define DIR_SEP_ALT '/'
 #  include <direct.h>
+#  include <sys/utime.h>
 #else
 #  define DIR_SEP '/'
 #  include <dirent.h>
 #  include <pwd.h>
 #  include <unistd.h>
+#  include <fcntl.h>
+#  include <utime.h>
+#  include <sys/mman.h>
 #  include <sys/types.h>
 #endif
 
@@ -768,6 +776,115 @@ bool path_remove(const string& path)
 	return remove(path.c_str()) == 0;
 }
 
+bool path_touch(const string& path)
+{
+#ifdef _WIN32
+	wstring path_wc = string_to_wstring(path);
+	return _wutime(path_wc.c_str(), NULL) == 0;
+#else
+	return utime(path.c_str(), NULL) == 0;
+#endif
+}
+
+string path_temp_filepath(const string& path)
+{
+	static uint32_t counter = 0;
+	uint32_t index = atomic_add_and_fetch_uint32(&counter, 1);
+#ifdef _WIN32
+	uint64_t pid = (uint64_t)GetCurrentProcessId();
+#else
+	uint64_t pid = (uint64_t)getpid();
+#endif
+	return path + string_printf(".%llu.%u.tmp", (unsigned long long)pid, index);
+}
+
+bool path_rename_replace(const string& from_path, const string& to_path)
+{
+#ifdef _WIN32
+	wstring from_path_wc = string_to_wstring(from_path);
+	wstring to_path_wc = string_to_wstring(to_path);
+	return MoveFileExW(from_path_wc.c_str(),
+	                   to_path_wc.c_str(),
+	                   MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(from_path.c_str(), to_path.c_str()) == 0;
+#endif
+}
+
+void *path_map_file(const string& path, size_t *size)
+{
+	*size = 0;
+
+#ifdef _WIN32
+	wstring path_wc = string_to_wstring(path);
+	HANDLE file = CreateFileW(path_wc.c_str(),
+	                          GENERIC_READ,
+	                          FILE_SHARE_READ | FILE_SHARE_DELETE,
+	                          NULL,
+	                          OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL,
+	                          NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(mapping == NULL) {
+		return NULL;
+	}
+
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if(data == NULL) {
+		return NULL;
+	}
+
+	*size = (size_t)file_size.QuadPart;
+	return data;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		return NULL;
+	}
+
+	*size = (size_t)st.st_size;
+	return data;
+#endif
+}
+
+void path_unmap_file(void *data, size_t size)
+{
+	if(data == NULL) {
+		return;
+	}
+
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
 static string line_directive(const string& base, const string& path, int line)
 {
 	string escaped_path = path;
@@ -872,5 +989,75 @@ void path_cache_clear_except(const string& name, const set<string>& except)
 
 }
 
+namespace {
+
+struct CacheFile {
+	string path;
+	uint64_t size;
+	uint64_t modified_time;
+
+	bool operator<(const CacheFile& other) const
+	{
+		return modified_time < other.modified_time;
+	}
+};
+
+}  /* namespace */
+
+void path_cache_trim(const string& dir, uint64_t max_size)
+{
+	if(!path_exists(dir)) {
+		return;
+	}
+
+	/* Temporary files of writes in progress are left alone, unless they are
+	 * old enough to be left over from a crashed process. */
+	const uint64_t temp_file_max_age = 60*60;
+	const uint64_t now = (uint64_t)time(NULL);
+
+	vector<CacheFile> files;
+	uint64_t total_size = 0;
+	directory_iterator it(dir), it_end;
+
+	for(; it != it_end; ++it) {
+		path_stat_t st;
+		string filepath = it->path();
+
+		if(path_stat(filepath, &st) != 0 || S_ISDIR(st.st_mode)) {
+			continue;
+		}
+
+		CacheFile file;
+		file.path = filepath;
+		file.size = st.st_size;
+		file.modified_time = st.st_mtime;
+
+		if(string_endswith(filepath, ".tmp") &&
+		   file.modified_time + temp_file_max_age > now)
+		{
+			continue;
+		}
+
+		files.push_back(file);
+		total_size += file.size;
+	}
+
+	if(total_size <= max_size) {
+		return;
+	}
+
+	/* Cache reads touch files, so this evicts least recently used first. */
+	std::sort(files.begin(), files.end());
+
+	foreach(const CacheFile& file, files) {
+		if(total_size <= max_size) {
+			break;
+		}
+		if(path_remove(file.path)) {
+			total_size -= file.size;
+		}
+	}
+}
+
 CCL_NAMESPACE_END
 
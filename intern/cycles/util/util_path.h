@@ -64,6 +64,18 @@ bool path_read_text(const string& path, string& text);
 
 /* File manipulation. */
 bool path_remove(const string& path);
+/* Set the modification time of a file to now. */
+bool path_touch(const string& path);
+/* Unique file name next to path, to write to before renaming into place.
+ * Unique across threads and processes sharing the directory. */
+string path_temp_filepath(const string& path);
+/* Rename a file, atomically replacing an existing file at the destination. */
+bool path_rename_replace(const string& from_path, const string& to_path);
+
+/* Map a file read-only into memory, returns NULL on failure. The mapping
+ * stays valid after the file is removed or replaced, until unmapped. */
+void *path_map_file(const string& path, size_t *size);
+void path_unmap_file(void *data, size_t size);
 
 /* source code utility */
 string path_source_replace_includes(const string& source,
@@ -72,6 +84,9 @@ string path_source_replace_includes(const string& source,
 
 /* cache utility */
 void path_cache_clear_except(const string& name, const set<string>& except);
+/* Remove least recently modified files from dir until the total size of the
+ * remaining files is at most max_size bytes. */
+void path_cache_trim(const string& dir, uint64_t max_size);
 
 CCL_NAMESPACE_END
 
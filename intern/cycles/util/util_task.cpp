@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include "util/util_algorithm.h"
+#include "util/util_atomic.h"
 #include "util/util_debug.h"
 #include "util/util_foreach.h"
 #include "util/util_logging.h"
@@ -68,26 +70,10 @@ void TaskPool::wait_work(Summary *stats)
 	while(num != 0) {
 		num_lock.unlock();
 
-		thread_scoped_lock queue_lock(TaskScheduler::queue_mutex);
-
 		/* find task from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
 		TaskScheduler::Entry work_entry;
-		bool found_entry = false;
-		list<TaskScheduler::Entry>::iterator it;
-
-		for(it = TaskScheduler::queue.begin(); it != TaskScheduler::queue.end(); it++) {
-			TaskScheduler::Entry& entry = *it;
-
-			if(entry.pool == this) {
-				work_entry = entry;
-				found_entry = true;
-				TaskScheduler::queue.erase(it);
-				break;
-			}
-		}
-
-		queue_lock.unlock();
+		bool found_entry = TaskScheduler::pop_pool(this, work_entry);
 
 		/* if found task, do it, otherwise wait until other tasks are done */
 		if(found_entry) {
@@ -182,9 +168,15 @@ int TaskScheduler::users = 0;
 vector<thread*> TaskScheduler::threads;
 bool TaskScheduler::do_exit = false;
 
-list<TaskScheduler::Entry> TaskScheduler::queue;
-thread_mutex TaskScheduler::queue_mutex;
-thread_condition_variable TaskScheduler::queue_cond;
+TaskScheduler::ThreadQueue *TaskScheduler::queues = NULL;
+int TaskScheduler::num_queues = 0;
+pthread_key_t TaskScheduler::queue_key;
+size_t TaskScheduler::next_queue = 0;
+
+size_t TaskScheduler::num_entries = 0;
+size_t TaskScheduler::num_waiting = 0;
+thread_mutex TaskScheduler::wait_mutex;
+thread_condition_variable TaskScheduler::wait_cond;
 
 void TaskScheduler::init(int num_threads)
 {
@@ -202,6 +194,15 @@ void TaskScheduler::init(int num_threads)
 		}
 		VLOG(1) << "Creating pool of " << num_threads << " threads.";
 
+		/* one queue per thread, the thread index is stored thread locally
+		 * to push tasks from a worker thread to its own queue */
+		num_queues = max(num_threads, 1);
+		queues = new ThreadQueue[num_queues];
+		next_queue = 0;
+		num_entries = 0;
+		num_waiting = 0;
+		pthread_key_create(&queue_key, NULL);
+
 		/* launch threads that will be waiting for work */
 		threads.resize(num_threads);
 
@@ -264,10 +265,10 @@ void TaskScheduler::exit()
 
 	if(users == 0) {
 		/* stop all waiting threads */
-		TaskScheduler::queue_mutex.lock();
+		wait_mutex.lock();
 		do_exit = true;
-		TaskScheduler::queue_cond.notify_all();
-		TaskScheduler::queue_mutex.unlock();
+		wait_cond.notify_all();
+		wait_mutex.unlock();
 
 		/* delete threads */
 		foreach(thread *t, threads) {
@@ -276,6 +277,12 @@ void TaskScheduler::exit()
 		}
 
 		threads.clear();
+
+		/* delete queues */
+		delete [] queues;
+		queues = NULL;
+		num_queues = 0;
+		pthread_key_delete(queue_key);
 	}
 }
 
@@ -285,32 +292,83 @@ void TaskScheduler::free_memory()
 	threads.free_memory();
 }
 
-bool TaskScheduler::thread_wait_pop(Entry& entry)
+bool TaskScheduler::pop(int queue_index, Entry& entry)
 {
-	thread_scoped_lock queue_lock(queue_mutex);
+	ThreadQueue& queue = queues[queue_index];
+	thread_scoped_lock queue_lock(queue.lock);
 
-	while(queue.empty() && !do_exit)
-		queue_cond.wait(queue_lock);
-
-	if(queue.empty()) {
-		assert(do_exit);
+	if(queue.entries.empty())
 		return false;
-	}
-	
-	entry = queue.front();
-	queue.pop_front();
+
+	entry = queue.entries.front();
+	queue.entries.pop_front();
+
+	atomic_sub_and_fetch_z(&num_entries, 1);
 
 	return true;
 }
 
+bool TaskScheduler::pop_pool(TaskPool *pool, Entry& entry)
+{
+	for(int i = 0; i < num_queues; i++) {
+		ThreadQueue& queue = queues[i];
+		thread_scoped_lock queue_lock(queue.lock);
+
+		list<Entry>::iterator it;
+
+		for(it = queue.entries.begin(); it != queue.entries.end(); it++) {
+			if(it->pool == pool) {
+				entry = *it;
+				queue.entries.erase(it);
+
+				atomic_sub_and_fetch_z(&num_entries, 1);
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool TaskScheduler::thread_wait_pop(int thread_id, Entry& entry)
+{
+	int queue_index = (thread_id - 1) % num_queues;
+
+	while(true) {
+		/* own queue first, then steal from the other queues */
+		for(int i = 0; i < num_queues; i++) {
+			if(pop((queue_index + i) % num_queues, entry))
+				return true;
+		}
+
+		/* all queues are empty, wait for new tasks. pushing increments the
+		 * number of entries before checking for waiting threads, and we do
+		 * the opposite here, so one of both sides sees the other. */
+		thread_scoped_lock wait_lock(wait_mutex);
+
+		atomic_add_and_fetch_z(&num_waiting, 1);
+
+		while(atomic_add_and_fetch_z(&num_entries, 0) == 0 && !do_exit)
+			wait_cond.wait(wait_lock);
+
+		atomic_sub_and_fetch_z(&num_waiting, 1);
+
+		if(do_exit && atomic_add_and_fetch_z(&num_entries, 0) == 0)
+			return false;
+	}
+}
+
 void TaskScheduler::thread_run(int thread_id)
 {
 	Entry entry;
 
+	pthread_setspecific(queue_key, (void*)(size_t)thread_id);
+
 	/* todo: test affinity/denormal mask */
 
 	/* keep popping off tasks */
-	while(thread_wait_pop(entry)) {
+	while(thread_wait_pop(thread_id, entry)) {
 		/* run task */
 		entry.task->run(thread_id);
 
@@ -326,40 +384,59 @@ void TaskScheduler::push(Entry& entry, bool front)
 {
 	entry.pool->num_increase();
 
+	/* worker threads push to their own queue, other threads to all queues
+	 * in turn */
+	size_t thread_id = (size_t)pthread_getspecific(queue_key);
+	int queue_index = (thread_id != 0)?
+	        (thread_id - 1) % num_queues:
+	        atomic_fetch_and_add_z(&next_queue, 1) % num_queues;
+
 	/* add entry to queue */
-	TaskScheduler::queue_mutex.lock();
+	ThreadQueue& queue = queues[queue_index];
+
+	queue.lock.lock();
 	if(front)
-		TaskScheduler::queue.push_front(entry);
+		queue.entries.push_front(entry);
 	else
-		TaskScheduler::queue.push_back(entry);
-
-	TaskScheduler::queue_cond.notify_one();
-	TaskScheduler::queue_mutex.unlock();
+		queue.entries.push_back(entry);
+	/* count under the queue lock, otherwise another thread can pop the entry
+	 * and decrement the count first, wrapping it around */
+	atomic_add_and_fetch_z(&num_entries, 1);
+	queue.lock.unlock();
+
+	/* wake up a waiting thread */
+	if(atomic_add_and_fetch_z(&num_waiting, 0) != 0) {
+		thread_scoped_lock wait_lock(wait_mutex);
+		wait_cond.notify_one();
+	}
 }
 
 void TaskScheduler::clear(TaskPool *pool)
 {
-	thread_scoped_lock queue_lock(TaskScheduler::queue_mutex);
-
-	/* erase all tasks from this pool from the queue */
-	list<Entry>::iterator it = queue.begin();
 	int done = 0;
 
-	while(it != queue.end()) {
-		Entry& entry = *it;
+	/* erase all tasks from this pool from the queues */
+	for(int i = 0; i < num_queues; i++) {
+		ThreadQueue& queue = queues[i];
+		thread_scoped_lock queue_lock(queue.lock);
+
+		list<Entry>::iterator it = queue.entries.begin();
+
+		while(it != queue.entries.end()) {
+			Entry& entry = *it;
 
-		if(entry.pool == pool) {
-			done++;
-			delete entry.task;
+			if(entry.pool == pool) {
+				done++;
+				delete entry.task;
 
-			it = queue.erase(it);
+				it = queue.entries.erase(it);
+				atomic_sub_and_fetch_z(&num_entries, 1);
+			}
+			else
+				it++;
 		}
-		else
-			it++;
 	}
 
-	queue_lock.unlock();
-
 	/* notify done */
 	pool->num_decrease(done);
 }
@@ -119,8 +119,15 @@ protected:
 
 /* Task Scheduler
  * 
- * Central scheduler that holds running threads ready to execute tasks. A singe
- * queue holds the task from all pools. */
+ * Central scheduler that holds running threads ready to execute tasks. Each
+ * thread has its own queue holding tasks from all pools, so threads don't
+ * contend on a single lock. Threads take tasks from the front of their own
+ * queue, and steal from the front of other queues once it is empty.
+ *
+ * Tasks pushed from a worker thread go to the queue of that thread, others
+ * are distributed over the queues in turn. Tasks pushed to the front are
+ * taken before other tasks of the same queue, but tasks in other queues may
+ * run before them. */
 
 class TaskScheduler
 {
@@ -143,17 +150,33 @@ protected:
 		TaskPool *pool;
 	};
 
+	struct ThreadQueue {
+		thread_mutex lock;
+		list<Entry> entries;
+	};
+
 	static thread_mutex mutex;
 	static int users;
 	static vector<thread*> threads;
 	static bool do_exit;
 
-	static list<Entry> queue;
-	static thread_mutex queue_mutex;
-	static thread_condition_variable queue_cond;
+	/* one queue per thread */
+	static ThreadQueue *queues;
+	static int num_queues;
+	static pthread_key_t queue_key;
+	static size_t next_queue;
+
+	/* number of entries in all queues, and threads waiting for them */
+	static size_t num_entries;
+	static size_t num_waiting;
+	static thread_mutex wait_mutex;
+	static thread_condition_variable wait_cond;
 
 	static void thread_run(int thread_id);
-	static bool thread_wait_pop(Entry& entry);
+	static bool thread_wait_pop(int thread_id, Entry& entry);
+
+	static bool pop(int queue_index, Entry& entry);
+	static bool pop_pool(TaskPool *pool, Entry& entry);
 
 	static void push(Entry& entry, bool front);
 	static void clear(TaskPool *pool);
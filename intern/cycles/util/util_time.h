@@ -51,6 +51,25 @@ protected:
 	double time_start_;
 };
 
+/* Adds the elapsed time to the value instead of overwriting it, to time a
+ * stage which runs multiple times. */
+class scoped_accumulate_timer {
+public:
+	explicit scoped_accumulate_timer(double *value) : value_(value)
+	{
+		time_start_ = time_dt();
+	}
+
+	~scoped_accumulate_timer()
+	{
+		*value_ += time_dt() - time_start_;
+	}
+
+protected:
+	double *value_;
+	double time_start_;
+};
+
 CCL_NAMESPACE_END
 
 #endif
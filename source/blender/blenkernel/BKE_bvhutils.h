@@ -201,6 +201,9 @@ enum {
 BVHTree *bvhcache_find(BVHCache *cache, int type);
 bool     bvhcache_has_tree(const BVHCache *cache, const BVHTree *tree);
 void     bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type);
+bool     bvhcache_refit_looptri(
+        BVHCache *cache,
+        const struct MVert *vert, const struct MLoop *mloop, const struct MLoopTri *looptri, int looptri_num);
 void     bvhcache_init(BVHCache **cache_p);
 void     bvhcache_free(BVHCache **cache_p);
 
@@ -910,9 +910,9 @@ static void pchan_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, f
 		else
 			mul_m4_v3(pchan->chan_mat, cop);
 
-		vec[0] += (cop[0] - co[0]) * weight;
-		vec[1] += (cop[1] - co[1]) * weight;
-		vec[2] += (cop[2] - co[2]) * weight;
+		/* Make this a delta from the base position */
+		sub_v3_v3(cop, co);
+		madd_v3_v3fl(vec, cop, weight);
 
 		if (mat)
 			pchan_deform_mat_add(pchan, weight, bbonemat, mat);
@@ -955,6 +955,190 @@ static void armature_bbone_defmats_cb(void *userdata, Link *iter, int index)
 	}
 }
 
+typedef struct ArmatureDeformVertsData {
+	Object *armOb;
+	float (*vertexCos)[3];
+	float (*defMats)[3][3];
+	float (*prevCos)[3];
+
+	bPoseChanDeform *pdef_info_array;
+	bPoseChannel **defnrToPC;
+	int *defnrToPCIndex;
+	int defbase_tot;
+
+	MDeformVert *dverts;
+	int target_totvert;
+	int armature_def_nr;
+
+	bool use_envelope;
+	bool use_quaternion;
+	bool invert_vgroup;
+	bool use_dverts;
+
+	float premat[4][4], postmat[4][4];
+	/* rotation/scale parts of premat and postmat, for defMats */
+	float premat3[3][3], postmat3[3][3];
+} ArmatureDeformVertsData;
+
+static float armature_deform_envelope(ArmatureDeformVertsData *data, float vec[3], DualQuat *dq,
+                                      float mat[3][3], const float co[3])
+{
+	bPoseChanDeform *pdef_info = data->pdef_info_array;
+	bPoseChannel *pchan;
+	float contrib = 0.0f;
+
+	for (pchan = data->armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
+		if (!(pchan->bone->flag & BONE_NO_DEFORM))
+			contrib += dist_bone_deform(pchan, pdef_info, vec, dq, mat, co);
+	}
+
+	return contrib;
+}
+
+static void armature_deform_vert(ArmatureDeformVertsData *data, const int i)
+{
+	float (*defMats)[3][3] = data->defMats;
+	const bool use_quaternion = data->use_quaternion;
+	MDeformVert *dvert = NULL;
+	DualQuat sumdq, *dq = NULL;
+	float *co, dco[3];
+	float sumvec[3], summat[3][3];
+	float *vec = NULL, (*smat)[3] = NULL;
+	float contrib = 0.0f;
+	float armature_weight = 1.0f; /* default to 1 if no overall def group */
+	float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
+
+	if (use_quaternion) {
+		memset(&sumdq, 0, sizeof(DualQuat));
+		dq = &sumdq;
+	}
+	else {
+		zero_v3(sumvec);
+		vec = sumvec;
+
+		if (defMats) {
+			zero_m3(summat);
+			smat = summat;
+		}
+	}
+
+	if ((data->use_dverts || data->armature_def_nr != -1) && data->dverts && i < data->target_totvert) {
+		dvert = data->dverts + i;
+	}
+
+	if (data->armature_def_nr != -1 && dvert) {
+		armature_weight = defvert_find_weight(dvert, data->armature_def_nr);
+
+		if (data->invert_vgroup)
+			armature_weight = 1.0f - armature_weight;
+
+		/* hackish: the blending factor can be used for blending with prevCos too */
+		if (data->prevCos) {
+			prevco_weight = armature_weight;
+			armature_weight = 1.0f;
+		}
+	}
+
+	/* check if there's any  point in calculating for this vert */
+	if (armature_weight == 0.0f)
+		return;
+
+	/* get the coord we work on */
+	co = data->prevCos ? data->prevCos[i] : data->vertexCos[i];
+
+	/* Apply the object's matrix */
+	mul_m4_v3(data->premat, co);
+
+	if (data->use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
+		MDeformWeight *dw = dvert->dw;
+		int deformed = 0;
+		unsigned int j;
+
+		for (j = dvert->totweight; j != 0; j--, dw++) {
+			const int index = dw->def_nr;
+			bPoseChannel *pchan;
+
+			if (index >= 0 && index < data->defbase_tot && (pchan = data->defnrToPC[index])) {
+				float weight = dw->weight;
+				Bone *bone = pchan->bone;
+				bPoseChanDeform *pdef_info = data->pdef_info_array + data->defnrToPCIndex[index];
+
+				deformed = 1;
+
+				if (bone && bone->flag & BONE_MULT_VG_ENV) {
+					weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
+					                             bone->rad_head, bone->rad_tail, bone->dist);
+				}
+				pchan_bone_deform(pchan, pdef_info, weight, vec, dq, smat, co, &contrib);
+			}
+		}
+		/* if there are vertexgroups but not groups with bones
+		 * (like for softbody groups) */
+		if (deformed == 0 && data->use_envelope) {
+			contrib += armature_deform_envelope(data, vec, dq, smat, co);
+		}
+	}
+	else if (data->use_envelope) {
+		contrib += armature_deform_envelope(data, vec, dq, smat, co);
+	}
+
+	/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
+	if (contrib > 0.0001f) {
+		if (use_quaternion) {
+			normalize_dq(dq, contrib);
+
+			if (armature_weight != 1.0f) {
+				copy_v3_v3(dco, co);
+				mul_v3m3_dq(dco, (defMats) ? summat : NULL, dq);
+				sub_v3_v3(dco, co);
+				mul_v3_fl(dco, armature_weight);
+				add_v3_v3(co, dco);
+			}
+			else
+				mul_v3m3_dq(co, (defMats) ? summat : NULL, dq);
+
+			smat = summat;
+		}
+		else {
+			mul_v3_fl(vec, armature_weight / contrib);
+			add_v3_v3v3(co, vec, co);
+		}
+
+		if (defMats) {
+			float tmpmat[3][3];
+
+			copy_m3_m3(tmpmat, defMats[i]);
+
+			if (!use_quaternion) /* quaternion already is scale corrected */
+				mul_m3_fl(smat, armature_weight / contrib);
+
+			mul_m3_series(defMats[i], data->postmat3, smat, data->premat3, tmpmat);
+		}
+	}
+
+	/* always, check above code */
+	mul_m4_v3(data->postmat, co);
+
+	/* interpolate with previous modifier position using weight group */
+	if (data->prevCos) {
+		float mw = 1.0f - prevco_weight;
+		float *vco = data->vertexCos[i];
+		vco[0] = prevco_weight * vco[0] + mw * co[0];
+		vco[1] = prevco_weight * vco[1] + mw * co[1];
+		vco[2] = prevco_weight * vco[2] + mw * co[2];
+	}
+}
+
+static void armature_deform_verts_cb(void *userdata, const int start, const int stop)
+{
+	ArmatureDeformVertsData *data = userdata;
+	int i;
+
+	for (i = start; i < stop; i++) {
+		armature_deform_vert(data, i);
+	}
+}
+
 void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
                            float (*defMats)[3][3], int numVerts, int deformflag,
                            float (*prevCos)[3], const char *defgrp_name)
@@ -1028,16 +1212,17 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 		}
 	}
 
+	/* if we have a DerivedMesh, only use its dverts, this also ensures
+	 * the layer exists before the threads below access it */
+	if (dm) {
+		dverts = dm->getVertDataArray(dm, CD_MDEFORMVERT);
+		target_totvert = dverts ? dm->getNumVerts(dm) : 0;
+	}
+
 	/* get a vertex-deform-index to posechannel array */
 	if (deformflag & ARM_DEF_VGROUP) {
 		if (ELEM(target->type, OB_MESH, OB_LATTICE)) {
-			/* if we have a DerivedMesh, only use dverts if it has them */
-			if (dm) {
-				use_dverts = (dm->getVertDataArray(dm, CD_MDEFORMVERT) != NULL);
-			}
-			else if (dverts) {
-				use_dverts = true;
-			}
+			use_dverts = (dverts != NULL);
 
 			if (use_dverts) {
 				defnrToPC = MEM_callocN(sizeof(*defnrToPC) * defbase_tot, "defnrToBone");
@@ -1070,150 +1255,22 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 		}
 	}
 
-	for (i = 0; i < numVerts; i++) {
-		MDeformVert *dvert;
-		DualQuat sumdq, *dq = NULL;
-		float *co, dco[3];
-		float sumvec[3], summat[3][3];
-		float *vec = NULL, (*smat)[3] = NULL;
-		float contrib = 0.0f;
-		float armature_weight = 1.0f; /* default to 1 if no overall def group */
-		float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
-
-		if (use_quaternion) {
-			memset(&sumdq, 0, sizeof(DualQuat));
-			dq = &sumdq;
-		}
-		else {
-			sumvec[0] = sumvec[1] = sumvec[2] = 0.0f;
-			vec = sumvec;
-
-			if (defMats) {
-				zero_m3(summat);
-				smat = summat;
-			}
-		}
-
-		if (use_dverts || armature_def_nr != -1) {
-			if (dm)
-				dvert = dm->getVertData(dm, i, CD_MDEFORMVERT);
-			else if (dverts && i < target_totvert)
-				dvert = dverts + i;
-			else
-				dvert = NULL;
-		}
-		else
-			dvert = NULL;
-
-		if (armature_def_nr != -1 && dvert) {
-			armature_weight = defvert_find_weight(dvert, armature_def_nr);
-
-			if (invert_vgroup)
-				armature_weight = 1.0f - armature_weight;
-
-			/* hackish: the blending factor can be used for blending with prevCos too */
-			if (prevCos) {
-				prevco_weight = armature_weight;
-				armature_weight = 1.0f;
-			}
-		}
-
-		/* check if there's any  point in calculating for this vert */
-		if (armature_weight == 0.0f)
-			continue;
-
-		/* get the coord we work on */
-		co = prevCos ? prevCos[i] : vertexCos[i];
-
-		/* Apply the object's matrix */
-		mul_m4_v3(premat, co);
-
-		if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-			MDeformWeight *dw = dvert->dw;
-			int deformed = 0;
-			unsigned int j;
-
-			for (j = dvert->totweight; j != 0; j--, dw++) {
-				const int index = dw->def_nr;
-				if (index >= 0 && index < defbase_tot && (pchan = defnrToPC[index])) {
-					float weight = dw->weight;
-					Bone *bone = pchan->bone;
-					pdef_info = pdef_info_array + defnrToPCIndex[index];
-
-					deformed = 1;
-
-					if (bone && bone->flag & BONE_MULT_VG_ENV) {
-						weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
-						                             bone->rad_head, bone->rad_tail, bone->dist);
-					}
-					pchan_bone_deform(pchan, pdef_info, weight, vec, dq, smat, co, &contrib);
-				}
-			}
-			/* if there are vertexgroups but not groups with bones
-			 * (like for softbody groups) */
-			if (deformed == 0 && use_envelope) {
-				pdef_info = pdef_info_array;
-				for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-					if (!(pchan->bone->flag & BONE_NO_DEFORM))
-						contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-				}
-			}
-		}
-		else if (use_envelope) {
-			pdef_info = pdef_info_array;
-			for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-				if (!(pchan->bone->flag & BONE_NO_DEFORM))
-					contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-			}
-		}
-
-		/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
-		if (contrib > 0.0001f) {
-			if (use_quaternion) {
-				normalize_dq(dq, contrib);
-
-				if (armature_weight != 1.0f) {
-					copy_v3_v3(dco, co);
-					mul_v3m3_dq(dco, (defMats) ? summat : NULL, dq);
-					sub_v3_v3(dco, co);
-					mul_v3_fl(dco, armature_weight);
-					add_v3_v3(co, dco);
-				}
-				else
-					mul_v3m3_dq(co, (defMats) ? summat : NULL, dq);
-
-				smat = summat;
-			}
-			else {
-				mul_v3_fl(vec, armature_weight / contrib);
-				add_v3_v3v3(co, vec, co);
-			}
-
-			if (defMats) {
-				float pre[3][3], post[3][3], tmpmat[3][3];
-
-				copy_m3_m4(pre, premat);
-				copy_m3_m4(post, postmat);
-				copy_m3_m3(tmpmat, defMats[i]);
-
-				if (!use_quaternion) /* quaternion already is scale corrected */
-					mul_m3_fl(smat, armature_weight / contrib);
-
-				mul_m3_series(defMats[i], post, smat, pre, tmpmat);
-			}
-		}
-
-		/* always, check above code */
-		mul_m4_v3(postmat, co);
+	/* Vertices are independent, their cost varies with the number of weights
+	 * so they're scheduled dynamically, in chunks. */
+	ArmatureDeformVertsData vert_data = {
+	    .armOb = armOb, .vertexCos = vertexCos, .defMats = defMats, .prevCos = prevCos,
+	    .pdef_info_array = pdef_info_array, .defnrToPC = defnrToPC, .defnrToPCIndex = defnrToPCIndex,
+	    .defbase_tot = defbase_tot,
+	    .dverts = dverts, .target_totvert = target_totvert, .armature_def_nr = armature_def_nr,
+	    .use_envelope = use_envelope, .use_quaternion = use_quaternion, .invert_vgroup = invert_vgroup,
+	    .use_dverts = use_dverts,
+	};
+	copy_m4_m4(vert_data.premat, premat);
+	copy_m4_m4(vert_data.postmat, postmat);
+	copy_m3_m4(vert_data.premat3, premat);
+	copy_m3_m4(vert_data.postmat3, postmat);
 
-		/* interpolate with previous modifier position using weight group */
-		if (prevCos) {
-			float mw = 1.0f - prevco_weight;
-			vertexCos[i][0] = prevco_weight * vertexCos[i][0] + mw * co[0];
-			vertexCos[i][1] = prevco_weight * vertexCos[i][1] + mw * co[1];
-			vertexCos[i][2] = prevco_weight * vertexCos[i][2] + mw * co[2];
-		}
-	}
+	BLI_task_parallel_range_chunked(0, numVerts, 64, &vert_data, armature_deform_verts_cb, numVerts > 1000);
 
 	if (dualquats)
 		MEM_freeN(dualquats);
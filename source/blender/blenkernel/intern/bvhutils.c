@@ -1336,6 +1336,51 @@ void bvhcache_insert(BVHCache **cache_p, BVHTree *tree, int type)
 	BLI_linklist_prepend(cache_p, item);
 }
 
+typedef struct LoopTriRefitData {
+	const MVert *vert;
+	const MLoop *mloop;
+	const MLoopTri *looptri;
+} LoopTriRefitData;
+
+static void bvhcache_refit_looptri_cb(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3])
+{
+	const LoopTriRefitData *data = userdata;
+	const MLoopTri *lt = &data->looptri[index];
+
+	UNUSED_VARS(r_co_moving);
+
+	copy_v3_v3(r_co[0], data->vert[data->mloop[lt->tri[0]].v].co);
+	copy_v3_v3(r_co[1], data->vert[data->mloop[lt->tri[1]].v].co);
+	copy_v3_v3(r_co[2], data->vert[data->mloop[lt->tri[2]].v].co);
+}
+
+/**
+ * Refits the cached looptri tree to new vertex positions,
+ * for when the vertices moved but the topology didn't change.
+ * Much cheaper than freeing the cache and building the tree again.
+ *
+ * \return true if there was a cached tree to refit.
+ */
+bool bvhcache_refit_looptri(
+        BVHCache *cache,
+        const MVert *vert, const MLoop *mloop, const MLoopTri *looptri, int looptri_num)
+{
+	BVHTree *tree;
+	bool refit = false;
+
+	BLI_rw_mutex_lock(&cache_rwlock, THREAD_LOCK_WRITE);
+	tree = bvhcache_find(cache, BVHTREE_FROM_LOOPTRI);
+	if (tree && (BLI_bvhtree_get_size(tree) == looptri_num)) {
+		LoopTriRefitData data = {vert, mloop, looptri};
+
+		BLI_bvhtree_refit(tree, 3, false, bvhcache_refit_looptri_cb, &data);
+		refit = true;
+	}
+	BLI_rw_mutex_unlock(&cache_rwlock);
+
+	return refit;
+}
+
 /**
  * inits and frees a bvhcache
  */
@@ -40,6 +40,7 @@
 #include "BLI_stackdefines.h"
 
 #include "BKE_pbvh.h"
+#include "BKE_bvhutils.h"
 #include "BKE_cdderivedmesh.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
@@ -2551,6 +2552,13 @@ void CDDM_apply_vert_coords(DerivedMesh *dm, float (*vertCoords)[3])
 	for (i = 0; i < dm->numVertData; ++i, ++vert)
 		copy_v3_v3(vert->co, vertCoords[i]);
 
+	/* topology didn't change, keep the cached looptri tree valid */
+	if (dm->bvhCache) {
+		bvhcache_refit_looptri(
+		        dm->bvhCache, cddm->mvert, cddm->mloop,
+		        dm->getLoopTriArray(dm), dm->getNumLoopTri(dm));
+	}
+
 	cddm->dm.dirty |= DM_DIRTY_NORMALS;
 }
 
@@ -217,90 +217,62 @@ static BVHTree *bvhtree_build_from_cloth (ClothModifierData *clmd, float epsilon
 	return bvhtree;
 }
 
+static void bvhtree_refit_from_cloth_cb(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3])
+{
+	const Cloth *cloth = userdata;
+	const ClothVertex *verts = cloth->verts;
+	const MVertTri *vt = &cloth->tri[index];
+
+	copy_v3_v3(r_co[0], verts[vt->tri[0]].txold);
+	copy_v3_v3(r_co[1], verts[vt->tri[1]].txold);
+	copy_v3_v3(r_co[2], verts[vt->tri[2]].txold);
+
+	/* update moving positions */
+	if (r_co_moving) {
+		copy_v3_v3(r_co_moving[0], verts[vt->tri[0]].tx);
+		copy_v3_v3(r_co_moving[1], verts[vt->tri[1]].tx);
+		copy_v3_v3(r_co_moving[2], verts[vt->tri[2]].tx);
+	}
+}
+
 void bvhtree_update_from_cloth(ClothModifierData *clmd, bool moving)
 {	
-	unsigned int i = 0;
 	Cloth *cloth = clmd->clothObject;
 	BVHTree *bvhtree = cloth->bvhtree;
-	ClothVertex *verts = cloth->verts;
-	const MVertTri *vt;
 	
 	if (!bvhtree)
 		return;
 	
-	vt = cloth->tri;
-	
 	/* update vertex position in bvh tree */
-	if (verts && vt) {
-		for (i = 0; i < cloth->tri_num; i++, vt++) {
-			float co[3][3], co_moving[3][3];
-			bool ret;
-
-			copy_v3_v3(co[0], verts[vt->tri[0]].txold);
-			copy_v3_v3(co[1], verts[vt->tri[1]].txold);
-			copy_v3_v3(co[2], verts[vt->tri[2]].txold);
-
-			/* copy new locations into array */
-			if (moving) {
-				/* update moving positions */
-				copy_v3_v3(co_moving[0], verts[vt->tri[0]].tx);
-				copy_v3_v3(co_moving[1], verts[vt->tri[1]].tx);
-				copy_v3_v3(co_moving[2], verts[vt->tri[2]].tx);
-
-				ret = BLI_bvhtree_update_node(bvhtree, i, co[0], co_moving[0], 3);
-			}
-			else {
-				ret = BLI_bvhtree_update_node(bvhtree, i, co[0], NULL, 3);
-			}
-			
-			/* check if tree is already full */
-			if (ret == false) {
-				break;
-			}
-		}
-		
-		BLI_bvhtree_update_tree(bvhtree);
+	if (cloth->verts && cloth->tri) {
+		BLI_bvhtree_refit(bvhtree, 3, moving, bvhtree_refit_from_cloth_cb, cloth);
+	}
+}
+
+static void bvhselftree_refit_from_cloth_cb(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3])
+{
+	const Cloth *cloth = userdata;
+	const ClothVertex *vert = &cloth->verts[index];
+
+	copy_v3_v3(r_co[0], vert->txold);
+
+	/* update moving positions */
+	if (r_co_moving) {
+		copy_v3_v3(r_co_moving[0], vert->tx);
 	}
 }
 
 void bvhselftree_update_from_cloth(ClothModifierData *clmd, bool moving)
 {	
-	unsigned int i = 0;
 	Cloth *cloth = clmd->clothObject;
 	BVHTree *bvhtree = cloth->bvhselftree;
-	ClothVertex *verts = cloth->verts;
-	const MVertTri *vt;
 	
 	if (!bvhtree)
 		return;
 
-	vt = cloth->tri;
-
 	/* update vertex position in bvh tree */
-	if (verts && vt) {
-		for (i = 0; i < cloth->mvert_num; i++, verts++) {
-			const float *co, *co_moving;
-			bool ret;
-
-			co = verts->txold;
-
-			/* copy new locations into array */
-			if (moving) {
-				/* update moving positions */
-				co_moving = verts->tx;
-				ret = BLI_bvhtree_update_node(bvhtree, i, co, co_moving, 1);
-			}
-			else {
-				ret = BLI_bvhtree_update_node(bvhtree, i, co, NULL, 1);
-			}
-
-			/* check if tree is already full */
-			if (ret == false) {
-				break;
-			}
-		}
-		
-		BLI_bvhtree_update_tree(bvhtree);
+	if (cloth->verts && cloth->tri) {
+		BLI_bvhtree_refit(bvhtree, 1, moving, bvhselftree_refit_from_cloth_cb, cloth);
 	}
 }
 
@@ -120,14 +120,36 @@ BVHTree *bvhtree_build_from_mvert(
 	return tree;
 }
 
+typedef struct MVertTriRefitData {
+	const MVert *mvert;
+	const MVert *mvert_moving;
+	const MVertTri *tri;
+} MVertTriRefitData;
+
+static void bvhtree_refit_from_mvert_cb(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3])
+{
+	const MVertTriRefitData *data = userdata;
+	const MVertTri *vt = &data->tri[index];
+
+	copy_v3_v3(r_co[0], data->mvert[vt->tri[0]].co);
+	copy_v3_v3(r_co[1], data->mvert[vt->tri[1]].co);
+	copy_v3_v3(r_co[2], data->mvert[vt->tri[2]].co);
+
+	/* update moving positions */
+	if (r_co_moving) {
+		copy_v3_v3(r_co_moving[0], data->mvert_moving[vt->tri[0]].co);
+		copy_v3_v3(r_co_moving[1], data->mvert_moving[vt->tri[1]].co);
+		copy_v3_v3(r_co_moving[2], data->mvert_moving[vt->tri[2]].co);
+	}
+}
+
 void bvhtree_update_from_mvert(
         BVHTree *bvhtree,
         const MVert *mvert, const MVert *mvert_moving,
         const MVertTri *tri, int tri_num,
         bool moving)
 {
-	const MVertTri *vt;
-	int i;
+	MVertTriRefitData data;
 
 	if ((bvhtree == NULL) || (mvert == NULL)) {
 		return;
@@ -137,35 +159,14 @@ void bvhtree_update_from_mvert(
 		moving = false;
 	}
 
-	for (i = 0, vt = tri; i < tri_num; i++, vt++) {
-		float co[3][3];
-		bool ret;
+	BLI_assert(BLI_bvhtree_get_size(bvhtree) == tri_num);
+	UNUSED_VARS_NDEBUG(tri_num);
 
-		copy_v3_v3(co[0], mvert[vt->tri[0]].co);
-		copy_v3_v3(co[1], mvert[vt->tri[1]].co);
-		copy_v3_v3(co[2], mvert[vt->tri[2]].co);
-
-		/* copy new locations into array */
-		if (moving) {
-			float co_moving[3][3];
-			/* update moving positions */
-			copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
-			copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
-			copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
-
-			ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], &co_moving[0][0], 3);
-		}
-		else {
-			ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], NULL, 3);
-		}
-
-		/* check if tree is already full */
-		if (ret == false) {
-			break;
-		}
-	}
+	data.mvert = mvert;
+	data.mvert_moving = mvert_moving;
+	data.tri = tri;
 
-	BLI_bvhtree_update_tree(bvhtree);
+	BLI_bvhtree_refit(bvhtree, 3, moving, bvhtree_refit_from_mvert_cb, &data);
 }
 
 /***********************************
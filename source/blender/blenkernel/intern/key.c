@@ -39,6 +39,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math_vector.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -709,6 +710,151 @@ static void cp_cu_key(Curve *cu, Key *key, KeyBlock *actkb, KeyBlock *kb, const
 	}
 }
 
+/* -------------------------------------------------------------------- */
+/* Mesh and lattice keys
+ *
+ * Elements of these are a single float[3], so they're blended with plain loops over floats
+ * the compiler can vectorize, from multiple threads. */
+
+/* Elements per call of the callbacks below, small enough for the output to stay in cache
+ * while all key blocks are blended into it. */
+#define KEY_FLOAT3_CHUNK_SIZE 1024
+/* Only use threads when blending more than this many elements (times key blocks). */
+#define KEY_FLOAT3_THREADED_MIN 16384
+
+static bool key_is_float3(const Key *key, const int mode)
+{
+	return ((mode != KEY_MODE_BEZTRIPLE) &&
+	        (key->elemstr[0] == 3) && (key->elemstr[1] == IPO_FLOAT) && (key->elemstr[2] == 0) &&
+	        (key->elemsize == sizeof(float[3])));
+}
+
+typedef struct KeyRelativeBlock {
+	const float *from, *reffrom;
+	const float *weights;
+	float icuval;
+	char *freefrom, *freereffrom;
+} KeyRelativeBlock;
+
+typedef struct KeyRelativeData {
+	float *out;
+	/* basis to copy into out first, NULL when out is already initialized */
+	const float *basis;
+	const KeyRelativeBlock *blocks;
+	int totblock;
+} KeyRelativeData;
+
+static void key_evaluate_relative_float3_cb(void *userdata, const int start, const int stop)
+{
+	const KeyRelativeData *data = userdata;
+	float * __restrict out = data->out + start * 3;
+	const int totelem = stop - start;
+	int b, a;
+
+	if (data->basis) {
+		memcpy(out, data->basis + start * 3, sizeof(float[3]) * (size_t)totelem);
+	}
+
+	/* all blocks are blended into this chunk before moving on to the next one,
+	 * instead of a pass over the whole output per block */
+	for (b = 0; b < data->totblock; b++) {
+		const KeyRelativeBlock *block = &data->blocks[b];
+		const float * __restrict from = block->from + start * 3;
+		const float * __restrict reffrom = block->reffrom + start * 3;
+		const float icuval = block->icuval;
+
+		if (block->weights) {
+			const float * __restrict weights = block->weights + start;
+
+			for (a = 0; a < totelem; a++) {
+				const float weight = weights[a] * icuval;
+				out[a * 3 + 0] -= weight * (reffrom[a * 3 + 0] - from[a * 3 + 0]);
+				out[a * 3 + 1] -= weight * (reffrom[a * 3 + 1] - from[a * 3 + 1]);
+				out[a * 3 + 2] -= weight * (reffrom[a * 3 + 2] - from[a * 3 + 2]);
+			}
+		}
+		else {
+			for (a = 0; a < totelem * 3; a++) {
+				out[a] -= icuval * (reffrom[a] - from[a]);
+			}
+		}
+	}
+}
+
+/**
+ * Same as the generic part of #BKE_key_evaluate_relative, for mesh and lattice keys.
+ */
+static void key_evaluate_relative_float3(const int start, const int end, const int tot, char *basispoin, Key *key,
+                                         KeyBlock *actkb, float **per_keyblock_weights)
+{
+	KeyRelativeBlock *blocks;
+	KeyBlock *kb;
+	char *basis, *freebasis = NULL;
+	int totblock = 0, keyblock_index, b;
+
+	/* step 1 init, in the blend pass when possible */
+	if (key->refkey->totelem == tot) {
+		basis = key_block_get_data(key, actkb, key->refkey, &freebasis);
+	}
+	else {
+		cp_key(start, end, tot, basispoin, key, actkb, key->refkey, NULL, KEY_MODE_DUMMY);
+		basis = NULL;
+	}
+
+	/* step 2: gather the blocks to blend */
+	blocks = MEM_mallocN(sizeof(*blocks) * (size_t)key->totkey, __func__);
+
+	for (kb = key->block.first, keyblock_index = 0; kb; kb = kb->next, keyblock_index++) {
+		if (kb != key->refkey) {
+			/* only with value, and no difference allowed */
+			if (!(kb->flag & KEYBLOCK_MUTE) && kb->curval != 0.0f && kb->totelem == tot) {
+				KeyRelativeBlock *block;
+				/* reference now can be any block */
+				KeyBlock *refb = BLI_findlink(&key->block, kb->relative);
+				if (refb == NULL) continue;
+
+				block = &blocks[totblock++];
+				block->from = (float *)key_block_get_data(key, actkb, kb, &block->freefrom);
+				block->reffrom = (float *)key_block_get_data(key, actkb, refb, &block->freereffrom);
+				block->weights = per_keyblock_weights ? per_keyblock_weights[keyblock_index] : NULL;
+				block->icuval = kb->curval;
+			}
+		}
+	}
+
+	/* step 3: do it */
+	KeyRelativeData data = {
+	    .out = (float *)basispoin, .basis = (float *)basis, .blocks = blocks, .totblock = totblock,
+	};
+	BLI_task_parallel_range_chunked(start, end, KEY_FLOAT3_CHUNK_SIZE, &data, key_evaluate_relative_float3_cb,
+	                                (size_t)(end - start) * (size_t)max_ii(totblock, 1) > KEY_FLOAT3_THREADED_MIN);
+
+	for (b = 0; b < totblock; b++) {
+		if (blocks[b].freefrom) MEM_freeN(blocks[b].freefrom);
+		if (blocks[b].freereffrom) MEM_freeN(blocks[b].freereffrom);
+	}
+	MEM_freeN(blocks);
+
+	if (freebasis) MEM_freeN(freebasis);
+}
+
+typedef struct KeyInterpData {
+	float *out;
+	float *k[4];
+	float *t;
+} KeyInterpData;
+
+static void key_interp_float3_cb(void *userdata, const int start, const int stop)
+{
+	KeyInterpData *data = userdata;
+
+	flerp((stop - start) * 3, data->out + start * 3,
+	      data->k[0] + start * 3, data->k[1] + start * 3, data->k[2] + start * 3, data->k[3] + start * 3,
+	      data->t);
+}
+
+/* -------------------------------------------------------------------- */
+
 void BKE_key_evaluate_relative(const int start, int end, const int tot, char *basispoin, Key *key, KeyBlock *actkb,
                                float **per_keyblock_weights, const int mode)
 {
@@ -730,6 +876,11 @@ void BKE_key_evaluate_relative(const int start, int end, const int tot, char *ba
 	elemstr[1] = IPO_BEZTRIPLE;
 	elemstr[2] = 0;
 
+	if (key_is_float3(key, mode)) {
+		key_evaluate_relative_float3(start, end, tot, basispoin, key, actkb, per_keyblock_weights);
+		return;
+	}
+
 	/* just here, not above! */
 	elemsize = key->elemsize;
 	if (mode == KEY_MODE_BEZTRIPLE) elemsize *= 3;
@@ -935,6 +1086,22 @@ static void do_key(const int start, int end, const int tot, char *poin, Key *key
 
 	}
 
+	/* all keys have the same number of elements, interpolate them as flat arrays */
+	if (flagflo == 0 && key_is_float3(key, mode)) {
+		KeyInterpData data = {
+		    .out = (float *)poin, .k = {(float *)k1, (float *)k2, (float *)k3, (float *)k4}, .t = t,
+		};
+		/* pointers are already offset by start */
+		BLI_task_parallel_range_chunked(0, end - start, KEY_FLOAT3_CHUNK_SIZE, &data, key_interp_float3_cb,
+		                                (end - start) > KEY_FLOAT3_THREADED_MIN);
+
+		if (freek1) MEM_freeN(freek1);
+		if (freek2) MEM_freeN(freek2);
+		if (freek3) MEM_freeN(freek3);
+		if (freek4) MEM_freeN(freek4);
+		return;
+	}
+
 	/* in case of beztriple */
 	elemstr[0] = 1;              /* nr of ipofloats */
 	elemstr[1] = IPO_BEZTRIPLE;
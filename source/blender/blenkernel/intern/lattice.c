@@ -40,6 +40,7 @@
 #include "BLI_listbase.h"
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
@@ -698,6 +699,57 @@ static bool calc_curve_deform(Scene *scene, Object *par, float co[3],
 	return false;
 }
 
+/* Vertices per call of the deform callbacks below, run by #BLI_task_parallel_range_chunked. */
+#define DEFORM_VERTS_CHUNK_SIZE 256
+/* Only use threads when deforming more vertices than this. */
+#define DEFORM_VERTS_THREADED_MIN 1024
+
+typedef struct CurveDeformVertsData {
+	Scene *scene;
+	Object *cuOb;
+	CurveDeform *cd;
+	float (*vertexCos)[3];
+	MDeformVert *dvert;
+	int defgrp_index;
+	short defaxis;
+	/* vertexCos are in object space, instead of already being in curve space */
+	bool use_curvespace;
+} CurveDeformVertsData;
+
+static void curve_deform_verts_cb(void *userdata, const int start, const int stop)
+{
+	CurveDeformVertsData *data = userdata;
+	CurveDeform *cd = data->cd;
+	int a;
+
+	for (a = start; a < stop; a++) {
+		float *co = data->vertexCos[a];
+
+		if (data->dvert) {
+			const float weight = defvert_find_weight(&data->dvert[a], data->defgrp_index);
+
+			if (weight > 0.0f) {
+				float vec[3];
+
+				if (data->use_curvespace) {
+					mul_m4_v3(cd->curvespace, co);
+				}
+				copy_v3_v3(vec, co);
+				calc_curve_deform(data->scene, data->cuOb, vec, data->defaxis, cd, NULL);
+				interp_v3_v3v3(co, co, vec, weight);
+				mul_m4_v3(cd->objectspace, co);
+			}
+		}
+		else {
+			if (data->use_curvespace) {
+				mul_m4_v3(cd->curvespace, co);
+			}
+			calc_curve_deform(data->scene, data->cuOb, co, data->defaxis, cd, NULL);
+			mul_m4_v3(cd->objectspace, co);
+		}
+	}
+}
+
 void curve_deform_verts(
         Scene *scene, Object *cuOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
         int numVerts, const char *vgroup, short defaxis)
@@ -747,26 +799,19 @@ void curve_deform_verts(
 		}
 	}
 
-	if (dvert) {
-		MDeformVert *dvert_iter;
-		float vec[3];
+#ifdef CYCLIC_DEPENDENCY_WORKAROUND
+	/* done here instead of in calc_curve_deform, which runs from multiple threads */
+	if (cuOb->curve_cache == NULL) {
+		BKE_displist_make_curveTypes(scene, cuOb, false);
+	}
+#endif
 
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
+	if ((cu->flag & CU_DEFORM_BOUNDS_OFF) == 0) {
+		/* set mesh min/max bounds, leaving the vertices in 'cd.curvespace' */
+		INIT_MINMAX(cd.dmin, cd.dmax);
 
-				if (weight > 0.0f) {
-					mul_m4_v3(cd.curvespace, vertexCos[a]);
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-		else {
-			/* set mesh min/max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
+		if (dvert) {
+			MDeformVert *dvert_iter;
 
 			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
 				if (defvert_find_weight(dvert_iter, defgrp_index) > 0.0f) {
@@ -774,44 +819,22 @@ void curve_deform_verts(
 					minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 				}
 			}
-
-			for (a = 0, dvert_iter = dvert; a < numVerts; a++, dvert_iter++) {
-				const float weight = defvert_find_weight(dvert_iter, defgrp_index);
-
-				if (weight > 0.0f) {
-					/* already in 'cd.curvespace', prev for loop */
-					copy_v3_v3(vec, vertexCos[a]);
-					calc_curve_deform(scene, cuOb, vec, defaxis, &cd, NULL);
-					interp_v3_v3v3(vertexCos[a], vertexCos[a], vec, weight);
-					mul_m4_v3(cd.objectspace, vertexCos[a]);
-				}
-			}
-		}
-	}
-	else {
-		if (cu->flag & CU_DEFORM_BOUNDS_OFF) {
-			for (a = 0; a < numVerts; a++) {
-				mul_m4_v3(cd.curvespace, vertexCos[a]);
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 		else {
-			/* set mesh min max bounds */
-			INIT_MINMAX(cd.dmin, cd.dmax);
-				
 			for (a = 0; a < numVerts; a++) {
 				mul_m4_v3(cd.curvespace, vertexCos[a]);
 				minmax_v3v3_v3(cd.dmin, cd.dmax, vertexCos[a]);
 			}
-	
-			for (a = 0; a < numVerts; a++) {
-				/* already in 'cd.curvespace', prev for loop */
-				calc_curve_deform(scene, cuOb, vertexCos[a], defaxis, &cd, NULL);
-				mul_m4_v3(cd.objectspace, vertexCos[a]);
-			}
 		}
 	}
+
+	CurveDeformVertsData data = {
+	    .scene = scene, .cuOb = cuOb, .cd = &cd, .vertexCos = vertexCos,
+	    .dvert = dvert, .defgrp_index = defgrp_index, .defaxis = defaxis,
+	    .use_curvespace = (cu->flag & CU_DEFORM_BOUNDS_OFF) != 0,
+	};
+	BLI_task_parallel_range_chunked(0, numVerts, DEFORM_VERTS_CHUNK_SIZE, &data, curve_deform_verts_cb,
+	                                numVerts > DEFORM_VERTS_THREADED_MIN);
 }
 
 /* input vec and orco = local coord in armature space */
@@ -849,12 +872,40 @@ void curve_deform_vector(Scene *scene, Object *cuOb, Object *target,
 
 }
 
+typedef struct LatticeDeformVertsData {
+	LatticeDeformData *lattice_deform_data;
+	float (*vertexCos)[3];
+	MDeformVert *dvert;
+	int defgrp_index;
+	float fac;
+} LatticeDeformVertsData;
+
+static void lattice_deform_verts_cb(void *userdata, const int start, const int stop)
+{
+	LatticeDeformVertsData *data = userdata;
+	int a;
+
+	if (data->dvert) {
+		for (a = start; a < stop; a++) {
+			const float weight = defvert_find_weight(&data->dvert[a], data->defgrp_index);
+
+			if (weight > 0.0f)
+				calc_latt_deform(data->lattice_deform_data, data->vertexCos[a], weight * data->fac);
+		}
+	}
+	else {
+		for (a = start; a < stop; a++) {
+			calc_latt_deform(data->lattice_deform_data, data->vertexCos[a], data->fac);
+		}
+	}
+}
+
 void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
                           float (*vertexCos)[3], int numVerts, const char *vgroup, float fac)
 {
 	LatticeDeformData *lattice_deform_data;
-	int a;
-	bool use_vgroups;
+	MDeformVert *dvert = NULL;
+	int defgrp_index = -1;
 
 	if (laOb->type != OB_LATTICE)
 		return;
@@ -865,43 +916,34 @@ void lattice_deform_verts(Object *laOb, Object *target, DerivedMesh *dm,
 	 * we want either a Mesh with no derived data, or derived data with
 	 * deformverts
 	 */
-	if (target && target->type == OB_MESH) {
+	if (vgroup && vgroup[0] && target && target->type == OB_MESH) {
 		/* if there's derived data without deformverts, don't use vgroups */
 		if (dm) {
-			use_vgroups = (dm->getVertDataArray(dm, CD_MDEFORMVERT) != NULL);
+			dvert = dm->getVertDataArray(dm, CD_MDEFORMVERT);
 		}
 		else {
 			Mesh *me = target->data;
-			use_vgroups = (me->dvert != NULL);
+			dvert = me->dvert;
 		}
-	}
-	else {
-		use_vgroups = false;
-	}
-	
-	if (vgroup && vgroup[0] && use_vgroups) {
-		Mesh *me = target->data;
-		const int defgrp_index = defgroup_name_index(target, vgroup);
-		float weight;
-
-		if (defgrp_index >= 0 && (me->dvert || dm)) {
-			MDeformVert *dvert = me->dvert;
-			
-			for (a = 0; a < numVerts; a++, dvert++) {
-				if (dm) dvert = dm->getVertData(dm, a, CD_MDEFORMVERT);
 
-				weight = defvert_find_weight(dvert, defgrp_index);
+		if (dvert) {
+			defgrp_index = defgroup_name_index(target, vgroup);
 
-				if (weight > 0.0f)
-					calc_latt_deform(lattice_deform_data, vertexCos[a], weight * fac);
+			/* a missing vertex group deforms nothing */
+			if (defgrp_index == -1) {
+				end_latt_deform(lattice_deform_data);
+				return;
 			}
 		}
 	}
-	else {
-		for (a = 0; a < numVerts; a++) {
-			calc_latt_deform(lattice_deform_data, vertexCos[a], fac);
-		}
-	}
+
+	LatticeDeformVertsData data = {
+	    .lattice_deform_data = lattice_deform_data, .vertexCos = vertexCos,
+	    .dvert = dvert, .defgrp_index = defgrp_index, .fac = fac,
+	};
+	BLI_task_parallel_range_chunked(0, numVerts, DEFORM_VERTS_CHUNK_SIZE, &data, lattice_deform_verts_cb,
+	                                numVerts > DEFORM_VERTS_THREADED_MIN);
+
 	end_latt_deform(lattice_deform_data);
 }
 
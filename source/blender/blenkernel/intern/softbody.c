@@ -69,7 +69,9 @@ variables on the UI for now
 #include "BLI_utildefines.h"
 #include "BLI_listbase.h"
 #include "BLI_ghash.h"
-#include "BLI_threads.h"
+#include "BLI_buffer.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_task.h"
 
 #include "BKE_curve.h"
 #include "BKE_effect.h"
@@ -132,16 +134,25 @@ typedef struct  SB_thread_context {
 		Object *ob;
 		float forcetime;
 		float timenow;
-		int ifirst;
-		int ilast;
 		ListBase *do_effector;
 		int do_deflector;
 		float fieldfactor;
 		float windfactor;
-		int nr;
-		int tot;
 } SB_thread_context;
 
+/* points and springs are handed to the task scheduler in chunks of this size,
+ * threading only kicks in when there are enough of them to be worth it */
+#define SB_THREAD_CHUNK_SIZE 64
+#define SB_THREADED_MIN 200
+
+/* chunk size for tot points or springs, never splitting them in more chunks than the
+ * scene's thread count, so no more than that many threads work on them at once */
+static int sb_thread_chunk_size(Scene *scene, int tot)
+{
+	const int totthread = BKE_scene_num_threads(scene);
+	return max_ii(SB_THREAD_CHUNK_SIZE, (tot + totthread - 1) / totthread);
+}
+
 #define MID_PRESERVE 1
 
 #define SOFTGOALSNAP  0.999f
@@ -262,29 +273,35 @@ float operations still
 */
 static const int CCD_SAVETY = 190561;
 
-typedef struct ccdf_minmax {
-	float minx, miny, minz, maxx, maxy, maxz;
-} ccdf_minmax;
-
-
 typedef struct ccd_Mesh {
 	int mvert_num, tri_num;
 	const MVert *mvert;
 	const MVert *mprevvert;
 	const MVertTri *tri;
 	int savety;
-	ccdf_minmax *mima;
+	/* broadphase on the triangle AABBs blown up with the forcefield ranges,
+	 * spanning mprevvert and mvert once the mesh got updated */
+	BVHTree *bvhtree;
 	/* Axis Aligned Bounding Box AABB */
 	float bbmin[3];
 	float bbmax[3];
 } ccd_Mesh;
 
+/* bounds of a triangle padded with hull, as the 2 corner points of the box */
+static void ccd_tri_bounds(const MVert *mvert, const MVertTri *vt, float hull, float r_co[2][3])
+{
+	INIT_MINMAX(r_co[0], r_co[1]);
+	minmax_v3v3_v3(r_co[0], r_co[1], mvert[vt->tri[0]].co);
+	minmax_v3v3_v3(r_co[0], r_co[1], mvert[vt->tri[1]].co);
+	minmax_v3v3_v3(r_co[0], r_co[1], mvert[vt->tri[2]].co);
+	add_v3_fl(r_co[0], -hull);
+	add_v3_fl(r_co[1], hull);
+}
 
 static ccd_Mesh *ccd_mesh_make(Object *ob)
 {
 	CollisionModifierData *cmd;
 	ccd_Mesh *pccd_M = NULL;
-	ccdf_minmax *mima;
 	const MVertTri *vt;
 	float hull;
 	int i;
@@ -327,48 +344,22 @@ static ccd_Mesh *ccd_mesh_make(Object *ob)
 	/* alloc and copy faces*/
 	pccd_M->tri = MEM_dupallocN(cmd->tri);
 
-	/* OBBs for idea1 */
-	pccd_M->mima = MEM_mallocN(sizeof(ccdf_minmax) * pccd_M->tri_num, "ccd_Mesh_Faces_mima");
+	/* anyhoo we need to walk the list of faces and find the AABB they live in,
+	 * a plain AABB tree (6 axes) since that is all the per face tests check */
+	pccd_M->bvhtree = BLI_bvhtree_new(pccd_M->tri_num, 0.0f, 4, 6);
+	for (i = 0, vt = pccd_M->tri; i < pccd_M->tri_num; i++, vt++) {
+		float co[2][3];
 
-
-	/* anyhoo we need to walk the list of faces and find OBB they live in */
-	for (i = 0, mima  = pccd_M->mima, vt = pccd_M->tri; i < pccd_M->tri_num; i++, mima++, vt++) {
-		const float *v;
-
-		mima->minx=mima->miny=mima->minz=1e30f;
-		mima->maxx=mima->maxy=mima->maxz=-1e30f;
-
-		v = pccd_M->mvert[vt->tri[0]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mvert[vt->tri[1]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mvert[vt->tri[2]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
+		ccd_tri_bounds(pccd_M->mvert, vt, hull, co);
+		BLI_bvhtree_insert(pccd_M->bvhtree, i, co[0], 2);
 	}
+	BLI_bvhtree_balance(pccd_M->bvhtree);
 
 	return pccd_M;
 }
 static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
 {
 	CollisionModifierData *cmd;
-	ccdf_minmax *mima;
 	const MVertTri *vt;
 	float hull;
 	int i;
@@ -424,64 +415,16 @@ static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
 
 	}
 
-	/* anyhoo we need to walk the list of faces and find OBB they live in */
-	for (i = 0, mima  = pccd_M->mima, vt = pccd_M->tri; i < pccd_M->tri_num; i++, mima++, vt++) {
-		const float *v;
+	/* anyhoo we need to walk the list of faces and find the AABB they live in,
+	 * covering both mvert and mprevvert, then refit the tree */
+	for (i = 0, vt = pccd_M->tri; i < pccd_M->tri_num; i++, vt++) {
+		float co[2][3], co_prev[2][3];
 
-		mima->minx=mima->miny=mima->minz=1e30f;
-		mima->maxx=mima->maxy=mima->maxz=-1e30f;
-
-		/* mvert */
-		v = pccd_M->mvert[vt->tri[0]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mvert[vt->tri[1]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mvert[vt->tri[2]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-
-		/* mprevvert */
-		v = pccd_M->mprevvert[vt->tri[0]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mprevvert[vt->tri[1]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
-
-		v = pccd_M->mprevvert[vt->tri[2]].co;
-		mima->minx = min_ff(mima->minx, v[0] - hull);
-		mima->miny = min_ff(mima->miny, v[1] - hull);
-		mima->minz = min_ff(mima->minz, v[2] - hull);
-		mima->maxx = max_ff(mima->maxx, v[0] + hull);
-		mima->maxy = max_ff(mima->maxy, v[1] + hull);
-		mima->maxz = max_ff(mima->maxz, v[2] + hull);
+		ccd_tri_bounds(pccd_M->mvert, vt, hull, co);
+		ccd_tri_bounds(pccd_M->mprevvert, vt, hull, co_prev);
+		BLI_bvhtree_update_node(pccd_M->bvhtree, i, co[0], co_prev[0], 2);
 	}
+	BLI_bvhtree_update_tree(pccd_M->bvhtree);
 	return;
 }
 
@@ -491,12 +434,59 @@ static void ccd_mesh_free(ccd_Mesh *ccdm)
 		MEM_freeN((void *)ccdm->mvert);
 		MEM_freeN((void *)ccdm->tri);
 		if (ccdm->mprevvert) MEM_freeN((void *)ccdm->mprevvert);
-		MEM_freeN(ccdm->mima);
+		BLI_bvhtree_free(ccdm->bvhtree);
 		MEM_freeN(ccdm);
 		ccdm = NULL;
 	}
 }
 
+/* +++ broadphase on the collider triangles */
+typedef struct ccd_AABBQuery {
+	float min[3], max[3];
+	BLI_Buffer *tris;
+} ccd_AABBQuery;
+
+static bool ccd_aabb_query_parent_cb(const BVHTreeAxisRange *bounds, void *userdata)
+{
+	const ccd_AABBQuery *query = userdata;
+
+	return !((query->max[0] < bounds[0].min) ||
+	         (query->min[0] > bounds[0].max) ||
+	         (query->max[1] < bounds[1].min) ||
+	         (query->min[1] > bounds[1].max) ||
+	         (query->max[2] < bounds[2].min) ||
+	         (query->min[2] > bounds[2].max));
+}
+
+static bool ccd_aabb_query_leaf_cb(const BVHTreeAxisRange *bounds, int index, void *userdata)
+{
+	ccd_AABBQuery *query = userdata;
+
+	if (ccd_aabb_query_parent_cb(bounds, userdata)) {
+		BLI_buffer_append(query->tris, int, index);
+	}
+	return true;
+}
+
+static bool ccd_aabb_query_order_cb(const BVHTreeAxisRange *UNUSED(bounds), char UNUSED(axis), void *UNUSED(userdata))
+{
+	return true;
+}
+
+/* collect the triangles of ccdm whose (padded) bounds overlap the box min, max into r_tris */
+static void ccd_mesh_find_tris(ccd_Mesh *ccdm, const float min[3], const float max[3], BLI_Buffer *r_tris)
+{
+	ccd_AABBQuery query;
+
+	copy_v3_v3(query.min, min);
+	copy_v3_v3(query.max, max);
+	query.tris = r_tris;
+
+	BLI_buffer_empty(r_tris);
+	BLI_bvhtree_walk_dfs(ccdm->bvhtree, ccd_aabb_query_parent_cb, ccd_aabb_query_leaf_cb, ccd_aabb_query_order_cb, &query);
+}
+/* --- broadphase on the collider triangles */
+
 static void ccd_build_deflector_hash_single(GHash *hash, Object *ob)
 {
 	/* only with deflecting set */
@@ -1175,6 +1165,7 @@ static int sb_detect_face_collisionCached(float face_v1[3], float face_v2[3], fl
 	float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
 	float t, tune = 10.0f;
 	int a, deflected=0;
+	BLI_buffer_declare_static(int, tris, BLI_BUFFER_NOP, 64);
 
 	aabbmin[0] = min_fff(face_v1[0], face_v2[0], face_v3[0]);
 	aabbmin[1] = min_fff(face_v1[1], face_v2[1], face_v3[1]);
@@ -1195,14 +1186,11 @@ static int sb_detect_face_collisionCached(float face_v1[3], float face_v2[3], fl
 				const MVert *mvert = NULL;
 				const MVert *mprevvert = NULL;
 				const MVertTri *vt = NULL;
-				const ccdf_minmax *mima = NULL;
 
 				if (ccdm) {
 					mvert = ccdm->mvert;
 					vt = ccdm->tri;
 					mprevvert = ccdm->mprevvert;
-					mima = ccdm->mima;
-					a = ccdm->tri_num;
 
 					if ((aabbmax[0] < ccdm->bbmin[0]) ||
 					    (aabbmax[1] < ccdm->bbmin[1]) ||
@@ -1225,19 +1213,10 @@ static int sb_detect_face_collisionCached(float face_v1[3], float face_v2[3], fl
 				}
 
 
-				/* use mesh*/
-				while (a--) {
-					if ((aabbmax[0] < mima->minx) ||
-					    (aabbmin[0] > mima->maxx) ||
-					    (aabbmax[1] < mima->miny) ||
-					    (aabbmin[1] > mima->maxy) ||
-					    (aabbmax[2] < mima->minz) ||
-					    (aabbmin[2] > mima->maxz))
-					{
-						mima++;
-						vt++;
-						continue;
-					}
+				/* use mesh, only the triangles the broadphase finds around us */
+				ccd_mesh_find_tris(ccdm, aabbmin, aabbmax, &tris);
+				for (a = 0; a < (int)tris.count; a++) {
+					vt = &ccdm->tri[BLI_buffer_at(&tris, int, a)];
 
 
 					if (mvert) {
@@ -1271,14 +1250,13 @@ static int sb_detect_face_collisionCached(float face_v1[3], float face_v2[3], fl
 						*damp=tune*ob->pd->pdef_sbdamp;
 						deflected = 2;
 					}
-					mima++;
-					vt++;
-				}/* while a */
+				}/* loop tris */
 			} /* if (ob->pd && ob->pd->deflect) */
 			BLI_ghashIterator_step(ihash);
 		}
 	} /* while () */
 	BLI_ghashIterator_free(ihash);
+	BLI_buffer_free(&tris);
 	return deflected;
 }
 
@@ -1359,7 +1337,9 @@ static int sb_detect_edge_collisionCached(float edge_v1[3], float edge_v2[3], fl
 	float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
 	float t, el;
 	int a, deflected=0;
+	BLI_buffer_declare_static(int, tris, BLI_BUFFER_NOP, 64);
 
+	INIT_MINMAX(aabbmin, aabbmax);
 	minmax_v3v3_v3(aabbmin, aabbmax, edge_v1);
 	minmax_v3v3_v3(aabbmin, aabbmax, edge_v2);
 
@@ -1377,14 +1357,11 @@ static int sb_detect_edge_collisionCached(float edge_v1[3], float edge_v2[3], fl
 				const MVert *mvert = NULL;
 				const MVert *mprevvert = NULL;
 				const MVertTri *vt = NULL;
-				const ccdf_minmax *mima = NULL;
 
 				if (ccdm) {
 					mvert = ccdm->mvert;
 					mprevvert = ccdm->mprevvert;
 					vt = ccdm->tri;
-					mima = ccdm->mima;
-					a = ccdm->tri_num;
 
 					if ((aabbmax[0] < ccdm->bbmin[0]) ||
 					    (aabbmax[1] < ccdm->bbmin[1]) ||
@@ -1407,19 +1384,10 @@ static int sb_detect_edge_collisionCached(float edge_v1[3], float edge_v2[3], fl
 				}
 
 
-				/* use mesh*/
-				while (a--) {
-					if ((aabbmax[0] < mima->minx) ||
-					    (aabbmin[0] > mima->maxx) ||
-					    (aabbmax[1] < mima->miny) ||
-					    (aabbmin[1] > mima->maxy) ||
-					    (aabbmax[2] < mima->minz) ||
-					    (aabbmin[2] > mima->maxz))
-					{
-						mima++;
-						vt++;
-						continue;
-					}
+				/* use mesh, only the triangles the broadphase finds around us */
+				ccd_mesh_find_tris(ccdm, aabbmin, aabbmax, &tris);
+				for (a = 0; a < (int)tris.count; a++) {
+					vt = &ccdm->tri[BLI_buffer_at(&tris, int, a)];
 
 
 					if (mvert) {
@@ -1459,14 +1427,13 @@ static int sb_detect_edge_collisionCached(float edge_v1[3], float edge_v2[3], fl
 						deflected = 2;
 					}
 
-					mima++;
-					vt++;
-				}/* while a */
+				}/* loop tris */
 			} /* if (ob->pd && ob->pd->deflect) */
 			BLI_ghashIterator_step(ihash);
 		}
 	} /* while () */
 	BLI_ghashIterator_free(ihash);
+	BLI_buffer_free(&tris);
 	return deflected;
 }
 
@@ -1554,65 +1521,28 @@ static void scan_for_ext_spring_forces(Scene *scene, Object *ob, float timenow)
 	pdEndEffectors(&do_effector);
 }
 
-static void *exec_scan_for_ext_spring_forces(void *data)
+static void exec_scan_for_ext_spring_forces(void *userdata, int ifirst, int ilast)
 {
-	SB_thread_context *pctx = (SB_thread_context*)data;
-	_scan_for_ext_spring_forces(pctx->scene, pctx->ob, pctx->timenow, pctx->ifirst, pctx->ilast, pctx->do_effector);
-	return NULL;
+	SB_thread_context *pctx = (SB_thread_context*)userdata;
+	_scan_for_ext_spring_forces(pctx->scene, pctx->ob, pctx->timenow, ifirst, ilast, pctx->do_effector);
 }
 
 static void sb_sfesf_threads_run(Scene *scene, struct Object *ob, float timenow, int totsprings, int *UNUSED(ptr_to_break_func(void)))
 {
 	ListBase *do_effector = NULL;
-	ListBase threads;
-	SB_thread_context *sb_threads;
-	int i, totthread, left, dec;
-	int lowsprings =100; /* wild guess .. may increase with better thread management 'above' or even be UI option sb->spawn_cf_threads_nopts */
+	SB_thread_context sb_thread = {NULL};
 
 	do_effector= pdInitEffectors(scene, ob, NULL, ob->soft->effector_weights, true);
 
-	/* figure the number of threads while preventing pretty pointless threading overhead */
-	totthread= BKE_scene_num_threads(scene);
-	/* what if we got zillions of CPUs running but less to spread*/
-	while ((totsprings/totthread < lowsprings) && (totthread > 1)) {
-		totthread--;
-	}
-
-	sb_threads= MEM_callocN(sizeof(SB_thread_context)*totthread, "SBSpringsThread");
-	memset(sb_threads, 0, sizeof(SB_thread_context)*totthread);
-	left = totsprings;
-	dec = totsprings/totthread +1;
-	for (i=0; i<totthread; i++) {
-		sb_threads[i].scene = scene;
-		sb_threads[i].ob = ob;
-		sb_threads[i].forcetime = 0.0; // not used here
-		sb_threads[i].timenow = timenow;
-		sb_threads[i].ilast   = left;
-		left = left - dec;
-		if (left >0) {
-			sb_threads[i].ifirst  = left;
-		}
-		else
-			sb_threads[i].ifirst  = 0;
-		sb_threads[i].do_effector = do_effector;
-		sb_threads[i].do_deflector = false;// not used here
-		sb_threads[i].fieldfactor = 0.0f;// not used here
-		sb_threads[i].windfactor  = 0.0f;// not used here
-		sb_threads[i].nr= i;
-		sb_threads[i].tot= totthread;
-	}
-	if (totthread > 1) {
-		BLI_init_threads(&threads, exec_scan_for_ext_spring_forces, totthread);
+	sb_thread.scene = scene;
+	sb_thread.ob = ob;
+	sb_thread.timenow = timenow;
+	sb_thread.do_effector = do_effector;
 
-		for (i=0; i<totthread; i++)
-			BLI_insert_thread(&threads, &sb_threads[i]);
-
-		BLI_end_threads(&threads);
-	}
-	else
-		exec_scan_for_ext_spring_forces(&sb_threads[0]);
-	/* clean up */
-	MEM_freeN(sb_threads);
+	/* every spring only writes to itself, so springs can be spread freely */
+	BLI_task_parallel_range_chunked(0, totsprings, sb_thread_chunk_size(scene, totsprings), &sb_thread,
+	                                exec_scan_for_ext_spring_forces,
+	                                totsprings > SB_THREADED_MIN);
 
 	pdEndEffectors(&do_effector);
 }
@@ -1662,6 +1592,7 @@ static int sb_detect_vertex_collisionCached(
 	      innerfacethickness = -0.5f, outerfacethickness = 0.2f,
 	      ee = 5.0f, ff = 0.1f, fa=1;
 	int a, deflected=0, cavel=0, ci=0;
+	BLI_buffer_declare_static(int, tris, BLI_BUFFER_NOP, 64);
 /* init */
 	*intrusion = 0.0f;
 	hash  = vertexowner->soft->scratch->colliderhash;
@@ -1679,14 +1610,11 @@ static int sb_detect_vertex_collisionCached(
 				const MVert *mvert = NULL;
 				const MVert *mprevvert = NULL;
 				const MVertTri *vt = NULL;
-				const ccdf_minmax *mima = NULL;
 
 				if (ccdm) {
 					mvert = ccdm->mvert;
 					mprevvert = ccdm->mprevvert;
 					vt = ccdm->tri;
-					mima = ccdm->mima;
-					a = ccdm->tri_num;
 
 					minx = ccdm->bbmin[0];
 					miny = ccdm->bbmin[1];
@@ -1723,19 +1651,10 @@ static int sb_detect_vertex_collisionCached(
 				fa *= fa;
 				fa = 1.0f/fa;
 				avel[0]=avel[1]=avel[2]=0.0f;
-				/* use mesh*/
-				while (a--) {
-					if ((opco[0] < mima->minx) ||
-					    (opco[0] > mima->maxx) ||
-					    (opco[1] < mima->miny) ||
-					    (opco[1] > mima->maxy) ||
-					    (opco[2] < mima->minz) ||
-					    (opco[2] > mima->maxz))
-					{
-						mima++;
-						vt++;
-						continue;
-					}
+				/* use mesh, only the triangles the broadphase finds around us */
+				ccd_mesh_find_tris(ccdm, opco, opco, &tris);
+				for (a = 0; a < (int)tris.count; a++) {
+					vt = &ccdm->tri[BLI_buffer_at(&tris, int, a)];
 
 					if (mvert) {
 
@@ -1802,9 +1721,7 @@ static int sb_detect_vertex_collisionCached(
 						}
 					}
 
-					mima++;
-					vt++;
-				}/* while a */
+				}/* loop tris */
 			} /* if (ob->pd && ob->pd->deflect) */
 			BLI_ghashIterator_step(ihash);
 		}
@@ -1829,6 +1746,7 @@ static int sb_detect_vertex_collisionCached(
 	}
 
 	BLI_ghashIterator_free(ihash);
+	BLI_buffer_free(&tris);
 	if (cavel) mul_v3_fl(avel, 1.0f/(float)cavel);
 	copy_v3_v3(vel, avel);
 	if (ci) *intrusion /= ci;
@@ -2013,7 +1931,10 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene, Object *ob, flo
 			float compare;
 			float bstune = sb->ballstiff;
 
-			for (c=sb->totpoint, obp= sb->bpoint; c>=ifirst+bb; c--, obp++) {
+			/* gather the forces of all other points on this one only, writing to obp
+			 * would race with the slice owning it since slices run in any order */
+			for (c=sb->totpoint, obp= sb->bpoint; c>0; c--, obp++) {
+				if (obp == bp) continue;
 				compare = (obp->colball + bp->colball);
 				sub_v3_v3v3(def, bp->pos, obp->pos);
 				/* rather check the AABBoxes before ever calulating the real distance */
@@ -2038,13 +1959,6 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene, Object *ob, flo
 
 						madd_v3_v3fl(bp->force, def, f * (1.0f - sb->balldamp));
 						madd_v3_v3fl(bp->force, dvel, sb->balldamp);
-
-						/* exploit force(a, b) == -force(b, a) part2/2 */
-						sub_v3_v3v3(dvel, velcenter, obp->vec);
-						mul_v3_fl(dvel, _final_mass(ob, bp));
-
-						madd_v3_v3fl(obp->force, dvel, sb->balldamp);
-						madd_v3_v3fl(obp->force, def, -f * (1.0f - sb->balldamp));
 					}
 				}
 			}
@@ -2171,66 +2085,28 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene, Object *ob, flo
 	return 0; /*done fine*/
 }
 
-static void *exec_softbody_calc_forces(void *data)
+static void exec_softbody_calc_forces(void *userdata, int ifirst, int ilast)
 {
-	SB_thread_context *pctx = (SB_thread_context*)data;
-	_softbody_calc_forces_slice_in_a_thread(pctx->scene, pctx->ob, pctx->forcetime, pctx->timenow, pctx->ifirst, pctx->ilast, NULL, pctx->do_effector, pctx->do_deflector, pctx->fieldfactor, pctx->windfactor);
-	return NULL;
+	SB_thread_context *pctx = (SB_thread_context*)userdata;
+	_softbody_calc_forces_slice_in_a_thread(pctx->scene, pctx->ob, pctx->forcetime, pctx->timenow, ifirst, ilast, NULL, pctx->do_effector, pctx->do_deflector, pctx->fieldfactor, pctx->windfactor);
 }
 
 static void sb_cf_threads_run(Scene *scene, Object *ob, float forcetime, float timenow, int totpoint, int *UNUSED(ptr_to_break_func(void)), struct ListBase *do_effector, int do_deflector, float fieldfactor, float windfactor)
 {
-	ListBase threads;
-	SB_thread_context *sb_threads;
-	int i, totthread, left, dec;
-	int lowpoints =100; /* wild guess .. may increase with better thread management 'above' or even be UI option sb->spawn_cf_threads_nopts */
-
-	/* figure the number of threads while preventing pretty pointless threading overhead */
-	totthread= BKE_scene_num_threads(scene);
-	/* what if we got zillions of CPUs running but less to spread*/
-	while ((totpoint/totthread < lowpoints) && (totthread > 1)) {
-		totthread--;
-	}
-
-	/* printf("sb_cf_threads_run spawning %d threads\n", totthread); */
-
-	sb_threads= MEM_callocN(sizeof(SB_thread_context)*totthread, "SBThread");
-	memset(sb_threads, 0, sizeof(SB_thread_context)*totthread);
-	left = totpoint;
-	dec = totpoint/totthread +1;
-	for (i=0; i<totthread; i++) {
-		sb_threads[i].scene = scene;
-		sb_threads[i].ob = ob;
-		sb_threads[i].forcetime = forcetime;
-		sb_threads[i].timenow = timenow;
-		sb_threads[i].ilast   = left;
-		left = left - dec;
-		if (left >0) {
-			sb_threads[i].ifirst  = left;
-		}
-		else
-			sb_threads[i].ifirst  = 0;
-		sb_threads[i].do_effector = do_effector;
-		sb_threads[i].do_deflector = do_deflector;
-		sb_threads[i].fieldfactor = fieldfactor;
-		sb_threads[i].windfactor  = windfactor;
-		sb_threads[i].nr= i;
-		sb_threads[i].tot= totthread;
-	}
-
+	SB_thread_context sb_thread;
 
-	if (totthread > 1) {
-		BLI_init_threads(&threads, exec_softbody_calc_forces, totthread);
+	sb_thread.scene = scene;
+	sb_thread.ob = ob;
+	sb_thread.forcetime = forcetime;
+	sb_thread.timenow = timenow;
+	sb_thread.do_effector = do_effector;
+	sb_thread.do_deflector = do_deflector;
+	sb_thread.fieldfactor = fieldfactor;
+	sb_thread.windfactor = windfactor;
 
-		for (i=0; i<totthread; i++)
-			BLI_insert_thread(&threads, &sb_threads[i]);
-
-		BLI_end_threads(&threads);
-	}
-	else
-		exec_softbody_calc_forces(&sb_threads[0]);
-	/* clean up */
-	MEM_freeN(sb_threads);
+	BLI_task_parallel_range_chunked(0, totpoint, sb_thread_chunk_size(scene, totpoint), &sb_thread,
+	                                exec_softbody_calc_forces,
+	                                totpoint > SB_THREADED_MIN);
 }
 
 static void softbody_calc_forcesEx(Scene *scene, Object *ob, float forcetime, float timenow)
@@ -101,6 +101,10 @@ typedef bool (*BVHTree_OverlapCallback)(void *userdata, int index_a, int index_b
 /* callback to range search query */
 typedef void (*BVHTree_RangeQuery)(void *userdata, int index, const float co[3], float dist_sq);
 
+/* callback to fill in the points of a leaf for BLI_bvhtree_refit (may run from multiple threads),
+ * r_co_moving is NULL unless the tree is refit with moving points */
+typedef void (*BVHTree_RefitLeafCallback)(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3]);
+
 
 /* callbacks to BLI_bvhtree_walk_dfs */
 /* return true to traverse into this nodes children, else skip. */
@@ -122,6 +126,12 @@ void BLI_bvhtree_balance(BVHTree *tree);
 bool BLI_bvhtree_update_node(BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
 
+/* batch update: refit all leafs from the points given by the callback, then the branches (multi-threaded) */
+#define BVH_REFIT_POINTS_MAX 4
+void BLI_bvhtree_refit(
+        BVHTree *tree, int numpoints, bool moving,
+        BVHTree_RefitLeafCallback leaf_cb, void *userdata);
+
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
 /* collision/overlap: check two trees if they overlap, alloc's *overlap with length of the int return value */
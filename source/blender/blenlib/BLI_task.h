@@ -110,6 +110,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 typedef void (*TaskParallelRangeFunc)(void *userdata, const int iter);
 typedef void (*TaskParallelRangeFuncEx)(void *userdata, void *userdata_chunk, const int iter, const int thread_id);
 typedef void (*TaskParallelRangeFuncFinalize)(void *userdata, void *userdata_chunk);
+typedef void (*TaskParallelRangeFuncChunk)(void *userdata, const int start, const int stop);
 void BLI_task_parallel_range_ex(
         int start, int stop,
         void *userdata,
@@ -134,6 +135,13 @@ void BLI_task_parallel_range_finalize(
         const bool use_threading,
         const bool use_dynamic_scheduling);
 
+void BLI_task_parallel_range_chunked(
+        int start, int stop,
+        const int chunk_size,
+        void *userdata,
+        TaskParallelRangeFuncChunk func_chunk,
+        const bool use_threading);
+
 typedef void (*TaskParallelListbaseFunc)(void *userdata,
                                          struct Link *iter,
                                          int index);
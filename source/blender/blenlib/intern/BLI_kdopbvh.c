@@ -73,6 +73,9 @@
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
 #endif
 
+/* leafs and branches handed to each task on refit */
+#define KDOPBVH_REFIT_CHUNK_SIZE 256
+
 
 /* -------------------------------------------------------------------- */
 
@@ -493,6 +496,17 @@ static void create_kdop_hull(const BVHTree *tree, BVHNode *node, const float *co
 	}
 }
 
+/* inflate the bv with some epsilon */
+static void node_inflate(const BVHTree *tree, BVHNode *node)
+{
+	axis_t axis_iter;
+
+	for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
+		node->bv[(2 * axis_iter)]     -= tree->epsilon; /* minimum */
+		node->bv[(2 * axis_iter) + 1] += tree->epsilon; /* maximum */
+	}
+}
+
 /**
  * \note depends on the fact that the BVH's for each face is already build
  */
@@ -1055,7 +1069,6 @@ void BLI_bvhtree_balance(BVHTree *tree)
 
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints)
 {
-	axis_t axis_iter;
 	BVHNode *node = NULL;
 
 	/* insert should only possible as long as tree->totbranch is 0 */
@@ -1068,11 +1081,7 @@ void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoin
 	create_kdop_hull(tree, node, co, numpoints, 0);
 	node->index = index;
 
-	/* inflate the bv with some epsilon */
-	for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
-		node->bv[(2 * axis_iter)] -= tree->epsilon; /* minimum */
-		node->bv[(2 * axis_iter) + 1] += tree->epsilon; /* maximum */
-	}
+	node_inflate(tree, node);
 }
 
 
@@ -1080,7 +1089,6 @@ void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoin
 bool BLI_bvhtree_update_node(BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints)
 {
 	BVHNode *node = NULL;
-	axis_t axis_iter;
 	
 	/* check if index exists */
 	if (index > tree->totleaf)
@@ -1093,27 +1101,110 @@ bool BLI_bvhtree_update_node(BVHTree *tree, int index, const float co[3], const
 	if (co_moving)
 		create_kdop_hull(tree, node, co_moving, numpoints, 1);
 	
-	/* inflate the bv with some epsilon */
-	for (axis_iter = tree->start_axis; axis_iter < tree->stop_axis; axis_iter++) {
-		node->bv[(2 * axis_iter)]     -= tree->epsilon; /* minimum */
-		node->bv[(2 * axis_iter) + 1] += tree->epsilon; /* maximum */
-	}
+	node_inflate(tree, node);
 
 	return true;
 }
 
+static void bvhtree_refit_branches_task_cb(void *userdata, const int start, const int stop)
+{
+	BVHTree *tree = userdata;
+	int i;
+
+	for (i = start; i < stop; i++) {
+		node_join(tree, tree->nodes[tree->totleaf + i]);
+	}
+}
+
+/**
+ * Update bottom=>top
+ * TRICKY: the way we build the tree all the childs have an index greater than the parent,
+ * and the branches are stored one level after the other (see #non_recursive_bvh_div_nodes).
+ * So we can refit a whole level at once, starting from the deepest one.
+ */
+static void bvhtree_refit_branches(BVHTree *tree)
+{
+	const int tree_type   = tree->tree_type;
+	const int tree_offset = 2 - tree->tree_type;
+	int level_first[32];  /* first branch on each level, implicit trees use 1-based indexs */
+	int i, depth, totlevel = 0;
+
+	for (i = 1; i <= tree->totbranch; i = i * tree_type + tree_offset) {
+		level_first[totlevel++] = i;
+	}
+
+	for (depth = totlevel - 1; depth >= 0; depth--) {
+		const int start = level_first[depth] - 1;
+		const int stop  = (depth + 1 < totlevel) ? level_first[depth + 1] - 1 : tree->totbranch;
+
+		BLI_task_parallel_range_chunked(
+		        start, stop, KDOPBVH_REFIT_CHUNK_SIZE, tree, bvhtree_refit_branches_task_cb,
+		        (stop - start) > KDOPBVH_THREAD_LEAF_THRESHOLD);
+	}
+}
+
 /* call BLI_bvhtree_update_node() first for every node/point/triangle */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
-	/* Update bottom=>top
-	 * TRICKY: the way we build the tree all the childs have an index greater than the parent
-	 * This allows us todo a bottom up update by starting on the bigger numbered branch */
+	bvhtree_refit_branches(tree);
+}
+
+typedef struct BVHRefitData {
+	BVHTree *tree;
+	int numpoints;
+	bool moving;
+
+	BVHTree_RefitLeafCallback leaf_cb;
+	void *userdata;
+} BVHRefitData;
+
+static void bvhtree_refit_leafs_task_cb(void *userdata, const int start, const int stop)
+{
+	const BVHRefitData *data = userdata;
+	BVHTree *tree = data->tree;
+	float co[BVH_REFIT_POINTS_MAX][3], co_moving[BVH_REFIT_POINTS_MAX][3];
+	int i;
+
+	for (i = start; i < stop; i++) {
+		BVHNode *node = tree->nodes[i];
+
+		data->leaf_cb(data->userdata, node->index, co, data->moving ? co_moving : NULL);
+
+		create_kdop_hull(tree, node, co[0], data->numpoints, 0);
+		if (data->moving) {
+			create_kdop_hull(tree, node, co_moving[0], data->numpoints, 1);
+		}
+		node_inflate(tree, node);
+	}
+}
+
+/**
+ * Refit a balanced tree to new positions of its points,
+ * the batch version of #BLI_bvhtree_update_node + #BLI_bvhtree_update_tree.
+ *
+ * All leafs are refit in parallel, then the branches one level at a time.
+ *
+ * \param numpoints: Number of points of every leaf, at most #BVH_REFIT_POINTS_MAX.
+ * \param moving: Also fetch the moving points, the leafs then bound both.
+ * \param leaf_cb: Fills in the points of the leaf with the given index (as passed to #BLI_bvhtree_insert).
+ */
+void BLI_bvhtree_refit(
+        BVHTree *tree, int numpoints, bool moving,
+        BVHTree_RefitLeafCallback leaf_cb, void *userdata)
+{
+	BVHRefitData data = {
+		.tree = tree, .numpoints = numpoints, .moving = moving,
+		.leaf_cb = leaf_cb, .userdata = userdata,
+	};
+
+	BLI_assert(numpoints > 0 && numpoints <= BVH_REFIT_POINTS_MAX);
+	BLI_assert(tree->totbranch > 0);
 
-	BVHNode **root  = tree->nodes + tree->totleaf;
-	BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+	BLI_task_parallel_range_chunked(
+	        0, tree->totleaf, KDOPBVH_REFIT_CHUNK_SIZE, &data, bvhtree_refit_leafs_task_cb,
+	        tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
 
-	for (; index >= root; index--)
-		node_join(tree, *index);
+	bvhtree_refit_branches(tree);
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
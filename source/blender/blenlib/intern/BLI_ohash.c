@@ -0,0 +1,814 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_ohash.c
+ *  \ingroup bli
+ *
+ * A general (pointer -> pointer) open addressing hash table.
+ *
+ * Entries live directly in a power of two sized bucket array and collisions
+ * are resolved with linear probing. Robin Hood insertion keeps the probe
+ * lengths short and even: an entry being inserted takes the bucket of any
+ * entry that is closer to its ideal bucket, which then continues probing in
+ * its place. This also lets lookups of missing keys stop early, and removal
+ * shifts the following entries back instead of leaving tombstones.
+ *
+ * Compared to #GHash, lookups touch a single contiguous run of buckets
+ * instead of following a linked list of #BLI_mempool allocated entries.
+ *
+ * Pointer and integer keyed tables inline their hash and compare functions.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_sys_types.h"  /* for intptr_t support */
+#include "BLI_utildefines.h"
+
+#define GHASH_INTERNAL_API
+#include "BLI_ohash.h"
+#include "BLI_strict_flags.h"
+
+#define OHASH_BUCKET_BIT_MIN 3
+#define OHASH_BUCKET_BIT_MAX 30  /* About 1G of buckets... */
+
+/**
+ * \note Same max load as #GHash, Robin Hood probing keeps lookups fast up to
+ * much higher loads, but misses get longer.
+ */
+#define OHASH_LIMIT_GROW(_nbkt) (((_nbkt) / 4) * 3)
+
+/* Zero hash marks an empty bucket. */
+#define OHASH_EMPTY 0u
+
+/* -------------------------------------------------------------------- */
+/* Structs */
+
+/** \name Structs & Constants
+ * \{ */
+
+typedef struct OHashEntry {
+	void *key;
+	void *val;
+	unsigned int hash;
+} OHashEntry;
+
+typedef enum OHashKeyType {
+	OHASH_KEY_CALLBACK = 0,
+	OHASH_KEY_PTR,
+	OHASH_KEY_INT,
+} OHashKeyType;
+
+struct OHash {
+	GHashHashFP hashfp;
+	GHashCmpFP cmpfp;
+
+	OHashEntry *buckets;
+	unsigned int bucket_mask;
+	unsigned int bucket_shift;
+	unsigned int limit_grow;
+	unsigned int nentries;
+	OHashKeyType keytype;
+};
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/* OHash API */
+
+/** \name Internal Utility API
+ * \{ */
+
+/* Same as #BLI_ghashutil_ptrhash. */
+BLI_INLINE unsigned int ohash_ptrhash(const void *key)
+{
+	size_t y = (size_t)key;
+	/* bottom 3 or 4 bits are likely to be 0; rotate y by 4 to avoid
+	 * excessive hash collisions for dicts and sets */
+	y = (y >> 4) | (y << (8 * sizeof(void *) - 4));
+	return (unsigned int)y;
+}
+
+/* Same as #BLI_ghashutil_inthash_p. */
+BLI_INLINE unsigned int ohash_inthash(const void *ptr)
+{
+	uintptr_t key = (uintptr_t)ptr;
+
+	key += ~(key << 16);
+	key ^=  (key >>  5);
+	key +=  (key <<  3);
+	key ^=  (key >> 13);
+	key += ~(key <<  9);
+	key ^=  (key >> 17);
+
+	return (unsigned int)(key & 0xffffffff);
+}
+
+BLI_INLINE unsigned int ohash_keyhash(const OHash *oh, const void *key)
+{
+	unsigned int hash;
+
+	switch (oh->keytype) {
+		case OHASH_KEY_PTR:
+			hash = ohash_ptrhash(key);
+			break;
+		case OHASH_KEY_INT:
+			hash = ohash_inthash(key);
+			break;
+		default:
+			hash = oh->hashfp(key);
+			break;
+	}
+
+	return (hash != OHASH_EMPTY) ? hash : 1u;
+}
+
+BLI_INLINE bool ohash_keyeq(const OHash *oh, const void *a, const void *b)
+{
+	if (oh->keytype != OHASH_KEY_CALLBACK) {
+		return (a == b);
+	}
+	return (oh->cmpfp(a, b) == false);
+}
+
+/**
+ * Ideal bucket of \a hash, using Fibonacci hashing (multiplying by 2^32 / phi and
+ * taking the top bits), since linear probing degrades badly when the low bits of
+ * hashes are correlated, as they are for pointers and sequential integers.
+ */
+BLI_INLINE unsigned int ohash_bucket_index(const OHash *oh, const unsigned int hash)
+{
+	return (hash * 2654435769u) >> oh->bucket_shift;
+}
+
+/**
+ * Distance of the entry with \a hash in bucket \a bucket from its ideal bucket.
+ */
+BLI_INLINE unsigned int ohash_probe_dist(const OHash *oh, const unsigned int hash, const unsigned int bucket)
+{
+	return (bucket - ohash_bucket_index(oh, hash)) & oh->bucket_mask;
+}
+
+/**
+ * Place an entry whose key is not in the table yet,
+ * returns the bucket the entry ends up in.
+ */
+static OHashEntry *ohash_bucket_insert(OHash *oh, void *key, void *val, const unsigned int hash)
+{
+	OHashEntry *buckets = oh->buckets;
+	OHashEntry entry = {key, val, hash};
+	OHashEntry *r_entry = NULL;
+	unsigned int bucket = ohash_bucket_index(oh, hash);
+	unsigned int dist = 0;
+
+	for (;; bucket = (bucket + 1) & oh->bucket_mask, dist++) {
+		OHashEntry *e = &buckets[bucket];
+
+		if (e->hash == OHASH_EMPTY) {
+			*e = entry;
+			return r_entry ? r_entry : e;
+		}
+		else {
+			const unsigned int e_dist = ohash_probe_dist(oh, e->hash, bucket);
+
+			if (e_dist < dist) {
+				/* Take the place of the richer entry, and continue inserting that one. */
+				SWAP(OHashEntry, *e, entry);
+				dist = e_dist;
+
+				if (r_entry == NULL) {
+					r_entry = e;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Resize to the smallest power of two fitting \a nentries, never shrinks.
+ */
+static void ohash_buckets_resize(OHash *oh, const unsigned int nentries)
+{
+	OHashEntry *buckets_old = oh->buckets;
+	const unsigned int nbuckets_old = buckets_old ? oh->bucket_mask + 1 : 0;
+	unsigned int bucket_bit = OHASH_BUCKET_BIT_MIN;
+	unsigned int nbuckets;
+	unsigned int i;
+
+	while ((bucket_bit < OHASH_BUCKET_BIT_MAX) && (OHASH_LIMIT_GROW(1u << bucket_bit) < nentries)) {
+		bucket_bit++;
+	}
+	nbuckets = 1u << bucket_bit;
+
+	if (nbuckets <= nbuckets_old) {
+		return;
+	}
+
+	oh->buckets = MEM_callocN(sizeof(*oh->buckets) * (size_t)nbuckets, __func__);
+	oh->bucket_mask = nbuckets - 1;
+	oh->bucket_shift = 32 - bucket_bit;
+	oh->limit_grow = OHASH_LIMIT_GROW(nbuckets);
+
+	for (i = 0; i < nbuckets_old; i++) {
+		OHashEntry *e = &buckets_old[i];
+		if (e->hash != OHASH_EMPTY) {
+			ohash_bucket_insert(oh, e->key, e->val, e->hash);
+		}
+	}
+
+	if (buckets_old) {
+		MEM_freeN(buckets_old);
+	}
+}
+
+BLI_INLINE void ohash_ensure_space(OHash *oh)
+{
+	if (UNLIKELY(oh->nentries + 1 > oh->limit_grow)) {
+		ohash_buckets_resize(oh, oh->nentries + 1);
+	}
+}
+
+BLI_INLINE OHashEntry *ohash_lookup_entry_ex(const OHash *oh, const void *key, const unsigned int hash)
+{
+	OHashEntry *buckets = oh->buckets;
+	unsigned int bucket = ohash_bucket_index(oh, hash);
+	unsigned int dist = 0;
+
+	for (;; bucket = (bucket + 1) & oh->bucket_mask, dist++) {
+		OHashEntry *e = &buckets[bucket];
+
+		if (e->hash == OHASH_EMPTY) {
+			return NULL;
+		}
+		/* Any entry of the key would have taken this bucket. */
+		if (ohash_probe_dist(oh, e->hash, bucket) < dist) {
+			return NULL;
+		}
+		if (e->hash == hash && ohash_keyeq(oh, key, e->key)) {
+			return e;
+		}
+	}
+}
+
+BLI_INLINE OHashEntry *ohash_lookup_entry(const OHash *oh, const void *key)
+{
+	return ohash_lookup_entry_ex(oh, key, ohash_keyhash(oh, key));
+}
+
+/**
+ * Remove the entry in bucket \a e, shifting back the entries
+ * probed past it.
+ */
+static void ohash_remove_entry(OHash *oh, OHashEntry *e)
+{
+	OHashEntry *buckets = oh->buckets;
+	unsigned int bucket = (unsigned int)(e - buckets);
+
+	for (;;) {
+		const unsigned int bucket_next = (bucket + 1) & oh->bucket_mask;
+		OHashEntry *e_next = &buckets[bucket_next];
+
+		if (e_next->hash == OHASH_EMPTY || ohash_probe_dist(oh, e_next->hash, bucket_next) == 0) {
+			break;
+		}
+
+		buckets[bucket] = *e_next;
+		bucket = bucket_next;
+	}
+
+	buckets[bucket].key = NULL;
+	buckets[bucket].val = NULL;
+	buckets[bucket].hash = OHASH_EMPTY;
+	oh->nentries--;
+}
+
+static void ohash_free_cb(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	unsigned int i;
+
+	BLI_assert(keyfreefp || valfreefp);
+
+	for (i = 0; i <= oh->bucket_mask; i++) {
+		OHashEntry *e = &oh->buckets[i];
+		if (e->hash != OHASH_EMPTY) {
+			if (keyfreefp) keyfreefp(e->key);
+			if (valfreefp) valfreefp(e->val);
+		}
+	}
+}
+
+static OHash *ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, OHashKeyType keytype,
+                        const char *info, const unsigned int nentries_reserve)
+{
+	OHash *oh = MEM_mallocN(sizeof(*oh), info);
+
+	oh->hashfp = hashfp;
+	oh->cmpfp = cmpfp;
+	oh->keytype = keytype;
+	oh->buckets = NULL;
+	oh->bucket_mask = 0;
+	oh->bucket_shift = 0;
+	oh->limit_grow = 0;
+	oh->nentries = 0;
+
+	ohash_buckets_resize(oh, nentries_reserve);
+
+	return oh;
+}
+
+/** \} */
+
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty OHash.
+ *
+ * \param hashfp  Hash callback.
+ * \param cmpfp  Comparison callback.
+ * \param info  Identifier string for the OHash.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty OHash.
+ */
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve)
+{
+	return ohash_new(hashfp, cmpfp, OHASH_KEY_CALLBACK, info, nentries_reserve);
+}
+
+/**
+ * Wraps #BLI_ohash_new_ex with zero entries reserved.
+ */
+OHash *BLI_ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_ohash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * OHash keyed by pointer identity, behaves like #BLI_ghash_ptr_new_ex.
+ */
+OHash *BLI_ohash_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return ohash_new(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, OHASH_KEY_PTR, info, nentries_reserve);
+}
+OHash *BLI_ohash_ptr_new(const char *info)
+{
+	return BLI_ohash_ptr_new_ex(info, 0);
+}
+
+/**
+ * OHash keyed by integers stored in pointers, behaves like #BLI_ghash_int_new_ex.
+ */
+OHash *BLI_ohash_int_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, OHASH_KEY_INT, info, nentries_reserve);
+}
+OHash *BLI_ohash_int_new(const char *info)
+{
+	return BLI_ohash_int_new_ex(info, 0);
+}
+
+/**
+ * Reserve given amount of entries (resize \a oh accordingly if needed).
+ */
+void BLI_ohash_reserve(OHash *oh, const unsigned int nentries_reserve)
+{
+	ohash_buckets_resize(oh, nentries_reserve);
+}
+
+/**
+ * \return size of the OHash.
+ */
+unsigned int BLI_ohash_size(OHash *oh)
+{
+	return oh->nentries;
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_ohash_insert(OHash *oh, void *key, void *val)
+{
+	const unsigned int hash = ohash_keyhash(oh, key);
+
+	BLI_assert(ohash_lookup_entry_ex(oh, key, hash) == NULL);
+
+	ohash_ensure_space(oh);
+	ohash_bucket_insert(oh, key, val, hash);
+	oh->nentries++;
+}
+
+/**
+ * Inserts a new value to a key that may already be in ohash.
+ *
+ * Avoids #BLI_ohash_remove, #BLI_ohash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_ohash_reinsert(OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const unsigned int hash = ohash_keyhash(oh, key);
+	OHashEntry *e = ohash_lookup_entry_ex(oh, key, hash);
+
+	if (e) {
+		if (keyfreefp) keyfreefp(e->key);
+		if (valfreefp) valfreefp(e->val);
+		e->key = key;
+		e->val = val;
+		return false;
+	}
+
+	ohash_ensure_space(oh);
+	ohash_bucket_insert(oh, key, val, hash);
+	oh->nentries++;
+	return true;
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \param key  The key to lookup.
+ * \returns the value for \a key or NULL.
+ */
+void *BLI_ohash_lookup(OHash *oh, const void *key)
+{
+	OHashEntry *e = ohash_lookup_entry(oh, key);
+	return e ? e->val : NULL;
+}
+
+/**
+ * A version of #BLI_ohash_lookup which accepts a fallback argument.
+ */
+void *BLI_ohash_lookup_default(OHash *oh, const void *key, void *val_default)
+{
+	OHashEntry *e = ohash_lookup_entry(oh, key);
+	return e ? e->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note This has 2 main benefits over #BLI_ohash_lookup.
+ * - A NULL return always means that \a key isn't in \a oh.
+ * - The value can be modified in-place without further function calls (faster).
+ *
+ * \note Unlike #BLI_ghash_lookup_p the pointer is invalidated by the next insertion or removal.
+ */
+void **BLI_ohash_lookup_p(OHash *oh, const void *key)
+{
+	OHashEntry *e = ohash_lookup_entry(oh, key);
+	return e ? &e->val : NULL;
+}
+
+/**
+ * Ensure \a key is exists in \a oh.
+ *
+ * This handles the common situation where the caller needs ensure a key is added to \a oh,
+ * constructing a new value in the case the key isn't found.
+ * Otherwise use the existing value.
+ *
+ * \param r_val: Pointer to the value, valid until the next insertion or removal.
+ * \returns true when the value was already present, false otherwise.
+ */
+bool BLI_ohash_ensure_p(OHash *oh, void *key, void ***r_val)
+{
+	const unsigned int hash = ohash_keyhash(oh, key);
+	OHashEntry *e = ohash_lookup_entry_ex(oh, key, hash);
+	const bool haskey = (e != NULL);
+
+	if (!haskey) {
+		ohash_ensure_space(oh);
+		e = ohash_bucket_insert(oh, key, NULL, hash);
+		oh->nentries++;
+	}
+
+	*r_val = &e->val;
+	return haskey;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \return true if \a key was removed from \a oh.
+ */
+bool BLI_ohash_remove(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	OHashEntry *e = ohash_lookup_entry(oh, key);
+
+	if (e) {
+		if (keyfreefp) keyfreefp(e->key);
+		if (valfreefp) valfreefp(e->val);
+		ohash_remove_entry(oh, e);
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \return the value of \a key int \a oh or NULL.
+ */
+void *BLI_ohash_popkey(OHash *oh, const void *key, GHashKeyFreeFP keyfreefp)
+{
+	OHashEntry *e = ohash_lookup_entry(oh, key);
+
+	if (e) {
+		void *val = e->val;
+		if (keyfreefp) keyfreefp(e->key);
+		ohash_remove_entry(oh, e);
+		return val;
+	}
+	else {
+		return NULL;
+	}
+}
+
+/**
+ * \return true if the \a key is in \a oh.
+ */
+bool BLI_ohash_haskey(OHash *oh, const void *key)
+{
+	return (ohash_lookup_entry(oh, key) != NULL);
+}
+
+/**
+ * Reset \a oh clearing all entries, keeping its buckets allocated.
+ *
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ */
+void BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp) {
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+	}
+
+	memset(oh->buckets, 0, sizeof(*oh->buckets) * ((size_t)oh->bucket_mask + 1));
+	oh->nentries = 0;
+}
+
+/**
+ * Frees the OHash and its members.
+ *
+ * \param oh  The OHash to free.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ */
+void BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp) {
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+	}
+
+	MEM_freeN(oh->buckets);
+	MEM_freeN(oh);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/* OHash Iterator API */
+
+/** \name Iterator API
+ * \{ */
+
+/**
+ * Init an already allocated OHashIterator. The hash table must not
+ * be mutated while the iterator is in use.
+ *
+ * \param ohi  The OHashIterator to initialize.
+ * \param oh  The OHash to iterate over.
+ */
+void BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh)
+{
+	ohi->oh = oh;
+	ohi->curEntry = NULL;
+	ohi->curBucket = UINT_MAX;  /* wraps to zero */
+	BLI_ohashIterator_step(ohi);
+}
+
+/**
+ * Steps the iterator to the next entry.
+ *
+ * \param ohi  The iterator.
+ */
+void BLI_ohashIterator_step(OHashIterator *ohi)
+{
+	OHash *oh = ohi->oh;
+
+	ohi->curEntry = NULL;
+	while (++ohi->curBucket <= oh->bucket_mask) {
+		OHashEntry *e = &oh->buckets[ohi->curBucket];
+		if (e->hash != OHASH_EMPTY) {
+			ohi->curEntry = e;
+			break;
+		}
+	}
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/* OSet API */
+
+/** \name OSet Public API
+ *
+ * Use ghash API to give 'set' functionality
+ * \{ */
+
+OSet *BLI_oset_new_ex(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info,
+                      const unsigned int nentries_reserve)
+{
+	return (OSet *)BLI_ohash_new_ex(hashfp, cmpfp, info, nentries_reserve);
+}
+
+OSet *BLI_oset_new(GSetHashFP hashfp, GSetCmpFP cmpfp, const char *info)
+{
+	return BLI_oset_new_ex(hashfp, cmpfp, info, 0);
+}
+
+OSet *BLI_oset_ptr_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return (OSet *)BLI_ohash_ptr_new_ex(info, nentries_reserve);
+}
+OSet *BLI_oset_ptr_new(const char *info)
+{
+	return BLI_oset_ptr_new_ex(info, 0);
+}
+
+OSet *BLI_oset_int_new_ex(const char *info, const unsigned int nentries_reserve)
+{
+	return (OSet *)BLI_ohash_int_new_ex(info, nentries_reserve);
+}
+OSet *BLI_oset_int_new(const char *info)
+{
+	return BLI_oset_int_new_ex(info, 0);
+}
+
+unsigned int BLI_oset_size(OSet *os)
+{
+	return ((OHash *)os)->nentries;
+}
+
+void BLI_oset_reserve(OSet *os, const unsigned int nentries_reserve)
+{
+	BLI_ohash_reserve((OHash *)os, nentries_reserve);
+}
+
+/**
+ * Adds the key to the set (no checks for unique keys!).
+ * Matching #BLI_ohash_insert
+ */
+void BLI_oset_insert(OSet *os, void *key)
+{
+	BLI_ohash_insert((OHash *)os, key, NULL);
+}
+
+/**
+ * A version of BLI_oset_insert which checks first if the key is in the set.
+ * \returns true if a new key has been added.
+ */
+bool BLI_oset_add(OSet *os, void *key)
+{
+	OHash *oh = (OHash *)os;
+	const unsigned int hash = ohash_keyhash(oh, key);
+
+	if (ohash_lookup_entry_ex(oh, key, hash)) {
+		return false;
+	}
+
+	ohash_ensure_space(oh);
+	ohash_bucket_insert(oh, key, NULL, hash);
+	oh->nentries++;
+	return true;
+}
+
+/**
+ * Adds the key to the set (duplicates are managed).
+ * Matching #BLI_ohash_reinsert
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_oset_reinsert(OSet *os, void *key, GSetKeyFreeFP keyfreefp)
+{
+	return BLI_ohash_reinsert((OHash *)os, key, NULL, keyfreefp, NULL);
+}
+
+/**
+ * \returns the key stored in the set which matches \a key, or NULL.
+ */
+void *BLI_oset_lookup(OSet *os, const void *key)
+{
+	OHashEntry *e = ohash_lookup_entry((OHash *)os, key);
+	return e ? e->key : NULL;
+}
+
+bool BLI_oset_haskey(OSet *os, const void *key)
+{
+	return (ohash_lookup_entry((OHash *)os, key) != NULL);
+}
+
+bool BLI_oset_remove(OSet *os, const void *key, GSetKeyFreeFP keyfreefp)
+{
+	return BLI_ohash_remove((OHash *)os, key, keyfreefp, NULL);
+}
+
+void BLI_oset_clear(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+	BLI_ohash_clear((OHash *)os, keyfreefp, NULL);
+}
+
+void BLI_oset_free(OSet *os, GSetKeyFreeFP keyfreefp)
+{
+	BLI_ohash_free((OHash *)os, keyfreefp, NULL);
+}
+
+/** \} */
+
+/** \name Debugging & Introspection
+ * \{ */
+
+/**
+ * \return number of buckets in the OHash.
+ */
+int BLI_ohash_buckets_size(OHash *oh)
+{
+	return (int)oh->bucket_mask + 1;
+}
+
+/**
+ * Measure how well the hash function performs, by the probe lengths of the
+ * entries (0 means the entry is in its ideal bucket).
+ *
+ * \return the mean number of buckets a successful lookup visits (the lower the better, 1.0 is ideal).
+ */
+double BLI_ohash_calc_quality_ex(
+        OHash *oh, double *r_load, double *r_mean_probe, int *r_longest_probe)
+{
+	double probe_sum = 0.0;
+	unsigned int longest = 0;
+	unsigned int i;
+
+	for (i = 0; i <= oh->bucket_mask; i++) {
+		OHashEntry *e = &oh->buckets[i];
+		if (e->hash != OHASH_EMPTY) {
+			const unsigned int dist = ohash_probe_dist(oh, e->hash, i);
+			probe_sum += (double)dist;
+			if (dist > longest) {
+				longest = dist;
+			}
+		}
+	}
+
+	if (oh->nentries) {
+		probe_sum /= (double)oh->nentries;
+	}
+
+	if (r_load) {
+		*r_load = (double)oh->nentries / (double)(oh->bucket_mask + 1);
+	}
+	if (r_mean_probe) {
+		*r_mean_probe = probe_sum;
+	}
+	if (r_longest_probe) {
+		*r_longest_probe = (int)longest;
+	}
+
+	return probe_sum + 1.0;
+}
+
+/** \} */
@@ -877,6 +877,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool)
  *
  * Main functions:
  * - #BLI_task_parallel_range
+ * - #BLI_task_parallel_range_chunked (calling back once per chunk of iterations)
  * - #BLI_task_parallel_listbase (#ListBase - double linked list)
  *
  * TODO:
@@ -896,6 +897,7 @@ typedef struct ParallelRangeState {
 
 	TaskParallelRangeFunc func;
 	TaskParallelRangeFuncEx func_ex;
+	TaskParallelRangeFuncChunk func_chunk;
 
 	int iter;
 	int chunk_size;
@@ -925,7 +927,10 @@ static void parallel_range_func(
 	while (parallel_range_next_iter_get(state, &iter, &count)) {
 		int i;
 
-		if (state->func_ex) {
+		if (state->func_chunk) {
+			state->func_chunk(state->userdata, iter, iter + count);
+		}
+		else if (state->func_ex) {
 			for (i = 0; i < count; ++i) {
 				state->func_ex(state->userdata, userdata_chunk, iter + i, threadid);
 			}
@@ -1017,6 +1022,7 @@ static void task_parallel_range_ex(
 	state.userdata = userdata;
 	state.func = func;
 	state.func_ex = func_ex;
+	state.func_chunk = NULL;
 	state.iter = start;
 	if (use_dynamic_scheduling) {
 		state.chunk_size = 32;
@@ -1144,6 +1150,82 @@ void BLI_task_parallel_range_finalize(
 #undef MALLOCA
 #undef MALLOCA_FREE
 
+/**
+ * Variant of #BLI_task_parallel_range where \a func_chunk is called once for each chunk of \a chunk_size
+ * iterations (the last one may be smaller), instead of once per iteration. Chunks are dynamically picked up by
+ * worker threads.
+ *
+ * Meant for cheap per element work such as deforming vertices, where calling a function for each element would
+ * cost as much as the work itself, and where the caller's inner loop benefits from being a plain for loop.
+ *
+ * \param start First index to process.
+ * \param stop Index to stop looping (excluded).
+ * \param chunk_size Number of iterations per call of \a func_chunk.
+ * \param userdata Common userdata passed to all instances of \a func_chunk.
+ * \param func_chunk Callback function, processing iterations from its \a start to its \a stop (excluded).
+ * \param use_threading If \a true, actually split-execute loop in threads, else just call \a func_chunk once
+ *                      for the whole range.
+ */
+void BLI_task_parallel_range_chunked(
+        int start, int stop,
+        const int chunk_size,
+        void *userdata,
+        TaskParallelRangeFuncChunk func_chunk,
+        const bool use_threading)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelRangeState state;
+	int i, num_threads, num_tasks, num_chunks;
+
+	if (start == stop) {
+		return;
+	}
+
+	BLI_assert(start < stop);
+	BLI_assert(chunk_size > 0);
+
+	num_chunks = (stop - start + chunk_size - 1) / chunk_size;
+
+	if (!use_threading || num_chunks == 1) {
+		func_chunk(userdata, start, stop);
+		return;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+	num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+
+	if (num_threads == 1) {
+		func_chunk(userdata, start, stop);
+		return;
+	}
+
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+	num_tasks = min_ii(num_threads * 2, num_chunks);
+
+	state.start = start;
+	state.stop = stop;
+	state.userdata = userdata;
+	state.func = NULL;
+	state.func_ex = NULL;
+	state.func_chunk = func_chunk;
+	state.iter = start;
+	state.chunk_size = chunk_size;
+	atomic_fetch_and_add_uint32((uint32_t *)(&state.iter), 0);
+
+	for (i = 0; i < num_tasks; i++) {
+		/* Use this pool's pre-allocated tasks. */
+		BLI_task_pool_push_from_thread(task_pool,
+		                               parallel_range_func,
+		                               NULL, false,
+		                               TASK_PRIORITY_HIGH,
+		                               task_pool->thread_id);
+	}
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+}
+
 typedef struct ParallelListbaseState {
 	void *userdata;
 	TaskParallelListbaseFunc func;
@@ -43,6 +43,7 @@
 #include "BLI_listbase.h"
 #include "BLI_string.h"
 #include "BLI_fileops.h"
+#include "BLI_math_bits.h"
 #include "BLI_math_geom.h"
 #include "BLI_path_util.h"
 
@@ -87,6 +88,7 @@ typedef struct BakeAPIRender {
 	ListBase selected_objects;
 
 	ScenePassType pass_type;
+	int pass_types; /* pass_type and the other passes baked with it */
 	int pass_filter;
 	int margin;
 
@@ -108,7 +110,6 @@ typedef struct BakeAPIRender {
 
 	int width;
 	int height;
-	const char *identifier;
 
 	int result;
 	bool ready;
@@ -351,6 +352,21 @@ static bool is_noncolor_pass(ScenePassType pass_type)
 	            SCE_PASS_INDEXMA);
 }
 
+/* split a combination of pass flags into the passes, in the order the render engine returns them */
+static int bake_passes_split(const int pass_types, ScenePassType r_passes[31])
+{
+	int tot_passes = 0;
+	int i;
+
+	for (i = 0; i < 31; i++) {
+		if (pass_types & (1 << i)) {
+			r_passes[tot_passes++] = (1 << i);
+		}
+	}
+
+	return tot_passes;
+}
+
 /* if all is good tag image and return true */
 static bool bake_object_check(Scene *scene, Object *ob, ReportList *reports)
 {
@@ -495,6 +511,21 @@ static bool bake_pass_filter_check(ScenePassType pass_type, const int pass_filte
 	}
 }
 
+static bool bake_passes_filter_check(const int pass_types, const int pass_filter, ReportList *reports)
+{
+	ScenePassType passes[31];
+	const int tot_passes = bake_passes_split(pass_types, passes);
+	int i;
+
+	for (i = 0; i < tot_passes; i++) {
+		if (!bake_pass_filter_check(passes[i], pass_filter, reports)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /* before even getting in the bake function we check for some basic errors */
 static bool bake_objects_check(Main *bmain, Scene *scene, Object *ob, ListBase *selected_objects,
                                ReportList *reports, const bool is_selected_to_active)
@@ -631,12 +662,12 @@ static Mesh *bake_mesh_new_from_object(Main *bmain, Scene *scene, Object *ob)
 
 static int bake(
         Render *re, Main *bmain, Scene *scene, Object *ob_low, ListBase *selected_objects, ReportList *reports,
-        const ScenePassType pass_type, const int pass_filter, const int margin,
+        const int pass_types, const int pass_filter, const int margin,
         const BakeSaveMode save_mode, const bool is_clear, const bool is_split_materials,
         const bool is_automatic_name, const bool is_selected_to_active, const bool is_cage,
         const float cage_extrusion, const int normal_space, const BakeNormalSwizzle normal_swizzle[],
         const char *custom_cage, const char *filepath, const int width, const int height,
-        const char *identifier, ScrArea *sa, const char *uv_layer)
+        ScrArea *sa, const char *uv_layer)
 {
 	int op_result = OPERATOR_CANCELLED;
 	bool ok = false;
@@ -661,14 +692,21 @@ static int bake(
 	BakePixel *pixel_array_high = NULL;
 
 	const bool is_save_internal = (save_mode == R_BAKE_SAVE_INTERNAL);
-	const bool is_noncolor = is_noncolor_pass(pass_type);
-	const int depth = RE_pass_depth(pass_type);
+
+	/* all passes are baked together by the engine, each taking depth * num_pixels of the result */
+	ScenePassType passes[31];
+	const int tot_passes = bake_passes_split(pass_types, passes);
+	int depth = 0;
 
 	BakeImages bake_images = {NULL};
 
 	size_t num_pixels;
 	int tot_materials;
 
+	for (int p = 0; p < tot_passes; p++) {
+		depth = max_ii(depth, RE_pass_depth(passes[p]));
+	}
+
 	RE_bake_engine_set_engine_parameters(re, bmain, scene);
 
 	if (!RE_bake_has_engine(re)) {
@@ -768,10 +806,10 @@ static int bake(
 
 	pixel_array_low = MEM_mallocN(sizeof(BakePixel) * num_pixels, "bake pixels low poly");
 	pixel_array_high = MEM_mallocN(sizeof(BakePixel) * num_pixels, "bake pixels high poly");
-	result = MEM_callocN(sizeof(float) * depth * num_pixels, "bake return pixels");
+	result = MEM_callocN(sizeof(float) * depth * num_pixels * tot_passes, "bake return pixels");
 
 	/* for multires bake, use linear UV subdivision to match low res UVs */
-	if (pass_type == SCE_PASS_NORMAL && normal_space == R_BAKE_SPACE_TANGENT && !is_selected_to_active) {
+	if ((pass_types & SCE_PASS_NORMAL) && normal_space == R_BAKE_SPACE_TANGENT && !is_selected_to_active) {
 		mmd_low = (MultiresModifierData *) modifiers_findByType(ob_low, eModifierType_Multires);
 		if (mmd_low) {
 			mmd_flags_low = mmd_low->flags;
@@ -881,7 +919,7 @@ static int bake(
 		/* the baking itself */
 		for (i = 0; i < tot_highpoly; i++) {
 			ok = RE_bake_engine(re, highpoly[i].ob, i, pixel_array_high,
-			                    num_pixels, depth, pass_type, pass_filter, result);
+			                    num_pixels, depth, pass_types, pass_filter, result);
 			if (!ok) {
 				BKE_reportf(reports, RPT_ERROR, "Error baking from object \"%s\"", highpoly[i].ob->id.name + 2);
 				goto cage_cleanup;
@@ -907,7 +945,7 @@ cage_cleanup:
 		ob_low->restrictflag &= ~OB_RESTRICT_RENDER;
 
 		if (RE_bake_has_engine(re)) {
-			ok = RE_bake_engine(re, ob_low, 0, pixel_array_low, num_pixels, depth, pass_type, pass_filter, result);
+			ok = RE_bake_engine(re, ob_low, 0, pixel_array_low, num_pixels, depth, pass_types, pass_filter, result);
 		}
 		else {
 			BKE_report(reports, RPT_ERROR, "Current render engine does not support baking");
@@ -917,7 +955,9 @@ cage_cleanup:
 
 	/* normal space conversion
 	 * the normals are expected to be in world space, +X +Y +Z */
-	if (ok && pass_type == SCE_PASS_NORMAL) {
+	if (ok && (pass_types & SCE_PASS_NORMAL)) {
+		float *result_normal = result + (size_t)count_bits_i(pass_types & (SCE_PASS_NORMAL - 1)) * num_pixels * depth;
+
 		switch (normal_space) {
 			case R_BAKE_SPACE_WORLD:
 			{
@@ -929,19 +969,19 @@ cage_cleanup:
 					break;
 				}
 				else {
-					RE_bake_normal_world_to_world(pixel_array_low, num_pixels,  depth, result, normal_swizzle);
+					RE_bake_normal_world_to_world(pixel_array_low, num_pixels,  depth, result_normal, normal_swizzle);
 				}
 				break;
 			}
 			case R_BAKE_SPACE_OBJECT:
 			{
-				RE_bake_normal_world_to_object(pixel_array_low, num_pixels, depth, result, ob_low, normal_swizzle);
+				RE_bake_normal_world_to_object(pixel_array_low, num_pixels, depth, result_normal, ob_low, normal_swizzle);
 				break;
 			}
 			case R_BAKE_SPACE_TANGENT:
 			{
 				if (is_selected_to_active) {
-					RE_bake_normal_world_to_tangent(pixel_array_low, num_pixels, depth, result, me_low, normal_swizzle, ob_low->obmat);
+					RE_bake_normal_world_to_tangent(pixel_array_low, num_pixels, depth, result_normal, me_low, normal_swizzle, ob_low->obmat);
 				}
 				else {
 					/* from multiresolution */
@@ -959,7 +999,7 @@ cage_cleanup:
 					me_nores = bake_mesh_new_from_object(bmain, scene, ob_low);
 					RE_bake_pixels_populate(me_nores, pixel_array_low, num_pixels, &bake_images, uv_layer);
 
-					RE_bake_normal_world_to_tangent(pixel_array_low, num_pixels, depth, result, me_nores, normal_swizzle, ob_low->obmat);
+					RE_bake_normal_world_to_tangent(pixel_array_low, num_pixels, depth, result_normal, me_nores, normal_swizzle, ob_low->obmat);
 					BKE_libblock_free(bmain, me_nores);
 
 					if (md)
@@ -977,83 +1017,91 @@ cage_cleanup:
 		op_result = OPERATOR_CANCELLED;
 	}
 	else {
-		/* save the results */
-		for (int i = 0; i < bake_images.size; i++) {
-			BakeImage *bk_image = &bake_images.data[i];
-
-			if (is_save_internal) {
-				ok = write_internal_bake_pixels(
-				         bk_image->image,
-				         pixel_array_low + bk_image->offset,
-				         result + bk_image->offset * depth,
-				         bk_image->width, bk_image->height,
-				         margin, is_clear, is_noncolor);
-
-				/* might be read by UI to set active image for display */
-				bake_update_image(sa, bk_image->image);
-
-				if (!ok) {
-					BKE_reportf(reports, RPT_ERROR,
-					           "Problem saving the bake map internally for object \"%s\"", ob_low->id.name + 2);
-					op_result = OPERATOR_CANCELLED;
+		/* save the results, the passes are saved to one file each */
+		for (int p = 0; p < tot_passes; p++) {
+			const bool is_noncolor = is_noncolor_pass(passes[p]);
+			float *result_pass = result + (size_t)p * num_pixels * depth;
+			const char *identifier = "";
+
+			RNA_enum_identifier(rna_enum_bake_pass_type_items, passes[p], &identifier);
+
+			for (int i = 0; i < bake_images.size; i++) {
+				BakeImage *bk_image = &bake_images.data[i];
+
+				if (is_save_internal) {
+					ok = write_internal_bake_pixels(
+					         bk_image->image,
+					         pixel_array_low + bk_image->offset,
+					         result_pass + bk_image->offset * depth,
+					         bk_image->width, bk_image->height,
+					         margin, is_clear, is_noncolor);
+
+					/* might be read by UI to set active image for display */
+					bake_update_image(sa, bk_image->image);
+
+					if (!ok) {
+						BKE_reportf(reports, RPT_ERROR,
+						           "Problem saving the bake map internally for object \"%s\"", ob_low->id.name + 2);
+						op_result = OPERATOR_CANCELLED;
+					}
+					else {
+						BKE_report(reports, RPT_INFO,
+						           "Baking map saved to internal image, save it externally or pack it");
+						op_result = OPERATOR_FINISHED;
+					}
 				}
+				/* save externally */
 				else {
-					BKE_report(reports, RPT_INFO,
-					           "Baking map saved to internal image, save it externally or pack it");
-					op_result = OPERATOR_FINISHED;
-				}
-			}
-			/* save externally */
-			else {
-				BakeData *bake = &scene->r.bake;
-				char name[FILE_MAX];
-
-				BKE_image_path_from_imtype(name, filepath, bmain->name, 0, bake->im_format.imtype, true, false, NULL);
+					BakeData *bake = &scene->r.bake;
+					char name[FILE_MAX];
 
-				if (is_automatic_name) {
-					BLI_path_suffix(name, FILE_MAX, ob_low->id.name + 2, "_");
-					BLI_path_suffix(name, FILE_MAX, identifier, "_");
-				}
+					BKE_image_path_from_imtype(name, filepath, bmain->name, 0, bake->im_format.imtype, true, false, NULL);
 
-				if (is_split_materials) {
-					if (bk_image->image) {
-						BLI_path_suffix(name, FILE_MAX, bk_image->image->id.name + 2, "_");
+					if (is_automatic_name) {
+						BLI_path_suffix(name, FILE_MAX, ob_low->id.name + 2, "_");
+						BLI_path_suffix(name, FILE_MAX, identifier, "_");
 					}
-					else {
-						if (ob_low->mat[i]) {
-							BLI_path_suffix(name, FILE_MAX, ob_low->mat[i]->id.name + 2, "_");
-						}
-						else if (me_low->mat[i]) {
-							BLI_path_suffix(name, FILE_MAX, me_low->mat[i]->id.name + 2, "_");
+
+					if (is_split_materials) {
+						if (bk_image->image) {
+							BLI_path_suffix(name, FILE_MAX, bk_image->image->id.name + 2, "_");
 						}
 						else {
-							/* if everything else fails, use the material index */
-							char tmp[4];
-							sprintf(tmp, "%d", i % 1000);
-							BLI_path_suffix(name, FILE_MAX, tmp, "_");
+							if (ob_low->mat[i]) {
+								BLI_path_suffix(name, FILE_MAX, ob_low->mat[i]->id.name + 2, "_");
+							}
+							else if (me_low->mat[i]) {
+								BLI_path_suffix(name, FILE_MAX, me_low->mat[i]->id.name + 2, "_");
+							}
+							else {
+								/* if everything else fails, use the material index */
+								char tmp[4];
+								sprintf(tmp, "%d", i % 1000);
+								BLI_path_suffix(name, FILE_MAX, tmp, "_");
+							}
 						}
 					}
-				}
 
-				/* save it externally */
-				ok = write_external_bake_pixels(
-				        name,
-				        pixel_array_low + bk_image->offset,
-				        result + bk_image->offset * depth,
-				        bk_image->width, bk_image->height,
-				        margin, &bake->im_format, is_noncolor);
-
-				if (!ok) {
-					BKE_reportf(reports, RPT_ERROR, "Problem saving baked map in \"%s\"", name);
-					op_result = OPERATOR_CANCELLED;
-				}
-				else {
-					BKE_reportf(reports, RPT_INFO, "Baking map written to \"%s\"", name);
-					op_result = OPERATOR_FINISHED;
-				}
+					/* save it externally */
+					ok = write_external_bake_pixels(
+					        name,
+					        pixel_array_low + bk_image->offset,
+					        result_pass + bk_image->offset * depth,
+					        bk_image->width, bk_image->height,
+					        margin, &bake->im_format, is_noncolor);
+
+					if (!ok) {
+						BKE_reportf(reports, RPT_ERROR, "Problem saving baked map in \"%s\"", name);
+						op_result = OPERATOR_CANCELLED;
+					}
+					else {
+						BKE_reportf(reports, RPT_INFO, "Baking map written to \"%s\"", name);
+						op_result = OPERATOR_FINISHED;
+					}
 
-				if (!is_split_materials) {
-					break;
+					if (!is_split_materials) {
+						break;
+					}
 				}
 			}
 		}
@@ -1121,6 +1169,7 @@ static void bake_init_api_data(wmOperator *op, bContext *C, BakeAPIRender *bkr)
 	bkr->sa = sc ? BKE_screen_find_big_area(sc, SPACE_IMAGE, 10) : NULL;
 
 	bkr->pass_type = RNA_enum_get(op->ptr, "type");
+	bkr->pass_types = bkr->pass_type | RNA_enum_get(op->ptr, "passes");
 	bkr->pass_filter = RNA_enum_get(op->ptr, "pass_filter");
 	bkr->margin = RNA_int_get(op->ptr, "margin");
 
@@ -1141,16 +1190,12 @@ static void bake_init_api_data(wmOperator *op, bContext *C, BakeAPIRender *bkr)
 
 	bkr->width = RNA_int_get(op->ptr, "width");
 	bkr->height = RNA_int_get(op->ptr, "height");
-	bkr->identifier = "";
 
 	RNA_string_get(op->ptr, "uv_layer", bkr->uv_layer);
 
 	RNA_string_get(op->ptr, "cage_object", bkr->custom_cage);
 
-	if ((!is_save_internal) && bkr->is_automatic_name) {
-		PropertyRNA *prop = RNA_struct_find_property(op->ptr, "type");
-		RNA_property_enum_identifier(C, op->ptr, prop, bkr->pass_type, &bkr->identifier);
-	}
+	RNA_string_get(op->ptr, "filepath", bkr->filepath);
 
 	CTX_data_selected_objects(C, &bkr->selected_objects);
 
@@ -1161,8 +1206,15 @@ static void bake_init_api_data(wmOperator *op, bContext *C, BakeAPIRender *bkr)
 	bkr->render = RE_NewRender(bkr->scene->id.name);
 
 	/* XXX hack to force saving to always be internal. Whether (and how) to support
-	 * external saving will be addressed later */
-	bkr->save_mode = R_BAKE_SAVE_INTERNAL;
+	 * external saving will be addressed later. Several passes can't share the
+	 * images of the materials, so they are saved to a file per pass. */
+	if (count_bits_i(bkr->pass_types) > 1) {
+		bkr->save_mode = R_BAKE_SAVE_EXTERNAL;
+		bkr->is_automatic_name = true;
+	}
+	else {
+		bkr->save_mode = R_BAKE_SAVE_INTERNAL;
+	}
 }
 
 static int bake_exec(bContext *C, wmOperator *op)
@@ -1183,7 +1235,7 @@ static int bake_exec(bContext *C, wmOperator *op)
 	/* setup new render */
 	RE_test_break_cb(re, NULL, bake_break);
 
-	if (!bake_pass_filter_check(bkr.pass_type, bkr.pass_filter, bkr.reports)) {
+	if (!bake_passes_filter_check(bkr.pass_types, bkr.pass_filter, bkr.reports)) {
 		goto finally;
 	}
 
@@ -1191,7 +1243,7 @@ static int bake_exec(bContext *C, wmOperator *op)
 		goto finally;
 	}
 
-	if (bkr.is_clear) {
+	if (bkr.is_clear && bkr.save_mode == R_BAKE_SAVE_INTERNAL) {
 		const bool is_tangent = ((bkr.pass_type == SCE_PASS_NORMAL) && (bkr.normal_space == R_BAKE_SPACE_TANGENT));
 		bake_images_clear(bkr.main, is_tangent);
 	}
@@ -1201,10 +1253,10 @@ static int bake_exec(bContext *C, wmOperator *op)
 	if (bkr.is_selected_to_active) {
 		result = bake(
 		        bkr.render, bkr.main, bkr.scene, bkr.ob, &bkr.selected_objects, bkr.reports,
-		        bkr.pass_type, bkr.pass_filter, bkr.margin, bkr.save_mode,
+		        bkr.pass_types, bkr.pass_filter, bkr.margin, bkr.save_mode,
 		        bkr.is_clear, bkr.is_split_materials, bkr.is_automatic_name, true, bkr.is_cage,
 		        bkr.cage_extrusion, bkr.normal_space, bkr.normal_swizzle,
-		        bkr.custom_cage, bkr.filepath, bkr.width, bkr.height, bkr.identifier, bkr.sa,
+		        bkr.custom_cage, bkr.filepath, bkr.width, bkr.height, bkr.sa,
 		        bkr.uv_layer);
 	}
 	else {
@@ -1214,10 +1266,10 @@ static int bake_exec(bContext *C, wmOperator *op)
 			Object *ob_iter = link->ptr.data;
 			result = bake(
 			        bkr.render, bkr.main, bkr.scene, ob_iter, NULL, bkr.reports,
-			        bkr.pass_type, bkr.pass_filter, bkr.margin, bkr.save_mode,
+			        bkr.pass_types, bkr.pass_filter, bkr.margin, bkr.save_mode,
 			        is_clear, bkr.is_split_materials, bkr.is_automatic_name, false, bkr.is_cage,
 			        bkr.cage_extrusion, bkr.normal_space, bkr.normal_swizzle,
-			        bkr.custom_cage, bkr.filepath, bkr.width, bkr.height, bkr.identifier, bkr.sa,
+			        bkr.custom_cage, bkr.filepath, bkr.width, bkr.height, bkr.sa,
 			        bkr.uv_layer);
 		}
 	}
@@ -1241,7 +1293,7 @@ static void bake_startjob(void *bkv, short *UNUSED(stop), short *do_update, floa
 
 	RE_SetReports(bkr->render, bkr->reports);
 
-	if (!bake_pass_filter_check(bkr->pass_type, bkr->pass_filter, bkr->reports)) {
+	if (!bake_passes_filter_check(bkr->pass_types, bkr->pass_filter, bkr->reports)) {
 		bkr->result = OPERATOR_CANCELLED;
 		return;
 	}
@@ -1251,7 +1303,7 @@ static void bake_startjob(void *bkv, short *UNUSED(stop), short *do_update, floa
 		return;
 	}
 
-	if (bkr->is_clear) {
+	if (bkr->is_clear && bkr->save_mode == R_BAKE_SAVE_INTERNAL) {
 		const bool is_tangent = ((bkr->pass_type == SCE_PASS_NORMAL) && (bkr->normal_space == R_BAKE_SPACE_TANGENT));
 		bake_images_clear(bkr->main, is_tangent);
 	}
@@ -1259,10 +1311,10 @@ static void bake_startjob(void *bkv, short *UNUSED(stop), short *do_update, floa
 	if (bkr->is_selected_to_active) {
 		bkr->result = bake(
 		        bkr->render, bkr->main, bkr->scene, bkr->ob, &bkr->selected_objects, bkr->reports,
-		        bkr->pass_type, bkr->pass_filter, bkr->margin, bkr->save_mode,
+		        bkr->pass_types, bkr->pass_filter, bkr->margin, bkr->save_mode,
 		        bkr->is_clear, bkr->is_split_materials, bkr->is_automatic_name, true, bkr->is_cage,
 		        bkr->cage_extrusion, bkr->normal_space, bkr->normal_swizzle,
-		        bkr->custom_cage, bkr->filepath, bkr->width, bkr->height, bkr->identifier, bkr->sa,
+		        bkr->custom_cage, bkr->filepath, bkr->width, bkr->height, bkr->sa,
 		        bkr->uv_layer);
 	}
 	else {
@@ -1272,10 +1324,10 @@ static void bake_startjob(void *bkv, short *UNUSED(stop), short *do_update, floa
 			Object *ob_iter = link->ptr.data;
 			bkr->result = bake(
 			        bkr->render, bkr->main, bkr->scene, ob_iter, NULL, bkr->reports,
-			        bkr->pass_type, bkr->pass_filter, bkr->margin, bkr->save_mode,
+			        bkr->pass_types, bkr->pass_filter, bkr->margin, bkr->save_mode,
 			        is_clear, bkr->is_split_materials, bkr->is_automatic_name, false, bkr->is_cage,
 			        bkr->cage_extrusion, bkr->normal_space, bkr->normal_swizzle,
-			        bkr->custom_cage, bkr->filepath, bkr->width, bkr->height, bkr->identifier, bkr->sa,
+			        bkr->custom_cage, bkr->filepath, bkr->width, bkr->height, bkr->sa,
 			        bkr->uv_layer);
 
 			if (bkr->result == OPERATOR_CANCELLED)
@@ -1448,6 +1500,10 @@ void OBJECT_OT_bake(wmOperatorType *ot)
 
 	RNA_def_enum(ot->srna, "type", rna_enum_bake_pass_type_items, SCE_PASS_COMBINED, "Type",
 	             "Type of pass to bake, some of them may not be supported by the current render engine");
+	prop = RNA_def_enum(ot->srna, "passes", rna_enum_bake_pass_type_items, 0, "Passes",
+	                    "Other passes to bake together with Type in one go, they are saved externally "
+	                    "with the pass type in the file name");
+	RNA_def_property_flag(prop, PROP_ENUM_FLAG);
 	prop = RNA_def_enum(ot->srna, "pass_filter", rna_enum_bake_pass_filter_type_items, R_BAKE_PASS_FILTER_NONE, "Pass Filter",
 	             "Filter to combined, diffuse, glossy, transmission and subsurface passes");
 	RNA_def_property_flag(prop, PROP_ENUM_FLAG);
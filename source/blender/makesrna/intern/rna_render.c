@@ -199,6 +199,34 @@ static void engine_bake(RenderEngine *engine, struct Scene *scene,
 	RNA_parameter_list_free(&list);
 }
 
+static void engine_bake_passes(RenderEngine *engine, struct Scene *scene,
+                               struct Object *object, const int pass_types, const int pass_filter,
+                               const int object_id, const struct BakePixel *pixel_array,
+                               const int num_pixels, const int depth, void *result)
+{
+	extern FunctionRNA rna_RenderEngine_bake_passes_func;
+	PointerRNA ptr;
+	ParameterList list;
+	FunctionRNA *func;
+
+	RNA_pointer_create(NULL, engine->type->ext.srna, engine, &ptr);
+	func = &rna_RenderEngine_bake_passes_func;
+
+	RNA_parameter_list_create(&list, &ptr, func);
+	RNA_parameter_set_lookup(&list, "scene", &scene);
+	RNA_parameter_set_lookup(&list, "object", &object);
+	RNA_parameter_set_lookup(&list, "pass_types", &pass_types);
+	RNA_parameter_set_lookup(&list, "pass_filter", &pass_filter);
+	RNA_parameter_set_lookup(&list, "object_id", &object_id);
+	RNA_parameter_set_lookup(&list, "pixel_array", &pixel_array);
+	RNA_parameter_set_lookup(&list, "num_pixels", &num_pixels);
+	RNA_parameter_set_lookup(&list, "depth", &depth);
+	RNA_parameter_set_lookup(&list, "result", &result);
+	engine->type->ext.call(NULL, &ptr, func, &list);
+
+	RNA_parameter_list_free(&list);
+}
+
 static void engine_view_update(RenderEngine *engine, const struct bContext *context)
 {
 	extern FunctionRNA rna_RenderEngine_view_update_func;
@@ -289,7 +317,7 @@ static StructRNA *rna_RenderEngine_register(Main *bmain, ReportList *reports, vo
 	RenderEngineType *et, dummyet = {NULL};
 	RenderEngine dummyengine = {NULL};
 	PointerRNA dummyptr;
-	int have_function[7];
+	int have_function[8];
 
 	/* setup dummy engine & engine type to store static properties in */
 	dummyengine.type = &dummyet;
@@ -328,10 +356,11 @@ static StructRNA *rna_RenderEngine_register(Main *bmain, ReportList *reports, vo
 	et->update = (have_function[0]) ? engine_update : NULL;
 	et->render = (have_function[1]) ? engine_render : NULL;
 	et->bake = (have_function[2]) ? engine_bake : NULL;
-	et->view_update = (have_function[3]) ? engine_view_update : NULL;
-	et->view_draw = (have_function[4]) ? engine_view_draw : NULL;
-	et->update_script_node = (have_function[5]) ? engine_update_script_node : NULL;
-	et->update_render_passes = (have_function[6]) ? engine_update_render_passes : NULL;
+	et->bake_passes = (have_function[3]) ? engine_bake_passes : NULL;
+	et->view_update = (have_function[4]) ? engine_view_update : NULL;
+	et->view_draw = (have_function[5]) ? engine_view_draw : NULL;
+	et->update_script_node = (have_function[6]) ? engine_update_script_node : NULL;
+	et->update_render_passes = (have_function[7]) ? engine_update_render_passes : NULL;
 
 	BLI_addtail(&R_engines, et);
 
@@ -492,6 +521,29 @@ static void rna_def_render_engine(BlenderRNA *brna)
 	parm = RNA_def_pointer(func, "result", "AnyType", "", "");
 	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+	func = RNA_def_function(srna, "bake_passes", NULL);
+	RNA_def_function_ui_description(func, "Bake several passes at once");
+	RNA_def_function_flag(func, FUNC_REGISTER_OPTIONAL | FUNC_ALLOW_WRITE);
+	parm = RNA_def_pointer(func, "scene", "Scene", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_pointer(func, "object", "Object", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_enum_flag(func, "pass_types", rna_enum_bake_pass_type_items, 0, "Passes",
+	                         "Passes to bake, the result holds one pass after the other in order of their values");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "pass_filter", 0, 0, INT_MAX, "Pass Filter", "Filter to combined, diffuse, glossy, transmission and subsurface passes", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "object_id", 0, 0, INT_MAX, "Object Id", "Id of the current object being baked in relation to the others", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_pointer(func, "pixel_array", "BakePixel", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "num_pixels", 0, 0, INT_MAX, "Number of Pixels", "Size of the baking batch", 0, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_int(func, "depth", 0, 0, INT_MAX, "Pixels depth", "Number of channels", 1, INT_MAX);
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+	parm = RNA_def_pointer(func, "result", "AnyType", "", "");
+	RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
 	/* viewport render callbacks */
 	func = RNA_def_function(srna, "view_update", NULL);
 	RNA_def_function_ui_description(func, "Update on data changes for viewport render");
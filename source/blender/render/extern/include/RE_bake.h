@@ -70,9 +70,11 @@ typedef struct BakeHighPolyData {
 /* external_engine.c */
 bool RE_bake_has_engine(struct Render *re);
 
+/* pass_types is a combination of ScenePassType flags, the result of each pass takes
+ * num_pixels * depth floats, one pass after the other in order of their flags */
 bool RE_bake_engine(
         struct Render *re, struct Object *object, const int object_id, const BakePixel pixel_array[],
-        const size_t num_pixels, const int depth, const ScenePassType pass_type, const int pass_filter, float result[]);
+        const size_t num_pixels, const int depth, const int pass_types, const int pass_filter, float result[]);
 
 /* bake.c */
 int RE_pass_depth(const ScenePassType pass_type);
@@ -91,6 +91,9 @@ typedef struct RenderEngineType {
 	void (*update)(struct RenderEngine *engine, struct Main *bmain, struct Scene *scene);
 	void (*render)(struct RenderEngine *engine, struct Scene *scene);
 	void (*bake)(struct RenderEngine *engine, struct Scene *scene, struct Object *object, const int pass_type, const int pass_filter, const int object_id, const struct BakePixel *pixel_array, const int num_pixels, const int depth, void *result);
+	/* bake several passes at once, pass_types is a combination of ScenePassType flags
+	 * and result holds the passes one after the other in order of their flags */
+	void (*bake_passes)(struct RenderEngine *engine, struct Scene *scene, struct Object *object, const int pass_types, const int pass_filter, const int object_id, const struct BakePixel *pixel_array, const int num_pixels, const int depth, void *result);
 
 	void (*view_update)(struct RenderEngine *engine, const struct bContext *context);
 	void (*view_draw)(struct RenderEngine *engine, const struct bContext *context);
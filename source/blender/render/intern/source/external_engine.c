@@ -39,6 +39,7 @@
 #include "BLT_translation.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_bits.h"
 #include "BLI_string.h"
 #include "BLI_utildefines.h"
 
@@ -69,7 +70,7 @@
 static RenderEngineType internal_render_type = {
 	NULL, NULL,
 	"BLENDER_RENDER", N_("Blender Render"), RE_INTERNAL,
-	NULL, NULL, NULL, NULL, NULL, NULL, render_internal_update_passes,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, render_internal_update_passes,
 	{NULL, NULL, NULL}
 };
 
@@ -78,7 +79,7 @@ static RenderEngineType internal_render_type = {
 static RenderEngineType internal_game_type = {
 	NULL, NULL,
 	"BLENDER_GAME", N_("Blender Game"), RE_INTERNAL | RE_GAME,
-	NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
 	{NULL, NULL, NULL}
 };
 
@@ -496,14 +497,14 @@ void RE_bake_engine_set_engine_parameters(Render *re, Main *bmain, Scene *scene)
 bool RE_bake_has_engine(Render *re)
 {
 	RenderEngineType *type = RE_engines_find(re->r.engine);
-	return (type->bake != NULL);
+	return (type->bake != NULL || type->bake_passes != NULL);
 }
 
 bool RE_bake_engine(
         Render *re, Object *object,
         const int object_id, const BakePixel pixel_array[],
         const size_t num_pixels, const int depth,
-        const ScenePassType pass_type, const int pass_filter,
+        const int pass_types, const int pass_filter,
         float result[])
 {
 	RenderEngineType *type = RE_engines_find(re->r.engine);
@@ -539,8 +540,21 @@ bool RE_bake_engine(
 	if (type->update)
 		type->update(engine, re->main, re->scene);
 
-	if (type->bake)
-		type->bake(engine, re->scene, object, pass_type, pass_filter, object_id, pixel_array, num_pixels, depth, result);
+	if (type->bake_passes && (count_bits_i(pass_types) > 1 || type->bake == NULL)) {
+		type->bake_passes(engine, re->scene, object, pass_types, pass_filter, object_id, pixel_array, num_pixels, depth, result);
+	}
+	else if (type->bake) {
+		/* engines without support for several passes bake them one by one */
+		float *pass_result = result;
+		int i;
+
+		for (i = 0; i < 31; i++) {
+			if (pass_types & (1 << i)) {
+				type->bake(engine, re->scene, object, (1 << i), pass_filter, object_id, pixel_array, num_pixels, depth, pass_result);
+				pass_result += num_pixels * depth;
+			}
+		}
+	}
 
 	engine->tile_x = 0;
 	engine->tile_y = 0;
@@ -0,0 +1,446 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_key_types.h"
+#include "DNA_lattice_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_deform.h"
+#include "BKE_key.h"
+#include "BKE_lattice.h"
+}
+
+/* old define from DNA_ipo_types.h for key element data-type, as in key.c */
+#define IPO_FLOAT 4
+
+/* Run the longest tests! */
+//#define DEFORM_RUN_BIG
+
+/* Number of bones and of weights per vertex, about what a production character uses. */
+#define DEFORM_TOTBONE 200
+#define DEFORM_TOTWEIGHT 4
+
+#define PRINTF_DEFORM_TIME(_str, _time, _totvert) \
+	printf("%s: %.6f sec, %.6f sec per million vertices (%d vertices)\n", \
+	       _str, _time, (_time) * 1e6 / (double)(_totvert), _totvert)
+
+/* -------------------------------------------------------------------- */
+/* Test rig: a chain of bones deforming a cloud of random points,
+ * with the DNA built by hand since there is no Main database here. */
+
+typedef struct DeformRig {
+	bArmature arm;
+	bPose pose;
+	Object ob_arm;
+
+	Mesh me;
+	Object ob_target;
+
+	float (*vertexCos)[3];
+	float (*vertexCos_orig)[3];
+	int totvert;
+} DeformRig;
+
+static void deform_rig_init(DeformRig *rig, const int totvert, const int segments)
+{
+	RNG *rng = BLI_rng_new(0);
+	int i;
+
+	memset(rig, 0, sizeof(*rig));
+
+	rig->ob_arm.type = OB_ARMATURE;
+	rig->ob_arm.data = &rig->arm;
+	rig->ob_arm.pose = &rig->pose;
+	unit_m4(rig->ob_arm.obmat);
+
+	for (i = 0; i < DEFORM_TOTBONE; i++) {
+		Bone *bone = (Bone *)MEM_callocN(sizeof(*bone), __func__);
+		bPoseChannel *pchan = (bPoseChannel *)MEM_callocN(sizeof(*pchan), __func__);
+		float rot[3][3];
+
+		BLI_snprintf(bone->name, sizeof(bone->name), "Bone.%03d", i);
+		unit_m4(bone->arm_mat);
+		bone->arm_mat[3][0] = (float)i;
+		copy_v3_v3(bone->arm_head, bone->arm_mat[3]);
+		copy_v3_v3(bone->arm_tail, bone->arm_head);
+		bone->arm_tail[1] += 1.0f;
+		bone->length = 1.0f;
+		bone->segments = (short)segments;
+		bone->rad_head = bone->rad_tail = 0.1f;
+		bone->dist = 0.25f;
+		bone->weight = 1.0f;
+		bone->ease1 = bone->ease2 = 1.0f;
+		bone->scaleIn = bone->scaleOut = 1.0f;
+		BLI_addtail(&rig->arm.bonebase, bone);
+
+		BLI_strncpy(pchan->name, bone->name, sizeof(pchan->name));
+		pchan->bone = bone;
+		copy_v3_fl(pchan->size, 1.0f);
+		axis_angle_to_mat3_single(rot, 'Z', 0.01f * (float)i);
+		copy_m4_m3(pchan->chan_mat, rot);
+		pchan->chan_mat[3][1] = 0.1f;
+		copy_m4_m4(pchan->pose_mat, pchan->chan_mat);
+		BLI_addtail(&rig->pose.chanbase, pchan);
+
+		bDeformGroup *dg = (bDeformGroup *)MEM_callocN(sizeof(*dg), __func__);
+		BLI_strncpy(dg->name, bone->name, sizeof(dg->name));
+		BLI_addtail(&rig->ob_target.defbase, dg);
+	}
+
+	rig->ob_target.type = OB_MESH;
+	rig->ob_target.data = &rig->me;
+	unit_m4(rig->ob_target.obmat);
+
+	rig->me.totvert = totvert;
+	rig->me.dvert = (MDeformVert *)MEM_callocN(sizeof(*rig->me.dvert) * (size_t)totvert, __func__);
+
+	rig->totvert = totvert;
+	rig->vertexCos = (float (*)[3])MEM_mallocN(sizeof(*rig->vertexCos) * (size_t)totvert, __func__);
+	rig->vertexCos_orig = (float (*)[3])MEM_mallocN(sizeof(*rig->vertexCos) * (size_t)totvert, __func__);
+
+	for (i = 0; i < totvert; i++) {
+		MDeformVert *dvert = &rig->me.dvert[i];
+		float *co = rig->vertexCos_orig[i];
+		const int bone_first = BLI_rng_get_int(rng) % (DEFORM_TOTBONE - DEFORM_TOTWEIGHT);
+		float totweight = 0.0f;
+		int j;
+
+		co[0] = BLI_rng_get_float(rng) * (float)DEFORM_TOTBONE;
+		co[1] = BLI_rng_get_float(rng);
+		co[2] = BLI_rng_get_float(rng) - 0.5f;
+
+		dvert->totweight = DEFORM_TOTWEIGHT;
+		dvert->dw = (MDeformWeight *)MEM_mallocN(sizeof(*dvert->dw) * DEFORM_TOTWEIGHT, __func__);
+		for (j = 0; j < DEFORM_TOTWEIGHT; j++) {
+			dvert->dw[j].def_nr = bone_first + j;
+			dvert->dw[j].weight = BLI_rng_get_float(rng);
+			totweight += dvert->dw[j].weight;
+		}
+		for (j = 0; j < DEFORM_TOTWEIGHT; j++) {
+			dvert->dw[j].weight /= max_ff(totweight, 1e-6f);
+		}
+	}
+
+	BLI_rng_free(rng);
+}
+
+static void deform_rig_reset(DeformRig *rig)
+{
+	memcpy(rig->vertexCos, rig->vertexCos_orig, sizeof(*rig->vertexCos) * (size_t)rig->totvert);
+}
+
+static void deform_rig_free(DeformRig *rig)
+{
+	bPoseChannel *pchan;
+	int i;
+
+	for (pchan = (bPoseChannel *)rig->pose.chanbase.first; pchan; pchan = pchan->next) {
+		MEM_freeN(pchan->bone);
+	}
+	BLI_freelistN(&rig->pose.chanbase);
+	BLI_freelistN(&rig->ob_target.defbase);
+
+	for (i = 0; i < rig->totvert; i++) {
+		MEM_freeN(rig->me.dvert[i].dw);
+	}
+	MEM_freeN(rig->me.dvert);
+	MEM_freeN(rig->vertexCos);
+	MEM_freeN(rig->vertexCos_orig);
+}
+
+/* -------------------------------------------------------------------- */
+/* Armature */
+
+static void armature_deform_test(const char *id, const int totvert, const int segments, const int deformflag,
+                                 const bool use_defmats)
+{
+	DeformRig rig;
+	float (*defMats)[3][3] = NULL;
+	double time_start;
+	double time;
+	int i;
+
+	deform_rig_init(&rig, totvert, segments);
+	deform_rig_reset(&rig);
+
+	if (use_defmats) {
+		defMats = (float (*)[3][3])MEM_mallocN(sizeof(*defMats) * (size_t)totvert, __func__);
+		for (i = 0; i < totvert; i++) {
+			unit_m3(defMats[i]);
+		}
+	}
+
+	time_start = PIL_check_seconds_timer();
+	armature_deform_verts(&rig.ob_arm, &rig.ob_target, NULL, rig.vertexCos, defMats, totvert, deformflag,
+	                      NULL, NULL);
+	time = PIL_check_seconds_timer() - time_start;
+
+	PRINTF_DEFORM_TIME(id, time, totvert);
+
+	/* All vertices are weighted, so all must have moved (chan_mat has a translation). */
+	if (deformflag & ARM_DEF_VGROUP) {
+		int totmoved = 0;
+		for (i = 0; i < totvert; i++) {
+			if (!equals_v3v3(rig.vertexCos[i], rig.vertexCos_orig[i])) {
+				totmoved++;
+			}
+		}
+		EXPECT_EQ(totmoved, totvert);
+	}
+
+	if (defMats) {
+		MEM_freeN(defMats);
+	}
+	deform_rig_free(&rig);
+}
+
+/* The task scheduler can't be recreated once freed, share it between all tests. */
+class deform : public ::testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		BLI_threadapi_exit();
+	}
+};
+
+TEST_F(deform, ArmatureVGroup100000)
+{
+	armature_deform_test("armature_deform_vgroup", 100000, 1, ARM_DEF_VGROUP, false);
+}
+
+TEST_F(deform, ArmatureVGroup1000000)
+{
+	armature_deform_test("armature_deform_vgroup", 1000000, 1, ARM_DEF_VGROUP, false);
+}
+
+TEST_F(deform, ArmatureVGroupDefMats1000000)
+{
+	armature_deform_test("armature_deform_vgroup_defmats", 1000000, 1, ARM_DEF_VGROUP, true);
+}
+
+TEST_F(deform, ArmatureVGroupQuaternion1000000)
+{
+	armature_deform_test("armature_deform_vgroup_quaternion", 1000000, 1, ARM_DEF_VGROUP | ARM_DEF_QUATERNION, false);
+}
+
+TEST_F(deform, ArmatureVGroupBBone1000000)
+{
+	armature_deform_test("armature_deform_vgroup_bbone", 1000000, 8, ARM_DEF_VGROUP, false);
+}
+
+TEST_F(deform, ArmatureEnvelope100000)
+{
+	armature_deform_test("armature_deform_envelope", 100000, 1, ARM_DEF_ENVELOPE, false);
+}
+
+#ifdef DEFORM_RUN_BIG
+TEST_F(deform, ArmatureVGroup10000000)
+{
+	armature_deform_test("armature_deform_vgroup", 10000000, 1, ARM_DEF_VGROUP, false);
+}
+#endif
+
+/* -------------------------------------------------------------------- */
+/* Lattice */
+
+static void lattice_deform_test(const char *id, const int totvert, const int res, const bool use_vgroup)
+{
+	DeformRig rig;
+	Lattice lt;
+	Object ob_lattice;
+	RNG *rng = BLI_rng_new(1);
+	double time_start;
+	double time;
+	int i, totmoved = 0;
+
+	deform_rig_init(&rig, totvert, 1);
+	deform_rig_reset(&rig);
+
+	memset(&lt, 0, sizeof(lt));
+	BLI_strncpy(lt.id.name, "LTLattice", sizeof(lt.id.name));
+	BKE_lattice_init(&lt);
+	BKE_lattice_resize(&lt, res, res, res, NULL);
+	for (i = 0; i < res * res * res; i++) {
+		lt.def[i].vec[0] += (BLI_rng_get_float(rng) - 0.5f) * 0.1f;
+		lt.def[i].vec[1] += (BLI_rng_get_float(rng) - 0.5f) * 0.1f;
+		lt.def[i].vec[2] += (BLI_rng_get_float(rng) - 0.5f) * 0.1f;
+	}
+
+	/* cover all of the rig's vertices */
+	memset(&ob_lattice, 0, sizeof(ob_lattice));
+	ob_lattice.type = OB_LATTICE;
+	ob_lattice.data = &lt;
+	const float size[3] = {(float)DEFORM_TOTBONE + 1.0f, 2.0f, 2.0f};
+	size_to_mat4(ob_lattice.obmat, size);
+	ob_lattice.obmat[3][0] = (float)DEFORM_TOTBONE * 0.5f;
+	ob_lattice.obmat[3][1] = 0.5f;
+
+	time_start = PIL_check_seconds_timer();
+	lattice_deform_verts(&ob_lattice, &rig.ob_target, NULL, rig.vertexCos, totvert,
+	                     use_vgroup ? "Bone.000" : NULL, 1.0f);
+	time = PIL_check_seconds_timer() - time_start;
+
+	PRINTF_DEFORM_TIME(id, time, totvert);
+
+	for (i = 0; i < totvert; i++) {
+		if (!equals_v3v3(rig.vertexCos[i], rig.vertexCos_orig[i])) {
+			totmoved++;
+		}
+	}
+	if (use_vgroup) {
+		EXPECT_LT(totmoved, totvert);
+	}
+	else {
+		EXPECT_EQ(totmoved, totvert);
+	}
+
+	BKE_lattice_free(&lt);
+	BLI_rng_free(rng);
+	deform_rig_free(&rig);
+}
+
+TEST_F(deform, Lattice1000000)
+{
+	lattice_deform_test("lattice_deform", 1000000, 4, false);
+}
+
+TEST_F(deform, LatticeVGroup1000000)
+{
+	lattice_deform_test("lattice_deform_vgroup", 1000000, 4, true);
+}
+
+TEST_F(deform, LatticeHighRes1000000)
+{
+	lattice_deform_test("lattice_deform_highres", 1000000, 16, false);
+}
+
+/* -------------------------------------------------------------------- */
+/* Shape keys */
+
+static void shape_key_test(const char *id, const int totvert, const int totkey, const bool use_vgroup)
+{
+	DeformRig rig;
+	Key key;
+	RNG *rng = BLI_rng_new(2);
+	float *out, (*out_ref)[3];
+	double time_start;
+	double time;
+	int totelem = 0;
+	int i, k;
+
+	deform_rig_init(&rig, totvert, 1);
+
+	memset(&key, 0, sizeof(key));
+	BLI_strncpy(key.id.name, "KEKey", sizeof(key.id.name));
+	key.type = KEY_RELATIVE;
+	key.elemstr[0] = 3;
+	key.elemstr[1] = IPO_FLOAT;
+	key.elemsize = sizeof(float[3]);
+
+	for (k = 0; k < totkey; k++) {
+		KeyBlock *kb = (KeyBlock *)MEM_callocN(sizeof(*kb), __func__);
+		float (*data)[3] = (float (*)[3])MEM_mallocN(sizeof(*data) * (size_t)totvert, __func__);
+
+		for (i = 0; i < totvert; i++) {
+			copy_v3_v3(data[i], rig.vertexCos_orig[i]);
+			if (k != 0) {
+				data[i][0] += BLI_rng_get_float(rng) - 0.5f;
+				data[i][1] += BLI_rng_get_float(rng) - 0.5f;
+				data[i][2] += BLI_rng_get_float(rng) - 0.5f;
+			}
+		}
+
+		kb->data = data;
+		kb->totelem = totvert;
+		kb->curval = (k != 0) ? BLI_rng_get_float(rng) : 0.0f;
+		if (use_vgroup && (k % 2)) {
+			BLI_snprintf(kb->vgroup, sizeof(kb->vgroup), "Bone.%03d", k % DEFORM_TOTBONE);
+		}
+		BLI_addtail(&key.block, kb);
+	}
+	key.refkey = (KeyBlock *)key.block.first;
+	key.totkey = totkey;
+
+	BLI_strncpy(rig.me.id.name, "MEMesh", sizeof(rig.me.id.name));
+	rig.me.key = &key;
+	key.from = &rig.me.id;
+
+	time_start = PIL_check_seconds_timer();
+	out = BKE_key_evaluate_object(&rig.ob_target, &totelem);
+	time = PIL_check_seconds_timer() - time_start;
+
+	PRINTF_DEFORM_TIME(id, time, totvert);
+
+	/* compare against blending one key block at a time */
+	out_ref = (float (*)[3])MEM_mallocN(sizeof(*out_ref) * (size_t)totvert, __func__);
+	memcpy(out_ref, key.refkey->data, sizeof(*out_ref) * (size_t)totvert);
+	for (KeyBlock *kb = key.refkey->next; kb; kb = kb->next) {
+		const int defgrp_index = kb->vgroup[0] ? defgroup_name_index(&rig.ob_target, kb->vgroup) : -1;
+		const float (*data)[3] = (const float (*)[3])kb->data;
+		const float (*refdata)[3] = (const float (*)[3])key.refkey->data;
+
+		for (i = 0; i < totvert; i++) {
+			float weight = kb->curval;
+			if (defgrp_index != -1) {
+				weight *= defvert_find_weight(&rig.me.dvert[i], defgrp_index);
+			}
+			out_ref[i][0] -= weight * (refdata[i][0] - data[i][0]);
+			out_ref[i][1] -= weight * (refdata[i][1] - data[i][1]);
+			out_ref[i][2] -= weight * (refdata[i][2] - data[i][2]);
+		}
+	}
+
+	ASSERT_TRUE(out != NULL);
+	EXPECT_EQ(totelem, totvert);
+	for (i = 0; i < totvert; i++) {
+		if (!compare_v3v3(&out[i * 3], out_ref[i], 1e-4f)) {
+			break;
+		}
+	}
+	EXPECT_EQ(i, totvert);
+
+	MEM_freeN(out);
+	MEM_freeN(out_ref);
+	for (KeyBlock *kb = (KeyBlock *)key.block.first; kb; kb = kb->next) {
+		MEM_freeN(kb->data);
+	}
+	BLI_freelistN(&key.block);
+	BLI_rng_free(rng);
+	deform_rig_free(&rig);
+}
+
+TEST_F(deform, ShapeKey10Keys1000000)
+{
+	shape_key_test("shape_key_10", 1000000, 10, false);
+}
+
+TEST_F(deform, ShapeKey150Keys100000)
+{
+	shape_key_test("shape_key_150", 100000, 150, false);
+}
+
+TEST_F(deform, ShapeKey150KeysVGroup100000)
+{
+	shape_key_test("shape_key_150_vgroup", 100000, 150, true);
+}
@@ -9,6 +9,7 @@ extern "C" {
 #include "MEM_guardedalloc.h"
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_ohash.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
 #include "PIL_time_utildefines.h"
@@ -534,3 +535,201 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
 	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+
+/* OHash: insert, lookup and remove throughput of the open addressing hash,
+ * compared to GHash on the same unique random keys. */
+
+#define PRINTF_OHASH_STATS(_oh) \
+{ \
+	double q, lf, mean; \
+	int longest; \
+	q = BLI_ohash_calc_quality_ex((_oh), &lf, &mean, &longest); \
+	printf("OHash stats (%u entries):\n\t" \
+	       "Quality (the lower the better): %f\n\tLoad: %f\n\t" \
+	       "Mean probe length: %f\n\tLongest probe: %d\n", \
+	       BLI_ohash_size(_oh), q, lf, mean, longest); \
+} void (0)
+
+static unsigned int *compare_tests_keys(const unsigned int nbr)
+{
+	unsigned int *data = (unsigned int *)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+	unsigned int i;
+
+	/* Multiplying by an odd constant is a bijection, so keys are unique. */
+	for (i = 0; i < nbr; i++) {
+		data[i] = (i + 1) * 2654435761u;
+	}
+
+	RNG *rng = BLI_rng_new(0);
+	BLI_rng_shuffle_array(rng, data, sizeof(*data), nbr);
+	BLI_rng_free(rng);
+
+	return data;
+}
+
+static void compare_ghash_tests(GHash *ghash, const unsigned int *data, const unsigned int nbr, const bool use_ptr)
+{
+	unsigned int i;
+
+#define COMPARE_KEY(_i) (use_ptr ? (void *)&data[_i] : SET_UINT_IN_POINTER(data[_i]))
+
+	{
+		TIMEIT_START(ghash_insert);
+		for (i = 0; i < nbr; i++) {
+			BLI_ghash_insert(ghash, COMPARE_KEY(i), SET_UINT_IN_POINTER(data[i]));
+		}
+		TIMEIT_END(ghash_insert);
+	}
+
+	{
+		TIMEIT_START(ghash_lookup);
+		for (i = nbr; i--; ) {
+			void *v = BLI_ghash_lookup(ghash, COMPARE_KEY(i));
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), data[i]);
+		}
+		TIMEIT_END(ghash_lookup);
+	}
+
+	{
+		TIMEIT_START(ghash_remove);
+		for (i = 0; i < nbr; i += 2) {
+			EXPECT_TRUE(BLI_ghash_remove(ghash, COMPARE_KEY(i), NULL, NULL));
+		}
+		for (i = 1; i < nbr; i += 2) {
+			EXPECT_TRUE(BLI_ghash_remove(ghash, COMPARE_KEY(i), NULL, NULL));
+		}
+		TIMEIT_END(ghash_remove);
+	}
+	EXPECT_EQ(BLI_ghash_size(ghash), 0);
+
+#undef COMPARE_KEY
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+static void compare_ohash_tests(OHash *ohash, const unsigned int *data, const unsigned int nbr, const bool use_ptr)
+{
+	unsigned int i;
+
+#define COMPARE_KEY(_i) (use_ptr ? (void *)&data[_i] : SET_UINT_IN_POINTER(data[_i]))
+
+	{
+		TIMEIT_START(ohash_insert);
+		for (i = 0; i < nbr; i++) {
+			BLI_ohash_insert(ohash, COMPARE_KEY(i), SET_UINT_IN_POINTER(data[i]));
+		}
+		TIMEIT_END(ohash_insert);
+	}
+
+	PRINTF_OHASH_STATS(ohash);
+
+	{
+		TIMEIT_START(ohash_lookup);
+		for (i = nbr; i--; ) {
+			void *v = BLI_ohash_lookup(ohash, COMPARE_KEY(i));
+			EXPECT_EQ(GET_UINT_FROM_POINTER(v), data[i]);
+		}
+		TIMEIT_END(ohash_lookup);
+	}
+
+	{
+		TIMEIT_START(ohash_remove);
+		for (i = 0; i < nbr; i += 2) {
+			EXPECT_TRUE(BLI_ohash_remove(ohash, COMPARE_KEY(i), NULL, NULL));
+		}
+		for (i = 1; i < nbr; i += 2) {
+			EXPECT_TRUE(BLI_ohash_remove(ohash, COMPARE_KEY(i), NULL, NULL));
+		}
+		TIMEIT_END(ohash_remove);
+	}
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+
+#undef COMPARE_KEY
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+static void compare_tests(const char *id, const unsigned int nbr)
+{
+	printf("\n========== STARTING %s ==========\n", id);
+
+	unsigned int *data = compare_tests_keys(nbr);
+
+	printf("Int keys:\n");
+	compare_ghash_tests(BLI_ghash_int_new(__func__), data, nbr, false);
+	compare_ohash_tests(BLI_ohash_int_new(__func__), data, nbr, false);
+
+	printf("Pointer keys:\n");
+	compare_ghash_tests(BLI_ghash_ptr_new(__func__), data, nbr, true);
+	compare_ohash_tests(BLI_ohash_ptr_new(__func__), data, nbr, true);
+
+	printf("Int keys with callbacks:\n");
+	compare_ghash_tests(BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__), data, nbr, false);
+	compare_ohash_tests(BLI_ohash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__), data, nbr, false);
+
+	MEM_freeN(data);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ohash, Compare1000)
+{
+	compare_tests("Compare GHash OHash - 1000", 1000);
+}
+
+TEST(ohash, Compare100000)
+{
+	compare_tests("Compare GHash OHash - 100000", 100000);
+}
+
+#ifdef GHASH_RUN_BIG
+TEST(ohash, Compare10000000)
+{
+	compare_tests("Compare GHash OHash - 10000000", 10000000);
+}
+
+TEST(ohash, Compare100000000)
+{
+	compare_tests("Compare GHash OHash - 100000000", 100000000);
+}
+#endif
+
+TEST(ohash, TextOHash)
+{
+	char *data = BLI_strdup(words10k);
+	OHash *ohash = BLI_ohash_new(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, __func__);
+	char *w, *c;
+
+	printf("\n========== STARTING StrOHash - OHash ==========\n");
+
+	TIMEIT_START(string_insert);
+	for (w = c = data; *c; c++) {
+		if (ELEM(*c, ' ', '.')) {
+			*c = '\0';
+			void **val;
+			if (!BLI_ohash_ensure_p(ohash, w, &val)) {
+				*val = SET_INT_IN_POINTER(w[0]);
+			}
+			w = c + 1;
+		}
+	}
+	TIMEIT_END(string_insert);
+
+	PRINTF_OHASH_STATS(ohash);
+
+	TIMEIT_START(string_lookup);
+	for (w = c = data; c < data + strlen(words10k); c++) {
+		if (*c == '\0') {
+			void *v = BLI_ohash_lookup(ohash, w);
+			EXPECT_EQ(GET_INT_FROM_POINTER(v), w[0]);
+			w = c + 1;
+		}
+	}
+	TIMEIT_END(string_lookup);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+	MEM_freeN(data);
+
+	printf("========== ENDED StrOHash - OHash ==========\n\n");
+}
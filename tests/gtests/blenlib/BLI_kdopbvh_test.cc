@@ -0,0 +1,220 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+}
+
+/* enough triangles for the refit to use threads */
+#define TRIS_NUM 10000
+
+typedef struct TriMesh {
+	std::vector<float> co;
+	std::vector<float> co_moving;
+	std::vector<unsigned int> tris;
+} TriMesh;
+
+class kdopbvh : public ::testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		BLI_threadapi_exit();
+	}
+};
+
+/* Small random triangles scattered in a unit cube, each with its own 3 vertices. */
+static void trimesh_init(TriMesh *mesh, const int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	int i, j;
+
+	mesh->co.resize(TRIS_NUM * 9);
+	mesh->tris.resize(TRIS_NUM * 3);
+	for (i = 0; i < TRIS_NUM; i++) {
+		float center[3] = {BLI_rng_get_float(rng), BLI_rng_get_float(rng), BLI_rng_get_float(rng)};
+		for (j = 0; j < 3; j++) {
+			float offset[3];
+			BLI_rng_get_float_unit_v3(rng, offset);
+			madd_v3_v3v3fl(&mesh->co[(i * 3 + j) * 3], center, offset, 0.01f);
+			mesh->tris[i * 3 + j] = (unsigned int)(i * 3 + j);
+		}
+	}
+	BLI_rng_free(rng);
+}
+
+/* Move all vertices by a random offset. */
+static void trimesh_deform(TriMesh *mesh, const int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	size_t i;
+
+	mesh->co_moving = mesh->co;
+	for (i = 0; i < mesh->co.size(); i += 3) {
+		float offset[3];
+		BLI_rng_get_float_unit_v3(rng, offset);
+		madd_v3_v3fl(&mesh->co[i], offset, 0.1f);
+	}
+	BLI_rng_free(rng);
+}
+
+static BVHTree *trimesh_tree_new(const TriMesh *mesh)
+{
+	BVHTree *tree = BLI_bvhtree_new(TRIS_NUM, 0.0f, 4, 6);
+	int i;
+
+	for (i = 0; i < TRIS_NUM; i++) {
+		float co[3][3];
+		copy_v3_v3(co[0], &mesh->co[mesh->tris[i * 3 + 0] * 3]);
+		copy_v3_v3(co[1], &mesh->co[mesh->tris[i * 3 + 1] * 3]);
+		copy_v3_v3(co[2], &mesh->co[mesh->tris[i * 3 + 2] * 3]);
+		BLI_bvhtree_insert(tree, i, co[0], 3);
+	}
+	BLI_bvhtree_balance(tree);
+	return tree;
+}
+
+static void trimesh_refit_leaf(void *userdata, int index, float (*r_co)[3], float (*r_co_moving)[3])
+{
+	const TriMesh *mesh = (const TriMesh *)userdata;
+	int j;
+
+	for (j = 0; j < 3; j++) {
+		const unsigned int v = mesh->tris[index * 3 + j];
+		copy_v3_v3(r_co[j], &mesh->co[v * 3]);
+		if (r_co_moving) {
+			copy_v3_v3(r_co_moving[j], &mesh->co_moving[v * 3]);
+		}
+	}
+}
+
+/* All bounds of the tree in depth first order, with the index of every leaf. */
+static bool tree_bounds_parent_cb(const BVHTreeAxisRange *bounds, void *userdata)
+{
+	std::vector<float> *r_bounds = (std::vector<float> *)userdata;
+	const float *bv = bounds[0].range;
+	r_bounds->insert(r_bounds->end(), bv, bv + 6);
+	return true;
+}
+
+static bool tree_bounds_leaf_cb(const BVHTreeAxisRange *bounds, int index, void *userdata)
+{
+	std::vector<float> *r_bounds = (std::vector<float> *)userdata;
+	tree_bounds_parent_cb(bounds, userdata);
+	r_bounds->push_back((float)index);
+	return true;
+}
+
+static bool tree_bounds_order_cb(const BVHTreeAxisRange *UNUSED(bounds), char UNUSED(axis), void *UNUSED(userdata))
+{
+	return true;
+}
+
+static std::vector<float> tree_bounds(BVHTree *tree)
+{
+	std::vector<float> bounds;
+	BLI_bvhtree_walk_dfs(tree, tree_bounds_parent_cb, tree_bounds_leaf_cb, tree_bounds_order_cb, &bounds);
+	return bounds;
+}
+
+static void trimesh_nearest_cb(void *userdata, int index, const float co[3], BVHTreeNearest *nearest)
+{
+	const TriMesh *mesh = (const TriMesh *)userdata;
+	float nearest_tmp[3], dist_sq;
+
+	closest_on_tri_to_point_v3(
+	        nearest_tmp, co,
+	        &mesh->co[mesh->tris[index * 3 + 0] * 3],
+	        &mesh->co[mesh->tris[index * 3 + 1] * 3],
+	        &mesh->co[mesh->tris[index * 3 + 2] * 3]);
+	dist_sq = len_squared_v3v3(co, nearest_tmp);
+
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, nearest_tmp);
+	}
+}
+
+static void refit_matches_update_node(const bool moving)
+{
+	TriMesh mesh;
+	BVHTree *tree_update, *tree_refit;
+	int i;
+
+	trimesh_init(&mesh, 0);
+	tree_update = trimesh_tree_new(&mesh);
+	tree_refit = trimesh_tree_new(&mesh);
+
+	trimesh_deform(&mesh, 1);
+
+	for (i = 0; i < TRIS_NUM; i++) {
+		float co[3][3], co_moving[3][3];
+		trimesh_refit_leaf(&mesh, i, co, co_moving);
+		BLI_bvhtree_update_node(tree_update, i, co[0], moving ? co_moving[0] : NULL, 3);
+	}
+	BLI_bvhtree_update_tree(tree_update);
+
+	BLI_bvhtree_refit(tree_refit, 3, moving, trimesh_refit_leaf, &mesh);
+
+	EXPECT_EQ(tree_bounds(tree_update), tree_bounds(tree_refit));
+
+	BLI_bvhtree_free(tree_update);
+	BLI_bvhtree_free(tree_refit);
+}
+
+TEST_F(kdopbvh, RefitMatchesUpdateNode)
+{
+	refit_matches_update_node(false);
+}
+
+TEST_F(kdopbvh, RefitMatchesUpdateNodeMoving)
+{
+	refit_matches_update_node(true);
+}
+
+/* A refit tree finds the same nearest triangles as one built from scratch on the new positions. */
+TEST_F(kdopbvh, RefitMatchesRebuild)
+{
+	TriMesh mesh;
+	BVHTree *tree_refit, *tree_rebuild;
+	RNG *rng;
+	int i;
+
+	trimesh_init(&mesh, 0);
+	tree_refit = trimesh_tree_new(&mesh);
+
+	trimesh_deform(&mesh, 1);
+	BLI_bvhtree_refit(tree_refit, 3, false, trimesh_refit_leaf, &mesh);
+	tree_rebuild = trimesh_tree_new(&mesh);
+
+	rng = BLI_rng_new(2);
+	for (i = 0; i < 1000; i++) {
+		const float co[3] = {BLI_rng_get_float(rng), BLI_rng_get_float(rng), BLI_rng_get_float(rng)};
+		BVHTreeNearest nearest_refit, nearest_rebuild;
+
+		nearest_refit.index = nearest_rebuild.index = -1;
+		nearest_refit.dist_sq = nearest_rebuild.dist_sq = FLT_MAX;
+
+		BLI_bvhtree_find_nearest(tree_refit, co, &nearest_refit, trimesh_nearest_cb, &mesh);
+		BLI_bvhtree_find_nearest(tree_rebuild, co, &nearest_rebuild, trimesh_nearest_cb, &mesh);
+
+		EXPECT_EQ(nearest_rebuild.index, nearest_refit.index);
+		EXPECT_EQ(nearest_rebuild.dist_sq, nearest_refit.dist_sq);
+	}
+	BLI_rng_free(rng);
+
+	BLI_bvhtree_free(tree_refit);
+	BLI_bvhtree_free(tree_rebuild);
+}
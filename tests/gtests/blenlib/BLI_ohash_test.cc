@@ -0,0 +1,169 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#define GHASH_INTERNAL_API
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ohash.h"
+#include "BLI_rand.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+/* Unique random keys, multiplying by an odd constant is a bijection. */
+static void init_keys(unsigned int keys[TESTCASE_SIZE], const int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		keys[i] = (unsigned int)(i + 1) * 2654435761u;
+	}
+	BLI_rng_shuffle_array(rng, keys, sizeof(*keys), TESTCASE_SIZE);
+	BLI_rng_free(rng);
+}
+
+/* Keys all hashing to the same few buckets, to exercise long probe sequences. */
+static unsigned int ohashutil_tests_badhash_p(const void *p)
+{
+	return GET_UINT_FROM_POINTER(p) & 0x7;
+}
+
+static bool ohashutil_tests_cmp_p(const void *a, const void *b)
+{
+	return a != b;
+}
+
+/* Insert and then lookup all keys, ensuring we do get back the expected stored 'data'. */
+TEST(ohash, InsertLookup)
+{
+	OHash *ohash = BLI_ohash_int_new(__func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 0);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), TESTCASE_SIZE);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ohash_lookup(ohash, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), *k);
+	}
+
+	EXPECT_FALSE(BLI_ohash_haskey(ohash, SET_UINT_IN_POINTER(0)));
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Remove every other key, then check the remaining ones are still found after entries were shifted back. */
+TEST(ohash, InsertRemove)
+{
+	OHash *ohash = BLI_ohash_new(ohashutil_tests_badhash_p, ohashutil_tests_cmp_p, __func__);
+	unsigned int keys[TESTCASE_SIZE / 10];
+	const int size = TESTCASE_SIZE / 10;
+	int i, bkt_size;
+
+	for (i = 0; i < size; i++) {
+		keys[i] = (unsigned int)i + 1;
+		BLI_ohash_insert(ohash, SET_UINT_IN_POINTER(keys[i]), SET_UINT_IN_POINTER(keys[i]));
+	}
+
+	bkt_size = BLI_ohash_buckets_size(ohash);
+
+	for (i = 0; i < size; i += 2) {
+		void *v = BLI_ohash_popkey(ohash, SET_UINT_IN_POINTER(keys[i]), NULL);
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), keys[i]);
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), size / 2);
+
+	for (i = 0; i < size; i++) {
+		void *v = BLI_ohash_lookup(ohash, SET_UINT_IN_POINTER(keys[i]));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(v), (i % 2) ? keys[i] : 0);
+	}
+
+	for (i = 1; i < size; i += 2) {
+		EXPECT_TRUE(BLI_ohash_remove(ohash, SET_UINT_IN_POINTER(keys[i]), NULL, NULL));
+	}
+
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+	EXPECT_EQ(BLI_ohash_buckets_size(ohash), bkt_size);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Check ensure_p, reinsert and iteration. */
+TEST(ohash, EnsureIterate)
+{
+	OHash *ohash = BLI_ohash_ptr_new(__func__);
+	unsigned int keys[TESTCASE_SIZE];
+	OHashIterator ohi;
+	unsigned int sum = 0, sum_iter = 0;
+	int i;
+
+	init_keys(keys, 10);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		void **val;
+		EXPECT_FALSE(BLI_ohash_ensure_p(ohash, &keys[i], &val));
+		*val = SET_UINT_IN_POINTER(keys[i]);
+		sum += keys[i];
+	}
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		void **val;
+		EXPECT_TRUE(BLI_ohash_ensure_p(ohash, &keys[i], &val));
+		EXPECT_EQ(GET_UINT_FROM_POINTER(*val), keys[i]);
+	}
+
+	EXPECT_FALSE(BLI_ohash_reinsert(ohash, &keys[0], SET_UINT_IN_POINTER(keys[1]), NULL, NULL));
+	EXPECT_EQ(GET_UINT_FROM_POINTER(BLI_ohash_lookup(ohash, &keys[0])), keys[1]);
+	sum += keys[1] - keys[0];
+
+	OHASH_ITER (ohi, ohash) {
+		sum_iter += GET_UINT_FROM_POINTER(BLI_ohashIterator_getValue(&ohi));
+	}
+
+	EXPECT_EQ(sum_iter, sum);
+
+	BLI_ohash_clear(ohash, NULL, NULL);
+	EXPECT_EQ(BLI_ohash_size(ohash), 0);
+	EXPECT_EQ(BLI_ohash_lookup(ohash, &keys[0]), (void *)NULL);
+
+	BLI_ohash_free(ohash, NULL, NULL);
+}
+
+/* Check the set API. */
+TEST(oset, AddRemove)
+{
+	OSet *oset = BLI_oset_int_new(__func__);
+	unsigned int keys[TESTCASE_SIZE];
+	int i;
+
+	init_keys(keys, 20);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_TRUE(BLI_oset_add(oset, SET_UINT_IN_POINTER(keys[i])));
+	}
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_FALSE(BLI_oset_add(oset, SET_UINT_IN_POINTER(keys[i])));
+	}
+
+	EXPECT_EQ(BLI_oset_size(oset), TESTCASE_SIZE);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_TRUE(BLI_oset_haskey(oset, SET_UINT_IN_POINTER(keys[i])));
+		EXPECT_TRUE(BLI_oset_remove(oset, SET_UINT_IN_POINTER(keys[i]), NULL));
+		EXPECT_FALSE(BLI_oset_haskey(oset, SET_UINT_IN_POINTER(keys[i])));
+	}
+
+	EXPECT_EQ(BLI_oset_size(oset), 0);
+
+	BLI_oset_free(oset, NULL);
+}
@@ -0,0 +1,225 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+"""
+Renders animations with persistent data and compares the last frame with a
+render of that frame without persistent data.
+
+./blender.bin --background -noaudio --factory-startup --python tests/python/cycles_persistent_data_test.py -- --outdir /tmp/cycles_persistent_data
+"""
+
+import pathlib
+import sys
+import unittest
+
+import bpy
+
+args = None
+
+FRAME_START = 1
+FRAME_END = 3
+
+
+def clear_scene(scene):
+    for ob in list(scene.objects):
+        scene.objects.unlink(ob)
+        bpy.data.objects.remove(ob)
+
+
+def emission_material(name, color, use_object_index=False):
+    mat = bpy.data.materials.new(name)
+    mat.use_nodes = True
+
+    nodes = mat.node_tree.nodes
+    links = mat.node_tree.links
+    nodes.clear()
+
+    emission = nodes.new("ShaderNodeEmission")
+    emission.inputs["Color"].default_value = color + (1.0,)
+    emission.inputs["Strength"].default_value = 1.0
+
+    output = nodes.new("ShaderNodeOutputMaterial")
+    links.new(emission.outputs["Emission"], output.inputs["Surface"])
+
+    if use_object_index:
+        # brightness follows the pass index of the object
+        info = nodes.new("ShaderNodeObjectInfo")
+        scale = nodes.new("ShaderNodeMath")
+        scale.operation = 'MULTIPLY'
+        scale.inputs[1].default_value = 0.25
+        links.new(info.outputs["Object Index"], scale.inputs[0])
+        links.new(scale.outputs["Value"], emission.inputs["Strength"])
+
+    return mat
+
+
+def add_plane(scene, name, location, material):
+    me = bpy.data.meshes.new(name)
+    me.from_pydata(((-0.5, -0.5, 0.0), (0.5, -0.5, 0.0), (0.5, 0.5, 0.0), (-0.5, 0.5, 0.0)),
+                   (),
+                   ((0, 1, 2, 3),))
+    me.materials.append(material)
+
+    ob = bpy.data.objects.new(name, me)
+    ob.location = location
+    scene.objects.link(ob)
+    return ob
+
+
+def keyframe(ob, data_path, values):
+    for frame, value in zip((FRAME_START, FRAME_END), values):
+        setattr(ob, data_path, value)
+        ob.keyframe_insert(data_path, frame=frame)
+
+
+class PersistentDataTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.outdir = args.outdir
+        cls.outdir.mkdir(parents=True, exist_ok=True)
+
+    def setUp(self):
+        scene = bpy.context.scene
+        clear_scene(scene)
+
+        scene.render.engine = 'CYCLES'
+        scene.render.resolution_x = 64
+        scene.render.resolution_y = 64
+        scene.render.resolution_percentage = 100
+        scene.render.use_motion_blur = False
+        scene.render.image_settings.file_format = 'PNG'
+        scene.render.image_settings.color_mode = 'RGB'
+        scene.render.image_settings.color_depth = '8'
+        scene.cycles.device = 'CPU'
+        scene.cycles.samples = 1
+        scene.frame_start = FRAME_START
+        scene.frame_end = FRAME_END
+
+        world = bpy.data.worlds.new("World")
+        world.horizon_color = (0.0, 0.0, 0.0)
+        scene.world = world
+
+        cam = bpy.data.objects.new("Camera", bpy.data.cameras.new("Camera"))
+        cam.location = (0.0, 0.0, 10.0)
+        cam.data.type = 'ORTHO'
+        cam.data.ortho_scale = 8.0
+        scene.objects.link(cam)
+        scene.camera = cam
+
+        self.scene = scene
+
+    def render_and_compare(self, name):
+        """
+        Render the animation with persistent data, then the last frame on
+        its own, and check that both renders of the last frame match.
+        """
+        scene = self.scene
+        persistent_path = self.outdir / (name + "_persistent_")
+        reference_path = self.outdir / (name + "_reference.png")
+
+        scene.render.use_persistent_data = True
+        scene.render.filepath = str(persistent_path)
+        bpy.ops.render.render(animation=True)
+
+        scene.render.use_persistent_data = False
+        scene.frame_set(FRAME_END)
+        scene.render.filepath = str(reference_path)
+        bpy.ops.render.render(write_still=True)
+
+        first = self.load_pixels(str(persistent_path) + "%04d.png" % FRAME_START)
+        last = self.load_pixels(str(persistent_path) + "%04d.png" % FRAME_END)
+        reference = self.load_pixels(str(reference_path))
+
+        # make sure the animation changes the image at all
+        self.assertNotEqual(first, reference)
+
+        self.assertEqual(len(last), len(reference))
+        max_diff = max(abs(a - b) for a, b in zip(last, reference))
+        self.assertLessEqual(max_diff, 1.5 / 255.0,
+                             "frame %d with persistent data differs from the reference" % FRAME_END)
+
+    def load_pixels(self, filepath):
+        image = bpy.data.images.load(filepath)
+        pixels = image.pixels[:]
+        bpy.data.images.remove(image)
+        return pixels
+
+    def test_moving_object(self):
+        # single user mesh without modifiers, its transform gets applied
+        ob = add_plane(self.scene, "Moving", (-2.0, 0.0, 0.0),
+                       emission_material("Red", (1.0, 0.0, 0.0)))
+        keyframe(ob, "location", ((-2.0, 0.0, 0.0), (2.0, 1.0, 0.0)))
+
+        self.render_and_compare("moving_object")
+
+    def test_parented_object(self):
+        parent = bpy.data.objects.new("Parent", None)
+        self.scene.objects.link(parent)
+        keyframe(parent, "location", ((0.0, -2.0, 0.0), (0.0, 2.0, 0.0)))
+
+        ob = add_plane(self.scene, "Child", (1.0, 0.0, 0.0),
+                       emission_material("Yellow", (1.0, 1.0, 0.0)))
+        ob.parent = parent
+
+        self.render_and_compare("parented_object")
+
+    def test_modifier_driven_by_object(self):
+        # not a deforming modifier, but it changes with the offset object
+        offset = bpy.data.objects.new("Offset", None)
+        self.scene.objects.link(offset)
+        keyframe(offset, "location", ((1.0, 0.0, 0.0), (1.0, 1.5, 0.0)))
+
+        ob = add_plane(self.scene, "Arrayed", (-2.0, -2.0, 0.0),
+                       emission_material("Green", (0.0, 1.0, 0.0)))
+        array = ob.modifiers.new("Array", 'ARRAY')
+        array.count = 3
+        array.use_relative_offset = False
+        array.use_object_offset = True
+        array.offset_object = offset
+
+        self.render_and_compare("modifier_driven_by_object")
+
+    def test_animated_pass_index(self):
+        ob = add_plane(self.scene, "Indexed", (0.0, 0.0, 0.0),
+                       emission_material("Blue", (0.0, 0.0, 1.0), use_object_index=True))
+        ob.scale = (4.0, 4.0, 1.0)
+        keyframe(ob, "pass_index", (1, 4))
+
+        self.render_and_compare("animated_pass_index")
+
+
+def main():
+    global args
+    import argparse
+
+    if '--' in sys.argv:
+        argv = [sys.argv[0]] + sys.argv[sys.argv.index('--') + 1:]
+    else:
+        argv = sys.argv
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--outdir', required=True, type=pathlib.Path)
+    args, remaining = parser.parse_known_args(argv)
+
+    unittest.main(argv=remaining)
+
+
+if __name__ == "__main__":
+    main()
@@ -3,6 +3,7 @@
 
 import argparse
 import os
+import re
 import shutil
 import subprocess
 import sys
@@ -216,11 +217,284 @@ def run_all_tests(dirpath):
     return True
 
 
+# Light tree benchmark, comparing noise per unit of render time with and
+# without the light tree on a generated scene with many mesh lights and lamps.
+
+LIGHT_TREE_SCENE_SCRIPT = """
+import bpy
+import random
+import sys
+import time
+from math import radians
+
+argv = sys.argv[sys.argv.index("--") + 1:]
+use_light_tree = argv[0] == "1"
+samples = int(argv[1])
+seed = int(argv[2])
+filepath = argv[3]
+
+scene = bpy.context.scene
+scene.render.engine = 'CYCLES'
+for ob in list(scene.objects):
+    if ob.type != 'CAMERA':
+        bpy.data.objects.remove(ob, do_unlink=True)
+
+scene.camera.location = (0.0, -40.0, 25.0)
+scene.camera.rotation_euler = (radians(58.0), 0.0, 0.0)
+
+random.seed(0)
+
+# Ground plane.
+ground = bpy.data.meshes.new("Ground")
+ground.from_pydata([(-40, -40, 0), (40, -40, 0), (40, 40, 0), (-40, 40, 0)], [], [(0, 1, 2, 3)])
+scene.objects.link(bpy.data.objects.new("Ground", ground))
+
+# Small emissive quads scattered over the ground, as a single mesh light.
+material = bpy.data.materials.new("Emission")
+material.use_nodes = True
+nodes = material.node_tree.nodes
+nodes.remove(nodes["Diffuse BSDF"])
+emission = nodes.new('ShaderNodeEmission')
+emission.inputs["Strength"].default_value = 20.0
+material.node_tree.links.new(emission.outputs["Emission"], nodes["Material Output"].inputs["Surface"])
+
+verts = []
+faces = []
+for i in range({num_mesh_lights}):
+    x, y, z = random.uniform(-35, 35), random.uniform(-35, 35), random.uniform(0.5, 4.0)
+    n = len(verts)
+    verts += [(x - 0.2, y, z), (x + 0.2, y, z), (x + 0.2, y, z + 0.4), (x - 0.2, y, z + 0.4)]
+    faces.append((n, n + 1, n + 2, n + 3))
+lights = bpy.data.meshes.new("MeshLights")
+lights.from_pydata(verts, [], faces)
+lights.materials.append(material)
+scene.objects.link(bpy.data.objects.new("MeshLights", lights))
+
+# Point and spot lamps.
+for i in range({num_lamps}):
+    lamp = bpy.data.lamps.new("Lamp", 'SPOT' if i % 2 else 'POINT')
+    lamp.shadow_soft_size = 0.1
+    lamp.use_nodes = True
+    lamp.node_tree.nodes["Emission"].inputs["Strength"].default_value = 200.0
+    ob = bpy.data.objects.new("Lamp", lamp)
+    ob.location = (random.uniform(-35, 35), random.uniform(-35, 35), random.uniform(1.0, 6.0))
+    ob.rotation_euler = (random.uniform(-0.5, 0.5), random.uniform(-0.5, 0.5), 0.0)
+    scene.objects.link(ob)
+
+scene.render.resolution_x = 320
+scene.render.resolution_y = 180
+scene.render.resolution_percentage = 100
+scene.render.image_settings.file_format = 'OPEN_EXR'
+scene.render.filepath = filepath
+scene.cycles.samples = samples
+scene.cycles.seed = seed
+scene.cycles.use_light_tree = use_light_tree
+
+time_start = time.time()
+bpy.ops.render.render(write_still=True)
+print("BENCHMARK_TIME {{}}".format(time.time() - time_start))
+"""
+
+
+def render_light_tree_scene(script, use_light_tree, samples, seed, filepath):
+    command = (
+        BLENDER,
+        "--background",
+        "-noaudio",
+        "--factory-startup",
+        "--python", script,
+        "--",
+        "1" if use_light_tree else "0",
+        str(samples),
+        str(seed),
+        filepath,
+        )
+    output = subprocess.check_output(command).decode("utf-8")
+    if VERBOSE:
+        print(output)
+    match = re.search(r"BENCHMARK_TIME ([0-9.]+)", output)
+    return float(match.group(1))
+
+
+def image_rms_error(reference_image, image):
+    command = (
+        IDIFF,
+        "-fail", "1e9",
+        "-failpercent", "100",
+        reference_image,
+        image,
+        )
+    try:
+        output = subprocess.check_output(command)
+    except subprocess.CalledProcessError as e:
+        output = e.output
+    match = re.search(r"RMS error = ([0-9.eE+-]+)", output.decode("utf-8"))
+    return float(match.group(1))
+
+
+def run_light_tree_benchmark(temp_dir):
+    num_mesh_lights = 2000
+    num_lamps = 500
+    samples = 16
+    reference_samples = 1024
+
+    script = os.path.join(temp_dir, "light_tree_scene.py")
+    with open(script, "w") as f:
+        f.write(LIGHT_TREE_SCENE_SCRIPT.format(num_mesh_lights=num_mesh_lights,
+                                               num_lamps=num_lamps))
+
+    printMessage('SUCCESS', "==========",
+                 "Light tree benchmark, {} mesh lights and {} lamps." .
+                 format(num_mesh_lights, num_lamps))
+
+    try:
+        reference = os.path.join(temp_dir, "reference.exr")
+        render_light_tree_scene(script, False, reference_samples, 1, reference)
+
+        results = []
+        for use_light_tree in (False, True):
+            filepath = os.path.join(temp_dir, "light_tree_{}.exr" . format(int(use_light_tree)))
+            elapsed = render_light_tree_scene(script, use_light_tree, samples, 0, filepath)
+            rms = image_rms_error(reference, filepath)
+            # Inverse of variance times render time, higher is better.
+            efficiency = 1.0 / max(rms * rms * elapsed, 1e-20)
+            results.append(efficiency)
+            printMessage('SUCCESS', 'OK', "{:<10} {:.3f} s, RMS error {:.5f}, efficiency {:.1f}" .
+                         format("tree" if use_light_tree else "no tree", elapsed, rms, efficiency))
+    except (subprocess.CalledProcessError, AttributeError, OSError) as e:
+        if VERBOSE:
+            print(e)
+        printMessage('FAILURE', 'FAILED', "Light tree benchmark")
+        return False
+    finally:
+        for filename in os.listdir(temp_dir):
+            os.remove(os.path.join(temp_dir, filename))
+
+    printMessage('SUCCESS', 'PASSED', "Light tree is {:.2f}x as efficient." .
+                 format(results[1] / results[0]))
+    return True
+
+
+# Hair benchmark, comparing memory use and render time of compact and full
+# precision curve keys on a generated scene with many strands.
+
+HAIR_SCENE_SCRIPT = """
+import bpy
+import sys
+import time
+from math import radians
+
+argv = sys.argv[sys.argv.index("--") + 1:]
+use_compact_keys = argv[0] == "1"
+samples = int(argv[1])
+filepath = argv[2]
+
+scene = bpy.context.scene
+scene.render.engine = 'CYCLES'
+for ob in list(scene.objects):
+    if ob.type not in {{'CAMERA', 'LAMP'}}:
+        bpy.data.objects.remove(ob, do_unlink=True)
+
+scene.camera.location = (0.0, -3.0, 2.0)
+scene.camera.rotation_euler = (radians(60.0), 0.0, 0.0)
+
+# Grid emitting hair, with interpolated children for the rendered strands.
+bpy.ops.mesh.primitive_grid_add(x_subdivisions=50, y_subdivisions=50, radius=1.0)
+emitter = scene.objects.active
+emitter.modifiers.new("Hair", 'PARTICLE_SYSTEM')
+settings = emitter.particle_systems[0].settings
+settings.type = 'HAIR'
+settings.count = {num_parents}
+settings.hair_length = 0.4
+settings.hair_step = {hair_steps}
+settings.render_step = {hair_steps}
+settings.child_type = 'INTERPOLATED'
+settings.rendered_child_count = {num_children}
+settings.roughness_2 = 0.05
+settings.kink = 'CURL'
+settings.kink_amplitude = 0.05
+
+scene.cycles_curves.use_curves = True
+scene.cycles_curves.use_compact_keys = use_compact_keys
+
+scene.render.resolution_x = 320
+scene.render.resolution_y = 180
+scene.render.resolution_percentage = 100
+scene.render.image_settings.file_format = 'OPEN_EXR'
+scene.render.filepath = filepath
+scene.cycles.samples = samples
+
+time_start = time.time()
+bpy.ops.render.render(write_still=True)
+print("BENCHMARK_TIME {{}}".format(time.time() - time_start))
+"""
+
+
+def render_hair_scene(script, use_compact_keys, samples, filepath):
+    command = (
+        BLENDER,
+        "--background",
+        "-noaudio",
+        "--factory-startup",
+        "--python", script,
+        "--",
+        "1" if use_compact_keys else "0",
+        str(samples),
+        filepath,
+        )
+    output = subprocess.check_output(command).decode("utf-8")
+    if VERBOSE:
+        print(output)
+    elapsed = float(re.search(r"BENCHMARK_TIME ([0-9.]+)", output).group(1))
+    # Peak memory reported by Cycles in the last render status line.
+    peak = float(re.findall(r"Mem:[0-9.]+M, Peak:([0-9.]+)M", output)[-1])
+    return elapsed, peak
+
+
+def run_hair_benchmark(temp_dir):
+    num_parents = 10000
+    num_children = 20
+    hair_steps = 5
+    samples = 16
+
+    script = os.path.join(temp_dir, "hair_scene.py")
+    with open(script, "w") as f:
+        f.write(HAIR_SCENE_SCRIPT.format(num_parents=num_parents,
+                                         num_children=num_children,
+                                         hair_steps=hair_steps))
+
+    printMessage('SUCCESS', "==========",
+                 "Hair benchmark, {} strands with {} keys." .
+                 format(num_parents * num_children, hair_steps + 1))
+
+    try:
+        results = []
+        for use_compact_keys in (False, True):
+            filepath = os.path.join(temp_dir, "hair_{}.exr" . format(int(use_compact_keys)))
+            elapsed, peak = render_hair_scene(script, use_compact_keys, samples, filepath)
+            results.append((elapsed, peak))
+            printMessage('SUCCESS', 'OK', "{:<10} {:.3f} s, peak memory {:.2f}M" .
+                         format("compact" if use_compact_keys else "full", elapsed, peak))
+    except (subprocess.CalledProcessError, AttributeError, IndexError, OSError) as e:
+        if VERBOSE:
+            print(e)
+        printMessage('FAILURE', 'FAILED', "Hair benchmark")
+        return False
+    finally:
+        for filename in os.listdir(temp_dir):
+            os.remove(os.path.join(temp_dir, filename))
+
+    printMessage('SUCCESS', 'PASSED', "Compact keys use {:.2f}M less memory, render time {:.2f}x." .
+                 format(results[0][1] - results[1][1], results[1][0] / results[0][0]))
+    return True
+
+
 def create_argparse():
     parser = argparse.ArgumentParser()
     parser.add_argument("-blender", nargs="+")
     parser.add_argument("-testdir", nargs=1)
     parser.add_argument("-idiff", nargs=1)
+    parser.add_argument("-benchmark", action="store_true")
     return parser
 
 
@@ -237,7 +511,7 @@ def main():
         COLORS = COLORS_ANSI
 
     BLENDER = args.blender[0]
-    ROOT = args.testdir[0]
+    ROOT = args.testdir[0] if args.testdir else None
     IDIFF = args.idiff[0]
 
     TEMP = tempfile.mkdtemp()
@@ -248,7 +522,11 @@ def main():
 
     VERBOSE = os.environ.get("BLENDER_VERBOSE") is not None
 
-    ok = run_all_tests(ROOT)
+    if args.benchmark:
+        ok = run_light_tree_benchmark(TEMP)
+        ok = run_hair_benchmark(TEMP) and ok
+    else:
+        ok = run_all_tests(ROOT)
 
     # Cleanup temp files and folders
     if os.path.exists(TEMP_FILE):